@@ -0,0 +1,269 @@
+"""Compression benchmark for pygds.
+
+Run from a built tree (``PYTHONPATH=. python benchmarks/bench_compress.py``).
+Writes synthetic and sample data (2-bit genotypes, sorted positions, float
+dosages and short strings) with each compression method, level and block
+size, and reports the compression ratio, encoding and sequential decoding
+speed (MB/s of uncompressed data) and random-access latency, as CSV or JSON
+so that the results of different builds can be compared.
+
+Examples:
+	python benchmarks/bench_compress.py --quick
+	python benchmarks/bench_compress.py --codec ZIP_RA LZ4_RA --block 64K 1M \\
+		--format json -o result.json
+"""
+
+import argparse
+import csv
+import json
+import os
+import platform
+import shutil
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+import pygds
+
+
+# ---------------------------------------------------------------------------
+# compression methods, matching the coder lists of the pipe managers
+
+LEVELS = {
+	'ZIP': ['min', 'fast', 'def', 'max'],
+	'ZIP_RA': ['min', 'fast', 'def', 'max'],
+	'LZ4': ['min', 'fast', 'hc', 'max'],
+	'LZ4_RA': ['min', 'fast', 'hc', 'max'],
+	'LZMA': ['min', 'fast', 'def', 'max'],
+	'LZMA_RA': ['min', 'fast', 'def', 'max'],
+	'ZSTD': ['min', 'fast', 'def', 'max'],
+	'ZSTD_RA': ['min', 'fast', 'def', 'max'],
+}
+
+# CdRAAlgorithm::TBlockSize, ra16KB .. ra8MB
+RA_BLOCKS = ['16K', '32K', '64K', '128K', '256K', '512K', '1M', '2M', '4M', '8M']
+
+
+def methods(codecs, levels, blocks):
+	"""Yield (codec, level, block, compression string)"""
+	for c in codecs:
+		for lv in levels or LEVELS[c]:
+			if lv not in LEVELS[c]:
+				continue
+			if c.endswith('_RA'):
+				for bk in blocks:
+					yield c, lv, bk, '%s.%s:%s' % (c, lv, bk)
+			else:
+				yield c, lv, '', '%s.%s' % (c, lv)
+
+
+# ---------------------------------------------------------------------------
+# datasets
+
+def _tile(a, nbytes):
+	"""Repeat 'a' along the first axis up to about 'nbytes'"""
+	n = max(1, int(np.ceil(nbytes / max(1, a.nbytes))))
+	return np.concatenate([a] * n, axis=0) if n > 1 else a
+
+
+def datasets(mb, seed):
+	"""Return a list of (name, storage, data)"""
+	rng = np.random.default_rng(seed)
+	nbytes = int(mb * 1024 * 1024)
+	rv = []
+
+	# genotypes of 1000 samples, allele frequencies from a U-shaped spectrum
+	nsamp = 1000
+	nvar = max(1, nbytes // (nsamp // 4))  # 2 bits per genotype
+	af = rng.beta(0.2, 0.8, nvar)[:, None]
+	geno = (rng.random((nvar, nsamp)) < af).astype(np.uint8) + \
+		(rng.random((nvar, nsamp)) < af).astype(np.uint8)
+	rv.append(('genotype', 'bit2', geno))
+
+	# sorted positions with geometric gaps
+	npos = max(1, nbytes // 4)
+	pos = np.cumsum(rng.geometric(1.0 / 300, npos)).astype(np.int32)
+	rv.append(('position', 'int32', pos))
+
+	# dosages around the genotypes with three decimal places
+	nd = max(1, nbytes // 4)
+	g = geno.reshape(-1)[:nd].astype(np.float32)
+	g = np.resize(g, nd)
+	dos = np.clip(g + rng.normal(0, 0.05, nd), 0, 2).round(3).astype(np.float32)
+	rv.append(('dosage', 'float32', dos))
+
+	# short strings: variant IDs and alleles
+	nstr = max(1, nbytes // 12)
+	base = np.array(list('ACGT'))
+	ids = ['rs%d' % i for i in rng.integers(1, 10**8, nstr)]
+	alle = ['%s/%s' % (a, b) for a, b in zip(base[rng.integers(0, 4, nstr)],
+		base[rng.integers(0, 4, nstr)])]
+	rv.append(('variant_id', 'string', ids))
+	rv.append(('allele', 'string', alle))
+
+	# sample data in the bundled example, repeated to the same size
+	f = pygds.gdsfile()
+	f.open(pygds.get_example_path('ceu_exon.gds'))
+	try:
+		r = f.root()
+		g = r.index('genotype/data').read()
+		rv.append(('ceu_genotype', 'bit2', _tile(g, nbytes * 4)))
+		# sorted within each copy, like the positions on several chromosomes
+		p = r.index('position').read()
+		rv.append(('ceu_position', 'int32', _tile(p, nbytes)))
+		a = list(r.index('allele').read())
+		rv.append(('ceu_allele', 'string', a * max(1, nstr // len(a))))
+	finally:
+		f.close()
+
+	return rv
+
+
+# ---------------------------------------------------------------------------
+# measurements
+
+def _best(fun, repeat):
+	tm = float('inf')
+	for _ in range(repeat):
+		t = time.perf_counter()
+		fun()
+		tm = min(tm, time.perf_counter() - t)
+	return tm
+
+
+def random_access(node, nread, seed):
+	"""Latency of small reads at random positions in microseconds"""
+	dm = node.description()['dim']
+	rng = np.random.default_rng(seed)
+	lat = []
+	for i in rng.integers(0, dm[0], nread):
+		st = [int(i)] + [0] * (len(dm) - 1)
+		if len(dm) > 1:
+			cnt = [1] + dm[1:]
+		else:
+			cnt = [min(64, dm[0] - int(i))]
+		t = time.perf_counter()
+		node.read(st, cnt)
+		lat.append((time.perf_counter() - t) * 1e6)
+	return float(np.median(lat)), float(np.percentile(lat, 95))
+
+
+def bench(args):
+	dat = datasets(args.mb, args.seed)
+	if args.dataset:
+		dat = [d for d in dat if d[0] in args.dataset]
+	tmpdir = tempfile.mkdtemp(prefix='pygds_bench_')
+	res = []
+	try:
+		# the uncompressed sizes
+		fn = os.path.join(tmpdir, 'raw.gds')
+		f = pygds.gdsfile(); f.create(fn)
+		try:
+			raw = {}
+			for nm, st, v in dat:
+				raw[nm] = f.root().add(nm, v, storage=st).description()['size']
+		finally:
+			f.close()
+		os.remove(fn)
+
+		for codec, level, block, comp in methods(args.codec, args.level,
+				args.block):
+			fn = os.path.join(tmpdir, 'bench.gds')
+			f = pygds.gdsfile(); f.create(fn)
+			enc = {}
+			try:
+				for nm, st, v in dat:
+					t = time.perf_counter()
+					f.root().add(nm, v, storage=st, compress=comp)
+					enc[nm] = time.perf_counter() - t
+			finally:
+				f.close()
+
+			f = pygds.gdsfile(); f.open(fn)
+			try:
+				for nm, st, v in dat:
+					n = f.root().index(nm)
+					size = n.description()['size']
+					dec = _best(n.read, args.repeat)
+					med, p95 = random_access(n, args.nread, args.seed)
+					mb = raw[nm] / 1e6
+					res.append(dict(dataset=nm, storage=st, codec=codec,
+						level=level, block=block, compress=comp,
+						raw_bytes=int(raw[nm]), comp_bytes=int(size),
+						ratio=round(size / raw[nm], 5),
+						encode_mbps=round(mb / enc[nm], 3),
+						decode_mbps=round(mb / dec, 3),
+						ra_median_us=round(med, 2), ra_p95_us=round(p95, 2)))
+					if args.verbose:
+						r = res[-1]
+						print('%-14s %-20s ratio %.4f  enc %8.1f MB/s  '
+							'dec %8.1f MB/s  ra %8.1f us' % (nm, comp,
+							r['ratio'], r['encode_mbps'], r['decode_mbps'],
+							r['ra_median_us']), file=sys.stderr)
+			finally:
+				f.close()
+			os.remove(fn)
+	finally:
+		shutil.rmtree(tmpdir, ignore_errors=True)
+	return res
+
+
+# ---------------------------------------------------------------------------
+
+def main(argv=None):
+	p = argparse.ArgumentParser(description='Compression benchmark for pygds')
+	p.add_argument('--codec', nargs='+', default=sorted(LEVELS),
+		choices=sorted(LEVELS), help='compression methods')
+	p.add_argument('--level', nargs='+', default=None,
+		help='compression levels (default: all of each method)')
+	p.add_argument('--block', nargs='+', default=RA_BLOCKS,
+		choices=RA_BLOCKS, help='block sizes of the _RA methods')
+	p.add_argument('--dataset', nargs='+', default=None,
+		help='datasets to use (default: all)')
+	p.add_argument('--mb', type=float, default=4,
+		help='approximate size of each dataset in MB (default: 4)')
+	p.add_argument('--repeat', type=int, default=3,
+		help='repeats of sequential decoding, the best is kept')
+	p.add_argument('--nread', type=int, default=200,
+		help='the number of random-access reads')
+	p.add_argument('--seed', type=int, default=1000)
+	p.add_argument('--quick', action='store_true',
+		help='a small run: 1 MB datasets, default levels, 64K and 1M blocks')
+	p.add_argument('--format', choices=['csv', 'json'], default='csv')
+	p.add_argument('-o', '--output', default=None,
+		help='the output file (default: stdout)')
+	p.add_argument('-v', '--verbose', action='store_true',
+		help='print the progress to stderr')
+	args = p.parse_args(argv)
+	if args.quick:
+		args.mb = min(args.mb, 1)
+		args.level = args.level or ['def', 'hc']
+		if args.block == RA_BLOCKS:
+			args.block = ['64K', '1M']
+		args.repeat = 1
+		args.nread = 50
+
+	res = bench(args)
+
+	out = open(args.output, 'w', newline='') if args.output else sys.stdout
+	try:
+		if args.format == 'json':
+			meta = dict(time=time.strftime('%Y-%m-%dT%H:%M:%S'),
+				python=platform.python_version(), machine=platform.machine(),
+				processor=platform.processor(), mb=args.mb,
+				repeat=args.repeat, nread=args.nread, seed=args.seed)
+			json.dump(dict(meta=meta, results=res), out, indent=1)
+			out.write('\n')
+		elif res:
+			w = csv.DictWriter(out, fieldnames=list(res[0]))
+			w.writeheader()
+			w.writerows(res)
+	finally:
+		if out is not sys.stdout:
+			out.close()
+
+
+if __name__ == '__main__':
+	main()
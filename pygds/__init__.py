@@ -2,6 +2,8 @@
 import numpy as np
 # import os
 import os
+# import warnings
+import warnings
 # import c library
 import pygds.ccall as cc
 
@@ -32,6 +34,175 @@ def cleanup_gds(filename, verbose=True):
 	cc.tidy_up(filename, verbose)
 
 
+def set_read_ahead(threads=None, blocks=None):
+	"""Read-ahead of compressed blocks
+
+	Set up the worker threads decoding the blocks of random-access
+	compressed data ('ZIP_RA', 'LZ4_RA', 'LZMA_RA' and 'ZSTD_RA') ahead of a
+	sequential scan. Read-ahead is switched on for a node after two successive blocks
+	are read, and the decoded blocks are buffered in memory.
+
+	Parameters
+	----------
+	threads : int
+		the number of worker threads, 0 for no read-ahead (by default);
+		None to keep the current setting
+	blocks : int
+		the number of blocks decoded ahead, 0 for twice the number of
+		threads; None to keep the current setting
+
+	Returns
+	-------
+	a tuple of the previous settings (threads, blocks)
+	"""
+	return cc.set_read_ahead(-1 if threads is None else int(threads),
+		-1 if blocks is None else int(blocks))
+
+
+def set_parallel_compress(threads=None):
+	"""Parallel compression of blocks
+
+	Set up the worker threads compressing the blocks of random-access
+	compressed data ('ZIP_RA', 'LZ4_RA', 'LZMA_RA' and 'ZSTD_RA') when
+	writing. A block is ended at the uncompressed size given by the block
+	size of the algorithm (e.g., 16K in 'ZIP_RA:16K'), with or without
+	worker threads, so the output is the same bytes for any number of
+	threads, and it can be read by any version of the library supporting
+	random access.
+
+	Parameters
+	----------
+	threads : int
+		the number of worker threads, 0 for serial compression (by default);
+		None to keep the current setting
+
+	Returns
+	-------
+	the previous number of threads
+	"""
+	return cc.set_parallel_compress(-1 if threads is None else int(threads))
+
+
+def set_lzma_threads(threads=None, block_size=None):
+	"""Multithreaded LZMA compression
+
+	Set up the multithreaded xz encoder of liblzma for the LZMA compressed
+	data without random access ('LZMA'). The data are split into xz blocks of
+	'block_size' uncompressed bytes, which are compressed independently by
+	the worker threads, so the output does not depend on the number of
+	threads, and it can be read by any version of the library. The memory
+	usage grows with the number of threads and the block size.
+
+	Parameters
+	----------
+	threads : int
+		the number of worker threads, 0 or 1 for single-threaded compression
+		(by default); None to keep the current setting
+	block_size : int
+		the uncompressed size of an xz block in bytes, 0 for the default of
+		liblzma (three times the dictionary size, e.g., 24MB for 'LZMA');
+		None to keep the current setting
+
+	Returns
+	-------
+	a tuple of the previous settings (threads, block_size)
+	"""
+	return cc.set_lzma_threads(-1 if threads is None else int(threads),
+		-1 if block_size is None else int(block_size))
+
+
+def set_block_cache(size=None):
+	"""Cache of decompressed blocks
+
+	Set the memory budget of the cache of decompressed blocks shared by all
+	GDS files. Random-access compressed data ('ZIP_RA', 'LZ4_RA', 'LZMA_RA'
+	and 'ZSTD_RA') are then decoded block by block, and the least recently used
+	blocks are dropped when exceeding the budget, which avoids decompressing
+	the same block repeatedly, e.g., when reading a column of a compressed
+	matrix stored by rows.
+
+	Parameters
+	----------
+	size : int
+		the memory budget in bytes, 0 to disable and free the cache (by
+		default); None to keep the current setting
+
+	Returns
+	-------
+	the previous memory budget in bytes
+	"""
+	return cc.set_block_cache(-1 if size is None else int(size))
+
+
+def block_cache_info(reset=False):
+	"""Statistics of the cache of decompressed blocks
+
+	Parameters
+	----------
+	reset : bool
+		if True, reset the hit and miss counters after returning them
+
+	Returns
+	-------
+	a dict with 'max_size' (the memory budget), 'size' (the bytes in use),
+	'blocks' (the number of cached blocks), 'hits' and 'misses'
+	"""
+	return cc.block_cache_info(reset)
+
+
+def set_checksum(write=None, verify=None):
+	"""Checksums of compressed blocks
+
+	Set whether the checksum (XXH64) of each uncompressed block is stored
+	with random-access compressed data ('ZIP_RA', 'LZ4_RA', 'LZMA_RA' and
+	'ZSTD_RA'), and whether the decompressed blocks are compared with their
+	checksums when reading, so that corrupted data are reported instead of
+	being returned silently. With checksums, the data can not be read by the
+	versions of the library before the stream format v1.2.
+
+	Parameters
+	----------
+	write : bool
+		if True, store the checksums in the data compressed afterward (False
+		by default); None to keep the current setting
+	verify : bool
+		if True, compare the blocks with their checksums when reading the
+		nodes opened or seeked afterward (False by default); None to keep the
+		current setting
+
+	Returns
+	-------
+	a tuple of the previous settings (write, verify)
+	"""
+	return cc.set_checksum(-1 if write is None else int(bool(write)),
+		-1 if verify is None else int(bool(verify)))
+
+
+def set_mmap(enable=None):
+	"""Memory-mapped files
+
+	Set whether a GDS file opened read-only is mapped into memory, so that
+	the data are copied from the mapping instead of being read by system
+	calls, and uncompressed data are copied to the output array once. The
+	file stream is used if the file can not be mapped.
+
+	A mapped file must not be truncated by another process while it is
+	open: reading the missing pages then terminates the process with
+	SIGBUS, instead of raising an error as the file stream does.
+
+	Parameters
+	----------
+	enable : bool
+		if True, map the files opened afterward (False by default); None to
+		keep the current setting
+
+	Returns
+	-------
+	bool : the previous setting
+	"""
+	return cc.set_mmap(-1 if enable is None else int(bool(enable)))
+
+
 def get_include():
 	"""
 	Return the directory that contains the pygds \\*.h header files.
@@ -113,12 +284,80 @@ def _prepare_value(val):
 	return (arr, list(arr.shape), False)
 
 
+# ---------------------------------------------------------------------------
+# Internal helpers for reading data
+# ---------------------------------------------------------------------------
+
+def _prepare_sel(s, n):
+	"""Normalise the selection of a dimension of length 'n' for the C layer.
+
+	Returns (sel, inv) where sel is None, a slice with a positive step, a bool
+	vector or a sorted vector of unique int64 indices, and inv is None or
+	the inverse indices to reorder the result along that dimension.
+	"""
+	if s is None:
+		return (None, None)
+	if isinstance(s, slice):
+		if s.step is None or s.step > 0:
+			return (s, None)
+		s = np.arange(n())[s]
+	a = np.asarray(s)
+	if a.size == 0:
+		a = a.astype(np.int64)
+	if a.dtype == np.bool_:
+		return (np.ascontiguousarray(a.ravel()), None)
+	if a.dtype.kind not in ('i', 'u'):
+		raise TypeError("The selection should be None, a slice, a bool " \
+			"vector or a vector of integers.")
+	a = a.astype(np.int64).ravel()
+	if a.size and a.min() < 0:
+		a = np.where(a < 0, a + n(), a)
+	if a.size > 1 and np.any(a[1:] <= a[:-1]):
+		a, inv = np.unique(a, return_inverse=True)
+		return (a, inv)
+	return (np.ascontiguousarray(a), None)
+
+
+def _string_dtype(v, out=None):
+	"""Convert a fixed-width 'U' array to NumPy 2 StringDType (cvt='T')"""
+	if not hasattr(np, 'dtypes') or not hasattr(np.dtypes, 'StringDType'):
+		raise ValueError("cvt='T' requires NumPy >= 2.0.")
+	if out is None:
+		return v.astype(np.dtypes.StringDType())
+	np.copyto(out, v, casting='unsafe')
+	return out
+
+
+def codes_to_categorical(codes, levels):
+	"""Convert factor codes and levels to a pandas Categorical
+
+	Parameters
+	----------
+	codes : numpy array
+		the 1-based int32 codes returned by read(cvt='codes'); the codes out
+		of [1, len(levels)] are treated as missing
+	levels : list of str
+
+	Returns
+	-------
+	pandas.Categorical
+	"""
+	import pandas as pd
+	codes = np.asarray(codes)
+	c = codes.astype(np.int64) - 1
+	c[(c < 0) | (c >= len(levels))] = -1
+	return pd.Categorical.from_codes(c.ravel(), categories=levels)
+
+
+
 def apply_gdsn(nodes, margins, fun, *args, as_is='none', **kwargs):
 	"""Apply a function over a margin of one or more array nodes
 
 	Iterate in lock-step over the given margin of each node; for each index,
 	call ``fun(slice0[, slice1, ...], *args, **kwargs)`` where each slice is
-	the corresponding sub-array with its margin axis removed.
+	the corresponding sub-array with its margin axis removed. The data are
+	read block by block, and the slices passed to 'fun' are numpy arrays
+	reused by the next call, so copy a slice if it should be kept.
 
 	Parameters
 	----------
@@ -133,36 +372,20 @@ def apply_gdsn(nodes, margins, fun, *args, as_is='none', **kwargs):
 	-------
 	None, list, or numpy array depending on 'as_is'
 	"""
-	single = isinstance(nodes, gdsnode)
-	if single:
+	if isinstance(nodes, gdsnode):
 		nodes = [nodes]
 		margins = [margins]
 	if len(nodes) != len(margins):
 		raise ValueError("'nodes' and 'margins' must have the same length.")
 
-	dims = [n.description()['dim'] for n in nodes]
-	counts = [dims[k][margins[k]] for k in range(len(nodes))]
-	N = counts[0]
-	if any(c != N for c in counts):
-		raise ValueError("All nodes must have the same length along their margins.")
-
+	it = cc.apply_init_gdsn([(n.idx, n.pid) for n in nodes],
+		[int(m) for m in margins], '', -1)
 	results = []
-	for i in range(N):
-		slices = []
-		for k, n in enumerate(nodes):
-			m = margins[k]
-			dim = dims[k]
-			sel = [None] * len(dim)
-			bv = np.zeros(dim[m], dtype=bool)
-			bv[i] = True
-			sel[m] = bv
-			s = n.readex(sel)
-			s = np.asarray(s)
-			if s.ndim == len(dim) and s.shape[m] == 1:
-				s = np.squeeze(s, axis=m)
-			slices.append(s)
-		r = fun(slices[0], *args, **kwargs) if single \
-			else fun(*slices, *args, **kwargs)
+	while True:
+		slices = cc.apply_next_gdsn(it)
+		if slices is None:
+			break
+		r = fun(*slices, *args, **kwargs)
 		if as_is != 'none':
 			results.append(r)
 
@@ -372,6 +595,118 @@ class gdsfile:
 		return cc.diagnosis_gds(self.fileid)
 
 
+	def verify(self, threads=1):
+		"""Verify the compressed data
+
+		Decompress all blocks of the compressed nodes without returning the
+		data, and compare the blocks with their checksums if stored (see
+		set_checksum()). The compressed data are read in order, and the
+		blocks with random access are decompressed by the worker threads;
+		the data without random access are decompressed entirely and checked
+		by the decoder. The nodes being written are skipped, and the file is
+		not modified.
+
+		Parameters
+		----------
+		threads : int
+			the number of threads for decompression
+
+		Returns
+		-------
+		dict : {nodes, blocks, checksums, skipped, errors} - the numbers of
+		compressed nodes, blocks decompressed (a node without random access
+		counts as one), blocks compared with checksums, and nodes skipped
+		since being written, and a list of errors, each a tuple (node name,
+		block index or -1, message)
+		"""
+		return cc.verify_gds(self.fileid, int(threads))
+
+
+	def recompress(self, filename, compress, threads=1, filter=None):
+		"""Recompress to a new GDS file
+
+		Copy all nodes to a new GDS file, and store the data of selected
+		nodes with a new compression method. The numeric arrays are encoded
+		by the worker threads concurrently, and the new file is written by
+		one thread in the order of nodes; the other selected nodes (e.g.,
+		strings) are recompressed when written. The compressed nodes being
+		written (see gdsnode.readmode()) are not copied, with a warning,
+		since their data can not be read without closing their writers.
+
+		Parameters
+		----------
+		filename : str
+			the file name of the new GDS file
+		compress : str
+			the compression method, e.g., "", "ZIP", "LZ4_RA.fast"
+		threads : int
+			the number of threads for compression
+		filter : callable
+			if None, all nodes with data are recompressed; otherwise called
+			with each gdsnode except folders, and the node is recompressed
+			if it returns True
+
+		Returns
+		-------
+		int : the number of nodes recompressed
+		"""
+		if os.path.exists(filename) and os.path.samefile(filename,
+				self.filename):
+			raise ValueError('The new file should not be the source file.')
+		names = None
+		if filter is not None:
+			names = []
+			def enum(node):
+				for nm in node.ls(True):
+					v = node.index(nm)
+					if v.description()['type'] == 'Folder':
+						enum(v)
+					elif filter(v):
+						names.append(v.name(True))
+			enum(self.root())
+		n, skipped = cc.recompress_gds(self.fileid, filename, compress,
+			int(threads), names)
+		if skipped:
+			warnings.warn('The nodes being written are not copied: ' +
+				', '.join(skipped))
+		return n
+
+
+	def read_many(self, reqs, cvt='', threads=1):
+		"""Read several GDS nodes at once
+
+		The requests are read under one lock of each GDS file, and numeric
+		data are decoded without the GIL: the nodes of the same file in the
+		order of their file offsets, and different files in parallel.
+
+		Parameters
+		----------
+		reqs : a list
+			each item is a gdsnode or a tuple (node, start, count), where
+			'start' and 'count' are the same as in gdsnode.read()
+		cvt : str
+			the same as in gdsnode.read(), applied to all nodes
+		threads : int
+			the number of threads for decoding
+
+		Returns
+		-------
+		a tuple of numpy arrays
+		"""
+		lst = []
+		for r in reqs:
+			if isinstance(r, gdsnode):
+				r = (r,)
+			v, start, count = (tuple(r) + (None, None))[:3]
+			lst.append((v.idx, v.pid,
+				None if start is None else [int(i) for i in start],
+				None if count is None else [int(i) for i in count]))
+		if cvt == 'T':
+			return tuple(_string_dtype(v) for v in
+				cc.read_many_gdsn(lst, 'U', int(threads)))
+		return cc.read_many_gdsn(lst, cvt, int(threads))
+
+
 
 
 
@@ -512,7 +847,7 @@ class gdsnode:
 		return cc.getattr_gdsn(self.idx, self.pid)
 
 
-	def read(self, start=None, count=None, cvt=''):
+	def read(self, start=None, count=None, cvt='', out=None):
 		"""Read data
 
 		Read data field of a GDS node.
@@ -525,33 +860,133 @@ class gdsnode:
 			the length of each dimnension, -1 indicates that all entries along that dimension should be read, starting from 'start'
 		cvt : str
 			'': no conversion; 'int8', 'uint8', 'int16', 'uint16', 'int32', 'uint32', 'int64', 'uint64': signed and unsigned integer;
-			'utf8': UTF-8 string; 'utf16': UTF-16 string
+			'utf8': UTF-8 string; 'utf16': UTF-16 string;
+			'S', 'U': strings or factor levels in a fixed-width numpy 'S'
+			(UTF-8 bytes) or 'U' array without per-element Python objects;
+			'T': NumPy 2 StringDType; 'codes': for a factor, a tuple of the
+			int32 codes (1-based as in R) and the list of levels
+		out : a numpy array, optional
+			a writable C-contiguous array with the dtype and shape of the
+			result (e.g., a view of a larger preallocated array); the data
+			are decoded into it directly and it is returned
 
 		Returns
 		-------
 		a numpy array object
 		"""
-		return cc.read_gdsn(self.idx, self.pid, start, count, cvt)
+		if cvt == 'T':
+			return _string_dtype(cc.read_gdsn(self.idx, self.pid, start, count,
+				'U'), out)
+		return cc.read_gdsn(self.idx, self.pid, start, count, cvt, out)
 
 
-	def readex(self, sel, cvt=''):
+	def readex(self, sel, cvt='', out=None):
 		"""Read data with selection
 
 		Read data field of a GDS node with selection
 
 		Parameters
 		----------
-		sel : a list of bool vectors
-			bool vectors indicating dimension selection, or None for all entries along that dimension
+		sel : a list of selections
+			for each dimension, None (all entries), a bool vector, a vector
+			of integer indices, or a slice; the cost of sorted unique indices
+			and slices scales with the selected range, not the dimension
 		cvt : str
 			'': no conversion; 'int8', 'uint8', 'int16', 'uint16', 'int32', 'uint32', 'int64', 'uint64': signed and unsigned integer;
-			'utf8': UTF-8 string; 'utf16': UTF-16 string
+			'utf8': UTF-8 string; 'utf16': UTF-16 string;
+			'S', 'U': strings or factor levels in a fixed-width numpy 'S'
+			(UTF-8 bytes) or 'U' array without per-element Python objects;
+			'T': NumPy 2 StringDType; 'codes': for a factor, a tuple of the
+			int32 codes (1-based as in R) and the list of levels
+		out : a numpy array, optional
+			a writable C-contiguous array with the dtype and shape of the
+			result, see read(); the integer indices should be sorted and
+			unique if 'out' is given
 
 		Returns
 		-------
 		a numpy array object
 		"""
-		return cc.read2_gdsn(self.idx, self.pid, sel, cvt)
+		dim = []
+		def dimlen(i):
+			if not dim:
+				dim.extend(self.description()['dim'])
+			return lambda: dim[i]
+		sel = [ _prepare_sel(s, dimlen(i)) for i, s in enumerate(sel) ]
+		inv = [ (i, v) for i, (s, v) in enumerate(sel) if v is not None ]
+		if inv and out is not None:
+			raise ValueError("The indices should be sorted and unique if 'out' is given.")
+		sel = [ s for s, _ in sel ]
+		if cvt == 'T':
+			v = cc.read2_gdsn(self.idx, self.pid, sel, 'U')
+		else:
+			v = cc.read2_gdsn(self.idx, self.pid, sel, cvt, out)
+		for i, x in inv:
+			if cvt == 'codes':
+				v = (np.take(v[0], x, axis=i), v[1])
+			else:
+				v = np.take(v, x, axis=i)
+		if cvt == 'T':
+			v = _string_dtype(v, out)
+		return v
+
+
+	def __getitem__(self, key):
+		"""Read data by numpy-style indexing
+
+		Each index is an integer, a slice, a bool vector or a vector of
+		integers, applied to each dimension independently (orthogonal
+		indexing); an Ellipsis expands to all entries of the remaining
+		dimensions, and integer-indexed dimensions are dropped.
+		"""
+		if not isinstance(key, tuple):
+			key = (key,)
+		dim = self.description()['dim']
+		el = [ i for i, k in enumerate(key) if k is Ellipsis ]
+		if len(el) > 1:
+			raise IndexError("An index can only have a single ellipsis.")
+		if el:
+			i = el[0]
+			key = key[:i] + (slice(None),)*(len(dim) - len(key) + 1) + key[i+1:]
+		if len(key) > len(dim):
+			raise IndexError("Too many indices for the GDS node.")
+		sel = []
+		drop = []
+		for i, k in enumerate(key):
+			if isinstance(k, (int, np.integer)):
+				k = int(k)
+				if k < -dim[i] or k >= dim[i]:
+					raise IndexError("Index %d is out of bounds for axis %d." % (k, i))
+				sel.append(np.array([k % dim[i]], dtype=np.int64))
+				drop.append(i)
+			else:
+				sel.append(k)
+		sel.extend([None] * (len(dim) - len(sel)))
+		v = self.readex(sel)
+		if drop:
+			v = np.squeeze(v, axis=tuple(drop))
+			if v.ndim == 0:
+				v = v[()]
+		return v
+
+
+	def read_categorical(self, sel=None):
+		"""Read a factor node as a pandas Categorical
+
+		Parameters
+		----------
+		sel : a list of selections, optional
+			see readex(); if None, read all data
+
+		Returns
+		-------
+		pandas.Categorical (flattened in C order)
+		"""
+		if sel is None:
+			codes, levels = self.read(cvt='codes')
+		else:
+			codes, levels = self.readex(sel, cvt='codes')
+		return codes_to_categorical(codes, levels)
 
 
 	# -------------------------------------------------------------------
@@ -577,7 +1012,15 @@ class gdsnode:
 			'packedreal16', 'fstring'; if '', it is inferred from 'val'
 		compress : str
 			the compression method, e.g. '', 'ZIP', 'ZIP_RA', 'LZMA',
-			'LZMA_RA', 'LZ4', 'LZ4_RA'
+			'LZMA_RA', 'LZ4', 'LZ4_RA', 'ZSTD', 'ZSTD_RA'; the suffix
+			'.shuffle' or '.bitshuffle' (e.g., 'LZ4_RA.shuffle',
+			'ZIP_RA.max.bitshuffle:16K') groups the bytes or bits of numeric
+			elements before compression, and '.delta' stores the differences
+			of adjacent integers (e.g., 'ZIP_RA.delta.shuffle' for sorted
+			positions); the suffixes are ignored for other types; the last
+			suffix '.dict' primes the blocks of 'ZIP_RA' and 'LZ4_RA' with a
+			dictionary sampled from the data (e.g., 'LZ4_RA.dict:16K'),
+			for small blocks of strings
 		valdim : a list of ints, optional
 			reset the dimensions after writing
 		closezip : bool
@@ -716,7 +1159,8 @@ class gdsnode:
 		Parameters
 		----------
 		compress : str
-			the compression method, e.g. '', 'ZIP', 'LZMA_RA', 'LZ4_RA'
+			the compression method, e.g. '', 'ZIP', 'LZMA_RA', 'LZ4_RA',
+			'LZ4_RA.shuffle'
 
 		Returns
 		-------
@@ -841,7 +1285,11 @@ class gdsnode:
 
 
 	def unload(self):
-		"""Unload this node from memory"""
+		"""Unload this node from memory
+
+		The handle of this node is invalidated, and the node is loaded again
+		when it is retrieved from its folder, e.g., by index().
+		"""
 		cc.unload_gdsn(self.idx, self.pid)
 
 
@@ -891,7 +1339,8 @@ class gdsnode:
 
 		Iterate over axis 'margin' (0-based, in numpy C-order), calling
 		``fun(slice, *args, **kwargs)`` for each index, where 'slice' is the
-		sub-array with the margin axis removed.
+		sub-array with the margin axis removed. 'slice' is a numpy array reused
+		by the next call, so copy it if it should be kept.
 
 		Parameters
 		----------
@@ -910,56 +1359,96 @@ class gdsnode:
 		return apply_gdsn(self, margin, fun, *args, as_is=as_is, **kwargs)
 
 
+	def iter_chunks(self, axis=0, size=1024, prefetch=1, cvt=''):
+		"""Iterate over chunks of this array node along an axis
+
+		Yield the sub-arrays of at most 'size' indices along axis 'axis'
+		(0-based, in numpy C-order), in order. For numeric data, a background
+		thread decodes the next 'prefetch' chunks with the GIL released while
+		the current chunk is being processed.
+
+		Parameters
+		----------
+		axis : int
+			the axis to split (0-based)
+		size : int
+			the number of indices along 'axis' in each chunk
+		prefetch : int
+			the number of chunks decoded ahead, 0 for no prefetching
+		cvt : str
+			the conversion as in read()
+
+		Returns
+		-------
+		a generator of numpy arrays; a prefetched numeric chunk is a reused
+		buffer overwritten after the next iteration, so copy it if it should
+		be kept
+		"""
+		if prefetch > 0 and cvt not in ('S', 'U', 'T', 'codes'):
+			it = cc.iter_chunks_init_gdsn(self.idx, self.pid, int(axis),
+				int(size), int(prefetch), cvt)
+			if it is not None:
+				while True:
+					v = cc.iter_chunks_next_gdsn(it)
+					if v is None:
+						return
+					yield v
+		# strings, factors or no prefetching
+		dim = self.description()['dim']
+		if axis < 0 or axis >= len(dim):
+			raise ValueError("'axis' is out of range.")
+		if size < 1:
+			raise ValueError("'size' should be greater than zero.")
+		start = [0] * len(dim)
+		count = [-1] * len(dim)
+		for i in range(0, dim[axis], size):
+			start[axis] = i
+			count[axis] = min(size, dim[axis] - i)
+			yield self.read(start, count, cvt)
+
+
 	def digest(self, algorithm='md5'):
 		"""Compute a hash digest of this node's data
 
 		The digest is computed over the raw element bytes in storage order
 		(little-endian for numeric data; UTF-8 for strings). For plain numeric
-		arrays this matches R gdsfmt's ``digest.gdsn``.
+		arrays this matches R gdsfmt's ``digest.gdsn``. The data are streamed
+		through a bounded buffer, so the node does not need to fit in memory.
 
 		Parameters
 		----------
 		algorithm : str
+			'xxh64' (a fast non-cryptographic checksum computed natively), or
 			a hashlib algorithm name, e.g. 'md5', 'sha1', 'sha256', 'sha512'
 
 		Returns
 		-------
 		str : the hex digest
 		"""
+		if algorithm.lower() == 'xxh64':
+			return cc.digest_gdsn(self.idx, self.pid, None)
 		import hashlib
-		data = self.read()
-		arr = np.asarray(data)
-		if arr.dtype.kind in ('U', 'S', 'O'):
-			flat = arr.ravel(order='C').tolist()
-			b = ''.join('' if x is None else str(x) for x in flat).encode('utf-8')
-		else:
-			b = np.ascontiguousarray(arr).tobytes()
 		h = hashlib.new(algorithm)
-		h.update(b)
+		cc.digest_gdsn(self.idx, self.pid, h)
 		return h.hexdigest()
 
 
-	def summarize(self):
+	def summarize(self, threads=1):
 		"""Summarize the data of this node
 
+		The data are streamed block by block in constant memory; non-finite
+		values are counted as missing.
+
+		Parameters
+		----------
+		threads : int
+			the number of threads used to reduce the decoded blocks
+
 		Returns
 		-------
 		dict : for numeric data {min, max, mean, num_na, n}; otherwise {n}
 		"""
-		d = self.description()
-		data = self.read()
-		arr = np.asarray(data)
-		if d['type'] in ('Integer', 'Factor', 'Logical', 'Real') and \
-				arr.dtype.kind not in ('U', 'S', 'O'):
-			v = arr.astype(float, copy=False)
-			finite = v[np.isfinite(v)]
-			n = int(v.size)
-			if finite.size:
-				return dict(min=float(finite.min()), max=float(finite.max()),
-					mean=float(finite.mean()), num_na=n - int(finite.size), n=n)
-			return dict(min=float('nan'), max=float('nan'), mean=float('nan'),
-				num_na=n, n=n)
-		return dict(n=int(arr.size))
+		return cc.summary_gdsn(self.idx, self.pid, threads)
 
 
 	def show(self, attribute=False, all=False, expand=True):
@@ -146,6 +146,7 @@ extern "C" {
 	#   define PyCapsule_New(p, name, destructor)   (PyCObject_FromVoidPtr(p, destructor))
 	#   define PyCapsule_CheckExact(p)              (PyCObject_Check(p))
 	#   define PyCapsule_GetPointer(capsule, name)  (PyCObject_AsVoidPtr(capsule))
+	#   define PyMemoryView_FromMemory(p, size, flags)  (PyBuffer_FromMemory(p, size))
 
 	#endif
 
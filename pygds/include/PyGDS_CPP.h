@@ -34,6 +34,8 @@
 #include <cstring>
 #include <cstdarg>
 #include <climits>
+#include <algorithm>
+#include <unordered_map>
 
 
 namespace CoreArray
@@ -167,6 +169,153 @@ namespace CoreArray
 		ErrGDSFmt(const std::string &msg) { fMessage = msg; }
 	};
 
+
+	/// release the Python GIL in a scope, and reacquire it when leaving
+	class COREARRAY_DLL_LOCAL CdPyNoGIL
+	{
+	public:
+		CdPyNoGIL(bool Release=true)
+			{ fState = Release ? PyEval_SaveThread() : NULL; }
+		~CdPyNoGIL()
+			{ if (fState) PyEval_RestoreThread(fState); }
+	private:
+		PyThreadState *fState;
+	};
+
+	/// lock the GDS file(s) in a scope
+	/** A thread holding a file lock may wait for the GIL, so the GIL is
+	 *  always released while waiting for a file lock to avoid deadlocks.
+	 *  Multiple locks are acquired in address order.
+	**/
+	class COREARRAY_DLL_LOCAL CdPyFileLock
+	{
+	public:
+		CdPyFileLock() { fMutex[0] = fMutex[1] = NULL; }
+		~CdPyFileLock() { Unlock(); }
+
+		void Lock(CdThreadMutex *m1, CdThreadMutex *m2=NULL)
+		{
+			Unlock();
+			if (m1 == m2) m2 = NULL;
+			if (m1 && m2 && (m2 < m1)) std::swap(m1, m2);
+			fMutex[0] = _lock(m1);
+			fMutex[1] = _lock(m2);
+		}
+		/// lock a list of mutexes ('List' is sorted, and duplicates removed)
+		void Lock(vector<CdThreadMutex*> &List)
+		{
+			Unlock();
+			std::sort(List.begin(), List.end());
+			List.erase(std::unique(List.begin(), List.end()), List.end());
+			for (size_t i=0; i < List.size(); i++)
+				if (List[i]) fList.push_back(_lock(List[i]));
+		}
+		void Unlock()
+		{
+			while (!fList.empty())
+				{ fList.back()->Unlock(); fList.pop_back(); }
+			if (fMutex[1]) { fMutex[1]->Unlock(); fMutex[1] = NULL; }
+			if (fMutex[0]) { fMutex[0]->Unlock(); fMutex[0] = NULL; }
+		}
+
+	private:
+		CdThreadMutex *fMutex[2];
+		vector<CdThreadMutex*> fList;
+		static CdThreadMutex *_lock(CdThreadMutex *m)
+		{
+			if (m && !m->TryLock())
+			{
+				CdPyNoGIL NoGIL;
+				m->Lock();
+			}
+			return m;
+		}
+	};
+
+
+	/// the table of GDS node handles passed to Python
+	/** A handle consists of a slot index (the lower 24 bits) and the
+	 *  generation of the slot (the higher 7 bits), so the handle of a closed
+	 *  or deleted node becomes invalid once its slot is reused. Free slots
+	 *  are kept in a list, and the slots owned by each GDS file are linked
+	 *  together, so no operation scans the whole table.
+	**/
+	class COREARRAY_DLL_LOCAL CdPyObjTable
+	{
+	public:
+		CdPyObjTable();
+
+		/// return the handle of a GDS node, and register it if needed
+		int Add(PdGDSObj Obj, int FileIdx);
+		/// return the GDS node of a handle, or NULL if it is invalid
+		PdGDSObj Get(int Handle) const;
+		/// unregister a GDS node, return false if it is not registered
+		bool Remove(PdGDSObj Obj);
+		/// unregister all GDS nodes owned by a GDS file
+		void RemoveFile(int FileIdx);
+		/// get the registered GDS nodes owned by a GDS file
+		void GetFileObjs(int FileIdx, vector<PdGDSObj> &Out) const;
+		/// unregister all GDS nodes
+		void Clear();
+
+	private:
+		struct TSlot
+		{
+			PdGDSObj Obj;  ///< the GDS node, NULL for a free slot
+			int File;      ///< the owner file index
+			int Prev;      ///< the previous slot of the same file
+			int Next;      ///< the next slot of the same file or free slot
+			C_UInt8 Gen;   ///< the generation
+		};
+		vector<TSlot> fSlot;
+		std::unordered_map<PdGDSObj, int> fMap;  ///< GDS node -> slot index
+		int fFree;                ///< the first free slot, or -1
+		/// the first slot of each file (the last one for the nodes without file)
+		int fFileHead[PKG_MAX_NUM_GDS_FILES + 1];
+
+		void unlink(int slot);
+	};
+
+
+	/// the mode of converting strings and factors when reading
+	enum TPyReadMode
+	{
+		prmDefault = 0,    ///< a numpy object array of Python strings
+		prmFixedBytes,     ///< a numpy fixed-width 'S' array (UTF-8 bytes)
+		prmFixedUnicode,   ///< a numpy fixed-width 'U' array
+		prmFactorCodes     ///< a tuple of int32 factor codes and levels
+	};
+
+
+	/// read an array-oriented object margin by margin into a numpy buffer
+	/** The same numpy object is returned by each call of Read(), and
+	 *  its content is overwritten by the next call.
+	**/
+	class COREARRAY_DLL_LOCAL CdPyArrayRead
+	{
+	public:
+		CdPyArrayRead();
+		~CdPyArrayRead();
+
+		/// initialize, and create the numpy buffer (requiring the GIL)
+		void Init(CdAbstractArray &vObj, int vMargin, C_SVType vSV);
+		/// read the next slice into the numpy buffer, the caller should
+		/// hold the file lock and the GIL (released when decoding)
+		PyObject *Read();
+
+		/// the underlying margin reader
+		COREARRAY_INLINE CdArrayRead &Reader() { return fReader; }
+		/// the numpy buffer (borrowed reference)
+		COREARRAY_INLINE PyObject *Buffer() { return fBuffer; }
+
+	private:
+		CdArrayRead fReader;
+		PyObject *fBuffer;   ///< the numpy buffer
+		PyObject *fLevels;   ///< factor levels if it is a factor
+		vector<C_Int32> fCodes;       ///< factor codes
+		vector<UTF8String> fStrings;  ///< strings
+	};
+
 	#endif  // COREARRAY_PYGDS_PACKAGE
 	// ]] ********
 
@@ -69,6 +69,34 @@ lz4_fnlst = [ os.path.join('src', 'LZ4', fn) for fn in [
 	'lz4frame.c',
 	'xxhash.c' ] ]
 
+zstd_fnlst = [ os.path.join('src', 'ZSTD', fn) for fn in [
+	os.path.join('common', 'debug.c'),
+	os.path.join('common', 'entropy_common.c'),
+	os.path.join('common', 'error_private.c'),
+	os.path.join('common', 'fse_decompress.c'),
+	os.path.join('common', 'pool.c'),
+	os.path.join('common', 'threading.c'),
+	os.path.join('common', 'xxhash.c'),
+	os.path.join('common', 'zstd_common.c'),
+	os.path.join('compress', 'fse_compress.c'),
+	os.path.join('compress', 'hist.c'),
+	os.path.join('compress', 'huf_compress.c'),
+	os.path.join('compress', 'zstd_compress.c'),
+	os.path.join('compress', 'zstd_compress_literals.c'),
+	os.path.join('compress', 'zstd_compress_sequences.c'),
+	os.path.join('compress', 'zstd_compress_superblock.c'),
+	os.path.join('compress', 'zstd_double_fast.c'),
+	os.path.join('compress', 'zstd_fast.c'),
+	os.path.join('compress', 'zstd_lazy.c'),
+	os.path.join('compress', 'zstd_ldm.c'),
+	os.path.join('compress', 'zstd_opt.c'),
+	os.path.join('compress', 'zstd_preSplit.c'),
+	os.path.join('compress', 'zstdmt_compress.c'),
+	os.path.join('decompress', 'huf_decompress.c'),
+	os.path.join('decompress', 'zstd_ddict.c'),
+	os.path.join('decompress', 'zstd_decompress.c'),
+	os.path.join('decompress', 'zstd_decompress_block.c') ] ]
+
 pygds_fnlst = [ os.path.join('src', fn) for fn in [
 	'PyCoreArray.cpp',
 	'pygds.cpp' ] ]
@@ -110,7 +138,7 @@ for l in lzma_lib:
 
 ext = Extension(
 	'pygds.ccall',
-	corearray_fnlst + zlib_fnlst + lz4_fnlst + pygds_fnlst,
+	corearray_fnlst + zlib_fnlst + lz4_fnlst + zstd_fnlst + pygds_fnlst,
 	include_dirs = [ 'pygds/include', 'src/CoreArray', numpy.get_include() ] + lzma_inc,
 	library_dirs = lzma_lib,
 	define_macros = [
@@ -118,6 +146,8 @@ ext = Extension(
 		('_FILE_OFFSET_BITS', 64),
 		# XZ/LZMA via the system liblzma (external-lib mode); LZ4 bundled in src/LZ4
 		('COREARRAY_USE_LZMA_EXT', None),
+		# zstd bundled in src/ZSTD, without the x86-64 assembly decoder
+		('ZSTD_DISABLE_ASM', None),
 		('NPY_NO_DEPRECATED_API', 'NPY_1_7_API_VERSION'),
 	],
 	libraries = [ 'lzma' ],
@@ -380,6 +380,11 @@ SIZE64 CdStream::GetSize()
 	return rv;
 }
 
+const void *CdStream::ReadPtr(SIZE64 Pos, ssize_t &Count)
+{
+	return NULL;
+}
+
 SIZE64 CdStream::Position()
 {
 	return Seek(0, soCurrent);
@@ -569,6 +574,21 @@ void CdBufStream::FlushWrite()
 void CdBufStream::ReadData(void *Buf, ssize_t Count)
 {
 	ssize_t ori_cnt = Count;
+	if ((Count > 0) && !_BufWriteFlag &&
+		((_Position<_BufStart) || (_Position>=_BufEnd)))
+	{
+		// copy from the stream directly if it can be accessed in memory
+		ssize_t L = Count;
+		const void *s;
+		while (((s = _Stream->ReadPtr(_Position, L)) != NULL) && (L > 0))
+		{
+			memcpy(Buf, s, L);
+			_Position += L; Count -= L;
+			if (Count <= 0) return;
+			Buf = (C_UInt8*)Buf + L;
+			L = Count;
+		}
+	}
 	if (Count > 0)
 	{
 		// check in range
@@ -595,12 +615,33 @@ void CdBufStream::ReadData(void *Buf, ssize_t Count)
 				FlushBuffer();
 				_BufStart = _BufEnd;
 				_Stream->SetPosition(_BufStart);
+				if ((Count >= _BufSize) &&
+					!(_Position & ((1 << BufStreamAlign) - 1)))
+				{
+					// large read, bypass the buffer and keep the position
+					// aligned to avoid seeking backward on the next read
+					L = (Count >> BufStreamAlign) << BufStreamAlign;
+					_Stream->ReadData(p, L);
+					_Position += L; p += L; Count -= L;
+					_BufStart = _BufEnd = _Position;
+					if (Count <= 0) break;
+				}
 				_BufEnd = _BufStart + _Stream->Read(_Buffer, _BufSize);
 			}
 		} while (Count > 0);
 	}
 }
 
+const void *CdBufStream::ReadPtr(ssize_t Count)
+{
+	if ((Count <= 0) || _BufWriteFlag) return NULL;
+	ssize_t L = Count;
+	const void *s = _Stream->ReadPtr(_Position, L);
+	if (!s || (L < Count)) return NULL;
+	_Position += Count;
+	return s;
+}
+
 C_UInt8 CdBufStream::R8b()
 {
 	// Check in Range
@@ -586,6 +586,10 @@ namespace CoreArray
 		virtual SIZE64 GetSize();
 		/// set or terminate the size of stream
 		virtual void SetSize(SIZE64 NewSize) = 0;
+		/// return a pointer to the data at Pos which can be read without
+		/// copying and reduce Count to the contiguous bytes, or NULL if not
+		/// supported (e.g., a memory-mapped file)
+		virtual const void *ReadPtr(SIZE64 Pos, ssize_t &Count);
 
 		/// return the current position
 		SIZE64 Position();
@@ -702,6 +706,10 @@ namespace CoreArray
 
 		/// Read block of data, or throw an exception if fail
 		void ReadData(void *Buffer, ssize_t Count);
+		/// Return a pointer to Count bytes at the current position and move
+		/// forward if they can be read from the stream without copying (e.g.,
+		/// an uncompressed block stream of a memory-mapped file), or NULL
+		const void *ReadPtr(ssize_t Count);
 		/// Read a 8-bit integer with native endianness
 		C_UInt8 R8b();
 		/// Read a 16-bit integer with native endianness
@@ -27,6 +27,7 @@
 
 #include "dFile.h"
 #include <algorithm>
+#include <atomic>
 #include <cerrno>   // ENOENT
 #include <map>
 
@@ -314,12 +315,10 @@ UTF8String CdGDSObj::Name() const
 {
 	if (fFolder)
 	{
-		vector<CdGDSFolder::TNode>::const_iterator it;
-		for (it = fFolder->fList.begin(); it != fFolder->fList.end(); it++)
-		{
-			if (it->Obj == this)
-				return it->Name;
-		}
+		vector<CdGDSFolder::TNode>::const_iterator it =
+			fFolder->FindObj(this);
+		if (it != fFolder->fList.end())
+			return it->Name;
 	}
 	throw ErrGDSObj(ERR_NO_NAME);
 }
@@ -351,6 +350,22 @@ void CdGDSObj::SetName(const UTF8String &NewName)
 			{
 				if (fFolder->_HasName(NewName))
 					throw ErrGDSObj(ERR_DUP_NAME);
+				if (fFolder->fIndexValid)
+				{
+					int i = it - fFolder->fList.begin();
+					unordered_map<UTF8String, int>::iterator p =
+						fFolder->fNameIndex.find(it->Name);
+					if ((p != fFolder->fNameIndex.end()) && (p->second == i))
+					{
+						// another child may have the same name
+						if (fFolder->fDupName)
+							fFolder->fIndexValid = false;
+						else
+							fFolder->fNameIndex.erase(p);
+					}
+					if (fFolder->fIndexValid)
+						fFolder->fNameIndex[NewName] = i;
+				}
 				it->Name = NewName;
 				fFolder->fChanged = true;
 			}
@@ -418,7 +433,8 @@ void CdGDSObj::MoveTo(CdGDSFolder &folder)
 				if (folder._HasName(it->Name))
 					throw ErrGDSObj(ERR_DUP_NAME);
 				folder.fList.push_back(*it);
-				fFolder->fList.erase(it);
+				folder._IndexAppend();
+				fFolder->_IndexErase(it - fFolder->fList.begin());
 				fFolder->fChanged = folder.fChanged = true;
 				fFolder = &folder;
 			}
@@ -644,6 +660,92 @@ namespace CoreArray
 	};
 
 
+	/// The pipe for writing data to a compressed stream primed with a
+	/// dictionary, which is trained from the data if 'vDict' is empty
+	template<typename CLASS, typename BSIZE>
+		class COREARRAY_DLL_DEFAULT CdDictWritePipe:
+		public CdWritePipe2<CLASS, BSIZE>
+	{
+	public:
+		CdDictWritePipe(CdRecodeStream::TLevel vLevel, BSIZE bs,
+				TdCompressRemainder &vRemainder, vector<C_UInt8> &vDict):
+			CdWritePipe2<CLASS, BSIZE>(vLevel, bs, vRemainder), fDict(vDict)
+			{ }
+
+	protected:
+		vector<C_UInt8> &fDict;
+
+		virtual CdStream *InitPipe(CdBufStream *BufStream)
+		{
+			CdStream *rv = CdWritePipe2<CLASS, BSIZE>::InitPipe(BufStream);
+			this->fPStream->SetDict(fDict);
+			return rv;
+		}
+	};
+
+	/// The pipe for reading a compressed stream primed with a dictionary
+	template<typename CLASS>
+		class COREARRAY_DLL_DEFAULT CdDictReadPipe: public CdStreamPipe
+	{
+	public:
+		CdDictReadPipe(const vector<C_UInt8> &vDict): CdStreamPipe(),
+			fDict(vDict) { fStream = NULL; fPStream = NULL; }
+
+	protected:
+		const vector<C_UInt8> &fDict;
+		CdStream *fStream;
+		CLASS *fPStream;
+
+		virtual CdStream *InitPipe(CdBufStream *BufStream)
+		{
+			fStream = BufStream->Stream();
+			fPStream = new CLASS(*fStream);
+			fPStream->SetDict(fDict);
+			return fPStream;
+		}
+		virtual CdStream *FreePipe()
+		{
+			if (fPStream) { fPStream->Release(); fPStream = NULL; }
+			return fStream;
+		}
+	};
+
+
+	/// The pipe for the shuffle filter
+	template<typename CLASS>
+		class COREARRAY_DLL_DEFAULT CdShufflePipe: public CdStreamPipe
+	{
+	public:
+		CdShufflePipe(CdShuffleStream::TMode vMode, int vElmSize):
+			CdStreamPipe()
+		{
+			fMode = vMode; fElmSize = vElmSize;
+			fStream = NULL; fPStream = NULL;
+		}
+
+	protected:
+		CdStream *fStream;
+		CLASS *fPStream;
+		CdShuffleStream::TMode fMode;
+		int fElmSize;
+
+		virtual CdStream *InitPipe(CdBufStream *BufStream)
+		{
+			fStream = BufStream->Stream();
+			fPStream = new CLASS(*fStream, fMode, fElmSize);
+			return fPStream;
+		}
+		virtual CdStream *FreePipe()
+		{
+			if (fPStream) { fPStream->Release(); fPStream = NULL; }
+			return fStream;
+		}
+	};
+
+	typedef CdShufflePipe<CdShuffleDecoder> CdShuffleReadPipe;
+	typedef CdShufflePipe<CdShuffleEncoder> CdShuffleWritePipe;
+
+
 	/// The pipe system with a template
 	template<int MaxBVal, int DefBVal, typename BSIZE,
 		typename CLASS, typename TYPE>
@@ -667,22 +769,31 @@ namespace CoreArray
 			rv->fParamIndex = fParamIndex;
 			rv->fLevel = fLevel;
 			rv->fBlockSize = fBlockSize;
+			rv->fShuffle = fShuffle;
+			rv->fShuffleSize = fShuffleSize;
+			// the same dictionary, so the compressed blocks can be copied
+			rv->fUseDict = fUseDict;
+			rv->fDict = fDict;
 			return rv;
 		}
 
 		virtual void PopPipe(CdBufStream &buf)
 		{
+			if (buf.Stream() != CoderStream(buf))
+				buf.PopPipe();  // the shuffle filter
 			buf.PopPipe();
 		}
 
 		virtual bool WriteMode(CdBufStream &buf) const
 		{
-			return (dynamic_cast<CLASS*>(buf.Stream()) != NULL);
+			return (dynamic_cast<CLASS*>(CoderStream(buf)) != NULL);
 		}
 
 		virtual void ClosePipe(CdBufStream &buf)
 		{
-			CLASS *s = dynamic_cast<CLASS*>(buf.Stream());
+			CdShuffleEncoder *f = dynamic_cast<CdShuffleEncoder*>(buf.Stream());
+			if (f) f->Close();
+			CLASS *s = dynamic_cast<CLASS*>(CoderStream(buf));
 			if (s) s->Close();
         }
 
@@ -691,10 +802,12 @@ namespace CoreArray
 			SIZE64 in, out;
 			if (buf)
 			{
-				CLASS *s = dynamic_cast<CLASS*>(buf->Stream());
+				CLASS *s = dynamic_cast<CLASS*>(CoderStream(*buf));
 				if (s)
 				{
-					in = s->TotalIn();
+					CdShuffleEncoder *f =
+						dynamic_cast<CdShuffleEncoder*>(buf->Stream());
+					in = f ? f->TotalIn() : s->TotalIn();
 					out = s->TotalOut() + (s->HaveClosed() ? 0 : s->Pending());
 				} else
 					return false;
@@ -821,9 +934,9 @@ namespace CoreArray
 			{ return "ZIP"; }
 		virtual const char *Description() const
 			{ return "zlib_" ZLIB_VERSION; }
-		virtual void PushReadPipe(CdBufStream &buf)
+		virtual void PushCoderReadPipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdZIPReadPipe); }
-		virtual void PushWritePipe(CdBufStream &buf)
+		virtual void PushCoderWritePipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdZIPWritePipe(fLevel, fRemainder)); }
 
 	protected:
@@ -838,6 +951,9 @@ namespace CoreArray
 
 	typedef CdStreamPipe2<CdZDecoder_RA> CdZRAReadPipe;
 	typedef CdWritePipe2<CdZEncoder_RA, CdRAAlgorithm::TBlockSize> CdZRAWritePipe;
+	typedef CdDictReadPipe<CdZDecoder_RA> CdZRADictReadPipe;
+	typedef CdDictWritePipe<CdZEncoder_RA, CdRAAlgorithm::TBlockSize>
+		CdZRADictWritePipe;
 
 	static const char *ZRA_Strings[] =
 	{
@@ -854,14 +970,27 @@ namespace CoreArray
 			{ return "ZIP_ra"; }
 		virtual const char *Description() const
 			{ return "zlib_" ZLIB_VERSION " (random access)"; }
-		virtual void PushReadPipe(CdBufStream &buf)
-			{ buf.PushPipe(new CdZRAReadPipe); }
-		virtual void PushWritePipe(CdBufStream &buf)
-			{ buf.PushPipe(new CdZRAWritePipe(fLevel, fBlockSize, fRemainder)); }
+		virtual void PushCoderReadPipe(CdBufStream &buf)
+		{
+			if (fUseDict)
+				buf.PushPipe(new CdZRADictReadPipe(fDict));
+			else
+				buf.PushPipe(new CdZRAReadPipe);
+		}
+		virtual void PushCoderWritePipe(CdBufStream &buf)
+		{
+			if (fUseDict)
+			{
+				buf.PushPipe(new CdZRADictWritePipe(fLevel, fBlockSize,
+					fRemainder, fDict));
+			} else
+				buf.PushPipe(new CdZRAWritePipe(fLevel, fBlockSize, fRemainder));
+		}
 
 	protected:
 		virtual const char **CoderList() const { return ZRA_Strings; }
 		virtual const char **ParamList() const { return RA_Str_BSize; }
+		virtual bool DictSupported() const { return true; }
 	};
 
 
@@ -896,9 +1025,9 @@ namespace CoreArray
 			LZ4_TEXT[9] = '0' + LZ4_VERSION_RELEASE;
 			return LZ4_TEXT;
 		}
-		virtual void PushReadPipe(CdBufStream &buf)
+		virtual void PushCoderReadPipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdLZ4ReadPipe); }
-		virtual void PushWritePipe(CdBufStream &buf)
+		virtual void PushCoderWritePipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdLZ4WritePipe(fLevel, fBlockSize, fRemainder)); }
 
 	protected:
@@ -913,6 +1042,9 @@ namespace CoreArray
 
 	typedef CdStreamPipe2<CdLZ4Decoder_RA> CdLZ4RAReadPipe;
 	typedef CdWritePipe2<CdLZ4Encoder_RA, CdRAAlgorithm::TBlockSize> CdLZ4RAWritePipe;
+	typedef CdDictReadPipe<CdLZ4Decoder_RA> CdLZ4RADictReadPipe;
+	typedef CdDictWritePipe<CdLZ4Encoder_RA, CdRAAlgorithm::TBlockSize>
+		CdLZ4RADictWritePipe;
 
 	static const char *LZ4RA_Strings[] =
 	{
@@ -935,14 +1067,29 @@ namespace CoreArray
 			LZ4_TEXT[9] = '0' + LZ4_VERSION_RELEASE;
 			return LZ4_TEXT;
 		}
-		virtual void PushReadPipe(CdBufStream &buf)
-			{ buf.PushPipe(new CdLZ4RAReadPipe); }
-		virtual void PushWritePipe(CdBufStream &buf)
-			{ buf.PushPipe(new CdLZ4RAWritePipe(fLevel, fBlockSize, fRemainder)); }
+		virtual void PushCoderReadPipe(CdBufStream &buf)
+		{
+			if (fUseDict)
+				buf.PushPipe(new CdLZ4RADictReadPipe(fDict));
+			else
+				buf.PushPipe(new CdLZ4RAReadPipe);
+		}
+		virtual void PushCoderWritePipe(CdBufStream &buf)
+		{
+			if (fUseDict)
+			{
+				buf.PushPipe(new CdLZ4RADictWritePipe(fLevel, fBlockSize,
+					fRemainder, fDict));
+			} else
+				buf.PushPipe(new CdLZ4RAWritePipe(fLevel, fBlockSize, fRemainder));
+		}
 
 	protected:
 		virtual const char **CoderList() const { return LZ4RA_Strings; }
 		virtual const char **ParamList() const { return RA_Str_BSize; }
+		/// no dictionary without compression
+		virtual bool DictSupported() const
+			{ return fLevel != CdRecodeStream::clMin; }
 	};
 
 #endif
@@ -971,9 +1118,9 @@ namespace CoreArray
 			{ return "LZMA"; }
 		virtual const char *Description() const
 			{ return "xz_" LZMA_VERSION_STRING; }
-		virtual void PushReadPipe(CdBufStream &buf)
+		virtual void PushCoderReadPipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdXZReadPipe); }
-		virtual void PushWritePipe(CdBufStream &buf)
+		virtual void PushCoderWritePipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdXZWritePipe(fLevel, fRemainder)); }
 
 	protected:
@@ -1004,9 +1151,9 @@ namespace CoreArray
 			{ return "LZMA_ra"; }
 		virtual const char *Description() const
 			{ return "xz_" LZMA_VERSION_STRING " (random access)"; }
-		virtual void PushReadPipe(CdBufStream &buf)
+		virtual void PushCoderReadPipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdXZReadPipe_RA); }
-		virtual void PushWritePipe(CdBufStream &buf)
+		virtual void PushCoderWritePipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdXZWritePipe_RA(fLevel, fBlockSize, fRemainder)); }
 
 	protected:
@@ -1014,6 +1161,75 @@ namespace CoreArray
 		virtual const char **ParamList() const { return RA_Str_BSize; }
 	};
 
+#endif
+
+
+	// =====================================================================
+	// ZSTD: Zstandard stream
+	// =====================================================================
+
+#ifndef COREARRAY_NO_ZSTD
+
+	typedef CdStreamPipe2<CdZstdDecoder> CdZstdReadPipe;
+	typedef CdWritePipe<CdZstdEncoder> CdZstdWritePipe;
+
+	static const char *ZSTD_Strings[] =
+	{
+		"ZSTD.min", "ZSTD.fast", "ZSTD.def", "ZSTD.max",
+		"ZSTD.ultra", "ZSTD.ultra_max", "ZSTD", NULL
+	};
+
+	class COREARRAY_DLL_DEFAULT CdPipeZstd:
+		public CdPipe<0, -1, int, CdZstdEncoder, CdPipeZstd>
+	{
+	public:
+		virtual const char *Coder() const
+			{ return "ZSTD"; }
+		virtual const char *Description() const
+			{ return "zstd_v" ZSTD_VERSION_STRING; }
+		virtual void PushCoderReadPipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdReadPipe); }
+		virtual void PushCoderWritePipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdWritePipe(fLevel, fRemainder)); }
+
+	protected:
+		virtual const char **CoderList() const { return ZSTD_Strings; }
+		virtual const char **ParamList() const { return NULL; }
+	};
+
+
+	// =====================================================================
+	// ZSTD_RA: Zstandard Pipe with the support of random access
+	// =====================================================================
+
+	typedef CdStreamPipe2<CdZstdDecoder_RA> CdZstdReadPipe_RA;
+	typedef CdWritePipe2<CdZstdEncoder_RA, CdRAAlgorithm::TBlockSize> CdZstdWritePipe_RA;
+
+	static const char *ZSTD_RA_Strings[] =
+	{
+		"ZSTD_RA.min", "ZSTD_RA.fast", "ZSTD_RA.def", "ZSTD_RA.max",
+		"ZSTD_RA.ultra", "ZSTD_RA.ultra_max", "ZSTD_RA", NULL
+	};
+
+	class COREARRAY_DLL_DEFAULT CdPipeZstd_RA:
+		public CdPipe<CdRAAlgorithm::raLast, CdRAAlgorithm::raDefault,
+		CdRAAlgorithm::TBlockSize, CdZstdEncoder_RA, CdPipeZstd_RA>
+	{
+	public:
+		virtual const char *Coder() const
+			{ return "ZSTD_ra"; }
+		virtual const char *Description() const
+			{ return "zstd_v" ZSTD_VERSION_STRING " (random access)"; }
+		virtual void PushCoderReadPipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdReadPipe_RA); }
+		virtual void PushCoderWritePipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdWritePipe_RA(fLevel, fBlockSize, fRemainder)); }
+
+	protected:
+		virtual const char **CoderList() const { return ZSTD_RA_Strings; }
+		virtual const char **ParamList() const { return RA_Str_BSize; }
+	};
+
 #endif
 
 }
@@ -1029,10 +1245,59 @@ CdPipeMgrItem::CdPipeMgrItem(): CdAbstractItem()
 {
 	fOwner = NULL;
 	fStreamTotalIn = fStreamTotalOut = -1;
+	fShuffle = CdShuffleStream::smNone;
+	fShuffleSize = 0;
+	fUseDict = false;
+	fDictStream = NULL;
 }
 
 CdPipeMgrItem::~CdPipeMgrItem() {}
 
+/// the suffixes of filters in the mode string
+static const char *SUFFIX_DELTA = ".delta";
+static const char *SUFFIX_SHUFFLE = ".shuffle";
+static const char *SUFFIX_BITSHUFFLE = ".bitshuffle";
+static const char *SUFFIX_DICT = ".dict";
+
+/// the suffix of a filter mode, the delta filter precedes the shuffle
+static string ShuffleSuffix(CdShuffleStream::TMode Mode)
+{
+	string s;
+	if (Mode & CdShuffleStream::smDelta)
+		s.append(SUFFIX_DELTA);
+	if (Mode & CdShuffleStream::smBit)
+		s.append(SUFFIX_BITSHUFFLE);
+	else if (Mode & CdShuffleStream::smByte)
+		s.append(SUFFIX_SHUFFLE);
+	return s;
+}
+
+string CdPipeMgrItem::StreamCoder() const
+{
+	return string(Coder()) + ShuffleSuffix(fShuffle) +
+		(fUseDict ? SUFFIX_DICT : "");
+}
+
+void CdPipeMgrItem::PushReadPipe(CdBufStream &buf)
+{
+	PushCoderReadPipe(buf);
+	if (fShuffle != CdShuffleStream::smNone)
+		buf.PushPipe(new CdShuffleReadPipe(fShuffle, fShuffleSize));
+}
+
+void CdPipeMgrItem::PushWritePipe(CdBufStream &buf)
+{
+	PushCoderWritePipe(buf);
+	if (fShuffle != CdShuffleStream::smNone)
+		buf.PushPipe(new CdShuffleWritePipe(fShuffle, fShuffleSize));
+}
+
+CdStream *CdPipeMgrItem::CoderStream(CdBufStream &buf)
+{
+	CdShuffleStream *s = dynamic_cast<CdShuffleStream*>(buf.Stream());
+	return s ? &s->Stream() : buf.Stream();
+}
+
 void CdPipeMgrItem::UpdateStreamSize()
 {
 	if (fOwner)
@@ -1056,6 +1321,71 @@ bool CdPipeMgrItem::EqualText(const char *s1, const char *s2)
 	return true;
 }
 
+CdShuffleStream::TMode CdPipeMgrItem::ParseShuffle(const char *Mode,
+	string &Coder)
+{
+	// in the reverse order of mode string, and only one shuffle filter
+	static const char *Suffix[3] =
+		{ SUFFIX_BITSHUFFLE, SUFFIX_SHUFFLE, SUFFIX_DELTA };
+	static const int Flag[3] =
+		{ CdShuffleStream::smBit, CdShuffleStream::smByte,
+		  CdShuffleStream::smDelta };
+
+	Coder = Mode;
+	size_t pos = Coder.find(':');
+	if (pos == string::npos) pos = Coder.size();
+	int rv = CdShuffleStream::smNone;
+	for (int i=0; i < 3; i++)
+	{
+		if ((i == 1) && (rv & CdShuffleStream::smBit)) continue;
+		size_t n = strlen(Suffix[i]);
+		if ((pos > n) && EqualText(Coder.substr(pos-n, n).c_str(), Suffix[i]))
+		{
+			Coder.erase(pos-n, n);
+			pos -= n;
+			rv |= Flag[i];
+		}
+	}
+	return (CdShuffleStream::TMode)rv;
+}
+
+bool CdPipeMgrItem::ParseDict(const char *Mode, string &Coder)
+{
+	// the outermost suffix, following the filters
+	Coder = Mode;
+	size_t pos = Coder.find(':');
+	if (pos == string::npos) pos = Coder.size();
+	size_t n = strlen(SUFFIX_DICT);
+	if ((pos > n) && EqualText(Coder.substr(pos-n, n).c_str(), SUFFIX_DICT))
+	{
+		Coder.erase(pos-n, n);
+		return true;
+	}
+	return false;
+}
+
+CdShuffleStream::TMode CdPipeMgrItem::ValidShuffle(CdGDSObjPipe &Obj,
+	CdShuffleStream::TMode Mode, int &ElmSize)
+{
+	ElmSize = (Mode != CdShuffleStream::smNone) ? Obj.ShuffleElmSize(Mode) : 0;
+	// keep the shuffle filter if the delta filter is not applicable
+	if ((ElmSize <= 0) && (Mode & CdShuffleStream::smDelta))
+	{
+		Mode = (CdShuffleStream::TMode)(Mode & ~CdShuffleStream::smDelta);
+		ElmSize = (Mode != CdShuffleStream::smNone) ?
+			Obj.ShuffleElmSize(Mode) : 0;
+	}
+	// byte shuffle is meaningless for single-byte elements
+	if (ElmSize == 1)
+		Mode = (CdShuffleStream::TMode)(Mode & ~CdShuffleStream::smByte);
+	if ((ElmSize <= 0) || (ElmSize > 255) || (Mode == CdShuffleStream::smNone))
+	{
+		ElmSize = 0;
+		return CdShuffleStream::smNone;
+	}
+	return Mode;
+}
+
 
 // CdPipeMgrItem2
 
@@ -1100,11 +1430,17 @@ string CdPipeMgrItem2::ExtOptString() const
 
 bool CdPipeMgrItem2::Equal(const char *Mode) const
 {
-	int ic, ip;
-	ParseMode(Mode, ic, ip);
+	string s, s1;
+	bool dict = ParseDict(Mode, s1);
+	CdShuffleStream::TMode sh = ParseShuffle(s1.c_str(), s);
+	int ic, ip, sz;
+	if (fOwner) sh = ValidShuffle(*fOwner, sh, sz);
+	ParseMode(s.c_str(), ic, ip);
 	if (fCoderIndex >= 0)
-		return (fCoderIndex == ic) && (fParamIndex == ip);
-	else
+	{
+		return (fCoderIndex == ic) && (fParamIndex == ip) &&
+			(fShuffle == sh) && (fUseDict == (dict && DictSupported()));
+	} else
 		return false;
 }
 
@@ -1113,6 +1449,8 @@ string CdPipeMgrItem2::CoderParam() const
 	string ans;
 	if (fCoderIndex >= 0)
 		ans.append(CoderList()[fCoderIndex]);
+	ans.append(ShuffleSuffix(fShuffle));
+	if (fUseDict) ans.append(SUFFIX_DICT);
 	if (fParamIndex >= 0)
 	{
 		ans.append(":");
@@ -1179,6 +1517,10 @@ CdStreamPipeMgr::CdStreamPipeMgr(): CdAbstractManager()
 	Register(new CdPipeXZ);
 	Register(new CdPipeXZ_RA);
 #endif
+#ifndef COREARRAY_NO_ZSTD
+	Register(new CdPipeZstd);
+	Register(new CdPipeZstd_RA);
+#endif
 }
 
 CdStreamPipeMgr::~CdStreamPipeMgr()
@@ -1197,13 +1539,20 @@ void CdStreamPipeMgr::Register(CdPipeMgrItem *vNewPipe)
 
 CdPipeMgrItem *CdStreamPipeMgr::Match(CdGDSObjPipe &Obj, const char *Mode)
 {
+	string s, s1;
+	bool dict = CdPipeMgrItem::ParseDict(Mode, s1);
+	CdShuffleStream::TMode sh = CdPipeMgrItem::ParseShuffle(s1.c_str(), s);
 	vector<CdPipeMgrItem*>::iterator it;
 	for (it = fRegList.begin(); it != fRegList.end(); it++)
 	{
-		CdPipeMgrItem *rv = (*it)->Match(Mode);
+		CdPipeMgrItem *rv = (*it)->Match(s.c_str());
 		if (rv)
 		{
         	rv->fOwner = &Obj;
+			rv->fShuffle = CdPipeMgrItem::ValidShuffle(Obj, sh,
+				rv->fShuffleSize);
+			// ignored if the coder does not support a dictionary
+			rv->fUseDict = dict && rv->DictSupported();
 			return rv;
         }
 	}
@@ -1216,7 +1565,13 @@ CdPipeMgrItem *CdStreamPipeMgr::Match(CdGDSObjPipe &Obj, const char *Mode)
 // =====================================================================
 
 static const char *VAR_PIPE = "PIPE";
+static const char *VAR_PIPE_SHUFFLE = "PIPE_SHUFFLE";
+static const char *VAR_PIPE_DICT = "PIPE_DICT";
 static const char *ERR_PIPE_CODER = "Invalid pipe coder: %s";
+static const char *ERR_PIPE_SHUFFLE = "Invalid 'PIPE_SHUFFLE' for %s";
+static const char *ERR_PIPE_DICT = "Invalid 'PIPE_DICT' for %s";
+/// the maximum size of dictionary, the LZ4 window
+static const C_UInt32 PIPE_DICT_MAX_SIZE = 65536;
 
 CdGDSObjPipe::CdGDSObjPipe(): CdGDSObj()
 {
@@ -1245,6 +1600,16 @@ CdGDSObjPipe *CdGDSObjPipe::AssignPipe(CdGDSObjPipe &Source)
 	return this;
 }
 
+void CdGDSObjPipe::DeletePipeDict()
+{
+	if (fPipeInfo && fPipeInfo->fDictStream && fGDSStream)
+	{
+		fGDSStream->Collection().DeleteBlockStream(
+			fPipeInfo->fDictStream->ID());
+		fPipeInfo->fDictStream = NULL;
+	}
+}
+
 void CdGDSObjPipe::Loading(CdReader &Reader, TdVersion Version)
 {
 	// clear Pipe
@@ -1261,6 +1626,43 @@ void CdGDSObjPipe::Loading(CdReader &Reader, TdVersion Version)
 			if (fPipeInfo==NULL)
     	    	throw ErrGDSObj(ERR_PIPE_CODER, RawText(Coder).c_str());
 			fPipeInfo->LoadStream(Reader, Version);
+
+			// the dictionary stored in a block stream
+			string s, s1;
+			fPipeInfo->fUseDict = CdPipeMgrItem::ParseDict(
+				RawText(Coder).c_str(), s1);
+			fPipeInfo->fDict.clear();
+			fPipeInfo->fDictStream = NULL;
+			if (fPipeInfo->fUseDict && fGDSStream &&
+				Reader.HaveProperty(VAR_PIPE_DICT))
+			{
+				TdGDSBlockID ID = 0;
+				Reader[VAR_PIPE_DICT] >> ID;
+				CdBlockStream *Stream = fGDSStream->Collection()[ID];
+				// the size, followed by the zlib-compressed dictionary
+				C_UInt32 Size = 0;
+				Stream->SetPosition(0);
+				BYTE_LE<CdStream>(Stream) >> Size;
+				if (Size > PIPE_DICT_MAX_SIZE)
+					throw ErrGDSObj(ERR_PIPE_DICT, RawText(Coder).c_str());
+				fPipeInfo->fDict.resize(Size);
+				TdAutoRef<CdZDecoder> Z(new CdZDecoder(*Stream));
+				Z.get()->ReadData(fPipeInfo->fDict.data(), Size);
+				fPipeInfo->fDictStream = Stream;
+			}
+
+			// the shuffle filter, the element size is stored in the file
+			fPipeInfo->fShuffle = CdPipeMgrItem::ParseShuffle(s1.c_str(), s);
+			fPipeInfo->fShuffleSize = 0;
+			if (fPipeInfo->fShuffle != CdShuffleStream::smNone)
+			{
+				C_UInt8 I = 0;
+				if (Reader.HaveProperty(VAR_PIPE_SHUFFLE))
+					Reader[VAR_PIPE_SHUFFLE] >> I;
+				if (I == 0)
+					throw ErrGDSObj(ERR_PIPE_SHUFFLE, RawText(Coder).c_str());
+				fPipeInfo->fShuffleSize = I;
+			}
 		}
 	}
 }
@@ -1270,13 +1672,39 @@ void CdGDSObjPipe::Saving(CdWriter &Writer)
 	CdGDSObj::Saving(Writer);
 	if (fPipeInfo)
 	{
-		Writer[VAR_PIPE] << UTF8Text(fPipeInfo->Coder());
+		Writer[VAR_PIPE] << UTF8Text(fPipeInfo->StreamCoder());
 		fPipeInfo->SaveStream(Writer);
+		if (fPipeInfo->fShuffle != CdShuffleStream::smNone)
+			Writer[VAR_PIPE_SHUFFLE] << C_UInt8(fPipeInfo->fShuffleSize);
+		// no dictionary if the data are too small
+		if (fPipeInfo->fUseDict && !fPipeInfo->fDict.empty() && fGDSStream)
+		{
+			if (!fPipeInfo->fDictStream)
+			{
+				CdBlockStream *Stream = fGDSStream->Collection().NewBlockStream();
+				BYTE_LE<CdStream>(Stream) << C_UInt32(fPipeInfo->fDict.size());
+				{
+					TdAutoRef<CdZEncoder> Z(new CdZEncoder(*Stream,
+						CdRecodeStream::clMax));
+					Z.get()->WriteData(fPipeInfo->fDict.data(),
+						fPipeInfo->fDict.size());
+					Z.get()->Close();
+				}
+				fPipeInfo->fDictStream = Stream;
+			}
+			TdGDSBlockID Entry = fPipeInfo->fDictStream->ID();
+			Writer[VAR_PIPE_DICT] << Entry;
+		}
 	}
 }
 
 void CdGDSObjPipe::GetPipeInfo() {}
 
+int CdGDSObjPipe::ShuffleElmSize(CdShuffleStream::TMode Mode)
+{
+	return 0;
+}
+
 
 
 // CdGDSLabel
@@ -1342,6 +1770,11 @@ void CdGDSFolder::TNode::SetFlagAttr(C_UInt32 val)
 }
 
 
+CdGDSFolder::CdGDSFolder(): CdGDSAbsFolder()
+{
+	fIndexValid = fDupName = false;
+}
+
 CdGDSFolder::~CdGDSFolder()
 {
     _ClearFolder();
@@ -1396,6 +1829,7 @@ CdGDSObj *CdGDSFolder::AddFolder(const UTF8String &Name)
 	I.StreamID = rv->fGDSStream->ID();
 	I.SetFlagType(CdGDSFolder::TNode::FLAG_TYPE_FOLDER);
 	fList.push_back(I);
+	_IndexAppend();
 	fChanged = true;
 
 	return rv;
@@ -1458,9 +1892,13 @@ CdGDSObj *CdGDSFolder::InsertObj(int index, const UTF8String &Name,
 
 	I.Name = Name; I.Obj = val;
 	if (index < 0)
+	{
 		fList.push_back(I);
-	else
+		_IndexAppend();
+	} else {
 		fList.insert(fList.begin()+index, I);
+		_IndexInsert(index);
+	}
 	fChanged = true;
 
 	return val;
@@ -1489,6 +1927,17 @@ void CdGDSFolder::MoveTo(int Index, int NewPos)
 			fList.insert(fList.begin() + NewPos, ND);
 		}
 
+		// the first one of duplicated names may change
+		if (fDupName) fIndexValid = false;
+		if (Index < NewPos)
+			_IndexShift(Index, NewPos, -1);
+		else
+			_IndexShift(NewPos+1, Index+1, 1);
+		if (fIndexValid)
+		{
+			fNameIndex[ND.Name] = NewPos;
+			if (ND.Obj) fObjIndex[ND.Obj] = NewPos;
+		}
 		fChanged = true;
 	}
 }
@@ -1512,6 +1961,7 @@ void CdGDSFolder::UnloadObj(int Index)
 		// resolves dName() to the base CdObject::dName() (returning "")
 		// because the derived vtable has already been unwound.
 		it->Obj->Synchronize();
+		if (fIndexValid) fObjIndex.erase(it->Obj);
 	#ifdef COREARRAY_CODE_DEBUG
 		if (it->Obj->Release() != 0)
 			throw ErrGDSObj(ERR_UNLOAD, (void*)(it->Obj));
@@ -1525,17 +1975,10 @@ void CdGDSFolder::UnloadObj(int Index)
 void CdGDSFolder::UnloadObj(CdGDSObj *val)
 {
 	if (val == NULL) return;
-	vector<CdGDSFolder::TNode>::iterator it;
-	int Index = 0;
-	for (it = fList.begin(); it != fList.end(); it++, Index++)
-	{
-		if (it->Obj == val)
-		{
-			UnloadObj(Index);
-			return;
-		}
-	}
-	throw ErrGDSObj();
+	int Index = _IndexObj(val);
+	if (Index < 0)
+		throw ErrGDSObj();
+	UnloadObj(Index);
 }
 
 void CdGDSFolder::DeleteObj(int Index, bool force)
@@ -1587,24 +2030,17 @@ void CdGDSFolder::DeleteObj(int Index, bool force)
 		}
 	}
 
-    fList.erase(it);
+	_IndexErase(Index);
 	fChanged = true;
 }
 
 void CdGDSFolder::DeleteObj(CdGDSObj *val, bool force)
 {
 	if (val == NULL) return;
-	vector<CdGDSFolder::TNode>::iterator it;
-	int Index = 0;
-	for (it = fList.begin(); it != fList.end(); it++, Index++)
-	{
-		if (it->Obj == val)
-		{
-			DeleteObj(Index, force);
-			return;
-		}
-	}
-	throw ErrGDSObj();
+	int Index = _IndexObj(val);
+	if (Index < 0)
+		throw ErrGDSObj();
+	DeleteObj(Index, force);
 }
 
 void CdGDSFolder::ClearObj(bool force)
@@ -1615,8 +2051,9 @@ void CdGDSFolder::ClearObj(bool force)
 	for (size_t i=0; i < fList.size(); i++)
 		lst.push_back(ObjItem(i));
 
-	for (size_t i=0; i < lst.size(); i++)
-		DeleteObj(lst[i], force);	
+	// from the last one, to avoid rebuilding the lookup tables
+	for (size_t i=lst.size(); i > 0; i--)
+		DeleteObj(lst[i-1], force);
 }
 
 CdGDSFolder & CdGDSFolder::DirItem(int Index)
@@ -1668,16 +2105,11 @@ CdGDSObj *CdGDSFolder::ObjItemEx(int Index)
 
 CdGDSObj *CdGDSFolder::ObjItemEx(const UTF8String &Name)
 {
-	vector<CdGDSFolder::TNode>::iterator it;
-	for (it = fList.begin(); it != fList.end(); it++)
-	{
-		if (it->Name == Name)
-		{
-			_LoadItem(*it);
-			return it->Obj;
-		}
-	}
-	return NULL;
+	int i = _IndexName(Name);
+	if (i < 0) return NULL;
+	CdGDSFolder::TNode &I = fList[i];
+	_LoadItem(I);
+	return I.Obj;
 }
 
 CdGDSObj *CdGDSFolder::Path(const UTF8String &FullName)
@@ -1714,15 +2146,9 @@ CdGDSObj *CdGDSFolder::PathEx(const UTF8String &FullName)
 int CdGDSFolder::IndexObj(CdGDSObj *Obj)
 {
 	if (Obj == NULL) return -1;
-	// Iterate fList directly to avoid force-loading every child just to
-	// compare pointers. Unloaded nodes cannot match a non-null caller
-	// pointer, so skipping them is safe.
-	for (size_t i=0; i < fList.size(); i++)
-	{
-		if (fList[i].Obj == Obj)
-			return (int)i;
-	}
-	return -1;
+	// Look up the loaded nodes only, since unloaded nodes cannot match a
+	// non-null caller pointer
+	return _IndexObj(Obj);
 }
 
 bool CdGDSFolder::HasChild(CdGDSObj *Obj, bool Recursive)
@@ -1778,6 +2204,7 @@ void CdGDSFolder::Loading(CdReader &Reader, TdVersion Version)
 		}
 		Reader.EndStruct();
 	}
+	fIndexValid = false;
 
 	// Load the attribute
 	CdGDSAbsFolder::Loading(Reader, Version);
@@ -1826,15 +2253,12 @@ void CdGDSFolder::_ClearFolder()
 		}
 	}
 	fList.clear();
+	fIndexValid = false;
 }
 
 bool CdGDSFolder::_HasName(const UTF8String &Name)
 {
-	vector<CdGDSFolder::TNode>::iterator it;
-	for (it = fList.begin(); it != fList.end(); it++)
-		if (it->Name == Name)
-			return true;
-	return false;
+	return _IndexName(Name) >= 0;
 }
 
 bool CdGDSFolder::_ValidName(const UTF8String &Name)
@@ -1850,11 +2274,101 @@ bool CdGDSFolder::_ValidName(const UTF8String &Name)
 
 CdGDSFolder::TNode &CdGDSFolder::_NameItem(const UTF8String &Name)
 {
-	vector<CdGDSFolder::TNode>::iterator it;
-	for (it = fList.begin(); it != fList.end(); it++)
-		if (it->Name == Name)
-			return *it;
-	throw ErrGDSObj(ERR_FOLDER_NAME, Name.c_str());
+	int i = _IndexName(Name);
+	if (i < 0)
+		throw ErrGDSObj(ERR_FOLDER_NAME, Name.c_str());
+	return fList[i];
+}
+
+int CdGDSFolder::_IndexName(const UTF8String &Name) const
+{
+	_IndexBuild();
+	unordered_map<UTF8String, int>::const_iterator p = fNameIndex.find(Name);
+	return (p != fNameIndex.end()) ? p->second : -1;
+}
+
+int CdGDSFolder::_IndexObj(const CdGDSObj *Obj) const
+{
+	_IndexBuild();
+	unordered_map<const CdGDSObj*, int>::const_iterator p = fObjIndex.find(Obj);
+	return (p != fObjIndex.end()) ? p->second : -1;
+}
+
+void CdGDSFolder::_IndexBuild() const
+{
+	if (fIndexValid) return;
+	fNameIndex.clear();
+	fObjIndex.clear();
+	fDupName = false;
+	for (int i=0; i < (int)fList.size(); i++)
+	{
+		const TNode &I = fList[i];
+		// the first one wins if the names are duplicated
+		if (!fNameIndex.insert(pair<UTF8String, int>(I.Name, i)).second)
+			fDupName = true;
+		if (I.Obj) fObjIndex[I.Obj] = i;
+	}
+	fIndexValid = true;
+}
+
+void CdGDSFolder::_IndexAppend()
+{
+	if (fIndexValid)
+	{
+		int i = fList.size() - 1;
+		const TNode &I = fList[i];
+		if (!fNameIndex.insert(pair<UTF8String, int>(I.Name, i)).second)
+			fDupName = true;
+		if (I.Obj) fObjIndex[I.Obj] = i;
+	}
+}
+
+void CdGDSFolder::_IndexInsert(int Index)
+{
+	_IndexShift(Index+1, fList.size(), 1);
+	if (fIndexValid)
+	{
+		const TNode &I = fList[Index];
+		if (!fNameIndex.insert(pair<UTF8String, int>(I.Name, Index)).second)
+			fDupName = true;
+		if (I.Obj) fObjIndex[I.Obj] = Index;
+	}
+}
+
+void CdGDSFolder::_IndexErase(int Index)
+{
+	vector<TNode>::iterator it = fList.begin() + Index;
+	if (fIndexValid)
+	{
+		unordered_map<UTF8String, int>::iterator p = fNameIndex.find(it->Name);
+		if ((p != fNameIndex.end()) && (p->second == Index))
+		{
+			// another child may have the same name
+			if (fDupName)
+				fIndexValid = false;
+			else
+				fNameIndex.erase(p);
+		}
+		if (it->Obj) fObjIndex.erase(it->Obj);
+	}
+	fList.erase(it);
+	_IndexShift(Index, fList.size(), -1);
+}
+
+void CdGDSFolder::_IndexShift(int Start, int End, int Delta)
+{
+	// fList[Start..End-1] were at the positions minus Delta, updated in
+	// the order of moving, so that a name maps to its first position
+	if (!fIndexValid) return;
+	for (int k=Start; k < End; k++)
+	{
+		const int i = (Delta > 0) ? (Start + End - 1 - k) : k;
+		const TNode &I = fList[i];
+		unordered_map<UTF8String, int>::iterator p = fNameIndex.find(I.Name);
+		if ((p != fNameIndex.end()) && (p->second == i - Delta))
+			p->second = i;
+		if (I.Obj) fObjIndex[I.Obj] = i;
+	}
 }
 
 void CdGDSFolder::_LoadItem(TNode &I)
@@ -1865,6 +2379,10 @@ void CdGDSFolder::_LoadItem(TNode &I)
 	if (I.Obj == NULL)
 	{
 		_CheckGDSStream();
+		// the lookup tables are rebuilt later if it fails
+		bool IndexValid = fIndexValid;
+		fIndexValid = false;
+
 		CdBlockStream *IStream = fGDSStream->Collection()[I.StreamID];
 		CdReader Reader(IStream, &GDSFile()->Log());
 
@@ -1957,6 +2475,11 @@ void CdGDSFolder::_LoadItem(TNode &I)
 		}
 
 		I.Obj->AddRef();
+		if (IndexValid)
+		{
+			fObjIndex[I.Obj] = &I - &fList[0];
+			fIndexValid = true;
+		}
 	}
 }
 
@@ -1982,25 +2505,15 @@ void CdGDSFolder::_UpdateAll()
 
 vector<CdGDSFolder::TNode>::iterator CdGDSFolder::FindObj(CdGDSObj *Obj)
 {
-	vector<TNode>::iterator it  = fList.begin();
-	vector<TNode>::iterator end = fList.end();
-	for (; it != end; it++)
-	{
-		if (it->Obj == Obj) break;
-	}
-	return it;
+	int i = Obj ? _IndexObj(Obj) : -1;
+	return (i >= 0) ? (fList.begin() + i) : fList.end();
 }
 
 vector<CdGDSFolder::TNode>::const_iterator CdGDSFolder::FindObj(
 	const CdGDSObj *Obj) const
 {
-	vector<TNode>::const_iterator it  = fList.begin();
-	vector<TNode>::const_iterator end = fList.end();
-	for (; it != end; it++)
-	{
-		if (it->Obj == Obj) break;
-	}
-	return it;
+	int i = Obj ? _IndexObj(Obj) : -1;
+	return (i >= 0) ? (fList.begin() + i) : fList.end();
 }
 
 
@@ -2371,6 +2884,7 @@ void CdGDSStreamContainer::SetPackedMode(const char *Mode)
 			// total size
 			SIZE64 TotalSize = GetSize();
 
+			DeletePipeDict();
 			if (fPipeInfo) delete fPipeInfo;
 			fPipeInfo = dStreamPipeMgr.Match(*this, Mode);
 			if ((fPipeInfo==NULL) && (strcmp(Mode, "")!=0))
@@ -2428,6 +2942,9 @@ void CdGDSStreamContainer::CloseWriter()
 			fPipeInfo->ClosePipe(*fBufStream);
 			if (_GetStreamPipeInfo(fBufStream, false))
 				_UpdateStreamPipeInfo(*fGDSStream);
+			// save the dictionary trained when writing
+			if (fPipeInfo->DictUnsaved())
+				SaveToBlockStream();
 
 			if (fBufStream)
 				fBufStream->Release();
@@ -2518,12 +3035,16 @@ void CdGDSStreamContainer::GetOwnBlockStream(vector<const CdBlockStream*> &Out)
 {
 	Out.clear();
 	if (vAllocStream) Out.push_back(vAllocStream);
+	if (fPipeInfo && fPipeInfo->DictStream())
+		Out.push_back(fPipeInfo->DictStream());
 }
 
 void CdGDSStreamContainer::GetOwnBlockStream(vector<CdStream*> &Out)
 {
 	Out.clear();
 	if (vAllocStream) Out.push_back(vAllocStream);
+	if (fPipeInfo && fPipeInfo->DictStream())
+		Out.push_back(fPipeInfo->DictStream());
 }
 
 
@@ -2600,6 +3121,40 @@ const char *CdGDSFile::GDSFilePrefix()
 	return COREARRAY_FILE_PREFIX;
 }
 
+/// whether a file opened read-only is mapped into memory
+static std::atomic<bool> GDS_MemoryMap(false);
+
+void CdGDSFile::SetMemoryMap(bool Value)
+{
+	GDS_MemoryMap = Value;
+}
+
+bool CdGDSFile::GetMemoryMap()
+{
+	return GDS_MemoryMap;
+}
+
+/// open a file stream, and the read-only file is mapped into memory if
+/// possible; a mapping has no file offset shared with forked processes
+static CdStream *GDS_OpenFile(const char *fn, bool ReadOnly, bool Fork)
+{
+	if (ReadOnly && GDS_MemoryMap)
+	{
+		try {
+			return new CdMappedFileStream(fn);
+		}
+		catch (ErrStream &) {
+			// e.g., not enough address space, use the file stream instead
+		}
+	}
+	CdFileStream::TdOpenMode Mode =
+		ReadOnly ? CdFileStream::fmOpenRead : CdFileStream::fmOpenReadWrite;
+	if (Fork)
+		return new CdForkFileStream(fn, Mode);
+	else
+		return new CdFileStream(fn, Mode);
+}
+
 void CdGDSFile::_Init()
 {
 	fVersion = COREARRAY_FILE_VERSION;
@@ -2743,24 +3298,21 @@ void CdGDSFile::SaveStream(CdStream *Stream)
 
 void CdGDSFile::LoadFile(const UTF8String &fn, bool ReadOnly, bool AllowError)
 {
-	TdAutoRef<CdStream> F(new CdFileStream(RawText(fn).c_str(),
-		ReadOnly ? CdFileStream::fmOpenRead : CdFileStream::fmOpenReadWrite));
+	TdAutoRef<CdStream> F(GDS_OpenFile(RawText(fn).c_str(), ReadOnly, false));
 	LoadStream(F.get(), ReadOnly, AllowError);
 	fFileName = fn;
 }
 
 void CdGDSFile::LoadFile(const char *fn, bool ReadOnly, bool AllowError)
 {
-	TdAutoRef<CdStream> F(new CdFileStream(fn,
-		ReadOnly ? CdFileStream::fmOpenRead : CdFileStream::fmOpenReadWrite));
+	TdAutoRef<CdStream> F(GDS_OpenFile(fn, ReadOnly, false));
 	LoadStream(F.get(), ReadOnly, AllowError);
 	fFileName = UTF8Text(fn);
 }
 
 void CdGDSFile::LoadFileFork(const char *fn, bool ReadOnly, bool AllowError)
 {
-	TdAutoRef<CdStream> F(new CdForkFileStream(fn,
-		ReadOnly ? CdFileStream::fmOpenRead : CdFileStream::fmOpenReadWrite));
+	TdAutoRef<CdStream> F(GDS_OpenFile(fn, ReadOnly, true));
 	LoadStream(F.get(), ReadOnly, AllowError);
 	fFileName = UTF8Text(fn);
 }
@@ -41,6 +41,7 @@
 #include "dSerial.h"
 #include "dStream.h"
 #include "dAny.h"
+#include <unordered_map>
 
 
 namespace CoreArray
@@ -249,9 +250,14 @@ namespace CoreArray
 		virtual bool Equal(const char *Mode) const = 0;
 		/// get the coder information with parameters
 		virtual string CoderParam() const = 0;
-
-		virtual void PushReadPipe(CdBufStream &buf) = 0;
-		virtual void PushWritePipe(CdBufStream &buf) = 0;
+		/// get the name of coder stored in stream, with the shuffle filter
+		/// and dictionary
+		string StreamCoder() const;
+
+		/// push the pipes for reading, including the shuffle filter if any
+		void PushReadPipe(CdBufStream &buf);
+		/// push the pipes for writing, including the shuffle filter if any
+		void PushWritePipe(CdBufStream &buf);
 		virtual void PopPipe(CdBufStream &buf) = 0;
 		virtual bool WriteMode(CdBufStream &buf) const = 0;
 		virtual void ClosePipe(CdBufStream &buf) = 0;
@@ -265,17 +271,55 @@ namespace CoreArray
 		COREARRAY_INLINE CdGDSObjPipe *Owner() { return fOwner; }
 		COREARRAY_INLINE TdCompressRemainder &Remainder() { return fRemainder; }
 
+		/// the shuffle filter applied before compression
+		COREARRAY_INLINE CdShuffleStream::TMode Shuffle() const
+			{ return fShuffle; }
+		/// the element size of the shuffle filter in bytes
+		COREARRAY_INLINE int ShuffleSize() const { return fShuffleSize; }
+
+		/// whether the compressed blocks are primed with a dictionary
+		COREARRAY_INLINE bool UseDict() const { return fUseDict; }
+		/// the dictionary, empty if it is not trained yet
+		COREARRAY_INLINE const vector<C_UInt8> &Dict() const { return fDict; }
+		/// the block stream storing the dictionary, or NULL
+		COREARRAY_INLINE CdBlockStream *DictStream() const
+			{ return fDictStream; }
+		/// return true if the dictionary is trained but not saved
+		COREARRAY_INLINE bool DictUnsaved() const
+			{ return fUseDict && !fDict.empty() && !fDictStream; }
+
+		/// get the stream of coder in buf, beneath the shuffle filter if any
+		static CdStream *CoderStream(CdBufStream &buf);
+
 	protected:
     	CdGDSObjPipe *fOwner;
 		SIZE64 fStreamTotalIn, fStreamTotalOut;
 		TdCompressRemainder fRemainder;
-
+		CdShuffleStream::TMode fShuffle;
+		int fShuffleSize;
+		bool fUseDict;
+		vector<C_UInt8> fDict;
+		CdBlockStream *fDictStream;
+
+		virtual void PushCoderReadPipe(CdBufStream &buf) = 0;
+		virtual void PushCoderWritePipe(CdBufStream &buf) = 0;
 		virtual CdPipeMgrItem *Match(const char *Mode) const = 0;
 		virtual void UpdateStreamInfo(CdStream &Stream) = 0;
 		virtual void LoadStream(CdReader &Reader, TdVersion Version);
 		virtual void SaveStream(CdWriter &Writer);
 
 		static bool EqualText(const char *s1, const char *s2);
+		/// remove the suffixes of filters (e.g., '.delta.shuffle') from Mode
+		static CdShuffleStream::TMode ParseShuffle(const char *Mode,
+			string &Coder);
+		/// the shuffle mode applicable to Obj, and its element size
+		static CdShuffleStream::TMode ValidShuffle(CdGDSObjPipe &Obj,
+			CdShuffleStream::TMode Mode, int &ElmSize);
+		/// remove the suffix of dictionary ('.dict') from Mode, return true
+		/// if it exists
+		static bool ParseDict(const char *Mode, string &Coder);
+		/// whether the coder supports priming the blocks with a dictionary
+		virtual bool DictSupported() const { return false; }
 	};
 
 	/// Data pipe for compression and decompression
@@ -342,6 +386,11 @@ namespace CoreArray
 
 		/// Set the mode of data storage (e.g, packed mode or compression)
 		virtual void SetPackedMode(const char *Mode) = 0;
+		/// the element size in bytes if the shuffle or delta filter (Mode) is
+		/// applicable to the data, otherwise 0
+		virtual int ShuffleElmSize(CdShuffleStream::TMode Mode);
+		/// the block stream of data processed by the pipe, or NULL
+		virtual CdBlockStream *PipeStream() { return NULL; }
 
 	protected:
 		CdPipeMgrItem *fPipeInfo;
@@ -352,6 +401,9 @@ namespace CoreArray
 
 		/// assignment of pipe, and return itself
 		CdGDSObjPipe *AssignPipe(CdGDSObjPipe &Source);
+		/// free the block stream storing the dictionary of fPipeInfo, before
+		/// the pipe is replaced
+		void DeletePipeDict();
 
 		COREARRAY_INLINE bool _GetStreamPipeInfo(CdBufStream *buf, bool Close)
 		{
@@ -442,6 +494,8 @@ namespace CoreArray
 		friend class CdGDSObj;
 		friend class CdGDSFile;
 
+		/// constructor
+		CdGDSFolder();
 		/// destructor
 		virtual ~CdGDSFolder();
 
@@ -521,6 +575,13 @@ namespace CoreArray
 		};
 		std::vector<TNode> fList;
 
+		/// the lookup tables of fList, rebuilt on demand if fIndexValid=false
+		mutable std::unordered_map<UTF8String, int> fNameIndex;
+		mutable std::unordered_map<const CdGDSObj*, int> fObjIndex;
+		mutable bool fIndexValid;
+		/// whether fList has duplicated names (valid if fIndexValid=true)
+		mutable bool fDupName;
+
 		virtual void Loading(CdReader &Reader, TdVersion Version);
 		virtual void Saving(CdWriter &Writer);
 		virtual bool IsWithClassName() { return false; }
@@ -532,6 +593,13 @@ namespace CoreArray
 	private:
 		bool _HasName(const UTF8String &Name);
 		bool _ValidName(const UTF8String &Name);
+		int _IndexName(const UTF8String &Name) const;
+		int _IndexObj(const CdGDSObj *Obj) const;
+		void _IndexBuild() const;
+		void _IndexAppend();
+		void _IndexInsert(int Index);
+		void _IndexErase(int Index);
+		void _IndexShift(int Start, int End, int Delta);
 		TNode &_NameItem(const UTF8String &Name);
 		void _LoadItem(TNode &I);
 		void _UpdateAll();
@@ -629,6 +697,8 @@ namespace CoreArray
 		virtual void GetOwnBlockStream(vector<const CdBlockStream*> &Out) const;
 		/// Get a list of CdStream owned by this object, except fGDSStream
 		virtual void GetOwnBlockStream(vector<CdStream*> &Out);
+		/// the block stream of data processed by the pipe, or NULL
+		virtual CdBlockStream *PipeStream() { return vAllocStream; }
 
 		void CopyFromBuf(CdBufStream &Source, SIZE64 Count=-1);
 		void CopyFrom(CdStream &Source, SIZE64 Count=-1);
@@ -721,6 +791,11 @@ namespace CoreArray
 		void LoadFile(const char *fn, bool ReadOnly=true, bool AllowError=false);
 		void LoadFileFork(const char *fn, bool ReadOnly=true, bool AllowError=false);
 
+		/// whether a file opened read-only is mapped into memory (false by
+		/// default), otherwise read by system calls
+		static void SetMemoryMap(bool Value);
+		static bool GetMemoryMap();
+
 		void LoadStream(CdStream* Stream, bool ReadOnly, bool AllowError);
 
 		void SaveAsFile(const UTF8String &fn);
@@ -753,6 +828,11 @@ namespace CoreArray
 		COREARRAY_INLINE CdLogRecord &Log() { return *fLog; }
 		COREARRAY_INLINE TdVersion Version() const { return fVersion; }
 
+		/// set the mutex locked when reading the file, allowing different
+		/// nodes to be read by several threads (NULL, no lock)
+		COREARRAY_INLINE void SetReadLock(CdThreadMutex *Lock)
+			{ CdBlockCollection::SetReadLock(Lock); }
+
 		static const char *GDSFilePrefix();
 
 	protected:
@@ -1548,7 +1548,7 @@ string CoreArray::TempFileName(const char *prefix, const char *tempdir)
 
 #else
 
-	fn.append("xxxxxx");
+	fn.append("XXXXXX");
 	// mkstemp requires a writable char array
 	vector<char> tpl(fn.begin(), fn.end());
 	tpl.push_back('\0');
@@ -28,11 +28,29 @@
 #include "dStream.h"
 #include <cctype>
 #include <limits>
+#include <deque>
+#include <list>
+#include <algorithm>
+#include <atomic>
+
+#ifdef COREARRAY_PLATFORM_UNIX
+#   include <sys/mman.h>
+#endif
 
 #ifndef COREARRAY_NO_STD_IN_OUT
 #   include <iostream>
 #endif
 
+#ifdef COREARRAY_SIMD_SSE2
+#   include <emmintrin.h>
+#endif
+
+// xxHash bundled with LZ4, for the checksums of blocks with random access
+#ifdef COREARRAY_NO_LZ4
+#   define XXH_INLINE_ALL
+#endif
+#include "../LZ4/xxhash.h"
+
 
 using namespace std;
 using namespace CoreArray;
@@ -186,6 +204,122 @@ COREARRAY_INLINE void CdForkFileStream::RedirectFile()
 }
 
 
+// =====================================================================
+// Read-only file stream mapped into memory
+
+static const char *ERR_MAPPED_READONLY =
+	"The memory-mapped file '%s' is read-only.";
+
+CdMappedFileStream::CdMappedFileStream(const char *const AFileName):
+	CdFileStream()
+{
+	static const char *ERR_FILE_MAP = "Can not map file '%s' into memory. %s";
+
+	fMemory = NULL;
+	fSize = fPosition = 0;
+#if defined(COREARRAY_PLATFORM_WINDOWS)
+	fMapping = NULL;
+#endif
+	Init(AFileName, fmOpenRead);
+	fSize = CdHandleStream::Seek(0, soEnd);
+	if (fSize <= 0) return;
+	if ((C_UInt64)fSize > (C_UInt64)std::numeric_limits<size_t>::max())
+	{
+		throw ErrStream(ERR_FILE_MAP, AFileName,
+			"Not enough address space.");
+	}
+
+#if defined(COREARRAY_PLATFORM_WINDOWS)
+	fMapping = CreateFileMapping(fHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (fMapping)
+		fMemory = (const C_UInt8*)MapViewOfFile(fMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!fMemory)
+	{
+		string s = LastSysErrMsg();
+		Unmap();
+		throw ErrStream(ERR_FILE_MAP, AFileName, s.c_str());
+	}
+#elif defined(COREARRAY_PLATFORM_UNIX)
+	void *p = mmap(NULL, fSize, PROT_READ, MAP_SHARED, fHandle, 0);
+	if (p == MAP_FAILED)
+		throw ErrStream(ERR_FILE_MAP, AFileName, LastSysErrMsg().c_str());
+	fMemory = (const C_UInt8*)p;
+#else
+	throw ErrStream(ERR_FILE_MAP, AFileName, "Not supported.");
+#endif
+}
+
+CdMappedFileStream::~CdMappedFileStream()
+{
+	Unmap();
+}
+
+void CdMappedFileStream::Unmap()
+{
+#if defined(COREARRAY_PLATFORM_WINDOWS)
+	if (fMemory) UnmapViewOfFile((LPCVOID)fMemory);
+	if (fMapping) CloseHandle(fMapping);
+	fMapping = NULL;
+#elif defined(COREARRAY_PLATFORM_UNIX)
+	if (fMemory) munmap((void*)fMemory, fSize);
+#endif
+	fMemory = NULL;
+}
+
+ssize_t CdMappedFileStream::Read(void *Buffer, ssize_t Count)
+{
+	if ((Count <= 0) || (fPosition >= fSize)) return 0;
+	if (Count > fSize - fPosition)
+		Count = fSize - fPosition;
+	memcpy(Buffer, fMemory + fPosition, Count);
+	fPosition += Count;
+	return Count;
+}
+
+ssize_t CdMappedFileStream::Write(const void *Buffer, ssize_t Count)
+{
+	throw ErrStream(ERR_MAPPED_READONLY, fFileName.c_str());
+}
+
+SIZE64 CdMappedFileStream::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	static const char *ERR_SEEK = "Invalid position (%lld) of memory-mapped file.";
+	SIZE64 p;
+	switch (Origin)
+	{
+		case soBeginning:
+			p = Offset; break;
+		case soCurrent:
+			p = fPosition + Offset; break;
+		case soEnd:
+			p = fSize + Offset; break;
+		default:
+			return -1;
+	}
+	if (p < 0)
+		throw ErrStream(ERR_SEEK, (long long)p);
+	return (fPosition = p);
+}
+
+SIZE64 CdMappedFileStream::GetSize()
+{
+	return fSize;
+}
+
+void CdMappedFileStream::SetSize(SIZE64 NewSize)
+{
+	throw ErrStream(ERR_MAPPED_READONLY, fFileName.c_str());
+}
+
+const void *CdMappedFileStream::ReadPtr(SIZE64 Pos, ssize_t &Count)
+{
+	if ((Pos < 0) || (Pos >= fSize) || (Count <= 0)) return NULL;
+	if (Count > fSize - Pos)
+		Count = fSize - Pos;
+	return fMemory + Pos;
+}
+
+
 // =====================================================================
 // CdTempStream
 
@@ -500,6 +634,503 @@ CdRAAlgorithm::CdRAAlgorithm(CdRecodeStream &owner):
 	fSizeType = raUnknown;
 }
 
+/// whether the checksums of raw blocks are stored when writing
+static std::atomic<bool> RA_WriteChecksum(false);
+/// whether the decoded blocks are compared with their checksums
+static std::atomic<bool> RA_VerifyChecksum(false);
+
+/// the checksum of a raw block in version 0x12
+static inline C_UInt64 RA_BlockChecksum(const C_UInt8 *Raw, size_t Size)
+{
+	return XXH64(Raw, Size, 0);
+}
+
+/// compare the decoded block 'Idx' with its checksum
+static void RA_CheckBlock(C_Int32 Idx, const C_UInt8 *Raw, size_t Size,
+	C_UInt64 Checksum)
+{
+	static const char *ERR_CHECKSUM =
+		"Checksum mismatch in compressed block %d (%016llX, expected %016llX).";
+	C_UInt64 h = RA_BlockChecksum(Raw, Size);
+	if (h != Checksum)
+	{
+		throw ErrRecodeStream(ERR_CHECKSUM, Idx, (unsigned long long)h,
+			(unsigned long long)Checksum);
+	}
+}
+
+
+// Read-ahead of the blocks with random access
+
+namespace CoreArray
+{
+	/// a block decoded by the read-ahead worker threads
+	struct COREARRAY_DLL_LOCAL TdRABlock
+	{
+		enum { rbQueued = 0, rbDecoding = 1, rbDone = 2 };
+
+		C_Int32 Index;        ///< the block index, -1 if unused
+		int State;            ///< rbQueued, rbDecoding or rbDone
+		vector<C_UInt8> Cmp;  ///< compressed data
+		vector<C_UInt8> Raw;  ///< decoded data
+		CdRA_Read::TDecodeProc Proc;      ///< decoding 'Cmp' to 'Raw'
+		CdRA_Write::TEncodeProc EncProc;  ///< or encoding 'Raw' to 'Cmp'
+		int Param, Param2;
+		const C_UInt8 *Dict;  ///< the dictionary owned by the stream, or NULL
+		size_t DictSize;      ///< the size of dictionary
+		bool UseChecksum;     ///< compute or compare the checksum of 'Raw'
+		C_UInt64 Checksum;    ///< the checksum of 'Raw'
+		string Error;         ///< the error message if fails
+
+		TdRABlock()
+		{
+			Index = -1; State = rbDone;
+			Proc = NULL; EncProc = NULL; Param = Param2 = 0;
+			Dict = NULL; DictSize = 0;
+			UseChecksum = false; Checksum = 0;
+		}
+
+		void Decode()
+		{
+			try {
+				if (EncProc)
+				{
+					(*EncProc)(Raw.data(), Raw.size(), Cmp, Param, Param2,
+						Dict, DictSize);
+					if (UseChecksum)
+						Checksum = RA_BlockChecksum(Raw.data(), Raw.size());
+				} else {
+					(*Proc)(Cmp.data(), Cmp.size(), Raw.data(), Raw.size(),
+						Param, Dict, DictSize);
+					if (UseChecksum)
+						RA_CheckBlock(Index, Raw.data(), Raw.size(), Checksum);
+				}
+			}
+			catch (std::exception &E) {
+				Error = E.what();
+			}
+			catch (...) {
+				Error = "unknown error!";
+			}
+		}
+	};
+
+	/// the worker threads decoding or encoding blocks, shared by all streams
+	/** The pool object is never freed, and its threads are joined by
+	 *  Shutdown() when the library is unloaded.
+	**/
+	class COREARRAY_DLL_LOCAL CdRAPool
+	{
+	public:
+		static CdRAPool &Instance()
+		{
+			static CdRAPool *pool = new CdRAPool;
+			return *pool;
+		}
+
+		/// set the number of worker threads, start them if needed
+		void SetNumThread(int n)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			fNumThread = n;
+			while ((int)fThreads.size() < n)
+			{
+				TWorker *w = new TWorker;
+				w->Pool = this; w->Index = fThreads.size();
+				fThreads.push_back(w);
+				w->Thread.BeginThread(thread_proc, w);
+			}
+			fJobCond.Broadcast();
+		}
+
+		/// stop and join the worker threads, the queued blocks are decoded
+		/// by the threads waiting for them
+		void Shutdown()
+		{
+			vector<TWorker*> lst;
+			{
+				TdAutoMutex AutoMutex(&fMutex);
+				fShutdown = true;
+				fNumThread = 0;
+				lst.swap(fThreads);
+				fJobCond.Broadcast();
+			}
+			for (size_t i=0; i < lst.size(); i++)
+				delete lst[i];  // wait for the thread
+			TdAutoMutex AutoMutex(&fMutex);
+			fShutdown = false;
+		}
+
+		/// add a block to the queue
+		void Submit(TdRABlock *p)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			p->State = TdRABlock::rbQueued;
+			p->Error.clear();
+			fQueue.push_back(p);
+			fJobCond.Signal();
+		}
+
+		/// wait until the block is decoded, or decode it on the calling
+		/// thread if it is still in the queue
+		void Wait(TdRABlock *p)
+		{
+			bool take;
+			{
+				TdAutoMutex AutoMutex(&fMutex);
+				take = Dequeue(p);
+			}
+			if (take)
+			{
+				p->Decode();
+				TdAutoMutex AutoMutex(&fMutex);
+				p->State = TdRABlock::rbDone;
+			} else {
+				TdAutoMutex AutoMutex(&fMutex);
+				while (p->State != TdRABlock::rbDone)
+					fDoneCond.Wait(fMutex);
+			}
+		}
+
+		/// remove a block from the queue, return false if it is being
+		/// decoded or has been decoded
+		bool Cancel(TdRABlock *p)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			if (!Dequeue(p)) return false;
+			p->State = TdRABlock::rbDone;
+			return true;
+		}
+
+	private:
+		struct TWorker
+		{
+			CdRAPool *Pool;
+			int Index;
+			CdThread Thread;
+		};
+
+		CdThreadMutex fMutex;
+		CdThreadCondition fJobCond, fDoneCond;
+		deque<TdRABlock*> fQueue;
+		vector<TWorker*> fThreads;
+		int fNumThread;
+		bool fShutdown;
+
+		CdRAPool() { fNumThread = 0; fShutdown = false; }
+
+		/// remove a queued block, and mark it decoding (fMutex is locked)
+		bool Dequeue(TdRABlock *p)
+		{
+			if (p->State != TdRABlock::rbQueued) return false;
+			deque<TdRABlock*>::iterator it =
+				std::find(fQueue.begin(), fQueue.end(), p);
+			if (it != fQueue.end()) fQueue.erase(it);
+			p->State = TdRABlock::rbDecoding;
+			return true;
+		}
+
+		static int thread_proc(CdThread *Thread, TWorker *w)
+		{
+			CdRAPool *pool = w->Pool;
+			TdAutoMutex AutoMutex(&pool->fMutex);
+			while (true)
+			{
+				// the worker is idle if the number of threads is reduced
+				while (!pool->fShutdown &&
+						(pool->fQueue.empty() || (w->Index >= pool->fNumThread)))
+					pool->fJobCond.Wait(pool->fMutex);
+				if (pool->fShutdown) break;
+				TdRABlock *p = pool->fQueue.front();
+				pool->fQueue.pop_front();
+				p->State = TdRABlock::rbDecoding;
+				pool->fMutex.Unlock();
+				p->Decode();
+				pool->fMutex.Lock();
+				p->State = TdRABlock::rbDone;
+				pool->fDoneCond.Broadcast();
+			}
+			return 0;
+		}
+	};
+
+	/// the blocks decoded ahead of the current block of a stream
+	class COREARRAY_DLL_LOCAL CdRA_ReadAhead
+	{
+	public:
+		bool Active;
+
+		CdRA_ReadAhead(int NumBlock): fBlock(NumBlock) { Active = false; }
+		~CdRA_ReadAhead()
+		{
+			Cancel();
+			for (size_t i=0; i < fBlock.size(); i++)
+				CdRAPool::Instance().Wait(&fBlock[i]);
+		}
+
+		COREARRAY_INLINE int NumBlock() const { return fBlock.size(); }
+
+		/// cancel the blocks in the queue
+		void Cancel()
+		{
+			for (size_t i=0; i < fBlock.size(); i++)
+			{
+				if (CdRAPool::Instance().Cancel(&fBlock[i]))
+					fBlock[i].Index = -1;
+			}
+		}
+
+		/// get the decoded block 'Idx', and queue the following blocks
+		TdRABlock &Get(CdRA_Read &R, C_Int32 Idx)
+		{
+			const int n = fBlock.size();
+			C_Int32 end = Idx + n;
+			if (end > (C_Int32)R.fIndexSize) end = R.fIndexSize;
+			for (C_Int32 i=Idx; i < end; i++)
+			{
+				TdRABlock &B = fBlock[i % n];
+				if (B.Index == i) continue;
+				// the slot is reused only if it is not being decoded
+				CdRAPool::Instance().Cancel(&B);
+				CdRAPool::Instance().Wait(&B);
+				Load(R, i, B);
+				CdRAPool::Instance().Submit(&B);
+			}
+			TdRABlock &B = fBlock[Idx % n];
+			CdRAPool::Instance().Wait(&B);
+			if (!B.Error.empty())
+			{
+				B.Index = -1;
+				throw ErrRecodeStream(B.Error);
+			}
+			return B;
+		}
+
+	private:
+		vector<TdRABlock> fBlock;
+
+		/// read the compressed data of block 'Idx' on the calling thread
+		void Load(CdRA_Read &R, C_Int32 Idx, TdRABlock &B)
+		{
+			const CdRA_Read::TIndex *p = R.fIndex + Idx;
+			B.Index = -1;
+			R.LoadBlock(Idx, B.Cmp);
+			B.Raw.resize(p[1].RawStart - p[0].RawStart);
+			B.Proc = R.fDecodeProc;
+			B.Param = R.fDecodeParam;
+			B.Dict = R.fDict.empty() ? NULL : R.fDict.data();
+			B.DictSize = R.fDict.size();
+			B.UseChecksum = R.fVerify;
+			B.Checksum = R.BlockChecksum(Idx);
+			B.Index = Idx;
+		}
+	};
+
+	/// the decoded blocks shared by all GDS block streams, and the least
+	/// recently used blocks are removed when exceeding the memory budget
+	class COREARRAY_DLL_LOCAL CdRABlockCache
+	{
+	public:
+		/// the key of a decoded block
+		struct TKey
+		{
+			const CdBlockCollection *File;  ///< the GDS file
+			C_UInt32 Stream;  ///< the block stream ID
+			SIZE64 Base;      ///< the start of compressed data in the stream
+			C_Int32 Block;    ///< the block index
+
+			bool operator< (const TKey &k) const
+			{
+				if (File != k.File) return File < k.File;
+				if (Stream != k.Stream) return Stream < k.Stream;
+				if (Base != k.Base) return Base < k.Base;
+				return Block < k.Block;
+			}
+		};
+
+		/// the cache is never freed, since it may be used until exiting
+		static CdRABlockCache &Instance()
+		{
+			static CdRABlockCache *cache = new CdRABlockCache;
+			return *cache;
+		}
+
+		COREARRAY_INLINE C_Int64 MaxSize() const { return fMaxSize; }
+
+		void SetMaxSize(C_Int64 Size)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			fMaxSize = (Size > 0) ? Size : 0;
+			Shrink();
+		}
+
+		/// copy the data of a cached block, return false if not cached
+		bool Read(const TKey &Key, SIZE64 Offset, void *Buffer, ssize_t Count)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			TMap::iterator it = fMap.find(Key);
+			if (it == fMap.end()) return false;
+			fList.splice(fList.begin(), fList, it->second);
+			memcpy(Buffer, &(it->second->Raw[Offset]), Count);
+			fHits ++;
+			return true;
+		}
+
+		/// add a decoded block by swapping 'Raw', return false if the block
+		/// exceeds the memory budget
+		bool Add(const TKey &Key, vector<C_UInt8> &Raw)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			fMisses ++;
+			if (((C_Int64)Raw.size() > fMaxSize) || (fMap.count(Key) > 0))
+				return false;
+			fList.push_front(TEntry());
+			fList.front().Key = Key;
+			fList.front().Raw.swap(Raw);
+			fMap[Key] = fList.begin();
+			fSize += fList.front().Raw.size();
+			Shrink();
+			return true;
+		}
+
+		/// remove all blocks of a block stream
+		void Remove(const CdBlockCollection *File, C_UInt32 Stream)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			TKey k = { File, Stream, 0, 0 };
+			TMap::iterator it = fMap.lower_bound(k);
+			while ((it != fMap.end()) && (it->first.File == File) &&
+				(it->first.Stream == Stream))
+			{
+				fSize -= it->second->Raw.size();
+				fList.erase(it->second);
+				fMap.erase(it++);
+			}
+		}
+
+		CdRA_Read::TBlockCacheStat Stat(bool ResetCounter)
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			CdRA_Read::TBlockCacheStat rv;
+			rv.MaxSize = fMaxSize;
+			rv.Size = fSize;
+			rv.NumBlock = fMap.size();
+			rv.Hits = fHits;
+			rv.Misses = fMisses;
+			if (ResetCounter) fHits = fMisses = 0;
+			return rv;
+		}
+
+	private:
+		struct TEntry
+		{
+			TKey Key;
+			vector<C_UInt8> Raw;
+		};
+		typedef map<TKey, list<TEntry>::iterator> TMap;
+
+		CdThreadMutex fMutex;
+		list<TEntry> fList;  ///< the most recently used block first
+		TMap fMap;
+		C_Int64 fMaxSize, fSize, fHits, fMisses;
+
+		CdRABlockCache() { fMaxSize = fSize = fHits = fMisses = 0; }
+
+		/// remove the least recently used blocks (fMutex is locked)
+		void Shrink()
+		{
+			while ((fSize > fMaxSize) && !fList.empty())
+			{
+				TEntry &e = fList.back();
+				fSize -= e.Raw.size();
+				fMap.erase(e.Key);
+				fList.pop_back();
+			}
+		}
+	};
+
+	/// the blocks compressed by the worker threads, and written in order
+	class COREARRAY_DLL_LOCAL CdRA_ParallelWrite
+	{
+	public:
+		CdRA_ParallelWrite(int NumBlock, ssize_t BlockSize):
+			fBlock(NumBlock), fBlockSize(BlockSize)
+			{ fHead = fCount = 0; }
+		~CdRA_ParallelWrite()
+		{
+			for (size_t i=0; i < fBlock.size(); i++)
+				CdRAPool::Instance().Cancel(&fBlock[i]);
+			for (size_t i=0; i < fBlock.size(); i++)
+				CdRAPool::Instance().Wait(&fBlock[i]);
+		}
+
+		/// buffer the data, and submit the full blocks
+		void Write(CdRA_Write &W, const C_UInt8 *Buffer, ssize_t Count)
+		{
+			while (Count > 0)
+			{
+				vector<C_UInt8> &Raw = Filling().Raw;
+				ssize_t L = fBlockSize - Raw.size();
+				if (L > Count) L = Count;
+				Raw.insert(Raw.end(), Buffer, Buffer + L);
+				Buffer += L; Count -= L;
+				if ((ssize_t)Raw.size() >= fBlockSize)
+				{
+					Submit(W);
+					if (fCount >= (int)fBlock.size()) WriteFirst(W);
+				}
+			}
+		}
+
+		/// submit the partial block, and write all blocks
+		void Sync(CdRA_Write &W)
+		{
+			if (!Filling().Raw.empty()) Submit(W);
+			while (fCount > 0) WriteFirst(W);
+		}
+
+	private:
+		vector<TdRABlock> fBlock;  ///< a ring of blocks
+		ssize_t fBlockSize;        ///< the uncompressed size of a block
+		int fHead;   ///< the first submitted block
+		int fCount;  ///< the number of submitted blocks
+
+		COREARRAY_INLINE TdRABlock &Filling()
+			{ return fBlock[(fHead + fCount) % fBlock.size()]; }
+
+		void Submit(CdRA_Write &W)
+		{
+			TdRABlock &B = Filling();
+			B.EncProc = W.fEncodeProc;
+			B.Param = W.fEncodeLevel;
+			B.Param2 = W.fSizeType;
+			B.Dict = W.fDict.empty() ? NULL : W.fDict.data();
+			B.DictSize = W.fDict.size();
+			B.UseChecksum = (W.fVersion == 0x12);
+			fCount ++;
+			CdRAPool::Instance().Submit(&B);
+		}
+
+		/// write the first compressed block to the stream
+		void WriteFirst(CdRA_Write &W)
+		{
+			TdRABlock &B = fBlock[fHead];
+			CdRAPool::Instance().Wait(&B);
+			fHead = (fHead + 1) % fBlock.size();
+			fCount --;
+			if (!B.Error.empty())
+				throw ErrRecodeStream(B.Error);
+			CdRecodeStream &S = W.fOwner;
+			S.UpdateStreamPosition();
+			S.fStream->WriteData(B.Cmp.data(), B.Cmp.size());
+			S.fStreamPos += B.Cmp.size();
+			S.fTotalOut = S.fStreamPos - S.fStreamBase;
+			W.AddBlockInfo(B.Cmp.size(), B.Raw.size(), B.Checksum);
+			B.Raw.clear();
+		}
+	};
+}
+
 
 // CdRA_Read
 
@@ -514,10 +1145,18 @@ CdRA_Read::CdRA_Read(CdRecodeStream *owner):
 	fIndexingStart = 0;
 	fIndex = NULL;
 	fIndexSize = 0;
+	fVerify = false;
+	fDecodeProc = NULL;
+	fDecodeParam = 0;
+	fReadAhead = NULL;
+	fSeqBlockCnt = 0;
+	fCacheMode = false;
+	fCacheBufIdx = -1;
 }
 
 CdRA_Read::~CdRA_Read()
 {
+	if (fReadAhead) delete fReadAhead;
 	if (fIndex) delete []fIndex;
 }
 
@@ -535,7 +1174,7 @@ void CdRA_Read::InitReadStream()
 		throw ErrRecodeStream("Invalid stream header with random access.");
 	// get the algorithm version
 	fVersion = fOwner.fStream->R8b();
-	if ((fVersion != 0x10) && (fVersion != 0x11))
+	if ((fVersion < 0x10) || (fVersion > 0x12))
 		throw ErrStream(ERR_UNSUPPORT, fVersion >> 4, fVersion & 0x0F);
 	// get size type
 	C_Int8 b = fOwner.fStream->R8b();
@@ -568,7 +1207,7 @@ void CdRA_Read::InitReadStream()
 			fIndex[1].CmpStart = fIndex[0].CmpStart + fCB_ZSize;
 			fIndexSize = 1;
 		}
-	} else if (fVersion == 0x11)
+	} else if ((fVersion == 0x11) || (fVersion == 0x12))
 	{
 		// pre-defined block information is stored after compressed data blocks
 		TdGDSPos Len;
@@ -585,6 +1224,8 @@ void CdRA_Read::InitReadStream()
 			fCB_ZSize = fIndex[1].CmpStart - fIndex[0].CmpStart;
 		} else
 			fCB_UZSize = fCB_ZSize = 0;
+		// the entire blocks are decoded to compare with checksums
+		fCacheMode = fVerify = RA_VerifyChecksum && HasChecksum();
 	} else
 		throw ErrStream(ERR_UNSUPPORT, fVersion >> 4, fVersion & 0x0F);
 }
@@ -677,6 +1318,11 @@ bool CdRA_Read::NextBlock()
 	}
 }
 
+void CdRA_Read::SetDict(const vector<C_UInt8> &Dict)
+{
+	fDict = Dict;
+}
+
 void CdRA_Read::BinSearch(SIZE64 Position, ssize_t low, ssize_t high)
 {
 	TIndex *p = fIndex;
@@ -733,75 +1379,352 @@ void CdRA_Read::LoadIndexing()
 			n->CmpStart = p->CmpStart + CmpLen;
 			p ++;
 		}
+		// the checksums of raw blocks follow the block list
+		if ((fVersion == 0x12) && (fBlockNum > 0))
+		{
+			fChecksum.resize(fBlockNum);
+			for (ssize_t i=0; i < fBlockNum; i++)
+				BYTE_LE<CdStream>(fOwner.fStream) >> fChecksum[i];
+		}
 		fIndexSize = fBlockNum;
 		fOwner.fStream->SetPosition(fOwner.fStreamPos);
 	}
 }
 
 
-// CdRA_Write
+// the settings are changed by the caller, and read by any thread
+static std::atomic<int> RA_NumThread(0);
+static std::atomic<int> RA_NumBlock(0);
+static std::atomic<int> RA_NumEncThread(0);
 
-CdRA_Write::CdRA_Write(CdRecodeStream *owner, TBlockSize bs):
-	CdRAAlgorithm(*owner)
+/// update the number of threads in the pool
+static void RA_SetPoolThread(int NumThread, int NumEncThread)
 {
-	static const char *ERR_INTERNAL =
-		"Invalid block size (%d) in CdRA_Write::CdRA_Write().";
-	if ((bs < raFirst) || (bs > raLast))
-		throw EZLibError(ERR_INTERNAL, (int)bs);
-	fVersion = 0x11;  // by default
-	fBlockNum = 0;
-	fCB_ZStart = fCB_UZStart = 0;
-	fBlockListStart = 0;
-	fHasInitWriteBlock = false;
+	int n = (NumThread > NumEncThread) ? NumThread : NumEncThread;
+	if ((n > 0) || (RA_NumThread > 0) || (RA_NumEncThread > 0))
+		CdRAPool::Instance().SetNumThread(n);
+	RA_NumThread = NumThread;
+	RA_NumEncThread = NumEncThread;
 }
 
-void CdRA_Write::InitWriteStream()
+void CdRA_Read::SetReadAhead(int NumThread, int NumBlock)
 {
-	// get the base position
-	fOwner.fStreamBase = fOwner.fStream->Position();
-	// write the magic number
-	WriteMagicNumber(*fOwner.fStream);
-	// write the version of this algorithm, v1.0
-	fOwner.fStream->W8b(fVersion);
-	// write the parameter of block size
-	fOwner.fStream->W8b(fSizeType);
-	// write the number of independent blocks, -1 for unknown
-	BYTE_LE<CdStream>(fOwner.fStream) << C_Int32(-1);
-	// set values
-	fBlockListStart = fOwner.fStreamPos = fOwner.fStream->Position();
-	// version
-	if (fVersion == 0x11)
-	{
-		BYTE_LE<CdStream>(fOwner.fStream) << TdGDSPos(0);
-		fOwner.fStreamPos += GDS_POS_SIZE;
-		fBlockListStart = fOwner.fStreamPos;
-	}
-	// set total out
-	fOwner.fTotalOut = (fOwner.fStreamPos - fOwner.fStreamBase);
-	fHasInitWriteBlock = false;
+	if (NumThread < 0) NumThread = 0;
+	if (NumBlock < 0) NumBlock = 0;
+	RA_SetPoolThread(NumThread, RA_NumEncThread);
+	RA_NumBlock = NumBlock;
 }
 
-void CdRA_Write::DoneWriteStream()
+void CdRA_Read::GetReadAhead(int &NumThread, int &NumBlock)
 {
-	DoneWriteBlock();
-	if (fVersion == 0x10)
-	{
-		// write the ending code, zero filling
-		C_UInt64 Val = 0;
-		fOwner.fStream->WriteData(&Val, SIZE_RA_BLOCK_HEADER);
-		fOwner.fStreamPos += SIZE_RA_BLOCK_HEADER;
-		fOwner.fTotalOut = fOwner.fStreamPos - fOwner.fStreamBase;
-	}
-	fHasInitWriteBlock = false;
-	// save position
-	SIZE64 OldPos = fOwner.fStreamPos;
+	NumThread = RA_NumThread;
+	NumBlock = RA_NumBlock;
+}
 
-	// write down the number of independent blocks
+void CdRA_Read::ShutdownPool()
+{
+	CdRAPool::Instance().Shutdown();
+}
+
+void CdRA_Read::SetBlockCache(C_Int64 MaxSize)
+{
+	CdRABlockCache::Instance().SetMaxSize(MaxSize);
+}
+
+CdRA_Read::TBlockCacheStat CdRA_Read::GetBlockCache(bool ResetCounter)
+{
+	return CdRABlockCache::Instance().Stat(ResetCounter);
+}
+
+void CdRA_Read::SetVerify(bool Verify)
+{
+	RA_VerifyChecksum = Verify;
+}
+
+bool CdRA_Read::GetVerify()
+{
+	return RA_VerifyChecksum;
+}
+
+bool CdRA_Read::BlockReadActive() const
+{
+	return fCacheMode || (fReadAhead && fReadAhead->Active);
+}
+
+ssize_t CdRA_Read::BlockRead(void *Buffer, ssize_t Count,
+	SIZE64 &CurPosition)
+{
+	C_UInt8 *pBuf = (C_UInt8*)Buffer;
+	ssize_t OldCount = Count;
+	while ((Count > 0) && (fBlockIdx < fBlockNum))
+	{
+		SIZE64 off = CurPosition - fCB_UZStart;
+		ssize_t L = fCB_UZSize - off;
+		if (L > Count) L = Count;
+		if (fReadAhead && fReadAhead->Active)
+		{
+			TdRABlock &B = fReadAhead->Get(*this, fBlockIdx);
+			memcpy(pBuf, &B.Raw[off], L);
+		} else
+			CacheRead(off, pBuf, L);
+		pBuf += L; Count -= L;
+		CurPosition += L;
+		if (CurPosition >= fCB_UZStart + fCB_UZSize)
+		{
+			NextBlock();
+			ReadAheadNext();
+		}
+	}
+
+	SIZE64 tmp = fCB_ZStart - fOwner.fStreamBase;
+	if (tmp > fOwner.fTotalIn) fOwner.fTotalIn = tmp;
+	if (CurPosition > fOwner.fTotalOut) fOwner.fTotalOut = CurPosition;
+	return OldCount - Count;
+}
+
+bool CdRA_Read::ReadAheadNext()
+{
+	// switch on after two successive blocks, when all blocks are indexed
+	if ((++fSeqBlockCnt < 2) || (RA_NumThread <= 0) || !fDecodeProc ||
+			(fIndexSize < fBlockNum) || (fReadAhead && fReadAhead->Active))
+		return false;
+	int n = RA_NumBlock.load();
+	if (n <= 0) n = 2*RA_NumThread;
+	if (fReadAhead && (fReadAhead->NumBlock() != n))
+		{ delete fReadAhead; fReadAhead = NULL; }
+	if (!fReadAhead)
+		fReadAhead = new CdRA_ReadAhead(n);
+	fReadAhead->Active = true;
+	return true;
+}
+
+bool CdRA_Read::BlockReadSeek(C_Int32 OldBlockIdx, bool &Moved)
+{
+	const bool OldActive = BlockReadActive();
+	if (Moved)
+	{
+		if (fBlockIdx == OldBlockIdx + 1)
+		{
+			ReadAheadNext();
+		} else if (fReadAhead && fReadAhead->Active &&
+			(fBlockIdx > OldBlockIdx) &&
+			(fBlockIdx < OldBlockIdx + fReadAhead->NumBlock()))
+		{
+			// still in the blocks decoded ahead
+		} else {
+			fSeqBlockCnt = 0;
+			if (fReadAhead)
+			{
+				fReadAhead->Active = false;
+				fReadAhead->Cancel();
+			}
+		}
+	}
+
+	// the decoded block cache is used for GDS block streams only, and the
+	// entire blocks are also decoded to compare with checksums
+	fVerify = RA_VerifyChecksum && HasChecksum();
+	fCacheMode = false;
+	if (!(fReadAhead && fReadAhead->Active) && fDecodeProc &&
+		(fIndexSize >= fBlockNum))
+	{
+		if (fVerify)
+			fCacheMode = true;
+		else if (CdRABlockCache::Instance().MaxSize() > 0)
+			fCacheMode = (dynamic_cast<CdBlockStream*>(fOwner.fStream) != NULL);
+	}
+
+	if (BlockReadActive()) return true;
+	if (OldActive) Moved = true;
+	return false;
+}
+
+void CdRA_Read::LoadBlock(C_Int32 Idx, vector<C_UInt8> &Cmp)
+{
+	const TIndex *p = fIndex + Idx;
+	SIZE64 start = p[0].CmpStart;
+	SIZE64 size  = p[1].CmpStart - start;
+	if (fVersion == 0x10)
+		{ start += SIZE_RA_BLOCK_HEADER; size -= SIZE_RA_BLOCK_HEADER; }
+	Cmp.resize(size);
+	fOwner.fStream->SetPosition(start);
+	fOwner.fStream->ReadData(Cmp.data(), size);
+}
+
+void CdRA_Read::CacheRead(SIZE64 Offset, void *Buffer, ssize_t Count)
+{
+	if (fCacheBufIdx == fBlockIdx)
+	{
+		memcpy(Buffer, &fCacheBuf[Offset], Count);
+		return;
+	}
+	// no shared cache if the blocks are decoded only for verification
+	CdRABlockCache &Cache = CdRABlockCache::Instance();
+	CdBlockStream *Stream = (Cache.MaxSize() > 0) ?
+		dynamic_cast<CdBlockStream*>(fOwner.fStream) : NULL;
+	CdRABlockCache::TKey Key = { NULL, 0, fOwner.fStreamBase, fBlockIdx };
+	if (Stream)
+	{
+		Key.File = &Stream->Collection();
+		Key.Stream = Stream->ID();
+		if (Cache.Read(Key, Offset, Buffer, Count)) return;
+	}
+
+	// decode the entire block
+	vector<C_UInt8> Cmp;
+	LoadBlock(fBlockIdx, Cmp);
+	fCacheBufIdx = -1;
+	fCacheBuf.resize(fCB_UZSize);
+	(*fDecodeProc)(Cmp.data(), Cmp.size(), fCacheBuf.data(), fCB_UZSize,
+		fDecodeParam, fDict.empty() ? NULL : fDict.data(), fDict.size());
+	if (fVerify)
+	{
+		RA_CheckBlock(fBlockIdx, fCacheBuf.data(), fCacheBuf.size(),
+			fChecksum[fBlockIdx]);
+	}
+	memcpy(Buffer, &fCacheBuf[Offset], Count);
+	if (Stream)
+	{
+		Stream->fHasCache = true;
+		if (Cache.Add(Key, fCacheBuf)) return;
+	}
+	fCacheBufIdx = fBlockIdx;
+}
+
+void CdRA_Read::VerifyBlock(C_Int32 Idx, const vector<C_UInt8> &Cmp,
+	vector<C_UInt8> &Raw) const
+{
+	const TIndex *p = fIndex + Idx;
+	Raw.resize(p[1].RawStart - p[0].RawStart);
+	(*fDecodeProc)(Cmp.data(), Cmp.size(), Raw.data(), Raw.size(),
+		fDecodeParam, fDict.empty() ? NULL : fDict.data(), fDict.size());
+	if (HasChecksum())
+		RA_CheckBlock(Idx, Raw.data(), Raw.size(), fChecksum[Idx]);
+}
+
+
+// CdRA_Write
+
+CdRA_Write::CdRA_Write(CdRecodeStream *owner, TBlockSize bs):
+	CdRAAlgorithm(*owner)
+{
+	static const char *ERR_INTERNAL =
+		"Invalid block size (%d) in CdRA_Write::CdRA_Write().";
+	if ((bs < raFirst) || (bs > raLast))
+		throw EZLibError(ERR_INTERNAL, (int)bs);
+	fSizeType = bs;
+	fVersion = RA_WriteChecksum ? 0x12 : 0x11;
+	fBlockNum = 0;
+	fCB_ZStart = fCB_UZStart = 0;
+	fBlockListStart = 0;
+	fHasInitWriteBlock = false;
+	fEncodeProc = NULL;
+	fEncodeLevel = 0;
+	fParallel = NULL;
+	fDictMaxSize = 0;
+	fDictTrain = false;
+	fDictOut = NULL;
+}
+
+CdRA_Write::~CdRA_Write()
+{
+	if (fParallel) delete fParallel;
+}
+
+void CdRA_Write::SetParallel(int NumThread)
+{
+	if (NumThread < 0) NumThread = 0;
+	RA_SetPoolThread(RA_NumThread, NumThread);
+}
+
+int CdRA_Write::GetParallel()
+{
+	return RA_NumEncThread;
+}
+
+void CdRA_Write::SetChecksum(bool Checksum)
+{
+	RA_WriteChecksum = Checksum;
+}
+
+bool CdRA_Write::GetChecksum()
+{
+	return RA_WriteChecksum;
+}
+
+bool CdRA_Write::ParallelMode()
+{
+	// the blocks are always ended at the uncompressed block size and
+	// compressed by fEncodeProc, even without worker threads, so the output
+	// does not depend on the number of threads
+	if (!fParallel && fEncodeProc && (fVersion >= 0x11) && !fHasInitWriteBlock)
+	{
+		fParallel = new CdRA_ParallelWrite(
+			(RA_NumEncThread > 0) ? (2*RA_NumEncThread + 1) : 1,
+			RA_BLOCK_SIZE_LIST[fSizeType]);
+	}
+	return (fParallel != NULL);
+}
+
+ssize_t CdRA_Write::ParallelWrite(const void *Buffer, ssize_t Count)
+{
+	fParallel->Write(*this, (const C_UInt8*)Buffer, Count);
+	fOwner.fTotalIn += Count;
+	return Count;
+}
+
+void CdRA_Write::ParallelSync()
+{
+	if (fParallel) fParallel->Sync(*this);
+}
+
+void CdRA_Write::InitWriteStream()
+{
+	// get the base position
+	fOwner.fStreamBase = fOwner.fStream->Position();
+	// write the magic number
+	WriteMagicNumber(*fOwner.fStream);
+	// write the version of this algorithm, v1.0
+	fOwner.fStream->W8b(fVersion);
+	// write the parameter of block size
+	fOwner.fStream->W8b(fSizeType);
+	// write the number of independent blocks, -1 for unknown
+	BYTE_LE<CdStream>(fOwner.fStream) << C_Int32(-1);
+	// set values
+	fBlockListStart = fOwner.fStreamPos = fOwner.fStream->Position();
+	// version
+	if (fVersion >= 0x11)
+	{
+		BYTE_LE<CdStream>(fOwner.fStream) << TdGDSPos(0);
+		fOwner.fStreamPos += GDS_POS_SIZE;
+		fBlockListStart = fOwner.fStreamPos;
+	}
+	// set total out
+	fOwner.fTotalOut = (fOwner.fStreamPos - fOwner.fStreamBase);
+	fHasInitWriteBlock = false;
+}
+
+void CdRA_Write::DoneWriteStream()
+{
+	DoneWriteBlock();
+	if (fVersion == 0x10)
+	{
+		// write the ending code, zero filling
+		C_UInt64 Val = 0;
+		fOwner.fStream->WriteData(&Val, SIZE_RA_BLOCK_HEADER);
+		fOwner.fStreamPos += SIZE_RA_BLOCK_HEADER;
+		fOwner.fTotalOut = fOwner.fStreamPos - fOwner.fStreamBase;
+	}
+	fHasInitWriteBlock = false;
+	// save position
+	SIZE64 OldPos = fOwner.fStreamPos;
+
+	// write down the number of independent blocks
 	if (fVersion == 0x10)
 	{
 		fOwner.fStream->SetPosition(fBlockListStart - sizeof(C_Int32));
 		BYTE_LE<CdStream>(fOwner.fStream) << C_Int32(fBlockNum);
-	} else if (fVersion == 0x11)
+	} else if (fVersion >= 0x11)
 	{
 		fOwner.fStream->SetPosition(fBlockListStart - sizeof(C_Int32) -
 			GDS_POS_SIZE);
@@ -826,6 +1749,12 @@ void CdRA_Write::DoneWriteStream()
 			};
 			fOwner.fStream->WriteData(SZ, SIZE_RA_BLOCK_HEADER);
 		}
+		// store the checksums of raw blocks
+		if (fVersion == 0x12)
+		{
+			for (ssize_t i=0; i < fBlockNum; i++)
+				BYTE_LE<CdStream>(fOwner.fStream) << fChecksumList[i];
+		}
 	}
 
 	// reset stream position
@@ -872,9 +1801,10 @@ void CdRA_Write::DoneWriteBlock()
 			fOwner.fStream->WriteData(SZ, SIZE_RA_BLOCK_HEADER);
 			fOwner.fStream->SetPosition(fOwner.fStreamPos);
 			fBlockNum ++;
-		} else if (fVersion == 0x11)
+		} else if (fVersion >= 0x11)
 		{
-			// add indexing info to fBlockInfoList
+			// add indexing info to fBlockInfoList (no checksum, since a
+			// block of version 0x12 is always compressed by fEncodeProc)
 			AddBlockInfo(SC, SU);
 		}
 		// reset
@@ -882,13 +1812,86 @@ void CdRA_Write::DoneWriteBlock()
 	}
 }
 
-void CdRA_Write::AddBlockInfo(C_UInt32 CmpLen, C_UInt32 RawLen)
+void CdRA_Write::AddBlockInfo(C_UInt32 CmpLen, C_UInt32 RawLen,
+	C_UInt64 Checksum)
 {
-	if (fVersion == 0x11)
+	if (fVersion >= 0x11)
 		fBlockInfoList.push_back(CmpLen | (C_UInt64(RawLen) << 32));
+	if (fVersion == 0x12)
+		fChecksumList.push_back(Checksum);
 	fBlockNum ++;
 }
 
+/// the size of data sampled for training a dictionary, relative to the
+/// maximum size of dictionary
+static const size_t RA_DICT_SAMPLE_FACTOR = 16;
+/// no dictionary if the data are less than this factor times the maximum
+/// size of dictionary
+static const size_t RA_DICT_MIN_FACTOR = 2;
+/// the size of segments copied from the sample to a dictionary
+static const size_t RA_DICT_SEGMENT = 2048;
+
+/// build a dictionary from the segments evenly spaced over the sample,
+/// since neither zlib nor LZ4 provides a trainer; the content at the end of
+/// the dictionary is the cheapest to refer to, so the first data are there
+static void RA_TrainDict(const vector<C_UInt8> &Sample, size_t MaxSize,
+	vector<C_UInt8> &Dict)
+{
+	const size_t n = MaxSize / RA_DICT_SEGMENT;
+	const size_t step = Sample.size() / n;
+	Dict.resize(n * RA_DICT_SEGMENT);
+	C_UInt8 *p = Dict.data() + Dict.size();
+	for (size_t i=0; i < n; i++)
+	{
+		p -= RA_DICT_SEGMENT;
+		memcpy(p, &Sample[i*step], RA_DICT_SEGMENT);
+	}
+}
+
+void CdRA_Write::SetDict(vector<C_UInt8> &Dict)
+{
+	if (fDictMaxSize <= 0) return;
+	if (!Dict.empty())
+	{
+		fDict = Dict;
+		if (fDict.size() > fDictMaxSize)
+			fDict.erase(fDict.begin(), fDict.end() - fDictMaxSize);
+		InitDict();
+	} else {
+		fDictTrain = true;
+		fDictOut = &Dict;
+	}
+}
+
+ssize_t CdRA_Write::DictWrite(const void *Buffer, ssize_t Count)
+{
+	const C_UInt8 *p = (const C_UInt8*)Buffer;
+	fDictSample.insert(fDictSample.end(), p, p + Count);
+	fOwner.fTotalIn += Count;
+	if (fDictSample.size() >= RA_DICT_SAMPLE_FACTOR*fDictMaxSize)
+		DictSync();
+	return Count;
+}
+
+void CdRA_Write::DictSync()
+{
+	if (!fDictTrain) return;
+	fDictTrain = false;
+	vector<C_UInt8> Sample;
+	Sample.swap(fDictSample);
+	if (Sample.size() >= RA_DICT_MIN_FACTOR*fDictMaxSize)
+	{
+		RA_TrainDict(Sample, fDictMaxSize, fDict);
+		if (fDictOut) *fDictOut = fDict;
+		InitDict();
+	}
+	fDictOut = NULL;
+	// write the buffered data
+	fOwner.fTotalIn -= Sample.size();
+	if (!Sample.empty())
+		fOwner.WriteData(Sample.data(), Sample.size());
+}
+
 
 // =====================================================================
 // The classes of ZLIB stream
@@ -1186,6 +2189,8 @@ static const C_UInt8 ZRA_MAGIC_HEADER[ZRA_MAGIC_HEADER_SIZE] =
 #define ZRA_WINDOW_BITS_64K    -13
 #define ZRA_WINDOW_BITS_128K   -14
 #define ZRA_WINDOW_BITS        -15
+// the maximum size of dictionary, the largest window
+#define ZRA_DICT_SIZE          32768
 
 // See: http://www.zlib.net/ChangeLog.txt
 #ifdef ZLIB_VERNUM
@@ -1199,15 +2204,54 @@ static const C_UInt8 ZRA_MAGIC_HEADER[ZRA_MAGIC_HEADER_SIZE] =
 #endif
 
 
+/// the window bits of ZIP blocks
+static int ZRA_BlockWindowBits(int BK)
+{
+	return BK==CdRAAlgorithm::ra16KB  ? ZRA_WINDOW_BITS_16K :
+		(BK==CdRAAlgorithm::ra32KB  ? ZRA_WINDOW_BITS_32K :
+		(BK==CdRAAlgorithm::ra64KB  ? ZRA_WINDOW_BITS_64K :
+		(BK==CdRAAlgorithm::ra128KB ? ZRA_WINDOW_BITS_128K : ZRA_WINDOW_BITS)));
+}
+
+/// compress an entire ZIP block in parallel, the largest window is used
+/// with a dictionary
+static void ZRA_EncodeBlock(const C_UInt8 *In, size_t InSize,
+	vector<C_UInt8> &Out, int Level, int SizeType, const C_UInt8 *Dict,
+	size_t DictSize)
+{
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	#define Z_DEFLATED 8
+	ZCheck(deflateInit2_(&z, ZLevels[Level], Z_DEFLATED,
+		Dict ? ZRA_WINDOW_BITS : ZRA_BlockWindowBits(SizeType),
+		Z_DEFAULT_MEMORY, Z_DEFAULT_STRATEGY, ZLIB_VERSION, sizeof(z)));
+	#undef Z_DEFLATED
+	if (Dict)
+	{
+		int ZResult = deflateSetDictionary(&z, Dict, DictSize);
+		if (ZResult != Z_OK)
+			{ deflateEnd(&z); throw EZLibError(ZResult); }
+	}
+	Out.resize(deflateBound(&z, InSize));
+	z.next_in = (Bytef*)In;
+	z.avail_in = InSize;
+	z.next_out = (Bytef*)Out.data();
+	z.avail_out = Out.size();
+	int ZResult = deflate(&z, Z_FINISH);
+	Out.resize(z.total_out);
+	deflateEnd(&z);
+	if (ZResult != Z_STREAM_END)
+		throw EZLibError((ZResult < 0) ? ZResult : Z_BUF_ERROR);
+}
+
 CdZEncoder_RA::CdZEncoder_RA(CdStream &Dest, TLevel Level,
 	TBlockSize BK): CdRA_Write(this, BK),
-	CdZEncoder( Dest, Level,
-		 BK==ra16KB  ? ZRA_WINDOW_BITS_16K :
-		(BK==ra32KB  ? ZRA_WINDOW_BITS_32K :
-		(BK==ra64KB  ? ZRA_WINDOW_BITS_64K :
-		(BK==ra128KB ? ZRA_WINDOW_BITS_128K : ZRA_WINDOW_BITS))) )
+	CdZEncoder(Dest, Level, ZRA_BlockWindowBits(BK))
 {
 	fBlockZIPSize = fCurBlockZIPSize = RA_BLOCK_SIZE_LIST[BK];
+	fEncodeProc = ZRA_EncodeBlock;
+	fEncodeLevel = Level;
+	fDictMaxSize = ZRA_DICT_SIZE;
 	InitWriteStream();
 }
 
@@ -1216,12 +2260,22 @@ ssize_t CdZEncoder_RA::Write(const void *Buffer, ssize_t Count)
 	if (fHaveClosed)
 		throw EZLibError(ERR_ZDEFLATE_CLOSED);
 	if (Count <= 0) return 0;
+	if (fDictTrain)
+		return DictWrite(Buffer, Count);
+	if (ParallelMode())
+	{
+		ssize_t rv = ParallelWrite(Buffer, Count);
+		fTotalOut = fStreamPos - fStreamBase;
+		return rv;
+	}
 
 	ssize_t OldCount = Count;
 	C_UInt8 *pBuf = (C_UInt8*)Buffer;
 
 	while (Count > 0)
 	{
+		if (!fHasInitWriteBlock && !fDict.empty())
+			ZCheck(deflateSetDictionary(&fZStream, fDict.data(), fDict.size()));
 		InitWriteBlock();
 
 		fZStream.next_in = (Bytef*)pBuf;
@@ -1274,6 +2328,7 @@ void CdZEncoder_RA::Close()
 				WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
 			PtrExtRec = NULL;
 		}
+		DictSync();
 		SyncFinishBlock();
 		DoneWriteStream();
 		fHaveClosed = true;
@@ -1287,6 +2342,7 @@ void CdZEncoder_RA::WriteMagicNumber(CdStream &Stream)
 
 void CdZEncoder_RA::SyncFinishBlock()
 {
+	ParallelSync();
 	if (fHasInitWriteBlock)
 	{
 		SyncFinish();
@@ -1298,12 +2354,28 @@ void CdZEncoder_RA::SyncFinishBlock()
 	}
 }
 
+void CdZEncoder_RA::InitDict()
+{
+	// the decoder always uses the largest window
+	deflateEnd(&fZStream);
+	#define Z_DEFLATED 8
+	ZCheck(deflateInit2_(&fZStream, ZLevels[fLevel], Z_DEFLATED,
+		ZRA_WINDOW_BITS, Z_DEFAULT_MEMORY, Z_DEFAULT_STRATEGY,
+		ZLIB_VERSION, sizeof(fZStream)));
+	#undef Z_DEFLATED
+	fZStream.next_out = fBuffer;
+	fZStream.avail_out = sizeof(fBuffer);
+}
+
 void CdZEncoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 {
 	if (dynamic_cast<CdZDecoder_RA*>(&Source))
 	{
 		CdZDecoder_RA *Src = static_cast<CdZDecoder_RA*>(&Source);
-		if ((Src->SizeType() == SizeType()) && (Src->fVersion == fVersion))
+		// the blocks are copied only if they are primed with the same
+		// dictionary
+		if ((Src->SizeType() == SizeType()) && (Src->fVersion == fVersion) &&
+			!fDictTrain && (Src->fDict == fDict))
 		{
 			Src->SetPosition(Pos);
 			if (Count < 0)
@@ -1341,7 +2413,8 @@ void CdZEncoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 					{
 						ZSize += Src->fCB_ZSize;
 						USize += Src->fCB_UZSize;
-						AddBlockInfo(Src->fCB_ZSize, Src->fCB_UZSize);
+						AddBlockInfo(Src->fCB_ZSize, Src->fCB_UZSize,
+							Src->BlockChecksum(Src->fBlockIdx));
 						Count -= Src->fCB_UZSize;
 						Pos += Src->fCB_UZSize;
 						Src->NextBlock();
@@ -1377,16 +2450,45 @@ void CdZEncoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 // Output stream for zlib with the support of random access
 // =====================================================================
 
+/// decode an entire ZIP block for read-ahead
+static void ZRA_DecodeBlock(const C_UInt8 *In, size_t InSize, C_UInt8 *Out,
+	size_t OutSize, int Param, const C_UInt8 *Dict, size_t DictSize)
+{
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	ZCheck(inflateInit2(&z, ZRA_WINDOW_BITS));
+	if (Dict)
+	{
+		int ZResult = inflateSetDictionary(&z, Dict, DictSize);
+		if (ZResult != Z_OK)
+			{ inflateEnd(&z); throw EZLibError(ZResult); }
+	}
+	z.next_in = (Bytef*)In;
+	z.avail_in = InSize;
+	z.next_out = (Bytef*)Out;
+	z.avail_out = OutSize;
+	int ZResult = inflate(&z, Z_FINISH);
+	size_t n = z.total_out;
+	inflateEnd(&z);
+	if (ZResult != Z_STREAM_END)
+		throw EZLibError((ZResult < 0) && (ZResult != Z_BUF_ERROR) ? ZResult : Z_DATA_ERROR);
+	if (n != OutSize)
+		throw EZLibError("Invalid ZIP block, inconsistent length.");
+}
+
 CdZDecoder_RA::CdZDecoder_RA(CdStream &Source):
 	CdRA_Read(this), CdZDecoder(Source, ZRA_WINDOW_BITS)
 {
 	InitReadStream();
+	fDecodeProc = ZRA_DecodeBlock;
 }
 
 ssize_t CdZDecoder_RA::Read(void *Buffer, ssize_t Count)
 {
 	if (Count <= 0) return 0;
 	if (fBlockIdx >= fBlockNum) return 0;
+	if (BlockReadActive())
+		return BlockRead(Buffer, Count, fCurPosition);
 
 	C_UInt8 *pBuf = (C_UInt8*)Buffer;
 	ssize_t OldCount = Count;
@@ -1432,9 +2534,12 @@ ssize_t CdZDecoder_RA::Read(void *Buffer, ssize_t Count)
 			// go to the next block
 			if (NextBlock())
 			{
-				fZStream.next_in = fBuffer;
-				fZStream.avail_in = 0;
-				ZCheck(inflateReset(&fZStream));
+				ResetBlock();
+				if (ReadAheadNext())
+				{
+					Count -= BlockRead(pBuf, Count, fCurPosition);
+					break;
+				}
 			} else
 				break;
 		}
@@ -1451,13 +2556,21 @@ SIZE64 CdZDecoder_RA::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
 {
 	if (Origin == soCurrent)
 	{
+		// Position(), valid even if the stream is empty
+		if (Offset == 0) return fCurPosition;
 		Offset += fCurPosition;
 		if (Offset < 0)
 			throw EZLibError(ERR_ZINFLATE_INVALID, "Seek");
 	} else if (Origin == soEnd)
 		throw EZLibError(ERR_ZINFLATE_INVALID, "Seek");
 
+	C_Int32 OldBlockIdx = fBlockIdx;
 	bool flag = SeekStream(Offset);
+	if (BlockReadSeek(OldBlockIdx, flag))
+	{
+		fCurPosition = Offset;
+		return fCurPosition;
+	}
 	if (flag || (Offset < fCurPosition))
 		Reset();
 
@@ -1483,17 +2596,30 @@ bool CdZDecoder_RA::ReadMagicNumber(CdStream &Stream)
 	return (memcmp(Header, ZRA_MAGIC_HEADER, ZRA_MAGIC_HEADER_SIZE) == 0);
 }
 
+void CdZDecoder_RA::SetDict(const vector<C_UInt8> &Dict)
+{
+	CdRA_Read::SetDict(Dict);
+	Reset();
+}
+
 void CdZDecoder_RA::Reset()
 {
-	fZStream.next_in = fBuffer;
-	fZStream.avail_in = 0;
-	ZCheck(inflateReset(&fZStream));
+	ResetBlock();
 	fStreamPos = fCB_ZStart;
 	if (fVersion == 0x10)
 		fStreamPos += SIZE_RA_BLOCK_HEADER;
 	fCurPosition = fCB_UZStart;
 }
 
+void CdZDecoder_RA::ResetBlock()
+{
+	fZStream.next_in = fBuffer;
+	fZStream.avail_in = 0;
+	ZCheck(inflateReset(&fZStream));
+	if (!fDict.empty())
+		ZCheck(inflateSetDictionary(&fZStream, fDict.data(), fDict.size()));
+}
+
 // EZLibError
 
 EZLibError::EZLibError(int Code): ErrRecodeStream()
@@ -1789,6 +2915,79 @@ static const C_UInt8 LZ4_MAGIC_HEADER[LZ4_MAGIC_HEADER_SIZE] =
 	{ 'L', 'Z', '4', '_', 'R', 'A', 0x10 };
 static const char *ERR_LZ4_COMPRESSING =
 	"Internal error in CdLZ4Encoder_RA::Compressing().";
+// the maximum size of dictionary, half of the LZ4 window, since a larger
+// dictionary costs more than it saves on short strings
+#define LZ4RA_DICT_SIZE           32768
+
+/// compress an entire LZ4 block in parallel, in the same chunks as
+/// CdLZ4Encoder_RA::Compressing() with double buffering
+static void LZ4RA_EncodeBlock(const C_UInt8 *In, size_t InSize,
+	vector<C_UInt8> &Out, int Level, int SizeType, const C_UInt8 *Dict,
+	size_t DictSize)
+{
+	void *ptr = NULL;
+	switch (Level)
+	{
+	case CdRecodeStream::clMin:
+		break;
+	case CdRecodeStream::clFast:
+		ptr = calloc(1, sizeof(LZ4_stream_t)); break;
+	case CdRecodeStream::clDefault: case CdRecodeStream::clMax:
+		ptr = LZ4_createStreamHC();
+		if (ptr)
+			LZ4_resetStreamHC((LZ4_streamHC_t*)ptr, LZ4DeflateLevel[Level]);
+		break;
+	default:
+		throw ELZ4Error(ERR_LZ4_COMPRESSING);
+	}
+	if (!ptr && (Level != CdRecodeStream::clMin))
+		throw ELZ4Error("LZ4RA_EncodeBlock: failed to allocate LZ4 stream.");
+	if (Dict && (Level == CdRecodeStream::clFast))
+		LZ4_loadDict((LZ4_stream_t*)ptr, (const char*)Dict, DictSize);
+	else if (Dict && ptr)
+		LZ4_loadDictHC((LZ4_streamHC_t*)ptr, (const char*)Dict, DictSize);
+
+	vector<char> raw(2 * LZ4RA_RAW_BUFFER_SIZE);
+	Out.resize((InSize / LZ4RA_RAW_BUFFER_SIZE + 1) *
+		(LZ4RA_LZ4_BUFFER_SIZE + 2));
+	size_t n = 0;
+	// the second chunk is not contiguous to the first one, so it refers to
+	// the first chunk only, but not the dictionary
+	int idx = Dict ? 1 : 0, cmpBytes = 0;
+	for (size_t i=0; i < InSize; i += LZ4RA_RAW_BUFFER_SIZE)
+	{
+		int bufsize = (InSize - i < LZ4RA_RAW_BUFFER_SIZE) ?
+			(InSize - i) : LZ4RA_RAW_BUFFER_SIZE;
+		char *pRaw = &raw[idx * LZ4RA_RAW_BUFFER_SIZE];
+		char *pOut = (char*)&Out[n + 2];
+		memcpy(pRaw, In + i, bufsize);
+		switch (Level)
+		{
+		case CdRecodeStream::clMin:
+			memcpy(pOut, pRaw, bufsize);
+			cmpBytes = bufsize; break;
+		case CdRecodeStream::clFast:
+			cmpBytes = LZ4_compress_fast_continue((LZ4_stream_t*)ptr,
+				pRaw, pOut, bufsize, LZ4_compressBound(bufsize), 1);
+			break;
+		default:
+			cmpBytes = LZ4_compress_HC_continue((LZ4_streamHC_t*)ptr,
+				pRaw, pOut, bufsize, LZ4_compressBound(bufsize));
+		}
+		if (cmpBytes <= 0) break;
+		Out[n] = cmpBytes & 0xFF;
+		Out[n+1] = (cmpBytes >> 8) & 0xFF;
+		n += 2 + cmpBytes;
+		idx = 1 - idx;
+	}
+	if (Level == CdRecodeStream::clFast)
+		free(ptr);
+	else if (ptr)
+		LZ4_freeStreamHC((LZ4_streamHC_t*)ptr);
+	if (cmpBytes <= 0)
+		throw ELZ4Error(ERR_LZ4_COMPRESSING);
+	Out.resize(n);
+}
 
 CdLZ4Encoder_RA::CdLZ4Encoder_RA(CdStream &Dest, TLevel Level, TBlockSize BK):
 	CdRA_Write(this, BK), CdBaseLZ4Stream(Dest), CdRecodeLevel(Level)
@@ -1816,6 +3015,10 @@ CdLZ4Encoder_RA::CdLZ4Encoder_RA(CdStream &Dest, TLevel Level, TBlockSize BK):
 	_IdxRaw = 0;
 
 	fBlockLZ4Size = fCurBlockLZ4Size = RA_BLOCK_SIZE_LIST[BK];
+	fEncodeProc = LZ4RA_EncodeBlock;
+	fEncodeLevel = Level;
+	// no dictionary without compression
+	fDictMaxSize = (Level != clMin) ? LZ4RA_DICT_SIZE : 0;
 	InitWriteStream();
 }
 
@@ -1843,6 +3046,10 @@ ssize_t CdLZ4Encoder_RA::Write(const void *Buffer, ssize_t Count)
 	if (fHaveClosed)
 		throw ELZ4Error(ERR_LZ4_DEFLATE_CLOSED);
 	if (Count <= 0) return 0;
+	if (fDictTrain)
+		return DictWrite(Buffer, Count);
+	if (ParallelMode())
+		return ParallelWrite(Buffer, Count);
 
 	ssize_t OldCount = Count;
 	C_UInt8 *pBuf = (C_UInt8*)Buffer;
@@ -1865,6 +3072,22 @@ ssize_t CdLZ4Encoder_RA::Write(const void *Buffer, ssize_t Count)
 			default:
 				break;
 			}
+			if (!fDict.empty())
+			{
+				// the second chunk is not contiguous to the first one, so
+				// it does not refer to the dictionary
+				_IdxRaw = 1;
+				pRaw = fRawBuffer[_IdxRaw];
+				if (fLevel == clFast)
+				{
+					LZ4_loadDict((LZ4_stream_t*)fLZ4Ptr,
+						(const char*)fDict.data(), fDict.size());
+				} else if (fLZ4Ptr)
+				{
+					LZ4_loadDictHC((LZ4_streamHC_t*)fLZ4Ptr,
+						(const char*)fDict.data(), fDict.size());
+				}
+			}
 		}
 		InitWriteBlock();
 
@@ -1918,6 +3141,8 @@ void CdLZ4Encoder_RA::Close()
 				WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
 			PtrExtRec = NULL;
 		}
+		DictSync();
+		ParallelSync();
 		fCurBlockLZ4Size = 0;
 		Compressing(LZ4RA_RAW_BUFFER_SIZE - fUnusedRawSize);
 		DoneWriteStream();
@@ -1995,7 +3220,10 @@ void CdLZ4Encoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 	if (dynamic_cast<CdLZ4Decoder_RA*>(&Source))
 	{
 		CdLZ4Decoder_RA *Src = static_cast<CdLZ4Decoder_RA*>(&Source);
-		if ((Src->SizeType() == SizeType()) && (Src->fVersion == fVersion))
+		// the blocks are copied only if they are primed with the same
+		// dictionary
+		if ((Src->SizeType() == SizeType()) && (Src->fVersion == fVersion) &&
+			!fDictTrain && (Src->fDict == fDict))
 		{
 			Src->SetPosition(Pos);
 			if (Count < 0)
@@ -2025,6 +3253,7 @@ void CdLZ4Encoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 				Src->SeekStream(Pos);
 				if ((Src->fCB_UZStart + Src->fCB_UZSize) <= (Pos + Count))
 				{
+					ParallelSync();
 					if (fHasInitWriteBlock)
 					{
 						fCurBlockLZ4Size = 0;
@@ -2038,7 +3267,8 @@ void CdLZ4Encoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 					{
 						ZSize += Src->fCB_ZSize;
 						USize += Src->fCB_UZSize;
-						AddBlockInfo(Src->fCB_ZSize, Src->fCB_UZSize);
+						AddBlockInfo(Src->fCB_ZSize, Src->fCB_UZSize,
+							Src->BlockChecksum(Src->fBlockIdx));
 						Count -= Src->fCB_UZSize;
 						Pos += Src->fCB_UZSize;
 						Src->NextBlock();
@@ -2073,21 +3303,72 @@ void CdLZ4Encoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 
 // CdLZ4Decoder_RA
 
+/// decode an entire LZ4 block for read-ahead, 'Param' is the compression
+/// level; the chunks are decoded into consecutive memory, so the previous
+/// chunk is still available as the dictionary
+static void LZ4RA_DecodeBlock(const C_UInt8 *In, size_t InSize, C_UInt8 *Out,
+	size_t OutSize, int Param, const C_UInt8 *Dict, size_t DictSize)
+{
+	LZ4_streamDecode_t lz4_body;
+	memset(&lz4_body, 0, sizeof(lz4_body));
+	if (Dict)
+		LZ4_setStreamDecode(&lz4_body, (const char*)Dict, DictSize);
+	const C_UInt8 *pIn = In, *pInEnd = In + InSize;
+	C_UInt8 *pOut = Out, *pOutEnd = Out + OutSize;
+	while (pIn < pInEnd)
+	{
+		if (pInEnd - pIn < 2)
+			throw ELZ4Error("Invalid LZ4 block for random access");
+		size_t Len = pIn[0] | (size_t(pIn[1]) << 8);
+		pIn += 2;
+		if ((ssize_t)Len > pInEnd - pIn)
+			throw ELZ4Error("Invalid LZ4 block for random access");
+		size_t Cap = pOutEnd - pOut;
+		if (Cap > LZ4RA_RAW_BUFFER_SIZE) Cap = LZ4RA_RAW_BUFFER_SIZE;
+		if (Param != CdRecodeStream::clMin)
+		{
+			int decBytes = LZ4_decompress_safe_continue(&lz4_body,
+				(const char*)pIn, (char*)pOut, Len, Cap);
+			if (decBytes <= 0)
+				throw ELZ4Error("Invalid LZ4 block for random access");
+			pOut += decBytes;
+		} else {
+			if (Len > Cap)
+				throw ELZ4Error("Invalid LZ4 block for random access");
+			memcpy(pOut, pIn, Len);
+			pOut += Len;
+		}
+		pIn += Len;
+	}
+	if (pOut != pOutEnd)
+		throw ELZ4Error("Invalid LZ4 block for random access");
+}
+
 CdLZ4Decoder_RA::CdLZ4Decoder_RA(CdStream &Source):
 	CdRA_Read(this), CdBaseLZ4Stream(Source)
 {
 	fLevel = clUnknown;
+	fRawBuffer[0] = fRawBuffer[1] = NULL;
 	InitReadStream();
 	_IdxRaw = 1;
 	fCurPosition = 0;
 	memset(&lz4_body, 0, sizeof(lz4_body));
 	iRaw = CntRaw = 0;
+	fDecodeProc = LZ4RA_DecodeBlock;
+	fDecodeParam = fLevel;
+}
+
+CdLZ4Decoder_RA::~CdLZ4Decoder_RA()
+{
+	if (fRawBuffer[0]) delete []fRawBuffer[0];
 }
 
 ssize_t CdLZ4Decoder_RA::Read(void *Buffer, ssize_t Count)
 {
 	if (Count <= 0) return 0;
 	if (fBlockIdx >= fBlockNum) return 0;
+	if (BlockReadActive())
+		return BlockRead(Buffer, Count, fCurPosition);
 
 	C_UInt8 *pBuf = (C_UInt8*)Buffer;
 	ssize_t OldCount = Count;
@@ -2095,56 +3376,76 @@ ssize_t CdLZ4Decoder_RA::Read(void *Buffer, ssize_t Count)
 
 	while (Count > 0)
 	{
-		if (CntRaw <= 0)
+		if ((CntRaw <= 0) && (fCurPosition == fCB_UZStart) &&
+			(Count >= fCB_UZSize))
 		{
-			UpdateStreamPosition();
-			C_UInt16 Len;
-			BYTE_LE<CdStream>(fStream) >> Len;
-
-			if (fLevel != clMin)
+			// the entire block is requested, skip the raw buffer
+			DecodeBlock(pBuf);
+			fCurPosition += fCB_UZSize;
+			Count -= fCB_UZSize;
+			pBuf += fCB_UZSize;
+		} else {
+			if (CntRaw <= 0)
 			{
-				char LZ4Buffer[65536];
-				fStream->ReadData(LZ4Buffer, Len);
-				fStreamPos += sizeof(Len) + Len;
-
-	            _IdxRaw = 1 - _IdxRaw;
-				int decBytes = LZ4_decompress_safe_continue(
-					&lz4_body, LZ4Buffer, fRawBuffer[_IdxRaw], Len,
-					LZ4RA_RAW_BUFFER_SIZE);
-	            if(decBytes <= 0)
-    	        	break;
-	            CntRaw = decBytes;
-	            pRaw = fRawBuffer[_IdxRaw];
-	        } else {
-				fStream->ReadData(fRawBuffer[_IdxRaw], Len);
-				fStreamPos += sizeof(Len) + Len;
-	            CntRaw = Len;
-	        }
-            iRaw = 0;
-		}
+				if (!fRawBuffer[0])
+				{
+					fRawBuffer[0] = new char[2*LZ4RA_RAW_BUFFER_SIZE];
+					fRawBuffer[1] = fRawBuffer[0] + LZ4RA_RAW_BUFFER_SIZE;
+				}
+				UpdateStreamPosition();
+				C_UInt16 Len;
+				BYTE_LE<CdStream>(fStream) >> Len;
 
-		ssize_t L = Count;
-		if (L > (CntRaw - iRaw)) L = CntRaw - iRaw;
-		memcpy(pBuf, &pRaw[iRaw], L);
-		fCurPosition += L;
-		Count -= L;
-		pBuf += L;
+				if (fLevel != clMin)
+				{
+					char LZ4Buffer[65536];
+					fStream->ReadData(LZ4Buffer, Len);
+					fStreamPos += sizeof(Len) + Len;
+
+					_IdxRaw = 1 - _IdxRaw;
+					int decBytes = LZ4_decompress_safe_continue(
+						&lz4_body, LZ4Buffer, fRawBuffer[_IdxRaw], Len,
+						LZ4RA_RAW_BUFFER_SIZE);
+					if(decBytes <= 0)
+						break;
+					CntRaw = decBytes;
+				} else {
+					fStream->ReadData(fRawBuffer[_IdxRaw], Len);
+					fStreamPos += sizeof(Len) + Len;
+					CntRaw = Len;
+				}
+				pRaw = fRawBuffer[_IdxRaw];
+				iRaw = 0;
+			}
 
-		iRaw += L;
-		if (iRaw >= CntRaw)
-		{
+			ssize_t L = Count;
+			if (L > (CntRaw - iRaw)) L = CntRaw - iRaw;
+			memcpy(pBuf, &pRaw[iRaw], L);
+			fCurPosition += L;
+			Count -= L;
+			pBuf += L;
+
+			iRaw += L;
+			if (iRaw < CntRaw) continue;
 			CntRaw = 0;
-			SIZE64 b = fCurPosition - fCB_UZStart;
-			if (b == fCB_UZSize)
+		}
+
+		SIZE64 b = fCurPosition - fCB_UZStart;
+		if (b == fCB_UZSize)
+		{
+			// go to the next block
+			if (NextBlock())
 			{
-				// go to the next block
-				if (NextBlock())
-					memset(&lz4_body, 0, sizeof(lz4_body));
-				else
+				ResetBlock();
+				if (ReadAheadNext())
+				{
+					Count -= BlockRead(pBuf, Count, fCurPosition);
 					break;
-			} else if (b > fCB_UZSize)
-				throw ELZ4Error("Invalid LZ4 block for random access");
-		}
+				}
+			} else
+				break;
+		} else if (b > fCB_UZSize)
+			throw ELZ4Error("Invalid LZ4 block for random access");
 	}
 
 	SIZE64 tmp = fStreamPos - fStreamBase;
@@ -2154,6 +3455,38 @@ ssize_t CdLZ4Decoder_RA::Read(void *Buffer, ssize_t Count)
 	return OldCount - Count;
 }
 
+void CdLZ4Decoder_RA::DecodeBlock(C_UInt8 *Buffer)
+{
+	// the chunks are decoded into consecutive memory, so the previous chunk
+	// is still available as the dictionary
+	C_UInt8 *pEnd = Buffer + fCB_UZSize;
+	while (Buffer < pEnd)
+	{
+		UpdateStreamPosition();
+		C_UInt16 Len;
+		BYTE_LE<CdStream>(fStream) >> Len;
+		ssize_t Cap = pEnd - Buffer;
+		if (Cap > LZ4RA_RAW_BUFFER_SIZE) Cap = LZ4RA_RAW_BUFFER_SIZE;
+
+		if (fLevel != clMin)
+		{
+			char LZ4Buffer[65536];
+			fStream->ReadData(LZ4Buffer, Len);
+			int decBytes = LZ4_decompress_safe_continue(&lz4_body,
+				LZ4Buffer, (char*)Buffer, Len, Cap);
+			if (decBytes <= 0)
+				throw ELZ4Error("Invalid LZ4 block for random access");
+			Buffer += decBytes;
+		} else {
+			if (Len > Cap)
+				throw ELZ4Error("Invalid LZ4 block for random access");
+			fStream->ReadData(Buffer, Len);
+			Buffer += Len;
+		}
+		fStreamPos += sizeof(Len) + Len;
+	}
+}
+
 ssize_t CdLZ4Decoder_RA::Write(const void *Buffer, ssize_t Count)
 {
 	throw ELZ4Error(ERR_LZ4_INFLATE_INVALID, "Write");
@@ -2163,13 +3496,21 @@ SIZE64 CdLZ4Decoder_RA::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
 {
 	if (Origin == soCurrent)
 	{
+		// Position(), valid even if the stream is empty
+		if (Offset == 0) return fCurPosition;
 		Offset += fCurPosition;
 		if (Offset < 0)
 			throw ELZ4Error(ERR_LZ4_INFLATE_INVALID, "Seek");
 	} else if (Origin == soEnd)
 		throw ELZ4Error(ERR_LZ4_INFLATE_INVALID, "Seek");
 
+	C_Int32 OldBlockIdx = fBlockIdx;
 	bool flag = SeekStream(Offset);
+	if (BlockReadSeek(OldBlockIdx, flag))
+	{
+		fCurPosition = Offset;
+		return fCurPosition;
+	}
 	if (flag || (Offset < fCurPosition))
 		Reset();
 
@@ -2210,9 +3551,15 @@ bool CdLZ4Decoder_RA::ReadMagicNumber(CdStream &Stream)
 		return false;
 }
 
+void CdLZ4Decoder_RA::SetDict(const vector<C_UInt8> &Dict)
+{
+	CdRA_Read::SetDict(Dict);
+	Reset();
+}
+
 void CdLZ4Decoder_RA::Reset()
 {
-	memset(&lz4_body, 0, sizeof(lz4_body));
+	ResetBlock();
 	iRaw = CntRaw = 0;
 	fStreamPos = fCB_ZStart;
 	if (fVersion == 0x10)
@@ -2220,6 +3567,16 @@ void CdLZ4Decoder_RA::Reset()
 	fCurPosition = fCB_UZStart;
 }
 
+void CdLZ4Decoder_RA::ResetBlock()
+{
+	memset(&lz4_body, 0, sizeof(lz4_body));
+	if (!fDict.empty())
+	{
+		LZ4_setStreamDecode(&lz4_body, (const char*)fDict.data(),
+			fDict.size());
+	}
+}
+
 #endif
 
 
@@ -2282,12 +3639,48 @@ CdBaseXZStream::CdBaseXZStream(CdStream &vStream): CdRecodeStream(vStream)
 
 // CdXZEncoder
 
-CdXZEncoder::CdXZEncoder(CdStream &Dest, TLevel Level):
+/// the number of threads of the multithreaded xz encoder
+static std::atomic<int> XZ_NumThread(0);
+/// the uncompressed block size of the multithreaded xz encoder
+static std::atomic<C_Int64> XZ_BlockSize(0);
+
+/// initialize a xz encoder with the LZMA2 filter options 'opt_lzma', or
+/// the preset 'Preset' if 'opt_lzma' is NULL; the multithreaded encoder
+/// splits the data into independent xz blocks, which can be read by any
+/// xz decoder
+static void XZ_InitStreamEncoder(lzma_stream &XZStream, C_UInt32 Preset,
+	lzma_options_lzma *opt_lzma, int NumThread)
+{
+	lzma_filter filters[2];
+	filters[0].id = LZMA_FILTER_LZMA2;
+	filters[0].options = opt_lzma;
+	filters[1].id = LZMA_VLI_UNKNOWN;
+#if defined(LZMA_VERSION) && (LZMA_VERSION >= 50020002)
+	if (NumThread > 1)
+	{
+		lzma_mt mt;
+		memset((void*)&mt, 0, sizeof(mt));
+		mt.threads = NumThread;
+		mt.block_size = XZ_BlockSize;
+		mt.preset = Preset;
+		mt.filters = opt_lzma ? filters : NULL;
+		mt.check = LZMA_CHECK_CRC32;
+		XZCheck(lzma_stream_encoder_mt(&XZStream, &mt));
+		return;
+	}
+#endif
+	if (opt_lzma)
+		XZCheck(lzma_stream_encoder(&XZStream, filters, LZMA_CHECK_CRC32));
+	else
+		XZCheck(lzma_easy_encoder(&XZStream, Preset, LZMA_CHECK_CRC32));
+}
+
+CdXZEncoder::CdXZEncoder(CdStream &Dest, TLevel Level, bool Parallel):
 	CdBaseXZStream(Dest), CdRecodeLevel(Level)
 {
 	PtrExtRec = NULL;
 	fHaveClosed = false;
-	InitXZStream();
+	InitXZStream(Parallel ? XZ_NumThread.load() : 0);
 }
 
 CdXZEncoder::CdXZEncoder(CdStream &Dest, int DictKB):
@@ -2302,12 +3695,7 @@ CdXZEncoder::CdXZEncoder(CdStream &Dest, int DictKB):
 	if (lzma_lzma_preset(&opt_lzma, 9 | LZMA_PRESET_EXTREME))
 		throw EXZError("CdXZEncoder initialization internal error.");
 	opt_lzma.dict_size = DictKB * 1024;
-
-	lzma_filter filters[2];
-	filters[0].id = LZMA_FILTER_LZMA2;
-	filters[0].options = &opt_lzma;
-	filters[1].id = LZMA_VLI_UNKNOWN;
-	XZCheck(lzma_stream_encoder(&fXZStream, filters, LZMA_CHECK_CRC32));
+	XZ_InitStreamEncoder(fXZStream, 0, &opt_lzma, XZ_NumThread);
 }
 
 CdXZEncoder::~CdXZEncoder()
@@ -2316,28 +3704,44 @@ CdXZEncoder::~CdXZEncoder()
 	lzma_end(&fXZStream);
 }
 
-void CdXZEncoder::InitXZStream()
+void CdXZEncoder::SetParallel(int NumThread, C_Int64 BlockSize)
+{
+	if (NumThread < 0) NumThread = 0;
+	if (BlockSize < 0) BlockSize = 0;
+	XZ_NumThread = NumThread;
+	XZ_BlockSize = BlockSize;
+}
+
+void CdXZEncoder::GetParallel(int &NumThread, C_Int64 &BlockSize)
+{
+	NumThread = XZ_NumThread;
+	BlockSize = XZ_BlockSize;
+}
+
+/// initialize a xz encoder according to the compression level
+static void XZ_InitEncoder(lzma_stream &XZStream, int Level, int NumThread=0)
 {
-	if (clMin<=fLevel && fLevel<=clMax)
+	if (CdRecodeStream::clMin<=Level && Level<=CdRecodeStream::clMax)
 	{
-		XZCheck(lzma_easy_encoder(&fXZStream, XZLevels[fLevel],
-			LZMA_CHECK_CRC32));
-	} else if (fLevel==clUltra || fLevel==clUltraMax)
+		XZ_InitStreamEncoder(XZStream, XZLevels[Level], NULL, NumThread);
+	} else if (Level==CdRecodeStream::clUltra ||
+		Level==CdRecodeStream::clUltraMax)
 	{
 		lzma_options_lzma opt_lzma;
 		if (lzma_lzma_preset(&opt_lzma, 9 | LZMA_PRESET_EXTREME))
 			throw EXZError("CdXZEncoder initialization internal error.");
-		opt_lzma.dict_size = (fLevel==clUltra) ? 512*1024*1024 : (1024+512)*1024*1024; // 512MiB : 1.5GB
-		opt_lzma.depth = (fLevel==clUltra) ?  512*8: 65536;  // -9e with 512
-		lzma_filter filters[2];
-		filters[0].id = LZMA_FILTER_LZMA2;
-		filters[0].options = &opt_lzma;
-		filters[1].id = LZMA_VLI_UNKNOWN;
-		XZCheck(lzma_stream_encoder(&fXZStream, filters, LZMA_CHECK_CRC32));
+		opt_lzma.dict_size = (Level==CdRecodeStream::clUltra) ? 512*1024*1024 : (1024+512)*1024*1024; // 512MiB : 1.5GB
+		opt_lzma.depth = (Level==CdRecodeStream::clUltra) ?  512*8: 65536;  // -9e with 512
+		XZ_InitStreamEncoder(XZStream, 0, &opt_lzma, NumThread);
 	} else
 		throw EXZError("CdXZEncoder initialization level error.");
 }
 
+void CdXZEncoder::InitXZStream(int NumThread)
+{
+	XZ_InitEncoder(fXZStream, fLevel, NumThread);
+}
+
 ssize_t CdXZEncoder::Read(void *Buffer, ssize_t Count)
 {
 	throw EXZError(ERR_XZ_INFLATE_INVALID, "Read");
@@ -2561,10 +3965,31 @@ static const C_UInt8 XZ_RA_MAGIC_HEADER[XZ_RA_MAGIC_HEADER_SIZE] =
 	{ 'X', 'Z', '_', 'R', 'A', 0x10 };
 
 
+/// compress an entire xz block in parallel
+static void XZRA_EncodeBlock(const C_UInt8 *In, size_t InSize,
+	vector<C_UInt8> &Out, int Level, int SizeType, const C_UInt8 *,
+	size_t)
+{
+	lzma_stream XZStream = LZMA_STREAM_INIT;
+	XZ_InitEncoder(XZStream, Level);
+	Out.resize(lzma_stream_buffer_bound(InSize));
+	XZStream.next_in = In;
+	XZStream.avail_in = InSize;
+	XZStream.next_out = &Out[0];
+	XZStream.avail_out = Out.size();
+	lzma_ret ret;
+	while ((ret = lzma_code(&XZStream, LZMA_FINISH)) == LZMA_OK);
+	Out.resize(XZStream.total_out);
+	lzma_end(&XZStream);
+	if (ret != LZMA_STREAM_END) XZCheck(ret);
+}
+
 CdXZEncoder_RA::CdXZEncoder_RA(CdStream &Dest, TLevel Level,
-	TBlockSize B): CdRA_Write(this, B), CdXZEncoder(Dest, Level)
+	TBlockSize B): CdRA_Write(this, B), CdXZEncoder(Dest, Level, false)
 {
 	fBlockZIPSize = fCurBlockZIPSize = RA_BLOCK_SIZE_LIST[B];
+	fEncodeProc = XZRA_EncodeBlock;
+	fEncodeLevel = Level;
 	InitWriteStream();
 }
 
@@ -2573,6 +3998,12 @@ ssize_t CdXZEncoder_RA::Write(const void *Buffer, ssize_t Count)
 	if (fHaveClosed)
 		throw EXZError(ERR_ZDEFLATE_CLOSED);
 	if (Count <= 0) return 0;
+	if (ParallelMode())
+	{
+		ssize_t rv = ParallelWrite(Buffer, Count);
+		fTotalOut = fStreamPos - fStreamBase;
+		return rv;
+	}
 
 	C_UInt8 buf[8192];
 	ssize_t OldCount = Count;
@@ -2644,6 +4075,7 @@ void CdXZEncoder_RA::WriteMagicNumber(CdStream &Stream)
 
 void CdXZEncoder_RA::SyncFinishBlock()
 {
+	ParallelSync();
 	if (fHasInitWriteBlock)
 	{
 		fXZStream.avail_in = 0;
@@ -2698,7 +4130,8 @@ void CdXZEncoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 					{
 						ZSize += Src->fCB_ZSize;
 						USize += Src->fCB_UZSize;
-						AddBlockInfo(Src->fCB_ZSize, Src->fCB_UZSize);
+						AddBlockInfo(Src->fCB_ZSize, Src->fCB_UZSize,
+							Src->BlockChecksum(Src->fBlockIdx));
 						Count -= Src->fCB_UZSize;
 						Pos += Src->fCB_UZSize;
 						Src->NextBlock();
@@ -2732,16 +4165,38 @@ void CdXZEncoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
 
 // =====================================================================
 
+/// decode an entire xz block for read-ahead
+static void XZRA_DecodeBlock(const C_UInt8 *In, size_t InSize, C_UInt8 *Out,
+	size_t OutSize, int Param, const C_UInt8 *, size_t)
+{
+	lzma_stream xz = LZMA_STREAM_INIT;
+	XZCheck(lzma_stream_decoder(&xz, UINT64_MAX, XZ_DECODER_FLAG));
+	xz.next_in = In;
+	xz.avail_in = InSize;
+	xz.next_out = Out;
+	xz.avail_out = OutSize;
+	lzma_ret ret = lzma_code(&xz, LZMA_FINISH);
+	size_t n = xz.total_out;
+	lzma_end(&xz);
+	if (ret != LZMA_STREAM_END)
+		XZCheck((ret == LZMA_OK) ? LZMA_DATA_ERROR : ret);
+	if (n != OutSize)
+		throw EXZError("Invalid XZ block, inconsistent length.");
+}
+
 CdXZDecoder_RA::CdXZDecoder_RA(CdStream &Source): CdRA_Read(this),
 	CdXZDecoder(Source)
 {
 	InitReadStream();
+	fDecodeProc = XZRA_DecodeBlock;
 }
 
 ssize_t CdXZDecoder_RA::Read(void *Buffer, ssize_t Count)
 {
 	if (Count <= 0) return 0;
 	if (fBlockIdx >= fBlockNum) return 0;
+	if (BlockReadActive())
+		return BlockRead(Buffer, Count, fCurPosition);
 
 	ssize_t OriCount = Count;
 	C_UInt8 *pBuffer = (C_UInt8 *)Buffer;
@@ -2788,6 +4243,11 @@ ssize_t CdXZDecoder_RA::Read(void *Buffer, ssize_t Count)
 				lzma_end(&fXZStream);
 				XZCheck(lzma_stream_decoder(&fXZStream, UINT64_MAX, XZ_DECODER_FLAG));
 				fXZStream.avail_in = 0;
+				if (ReadAheadNext())
+				{
+					Count -= BlockRead(pBuffer, Count, fCurPosition);
+					break;
+				}
 			} else
 				break;
 		}
@@ -2804,13 +4264,21 @@ SIZE64 CdXZDecoder_RA::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
 {
 	if (Origin == soCurrent)
 	{
+		// Position(), valid even if the stream is empty
+		if (Offset == 0) return fCurPosition;
 		Offset += fCurPosition;
 		if (Offset < 0)
 			throw EXZError(ERR_XZ_INFLATE_INVALID, "Seek");
 	} else if (Origin == soEnd)
 		throw EXZError(ERR_XZ_INFLATE_INVALID, "Seek");
 
+	C_Int32 OldBlockIdx = fBlockIdx;
 	bool flag = SeekStream(Offset);
+	if (BlockReadSeek(OldBlockIdx, flag))
+	{
+		fCurPosition = Offset;
+		return fCurPosition;
+	}
 	if (flag || (Offset < fCurPosition))
 		Reset();
 
@@ -2852,154 +4320,1297 @@ void CdXZDecoder_RA::Reset()
 
 
 // =====================================================================
-// GDS block stream
+// The classes of zstd stream
+// =====================================================================
 
-static const char *ERR_BLOCK_INVALID_POS =
-	"Invalid Position: %lld in CdBlockStream (current blocksize: %lld).";
-static const char *ERR_INVALID_BLOCK_LEN =
-	"Invalid block length in CdBlockCollection!";
+#ifndef COREARRAY_NO_ZSTD
 
-// CoreArray GDS Stream position mask
-const C_Int64 CoreArray::GDS_STREAM_POS_MASK = 0x7FFFFFFFFFFFLL;
-const C_Int64 CoreArray::GDS_STREAM_POS_MASK_HEAD_BIT = 0x800000000000LL;
+static const char *ERR_ZSTD_DEFLATE_INVALID =
+	"Invalid zstd deflate stream operation '%s'!";
+static const char *ERR_ZSTD_INFLATE_INVALID =
+	"Invalid zstd inflate stream operation '%s'!";
+static const char *ERR_ZSTD_DEFLATE_CLOSED =
+	"zstd deflate stream has been closed.";
 
+static const int ZstdLevels[6] =
+{
+	1,   // clMin
+	3,   // clFast
+	9,   // clDefault
+	19,  // clMax
+	22,  // clUltra (128MiB window)
+	22   // clUltraMax (1GiB window with long distance matching)
+};
 
-// CdBlockStream
+/// the maximum window size allowed when decoding (2^31 for 64-bit)
+static const int ZSTD_WINDOW_LOG_MAX = (sizeof(size_t) == 4) ? 30 : 31;
 
-inline static void xClearList(CdBlockStream::TBlockInfo *Head)
+COREARRAY_INLINE static size_t ZstdCheck(size_t code)
 {
-	for (CdBlockStream::TBlockInfo *p=Head; p; )
+	if (ZSTD_isError(code))
+		throw EZstdError(code);
+	return code;
+}
+
+/// set the compression level of a zstd compression context
+static void ZstdSetLevel(ZSTD_CCtx *CCtx, int Level)
+{
+	if ((Level < CdRecodeStream::clMin) || (Level > CdRecodeStream::clUltraMax))
+		throw EZstdError("CdZstdEncoder initialization level error.");
+	ZstdCheck(ZSTD_CCtx_setParameter(CCtx, ZSTD_c_compressionLevel,
+		ZstdLevels[Level]));
+	if (Level == CdRecodeStream::clUltraMax)
 	{
-		CdBlockStream::TBlockInfo *q = p;
-		p = p->Next;
-		delete q;
+		ZstdCheck(ZSTD_CCtx_setParameter(CCtx, ZSTD_c_windowLog, 30));
+		ZstdCheck(ZSTD_CCtx_setParameter(CCtx,
+			ZSTD_c_enableLongDistanceMatching, 1));
 	}
 }
 
-CdBlockStream::TBlockInfo::TBlockInfo()
+
+// CdBaseZstdStream
+
+CdBaseZstdStream::CdBaseZstdStream(CdStream &vStream):
+	CdRecodeStream(vStream)
+{ }
+
+
+// CdZstdEncoder
+
+CdZstdEncoder::CdZstdEncoder(CdStream &Dest, TLevel Level):
+	CdBaseZstdStream(Dest), CdRecodeLevel(Level)
 {
-	Next = NULL;
-	BlockStart = BlockSize = StreamStart = StreamNext = 0;
-	Head = false;
+	PtrExtRec = NULL;
+	fHaveClosed = false;
+	fCCtx = ZSTD_createCCtx();
+	if (!fCCtx)
+		throw EZstdError("CdZstdEncoder initialization error.");
+	try {
+		ZstdSetLevel(fCCtx, Level);
+	} catch (...) {
+		ZSTD_freeCCtx(fCCtx);
+		throw;
+	}
 }
 
-CdBlockStream::TBlockInfo::TBlockInfo(bool head, SIZE64 bs, SIZE64 ss, SIZE64 sn)
+CdZstdEncoder::~CdZstdEncoder()
 {
-	Next = NULL;
-	BlockStart = 0;
-	BlockSize = bs; StreamStart = ss; StreamNext = sn;
-	Head = head;
+	Close();
+	ZSTD_freeCCtx(fCCtx);
 }
 
-SIZE64 CdBlockStream::TBlockInfo::AbsStart() const
+ssize_t CdZstdEncoder::Read(void *Buffer, ssize_t Count)
 {
-	return StreamStart - (Head ? (HEAD_SIZE+2*GDS_POS_SIZE) : (2*GDS_POS_SIZE));
+	throw EZstdError(ERR_ZSTD_DEFLATE_INVALID, "Read");
 }
 
-void CdBlockStream::TBlockInfo::SetSize(CdStream &Stream, SIZE64 _Size)
+ssize_t CdZstdEncoder::Write(const void *Buffer, ssize_t Count)
 {
-	BlockSize = _Size;
-	SIZE64 L = Head ? (HEAD_SIZE + 2*GDS_POS_SIZE) : (2*GDS_POS_SIZE);
-	Stream.SetPosition(StreamStart - L);
-	BYTE_LE<CdStream>(Stream) <<
-		TdGDSPos((_Size+L) | (Head ? GDS_STREAM_POS_MASK_HEAD_BIT : 0));
+	if (fHaveClosed)
+		throw EZstdError(ERR_ZSTD_DEFLATE_CLOSED);
+	if (Count <= 0) return 0;
+
+	C_UInt8 buf[65536];
+	ZSTD_inBuffer in = { Buffer, (size_t)Count, 0 };
+
+	while (in.pos < in.size)
+	{
+		ZSTD_outBuffer out = { buf, sizeof(buf), 0 };
+		size_t pos = in.pos;
+		ZstdCheck(ZSTD_compressStream2(fCCtx, &out, &in, ZSTD_e_continue));
+		fTotalIn += in.pos - pos;
+		if (out.pos > 0)
+		{
+			UpdateStreamPosition();
+			fStream->WriteData(buf, out.pos);
+			fStreamPos += out.pos;
+			fTotalOut += out.pos;
+		}
+	}
+
+	return Count;
 }
 
-void CdBlockStream::TBlockInfo::SetNext(CdStream &Stream, SIZE64 _Next)
+SIZE64 CdZstdEncoder::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
 {
-	StreamNext = _Next;
-	Stream.SetPosition(StreamStart -
-		(Head ? (HEAD_SIZE + GDS_POS_SIZE) : GDS_POS_SIZE));
-	BYTE_LE<CdStream>(Stream) << TdGDSPos(_Next);
+	switch (Origin)
+	{
+		case soBeginning:
+			if (Offset == fTotalIn) return fTotalIn;
+			break;
+		case soCurrent:
+			if (Offset == 0) return fTotalIn;
+			break;
+		case soEnd:
+			if (Offset == 0) return fTotalIn;
+			break;
+	}
+	throw EZstdError(ERR_ZSTD_DEFLATE_INVALID, "Seek");
 }
 
-void CdBlockStream::TBlockInfo::SetSize2(CdStream &Stream,
-	SIZE64 _Size, SIZE64 _Next)
+void CdZstdEncoder::SetSize(SIZE64 NewSize)
 {
-	BlockSize = _Size;
-	StreamNext = _Next;
-	SIZE64 L = Head ? (HEAD_SIZE + 2*GDS_POS_SIZE) : (2*GDS_POS_SIZE);
-	Stream.SetPosition(StreamStart - L);
-	BYTE_LE<CdStream>(Stream)
-		<< TdGDSPos((_Size+L) | (Head ? GDS_STREAM_POS_MASK_HEAD_BIT : 0))
-		<< TdGDSPos(_Next);
+	if (NewSize != fTotalIn)
+		throw EZstdError(ERR_ZSTD_DEFLATE_INVALID, "SetSize");
 }
 
-
-CdBlockStream::CdBlockStream(CdBlockCollection &vCollection):
-	CdStream(), fCollection(vCollection)
+void CdZstdEncoder::Close()
 {
-	fID = 0;
-	fList = fCurrent = NULL;
-	fPosition = fBlockCapacity = 0;
-	fBlockSize = 0;
-	fNeedSyncSize = false;
-	if (vCollection.fStream)
+	if (!fHaveClosed)
 	{
-		vCollection.fStream->AddRef();
+		if (PtrExtRec)
+		{
+			if (PtrExtRec->Size > 0)
+				WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
+			PtrExtRec = NULL;
+		}
+		SyncFinish();
+		fHaveClosed = true;
 	}
 }
 
-CdBlockStream::~CdBlockStream()
+void CdZstdEncoder::SyncFinish()
 {
-	SyncSizeInfo();
-	xClearList(fList);
-	if (fCollection.fStream)
-		fCollection.fStream->Release();
+	C_UInt8 buffer[65536];
+	ZSTD_inBuffer in = { NULL, 0, 0 };
+	size_t remaining;
+	do {
+		ZSTD_outBuffer out = { buffer, sizeof(buffer), 0 };
+		remaining = ZstdCheck(ZSTD_compressStream2(fCCtx, &out, &in,
+			ZSTD_e_end));
+		if (out.pos > 0)
+		{
+			UpdateStreamPosition();
+			fStream->WriteData(buffer, out.pos);
+			fStreamPos += out.pos;
+			fTotalOut += out.pos;
+		}
+	} while (remaining > 0);
 }
 
-ssize_t CdBlockStream::Read(void *Buffer, ssize_t Count)
+ssize_t CdZstdEncoder::Pending()
 {
-	SIZE64 LastPos = fPosition;
-	if ((LastPos+Count) > fBlockSize)
-		Count = fBlockSize - LastPos;
+	return 0;
+}
 
-	if (fCurrent && (Count>0))
-	{
-		CdStream *vStream = fCollection.Stream();
-		if (!vStream) return 0;
 
-		char *p = (char*)Buffer;
-		SIZE64 I, L;
-		ssize_t RL;
-		do {
-			I = fPosition - fCurrent->BlockStart;
-			L = fCurrent->BlockSize - I;
-			if (Count < L)
-			{
-				vStream->SetPosition(fCurrent->StreamStart + I);
-				RL = vStream->Read((void*)p, Count);
-				fPosition += RL;
-				break;
-			} else {
-				if (L > 0)
-				{
-					vStream->SetPosition(fCurrent->StreamStart + I);
-					RL = vStream->Read((void*)p, L);
-					Count -= RL; fPosition += RL; p += RL;
-					if (RL != L) break;
-                }
-				fCurrent = fCurrent->Next;
-				if ((fCurrent==NULL) || (Count<=0))
-					break;
-			}
-		} while (true);
-	}
+// CdZstdDecoder
 
-	return fPosition - LastPos;
+CdZstdDecoder::CdZstdDecoder(CdStream &Source): CdBaseZstdStream(Source)
+{
+	fBufPos = fBufSize = 0;
+	fCurPosition = 0;
+	fDCtx = ZSTD_createDCtx();
+	if (!fDCtx)
+		throw EZstdError("CdZstdDecoder initialization error.");
+	ZSTD_DCtx_setParameter(fDCtx, ZSTD_d_windowLogMax, ZSTD_WINDOW_LOG_MAX);
 }
 
-ssize_t CdBlockStream::Write(const void *Buffer, ssize_t Count)
+CdZstdDecoder::~CdZstdDecoder()
 {
-	SIZE64 LastPos = fPosition;
+	ZSTD_freeDCtx(fDCtx);
+}
 
-	if (Count > 0)
-	{
-		SIZE64 L = fPosition + Count;
-		if (L > fBlockCapacity)
-			fCollection._IncStreamSize(*this, L);
+void CdZstdDecoder::ResetDCtx()
+{
+	ZstdCheck(ZSTD_DCtx_reset(fDCtx, ZSTD_reset_session_only));
+	fBufPos = fBufSize = 0;
+}
 
-		CdStream *vStream = fCollection.Stream();
+ssize_t CdZstdDecoder::Read(void *Buffer, ssize_t Count)
+{
+	ssize_t OriCount = Count;
+	C_UInt8 *pBuffer = (C_UInt8 *)Buffer;
+	size_t ret = 1;
+
+	while ((Count > 0) && (ret != 0))
+	{
+		if (fBufPos >= fBufSize)
+		{
+			UpdateStreamPosition();
+			fBufSize = fStream->Read(fBuffer, sizeof(fBuffer));
+			fBufPos = 0;
+			if (fBufSize <= 0)
+				return OriCount - Count;
+			fStreamPos += fBufSize;
+		}
+
+		ZSTD_inBuffer in = { fBuffer, fBufSize, fBufPos };
+		ZSTD_outBuffer out = { pBuffer, (size_t)Count, 0 };
+		ret = ZstdCheck(ZSTD_decompressStream(fDCtx, &out, &in));
+		fBufPos = in.pos;
+
+		fCurPosition += out.pos;
+		pBuffer += out.pos;
+		Count -= out.pos;
+	}
+
+	if ((ret == 0) && (fBufPos < fBufSize))
+	{
+		fStreamPos -= fBufSize - fBufPos;
+		fStream->SetPosition(fStreamPos);
+		fBufPos = fBufSize = 0;
+	}
+
+	SIZE64 tmp = fStreamPos - fStreamBase;
+	if (tmp > fTotalIn) fTotalIn = tmp;
+	if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+
+	return OriCount - Count;
+}
+
+ssize_t CdZstdDecoder::Write(const void *Buffer, ssize_t Count)
+{
+	throw EZstdError(ERR_ZSTD_INFLATE_INVALID, "Write");
+}
+
+SIZE64 CdZstdDecoder::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	if ((Offset==0) && (Origin==soBeginning))
+	{
+		if (fCurPosition == 0) return 0;
+		ResetDCtx();
+		fStream->SetPosition(fStreamPos = fStreamBase);
+		return (fCurPosition = 0);
+	} else if (Origin != soEnd)
+	{
+		if ((Offset==0) && (Origin==soCurrent))
+			return fCurPosition;
+
+		if (Origin == soCurrent) Offset += fCurPosition;
+		if (Offset < fCurPosition)
+			Seek(0, soBeginning);
+		else
+			Offset -= fCurPosition;
+
+		C_UInt8 buffer[4096];
+		SIZE64 DivI = Offset / sizeof(buffer);
+		for (; DivI > 0; DivI--)
+			ReadData(buffer, sizeof(buffer));
+		ReadData(buffer, Offset % sizeof(buffer));
+	} else
+		throw EZstdError(ERR_ZSTD_INFLATE_INVALID, "Seek");
+
+	return fCurPosition;
+}
+
+SIZE64 CdZstdDecoder::GetSize()
+{
+	return -1;
+}
+
+void CdZstdDecoder::SetSize(SIZE64 NewSize)
+{
+	throw EZstdError(ERR_ZSTD_INFLATE_INVALID, "SetSize");
+}
+
+
+
+// =====================================================================
+// Input stream for zstd with the support of random access
+
+#define ZSTD_RA_MAGIC_HEADER_SIZE     6
+static const C_UInt8 ZSTD_RA_MAGIC_HEADER[ZSTD_RA_MAGIC_HEADER_SIZE] =
+	{ 'Z', 'S', 'T', 'R', 'A', 0x10 };
+
+
+/// the compression context of a thread, reused by the blocks it compresses
+struct TZstdThreadCCtx
+{
+	ZSTD_CCtx *CCtx;
+	TZstdThreadCCtx() { CCtx = NULL; }
+	~TZstdThreadCCtx() { if (CCtx) ZSTD_freeCCtx(CCtx); }
+};
+
+static thread_local TZstdThreadCCtx ZstdRA_ThreadCCtx;
+
+/// compress an entire block as a zstd frame
+static void ZstdRA_EncodeBlock(const C_UInt8 *In, size_t InSize,
+	vector<C_UInt8> &Out, int Level, int SizeType, const C_UInt8 *,
+	size_t)
+{
+	ZSTD_CCtx *&CCtx = ZstdRA_ThreadCCtx.CCtx;
+	if (!CCtx)
+	{
+		CCtx = ZSTD_createCCtx();
+		if (!CCtx)
+			throw EZstdError("ZstdRA_EncodeBlock: failed to allocate memory.");
+	} else
+		ZstdCheck(ZSTD_CCtx_reset(CCtx, ZSTD_reset_session_and_parameters));
+	ZstdSetLevel(CCtx, Level);
+	Out.resize(ZSTD_compressBound(InSize));
+	size_t rv = ZSTD_compress2(CCtx, &Out[0], Out.size(), In, InSize);
+	Out.resize(ZstdCheck(rv));
+}
+
+CdZstdEncoder_RA::CdZstdEncoder_RA(CdStream &Dest, TLevel Level,
+	TBlockSize B): CdRA_Write(this, B), CdZstdEncoder(Dest, Level)
+{
+	fEncodeProc = ZstdRA_EncodeBlock;
+	fEncodeLevel = Level;
+	InitWriteStream();
+}
+
+ssize_t CdZstdEncoder_RA::Write(const void *Buffer, ssize_t Count)
+{
+	if (fHaveClosed)
+		throw EZstdError(ERR_ZSTD_DEFLATE_CLOSED);
+	if (Count <= 0) return 0;
+	if (!ParallelMode())
+		throw EZstdError(ERR_ZSTD_DEFLATE_INVALID, "Write");
+	return ParallelWrite(Buffer, Count);
+}
+
+void CdZstdEncoder_RA::Close()
+{
+	if (!fHaveClosed)
+	{
+		if (PtrExtRec)
+		{
+			if (PtrExtRec->Size > 0)
+				WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
+			PtrExtRec = NULL;
+		}
+		ParallelSync();
+		DoneWriteStream();
+		fHaveClosed = true;
+	}
+}
+
+void CdZstdEncoder_RA::WriteMagicNumber(CdStream &Stream)
+{
+	Stream.WriteData(ZSTD_RA_MAGIC_HEADER, ZSTD_RA_MAGIC_HEADER_SIZE);
+}
+
+void CdZstdEncoder_RA::CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count)
+{
+	if (dynamic_cast<CdZstdDecoder_RA*>(&Source))
+	{
+		CdZstdDecoder_RA *Src = static_cast<CdZstdDecoder_RA*>(&Source);
+		if ((Src->SizeType() == SizeType()) && (Src->fVersion == fVersion))
+		{
+			Src->SetPosition(Pos);
+			if (Count < 0)
+				Count = Src->GetSize() - Pos;
+
+			C_UInt8 Buffer[COREARRAY_STREAM_BUFFER];
+			const ssize_t SIZE = sizeof(Buffer);
+
+			// header
+			if (Pos > Src->fCB_UZStart)
+			{
+				SIZE64 L = Src->fCB_UZStart + Src->fCB_UZSize - Pos;
+				if (L > Count) L = Count;
+				for (; L > 0; )
+				{
+					ssize_t N = (L <= SIZE) ? L : SIZE;
+					Src->ReadData(Buffer, N);
+					WriteData((void*)Buffer, N);
+					Count -= N; Pos += N;
+					L -= N;
+				}
+			}
+
+			// body
+			if (Count > 0)
+			{
+				Src->SeekStream(Pos);
+				if ((Src->fCB_UZStart + Src->fCB_UZSize) <= (Pos + Count))
+				{
+					ParallelSync();
+					// determine start and size
+					SIZE64 Start = Src->fCB_ZStart;
+					SIZE64 ZSize = 0, USize = 0;
+					while ((Src->fCB_UZStart + Src->fCB_UZSize) <= (Pos + Count))
+					{
+						ZSize += Src->fCB_ZSize;
+						USize += Src->fCB_UZSize;
+						AddBlockInfo(Src->fCB_ZSize, Src->fCB_UZSize,
+							Src->BlockChecksum(Src->fBlockIdx));
+						Count -= Src->fCB_UZSize;
+						Pos += Src->fCB_UZSize;
+						Src->NextBlock();
+					}
+					Src->Reset();
+					// copying
+					UpdateStreamPosition();
+					fStream->CopyFrom(*Src->fStream, Start, ZSize);
+					fTotalIn += USize;
+					fStreamPos += ZSize;
+					fTotalOut = fStreamPos - fStreamBase;
+				}
+			}
+
+			// tail
+			if (Count > 0) Src->SetPosition(Pos);
+			for (; Count > 0; )
+			{
+				ssize_t N = (Count <= SIZE) ? Count : SIZE;
+				Src->ReadData(Buffer, N);
+				WriteData((void*)Buffer, N);
+				Count -= N;
+			}
+
+			return;
+		}
+	}
+
+	CdStream::CopyFrom(Source, Pos, Count);
+}
+
+
+// =====================================================================
+
+/// decode an entire zstd block
+static void ZstdRA_DecodeBlock(const C_UInt8 *In, size_t InSize, C_UInt8 *Out,
+	size_t OutSize, int Param, const C_UInt8 *, size_t)
+{
+	size_t n = ZstdCheck(ZSTD_decompress(Out, OutSize, In, InSize));
+	if (n != OutSize)
+		throw EZstdError("Invalid zstd block, inconsistent length.");
+}
+
+CdZstdDecoder_RA::CdZstdDecoder_RA(CdStream &Source): CdRA_Read(this),
+	CdZstdDecoder(Source)
+{
+	InitReadStream();
+	fDecodeProc = ZstdRA_DecodeBlock;
+}
+
+ssize_t CdZstdDecoder_RA::Read(void *Buffer, ssize_t Count)
+{
+	if (Count <= 0) return 0;
+	if (fBlockIdx >= fBlockNum) return 0;
+	if (BlockReadActive())
+		return BlockRead(Buffer, Count, fCurPosition);
+
+	ssize_t OriCount = Count;
+	C_UInt8 *pBuffer = (C_UInt8 *)Buffer;
+
+	while (Count > 0)
+	{
+		size_t ret = 1;
+
+		while ((Count > 0) && (ret != 0))
+		{
+			if (fBufPos >= fBufSize)
+			{
+				UpdateStreamPosition();
+				ssize_t n = fCB_ZSize - (fStreamPos - fCB_ZStart);
+				if (n > (ssize_t)sizeof(fBuffer)) n = sizeof(fBuffer);
+				if (n < 0) n = 0;
+				fBufSize = fStream->Read(fBuffer, n);
+				fBufPos = 0;
+				if (fBufSize <= 0)
+					return OriCount - Count;
+				fStreamPos += fBufSize;
+			}
+
+			ZSTD_inBuffer in = { fBuffer, fBufSize, fBufPos };
+			ZSTD_outBuffer out = { pBuffer, (size_t)Count, 0 };
+			ret = ZstdCheck(ZSTD_decompressStream(fDCtx, &out, &in));
+			fBufPos = in.pos;
+
+			fCurPosition += out.pos;
+			pBuffer += out.pos;
+			Count -= out.pos;
+		}
+
+		if (ret == 0)
+		{
+			if ((fCurPosition-fCB_UZStart) != fCB_UZSize)
+				throw EZstdError("Invalid zstd block, inconsistent length.");
+
+			// go to the next block
+			if (NextBlock())
+			{
+				ResetDCtx();
+				if (ReadAheadNext())
+				{
+					Count -= BlockRead(pBuffer, Count, fCurPosition);
+					break;
+				}
+			} else
+				break;
+		}
+	}
+
+	SIZE64 tmp = fStreamPos - fStreamBase;
+	if (tmp > fTotalIn) fTotalIn = tmp;
+	if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+
+	return OriCount - Count;
+}
+
+SIZE64 CdZstdDecoder_RA::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	if (Origin == soCurrent)
+	{
+		// Position(), valid even if the stream is empty
+		if (Offset == 0) return fCurPosition;
+		Offset += fCurPosition;
+		if (Offset < 0)
+			throw EZstdError(ERR_ZSTD_INFLATE_INVALID, "Seek");
+	} else if (Origin == soEnd)
+		throw EZstdError(ERR_ZSTD_INFLATE_INVALID, "Seek");
+
+	C_Int32 OldBlockIdx = fBlockIdx;
+	bool flag = SeekStream(Offset);
+	if (BlockReadSeek(OldBlockIdx, flag))
+	{
+		fCurPosition = Offset;
+		return fCurPosition;
+	}
+	if (flag || (Offset < fCurPosition))
+		Reset();
+
+	Offset -= fCurPosition;
+	if (Offset > 0)
+	{
+		C_UInt8 buffer[4096];
+		SIZE64 DivI = Offset / sizeof(buffer);
+		for (; DivI > 0; DivI--)
+			ReadData(buffer, sizeof(buffer));
+		ReadData(buffer, Offset % sizeof(buffer));
+	} else if (Offset < 0)
+		throw EZstdError(ERR_ZSTD_INFLATE_INVALID, "Seek");
+
+	return fCurPosition;
+}
+
+bool CdZstdDecoder_RA::ReadMagicNumber(CdStream &Stream)
+{
+	C_UInt8 Header[ZSTD_RA_MAGIC_HEADER_SIZE];
+	Stream.SetPosition(fStreamBase);
+	Stream.ReadData(Header, sizeof(Header));
+	return (memcmp(Header, ZSTD_RA_MAGIC_HEADER, ZSTD_RA_MAGIC_HEADER_SIZE) == 0);
+}
+
+void CdZstdDecoder_RA::Reset()
+{
+	ResetDCtx();
+	fStreamPos = fCB_ZStart;
+	if (fVersion == 0x10)
+		fStreamPos += SIZE_RA_BLOCK_HEADER;
+	fCurPosition = fCB_UZStart;
+}
+
+#endif
+
+
+
+// =====================================================================
+// The classes of shuffle filter
+// =====================================================================
+
+static const char *ERR_SHUFFLE_INVALID =
+	"Invalid shuffle stream operation '%s'!";
+static const char *ERR_SHUFFLE_CLOSED =
+	"The shuffle stream has been closed.";
+static const char *ERR_SHUFFLE_ELMSIZE =
+	"Invalid element size (%d) in the shuffle stream.";
+
+/// byte shuffle n elements, Out[j*n + i] = In[i*ElmSize + j]
+static void ShuffleBytes(C_UInt8 *Out, const C_UInt8 *In, size_t n,
+	size_t ElmSize)
+{
+	size_t i = 0;
+#ifdef COREARRAY_SIMD_SSE2
+	if ((ElmSize==2) || (ElmSize==4) || (ElmSize==8))
+	{
+		// 16 elements in each loop, split the bytes of each pair of vectors
+		// into the even and odd bytes, which gives the byte planes in order
+		// after log2(ElmSize) rounds
+		const __m128i mask = _mm_set1_epi16(0xFF);
+		const size_t h = ElmSize / 2;
+		__m128i v[8], w[8];
+		for (; i+16 <= n; i += 16)
+		{
+			const C_UInt8 *s = In + i*ElmSize;
+			for (size_t k=0; k < ElmSize; k++)
+				v[k] = _mm_loadu_si128((__m128i const*)(s + 16*k));
+			for (size_t L=ElmSize; L > 1; L >>= 1)
+			{
+				for (size_t k=0; k < h; k++)
+				{
+					__m128i a = v[2*k], b = v[2*k+1];
+					w[k] = _mm_packus_epi16(_mm_and_si128(a, mask),
+						_mm_and_si128(b, mask));
+					w[h+k] = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+						_mm_srli_epi16(b, 8));
+				}
+				for (size_t k=0; k < ElmSize; k++) v[k] = w[k];
+			}
+			for (size_t k=0; k < ElmSize; k++)
+				_mm_storeu_si128((__m128i*)(Out + k*n + i), v[k]);
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		const C_UInt8 *s = In + i*ElmSize;
+		for (size_t k=0; k < ElmSize; k++)
+			Out[k*n + i] = s[k];
+	}
+}
+
+/// the inverse of ShuffleBytes()
+static void UnshuffleBytes(C_UInt8 *Out, const C_UInt8 *In, size_t n,
+	size_t ElmSize)
+{
+	size_t i = 0;
+#ifdef COREARRAY_SIMD_SSE2
+	if ((ElmSize==2) || (ElmSize==4) || (ElmSize==8))
+	{
+		// interleave the byte planes, the inverse of ShuffleBytes()
+		const size_t h = ElmSize / 2;
+		__m128i v[8], w[8];
+		for (; i+16 <= n; i += 16)
+		{
+			for (size_t k=0; k < ElmSize; k++)
+				v[k] = _mm_loadu_si128((__m128i const*)(In + k*n + i));
+			for (size_t L=ElmSize; L > 1; L >>= 1)
+			{
+				for (size_t k=0; k < h; k++)
+				{
+					w[2*k] = _mm_unpacklo_epi8(v[k], v[h+k]);
+					w[2*k+1] = _mm_unpackhi_epi8(v[k], v[h+k]);
+				}
+				for (size_t k=0; k < ElmSize; k++) v[k] = w[k];
+			}
+			C_UInt8 *p = Out + i*ElmSize;
+			for (size_t k=0; k < ElmSize; k++)
+				_mm_storeu_si128((__m128i*)(p + 16*k), v[k]);
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		C_UInt8 *p = Out + i*ElmSize;
+		for (size_t k=0; k < ElmSize; k++)
+			p[k] = In[k*n + i];
+	}
+}
+
+/// transpose a 8x8 bit matrix, bit (8*i+j) <-> bit (8*j+i)
+COREARRAY_INLINE static C_UInt64 BitTranspose8(C_UInt64 x)
+{
+	C_UInt64 t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x = x ^ t ^ (t << 28);
+	return x;
+}
+
+/// bit shuffle a byte plane of n bytes (n is a multiple of 8), the bit k
+/// of In[8*g + t] is stored in the bit t of Out[k*n/8 + g]
+static void ShuffleBits(C_UInt8 *Out, const C_UInt8 *In, size_t n)
+{
+	const size_t m = n / 8;
+	size_t g = 0;
+#ifdef COREARRAY_SIMD_SSE2
+	// the sign bits of 16 bytes in each step
+	for (; g+2 <= m; g += 2)
+	{
+		__m128i v = _mm_loadu_si128((__m128i const*)(In + 8*g));
+		for (int k=7; k >= 0; k--)
+		{
+			int b = _mm_movemask_epi8(v);
+			Out[k*m + g] = C_UInt8(b);
+			Out[k*m + g + 1] = C_UInt8(b >> 8);
+			v = _mm_slli_epi16(v, 1);
+		}
+	}
+#endif
+	for (; g < m; g++)
+	{
+		const C_UInt8 *s = In + 8*g;
+		C_UInt64 x = 0;
+		for (int t=0; t < 8; t++) x |= C_UInt64(s[t]) << (8*t);
+		x = BitTranspose8(x);
+		for (int k=0; k < 8; k++) Out[k*m + g] = C_UInt8(x >> (8*k));
+	}
+}
+
+/// the inverse of ShuffleBits()
+static void UnshuffleBits(C_UInt8 *Out, const C_UInt8 *In, size_t n)
+{
+	const size_t m = n / 8;
+	for (size_t g=0; g < m; g++)
+	{
+		C_UInt64 x = 0;
+		for (int k=0; k < 8; k++) x |= C_UInt64(In[k*m + g]) << (8*k);
+		x = BitTranspose8(x);
+		C_UInt8 *p = Out + 8*g;
+		for (int t=0; t < 8; t++) p[t] = C_UInt8(x >> (8*t));
+	}
+}
+
+/// delta and zigzag encoding of n little-endian integers
+template<typename UTYPE, typename STYPE>
+	static void DeltaEncode(UTYPE *Out, const UTYPE *In, size_t n)
+{
+	const int sh = sizeof(UTYPE)*8 - 1;
+	UTYPE last = 0;
+	for (size_t i=0; i < n; i++)
+	{
+		UTYPE v = COREARRAY_ENDIAN_LE_TO_NT(In[i]);
+		UTYPE d = v - last;
+		last = v;
+		Out[i] = COREARRAY_ENDIAN_NT_TO_LE(
+			UTYPE((d << 1) ^ UTYPE(STYPE(d) >> sh)));
+	}
+}
+
+/// decode the differences from the i-th element, a prefix sum
+template<typename UTYPE>
+	static void DeltaDecodeFrom(UTYPE *Out, const UTYPE *In, size_t n,
+		size_t i, UTYPE last)
+{
+	for (; i < n; i++)
+	{
+		UTYPE z = COREARRAY_ENDIAN_LE_TO_NT(In[i]);
+		last += (z >> 1) ^ UTYPE(~(z & 1) + 1);
+		Out[i] = COREARRAY_ENDIAN_NT_TO_LE(last);
+	}
+}
+
+/// the inverse of DeltaEncode()
+template<typename UTYPE>
+	static void DeltaDecode(UTYPE *Out, const UTYPE *In, size_t n)
+{
+	DeltaDecodeFrom<UTYPE>(Out, In, n, 0, 0);
+}
+
+#if defined(COREARRAY_SIMD_SSE2) && defined(COREARRAY_ENDIAN_LITTLE)
+
+// prefix sums within a vector by shifting and adding, plus the carry from
+// the previous vector
+
+template<> void DeltaDecode<C_UInt16>(C_UInt16 *Out, const C_UInt16 *In,
+	size_t n)
+{
+	const __m128i one = _mm_set1_epi16(1);
+	__m128i carry = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i+8 <= n; i += 8)
+	{
+		__m128i z = _mm_loadu_si128((__m128i const*)(In + i));
+		__m128i d = _mm_xor_si128(_mm_srli_epi16(z, 1),
+			_mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(z, one)));
+		d = _mm_add_epi16(d, _mm_slli_si128(d, 2));
+		d = _mm_add_epi16(d, _mm_slli_si128(d, 4));
+		d = _mm_add_epi16(d, _mm_slli_si128(d, 8));
+		d = _mm_add_epi16(d, carry);
+		_mm_storeu_si128((__m128i*)(Out + i), d);
+		carry = _mm_shufflehi_epi16(d, 0xFF);
+		carry = _mm_shuffle_epi32(carry, 0xFF);
+	}
+	DeltaDecodeFrom<C_UInt16>(Out, In, n, i, i>0 ? Out[i-1] : 0);
+}
+
+template<> void DeltaDecode<C_UInt32>(C_UInt32 *Out, const C_UInt32 *In,
+	size_t n)
+{
+	const __m128i one = _mm_set1_epi32(1);
+	__m128i carry = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i+4 <= n; i += 4)
+	{
+		__m128i z = _mm_loadu_si128((__m128i const*)(In + i));
+		__m128i d = _mm_xor_si128(_mm_srli_epi32(z, 1),
+			_mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, one)));
+		d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+		d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+		d = _mm_add_epi32(d, carry);
+		_mm_storeu_si128((__m128i*)(Out + i), d);
+		carry = _mm_shuffle_epi32(d, 0xFF);
+	}
+	DeltaDecodeFrom<C_UInt32>(Out, In, n, i, i>0 ? Out[i-1] : 0);
+}
+
+template<> void DeltaDecode<C_UInt64>(C_UInt64 *Out, const C_UInt64 *In,
+	size_t n)
+{
+	const __m128i one = _mm_set1_epi64x(1);
+	__m128i carry = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i+2 <= n; i += 2)
+	{
+		__m128i z = _mm_loadu_si128((__m128i const*)(In + i));
+		__m128i d = _mm_xor_si128(_mm_srli_epi64(z, 1),
+			_mm_sub_epi64(_mm_setzero_si128(), _mm_and_si128(z, one)));
+		d = _mm_add_epi64(d, _mm_slli_si128(d, 8));
+		d = _mm_add_epi64(d, carry);
+		_mm_storeu_si128((__m128i*)(Out + i), d);
+		carry = _mm_unpackhi_epi64(d, d);
+	}
+	DeltaDecodeFrom<C_UInt64>(Out, In, n, i, i>0 ? Out[i-1] : 0);
+}
+
+#endif
+
+/// delta encoding of n elements
+static void DeltaEncodeElm(C_UInt8 *Out, const C_UInt8 *In, size_t n,
+	size_t ElmSize)
+{
+	switch (ElmSize)
+	{
+	case 1:
+		DeltaEncode<C_UInt8, C_Int8>(Out, In, n); break;
+	case 2:
+		DeltaEncode<C_UInt16, C_Int16>((C_UInt16*)Out, (const C_UInt16*)In, n);
+		break;
+	case 4:
+		DeltaEncode<C_UInt32, C_Int32>((C_UInt32*)Out, (const C_UInt32*)In, n);
+		break;
+	case 8:
+		DeltaEncode<C_UInt64, C_Int64>((C_UInt64*)Out, (const C_UInt64*)In, n);
+		break;
+	}
+}
+
+/// the inverse of DeltaEncodeElm()
+static void DeltaDecodeElm(C_UInt8 *Out, const C_UInt8 *In, size_t n,
+	size_t ElmSize)
+{
+	switch (ElmSize)
+	{
+	case 1:
+		DeltaDecode<C_UInt8>(Out, In, n); break;
+	case 2:
+		DeltaDecode<C_UInt16>((C_UInt16*)Out, (const C_UInt16*)In, n); break;
+	case 4:
+		DeltaDecode<C_UInt32>((C_UInt32*)Out, (const C_UInt32*)In, n); break;
+	case 8:
+		DeltaDecode<C_UInt64>((C_UInt64*)Out, (const C_UInt64*)In, n); break;
+	}
+}
+
+/// the number of elements shuffled in a chunk of Size bytes
+COREARRAY_INLINE static size_t ShuffleNumElm(int Mode, size_t Size,
+	size_t ElmSize)
+{
+	size_t n = Size / ElmSize;
+	if (Mode & CdShuffleStream::smBit) n &= ~size_t(7);
+	return n;
+}
+
+/// shuffle a chunk of Size bytes, Tmp has at least 2*Size bytes
+static void ShuffleChunk(CdShuffleStream::TMode Mode, size_t ElmSize,
+	C_UInt8 *Out, const C_UInt8 *In, size_t Size, C_UInt8 *Tmp)
+{
+	if (Mode & CdShuffleStream::smDelta)
+	{
+		// the remaining bytes are copied by the shuffle or here
+		C_UInt8 *p = (Mode & (CdShuffleStream::smByte|CdShuffleStream::smBit)) ?
+			Tmp + Size : Out;
+		const size_t n = Size / ElmSize, m = n * ElmSize;
+		DeltaEncodeElm(p, In, n, ElmSize);
+		if (m < Size) memcpy(p + m, In + m, Size - m);
+		if (p == Out) return;
+		In = p;
+	}
+
+	const size_t n = ShuffleNumElm(Mode, Size, ElmSize);
+	if (Mode & CdShuffleStream::smBit)
+	{
+		ShuffleBytes(Tmp, In, n, ElmSize);
+		for (size_t k=0; k < ElmSize; k++)
+			ShuffleBits(Out + k*n, Tmp + k*n, n);
+	} else
+		ShuffleBytes(Out, In, n, ElmSize);
+	const size_t m = n * ElmSize;
+	if (m < Size) memcpy(Out + m, In + m, Size - m);
+}
+
+/// the inverse of ShuffleChunk()
+static void UnshuffleChunk(CdShuffleStream::TMode Mode, size_t ElmSize,
+	C_UInt8 *Out, const C_UInt8 *In, size_t Size, C_UInt8 *Tmp)
+{
+	if (Mode & (CdShuffleStream::smByte|CdShuffleStream::smBit))
+	{
+		// unshuffle to Out, or to Tmp followed by delta decoding
+		C_UInt8 *p = (Mode & CdShuffleStream::smDelta) ? Tmp + Size : Out;
+		const size_t n = ShuffleNumElm(Mode, Size, ElmSize);
+		if (Mode & CdShuffleStream::smBit)
+		{
+			for (size_t k=0; k < ElmSize; k++)
+				UnshuffleBits(Tmp + k*n, In + k*n, n);
+			UnshuffleBytes(p, Tmp, n, ElmSize);
+		} else
+			UnshuffleBytes(p, In, n, ElmSize);
+		const size_t m = n * ElmSize;
+		if (m < Size) memcpy(p + m, In + m, Size - m);
+		if (p == Out) return;
+		In = p;
+	}
+
+	const size_t n = Size / ElmSize, m = n * ElmSize;
+	DeltaDecodeElm(Out, In, n, ElmSize);
+	if (m < Size) memcpy(Out + m, In + m, Size - m);
+}
+
+
+// CdShuffleStream
+
+CdShuffleStream::CdShuffleStream(CdStream &vStream, TMode Mode, int ElmSize):
+	CdRecodeStream(vStream)
+{
+	if ((ElmSize <= 0) || (ElmSize > 255))
+		throw EShuffleError(ERR_SHUFFLE_ELMSIZE, ElmSize);
+	if ((Mode & smDelta) && (ElmSize!=1) && (ElmSize!=2) && (ElmSize!=4) &&
+			(ElmSize!=8))
+		throw EShuffleError(ERR_SHUFFLE_ELMSIZE, ElmSize);
+	fMode = Mode;
+	fElmSize = ElmSize;
+	fChunkSize = SHUFFLE_CHUNK * ElmSize;
+	fBuffer.resize(fChunkSize);
+	fTmp.resize(3 * fChunkSize);
+}
+
+
+// CdShuffleEncoder
+
+CdShuffleEncoder::CdShuffleEncoder(CdStream &Dest, TMode Mode, int ElmSize):
+	CdShuffleStream(Dest, Mode, ElmSize)
+{
+	fBufLen = 0;
+	fHaveClosed = false;
+}
+
+CdShuffleEncoder::~CdShuffleEncoder()
+{
+	Close();
+}
+
+ssize_t CdShuffleEncoder::Read(void *Buffer, ssize_t Count)
+{
+	throw EShuffleError(ERR_SHUFFLE_INVALID, "Read");
+}
+
+ssize_t CdShuffleEncoder::Write(const void *Buffer, ssize_t Count)
+{
+	if (fHaveClosed)
+		throw EShuffleError(ERR_SHUFFLE_CLOSED);
+	if (Count <= 0) return 0;
+
+	const C_UInt8 *p = (const C_UInt8*)Buffer;
+	ssize_t OriCount = Count;
+	while (Count > 0)
+	{
+		if ((fBufLen == 0) && (Count >= fChunkSize))
+		{
+			// a whole chunk from the buffer directly
+			WriteChunk(p, fChunkSize);
+			p += fChunkSize; Count -= fChunkSize;
+		} else {
+			ssize_t L = fChunkSize - fBufLen;
+			if (L > Count) L = Count;
+			memcpy(&fBuffer[fBufLen], p, L);
+			fBufLen += L;
+			p += L; Count -= L;
+			if (fBufLen >= fChunkSize)
+			{
+				WriteChunk(&fBuffer[0], fBufLen);
+				fBufLen = 0;
+			}
+		}
+	}
+	fTotalIn += OriCount;
+	return OriCount;
+}
+
+SIZE64 CdShuffleEncoder::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	switch (Origin)
+	{
+		case soBeginning:
+			if (Offset == fTotalIn) return fTotalIn;
+			break;
+		case soCurrent:
+			if (Offset == 0) return fTotalIn;
+			break;
+		case soEnd:
+			if (Offset == 0) return fTotalIn;
+			break;
+	}
+	throw EShuffleError(ERR_SHUFFLE_INVALID, "Seek");
+}
+
+void CdShuffleEncoder::SetSize(SIZE64 NewSize)
+{
+	if (NewSize != fTotalIn)
+		throw EShuffleError(ERR_SHUFFLE_INVALID, "SetSize");
+}
+
+void CdShuffleEncoder::Close()
+{
+	if (!fHaveClosed)
+	{
+		if (fBufLen > 0)
+		{
+			WriteChunk(&fBuffer[0], fBufLen);
+			fBufLen = 0;
+		}
+		fHaveClosed = true;
+	}
+}
+
+void CdShuffleEncoder::WriteChunk(const C_UInt8 *Buffer, ssize_t Count)
+{
+	ShuffleChunk(fMode, fElmSize, &fTmp[0], Buffer, Count,
+		&fTmp[fChunkSize]);
+	fStream->WriteData(&fTmp[0], Count);
+	fTotalOut += Count;
+}
+
+
+// CdShuffleDecoder
+
+CdShuffleDecoder::CdShuffleDecoder(CdStream &Source, TMode Mode, int ElmSize):
+	CdShuffleStream(Source, Mode, ElmSize)
+{
+	fCurPosition = fChunkStart = 0;
+	fChunkLen = -1;
+}
+
+ssize_t CdShuffleDecoder::Read(void *Buffer, ssize_t Count)
+{
+	C_UInt8 *p = (C_UInt8*)Buffer;
+	ssize_t OriCount = Count;
+	while (Count > 0)
+	{
+		if ((fChunkLen < 0) || (fCurPosition < fChunkStart) ||
+			(fCurPosition >= fChunkStart + fChunkLen))
+		{
+			if (!LoadChunk(fCurPosition)) break;
+		}
+		ssize_t I = fCurPosition - fChunkStart;
+		ssize_t L = fChunkLen - I;
+		if (L > Count) L = Count;
+		memcpy(p, &fBuffer[I], L);
+		p += L; Count -= L;
+		fCurPosition += L;
+	}
+	if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+	return OriCount - Count;
+}
+
+ssize_t CdShuffleDecoder::Write(const void *Buffer, ssize_t Count)
+{
+	throw EShuffleError(ERR_SHUFFLE_INVALID, "Write");
+}
+
+SIZE64 CdShuffleDecoder::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	switch (Origin)
+	{
+		case soBeginning:
+			break;
+		case soCurrent:
+			Offset += fCurPosition; break;
+		default:
+			throw EShuffleError(ERR_SHUFFLE_INVALID, "Seek");
+	}
+	if (Offset < 0)
+		throw EShuffleError(ERR_SHUFFLE_INVALID, "Seek");
+	return (fCurPosition = Offset);
+}
+
+SIZE64 CdShuffleDecoder::GetSize()
+{
+	return fStream->GetSize();
+}
+
+void CdShuffleDecoder::SetSize(SIZE64 NewSize)
+{
+	throw EShuffleError(ERR_SHUFFLE_INVALID, "SetSize");
+}
+
+bool CdShuffleDecoder::LoadChunk(SIZE64 Position)
+{
+	// the chunk starting position
+	const SIZE64 Start = Position - Position % fChunkSize;
+	if (fStream->Position() != Start)
+		fStream->SetPosition(Start);
+	fChunkStart = Start;
+	fChunkLen = -1;
+
+	// read the whole chunk, the last one could be shorter
+	ssize_t n = 0;
+	while (n < fChunkSize)
+	{
+		ssize_t L = fStream->Read(&fTmp[n], fChunkSize - n);
+		if (L <= 0) break;
+		n += L;
+	}
+	if (n <= 0) return false;
+	UnshuffleChunk(fMode, fElmSize, &fBuffer[0], &fTmp[0], n,
+		&fTmp[fChunkSize]);
+	fChunkLen = n;
+	if (Start + n > fTotalIn) fTotalIn = Start + n;
+	return (Position < Start + n);
+}
+
+
+
+// =====================================================================
+// GDS block stream
+
+static const char *ERR_BLOCK_INVALID_POS =
+	"Invalid Position: %lld in CdBlockStream (current blocksize: %lld).";
+static const char *ERR_INVALID_BLOCK_LEN =
+	"Invalid block length in CdBlockCollection!";
+
+// CoreArray GDS Stream position mask
+const C_Int64 CoreArray::GDS_STREAM_POS_MASK = 0x7FFFFFFFFFFFLL;
+const C_Int64 CoreArray::GDS_STREAM_POS_MASK_HEAD_BIT = 0x800000000000LL;
+
+
+// CdBlockStream
+
+inline static void xClearList(CdBlockStream::TBlockInfo *Head)
+{
+	for (CdBlockStream::TBlockInfo *p=Head; p; )
+	{
+		CdBlockStream::TBlockInfo *q = p;
+		p = p->Next;
+		delete q;
+	}
+}
+
+CdBlockStream::TBlockInfo::TBlockInfo()
+{
+	Next = NULL;
+	BlockStart = BlockSize = StreamStart = StreamNext = 0;
+	Head = false;
+}
+
+CdBlockStream::TBlockInfo::TBlockInfo(bool head, SIZE64 bs, SIZE64 ss, SIZE64 sn)
+{
+	Next = NULL;
+	BlockStart = 0;
+	BlockSize = bs; StreamStart = ss; StreamNext = sn;
+	Head = head;
+}
+
+SIZE64 CdBlockStream::TBlockInfo::AbsStart() const
+{
+	return StreamStart - (Head ? (HEAD_SIZE+2*GDS_POS_SIZE) : (2*GDS_POS_SIZE));
+}
+
+void CdBlockStream::TBlockInfo::SetSize(CdStream &Stream, SIZE64 _Size)
+{
+	BlockSize = _Size;
+	SIZE64 L = Head ? (HEAD_SIZE + 2*GDS_POS_SIZE) : (2*GDS_POS_SIZE);
+	Stream.SetPosition(StreamStart - L);
+	BYTE_LE<CdStream>(Stream) <<
+		TdGDSPos((_Size+L) | (Head ? GDS_STREAM_POS_MASK_HEAD_BIT : 0));
+}
+
+void CdBlockStream::TBlockInfo::SetNext(CdStream &Stream, SIZE64 _Next)
+{
+	StreamNext = _Next;
+	Stream.SetPosition(StreamStart -
+		(Head ? (HEAD_SIZE + GDS_POS_SIZE) : GDS_POS_SIZE));
+	BYTE_LE<CdStream>(Stream) << TdGDSPos(_Next);
+}
+
+void CdBlockStream::TBlockInfo::SetSize2(CdStream &Stream,
+	SIZE64 _Size, SIZE64 _Next)
+{
+	BlockSize = _Size;
+	StreamNext = _Next;
+	SIZE64 L = Head ? (HEAD_SIZE + 2*GDS_POS_SIZE) : (2*GDS_POS_SIZE);
+	Stream.SetPosition(StreamStart - L);
+	BYTE_LE<CdStream>(Stream)
+		<< TdGDSPos((_Size+L) | (Head ? GDS_STREAM_POS_MASK_HEAD_BIT : 0))
+		<< TdGDSPos(_Next);
+}
+
+
+CdBlockStream::CdBlockStream(CdBlockCollection &vCollection):
+	CdStream(), fCollection(vCollection)
+{
+	fID = 0;
+	fList = fCurrent = NULL;
+	fPosition = fBlockCapacity = 0;
+	fBlockSize = 0;
+	fNeedSyncSize = false;
+	fHasCache = false;
+	if (vCollection.fStream)
+	{
+		vCollection.fStream->AddRef();
+	}
+}
+
+CdBlockStream::~CdBlockStream()
+{
+	_ClearCache();
+	SyncSizeInfo();
+	xClearList(fList);
+	if (fCollection.fStream)
+		fCollection.fStream->Release();
+}
+
+ssize_t CdBlockStream::Read(void *Buffer, ssize_t Count)
+{
+	SIZE64 LastPos = fPosition;
+	if ((LastPos+Count) > fBlockSize)
+		Count = fBlockSize - LastPos;
+
+	if (fCurrent && (Count>0))
+	{
+		CdStream *vStream = fCollection.Stream();
+		if (!vStream) return 0;
+		TdAutoMutex AutoMutex(fCollection.fReadLock);
+
+		char *p = (char*)Buffer;
+		SIZE64 I, L;
+		ssize_t RL;
+		do {
+			I = fPosition - fCurrent->BlockStart;
+			L = fCurrent->BlockSize - I;
+			if (Count < L)
+			{
+				vStream->SetPosition(fCurrent->StreamStart + I);
+				RL = vStream->Read((void*)p, Count);
+				fPosition += RL;
+				break;
+			} else {
+				if (L > 0)
+				{
+					vStream->SetPosition(fCurrent->StreamStart + I);
+					RL = vStream->Read((void*)p, L);
+					Count -= RL; fPosition += RL; p += RL;
+					if (RL != L) break;
+                }
+				fCurrent = fCurrent->Next;
+				if ((fCurrent==NULL) || (Count<=0))
+					break;
+			}
+		} while (true);
+	}
+
+	return fPosition - LastPos;
+}
+
+ssize_t CdBlockStream::Write(const void *Buffer, ssize_t Count)
+{
+	SIZE64 LastPos = fPosition;
+
+	if (Count > 0)
+	{
+		_ClearCache();
+		SIZE64 L = fPosition + Count;
+		if (L > fBlockCapacity)
+			fCollection._IncStreamSize(*this, L);
+
+		CdStream *vStream = fCollection.Stream();
 		if (!vStream) return 0;
 
 		C_UInt8 *p = (C_UInt8*)Buffer;
@@ -3073,6 +5684,21 @@ SIZE64 CdBlockStream::GetSize()
 	return fBlockSize;
 }
 
+const void *CdBlockStream::ReadPtr(SIZE64 Pos, ssize_t &Count)
+{
+	CdStream *vStream = fCollection.Stream();
+	if (!vStream || (Pos < 0) || (Pos >= fBlockSize) || (Count <= 0))
+		return NULL;
+	// the contiguous data in the current block
+	TBlockInfo *p = _FindCur(Pos);
+	if (!p) return NULL;
+	SIZE64 I = Pos - p->BlockStart;
+	SIZE64 L = p->BlockSize - I;
+	if (L <= 0) return NULL;
+	if (Count > L) Count = L;
+	return vStream->ReadPtr(p->StreamStart + I, Count);
+}
+
 SIZE64 CdBlockStream::GetSize() const
 {
 	return fBlockSize;
@@ -3082,6 +5708,7 @@ void CdBlockStream::SetSize(SIZE64 NewSize)
 {
 	if ((0<=NewSize) && (NewSize!=fBlockSize))
 	{
+		_ClearCache();
 		if (NewSize > fBlockCapacity)
 			fCollection._IncStreamSize(*this, NewSize);
 		else if (NewSize < fBlockCapacity)
@@ -3101,6 +5728,7 @@ void CdBlockStream::SetSizeOnly(SIZE64 NewSize)
 {
 	if ((0<=NewSize) && (NewSize!=fBlockSize))
 	{
+		_ClearCache();
 		if (NewSize > fBlockCapacity)
 		{
 			SetSize(NewSize);
@@ -3163,6 +5791,103 @@ CdBlockStream::TBlockInfo *CdBlockStream::_FindCur(const SIZE64 Pos)
 		return NULL;
 }
 
+void CdBlockStream::_ClearCache()
+{
+	// remove the decoded blocks of this stream
+	if (fHasCache)
+	{
+		CdRABlockCache::Instance().Remove(&fCollection, fID);
+		fHasCache = false;
+	}
+}
+
+
+// CdBlockStreamView
+
+static const char *ERR_VIEW_READONLY = "CdBlockStreamView is read-only.";
+
+CdBlockStreamView::CdBlockStreamView(CdBlockStream &Source): CdStream()
+{
+	fSource = &Source;
+	fSource->AddRef();
+	fCurrent = Source.List();
+	fPosition = 0;
+}
+
+CdBlockStreamView::~CdBlockStreamView()
+{
+	fSource->Release();
+}
+
+ssize_t CdBlockStreamView::Read(void *Buffer, ssize_t Count)
+{
+	const SIZE64 Size = fSource->Size();
+	if (fPosition + Count > Size)
+		Count = Size - fPosition;
+	CdStream *vStream = fSource->Collection().Stream();
+	if (!vStream || (Count <= 0)) return 0;
+
+	// the block containing the current position
+	if (!fCurrent || (fPosition < fCurrent->BlockStart))
+		fCurrent = fSource->List();
+	while (fCurrent && fCurrent->Next &&
+			(fPosition >= fCurrent->Next->BlockStart))
+		fCurrent = fCurrent->Next;
+
+	TdAutoMutex AutoMutex(fSource->Collection().ReadLock());
+	C_UInt8 *p = (C_UInt8*)Buffer;
+	const SIZE64 LastPos = fPosition;
+	while (fCurrent && (Count > 0))
+	{
+		SIZE64 I = fPosition - fCurrent->BlockStart;
+		SIZE64 L = fCurrent->BlockSize - I;
+		if (L > Count) L = Count;
+		if (L > 0)
+		{
+			vStream->SetPosition(fCurrent->StreamStart + I);
+			ssize_t RL = vStream->Read(p, L);
+			fPosition += RL; p += RL; Count -= RL;
+			if (RL != L) break;
+		}
+		if (Count > 0) fCurrent = fCurrent->Next;
+	}
+	return fPosition - LastPos;
+}
+
+ssize_t CdBlockStreamView::Write(const void *Buffer, ssize_t Count)
+{
+	throw ErrStream(ERR_VIEW_READONLY);
+}
+
+SIZE64 CdBlockStreamView::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	switch (Origin)
+	{
+		case soBeginning:
+			break;
+		case soCurrent:
+			Offset += fPosition; break;
+		case soEnd:
+			Offset += fSource->Size(); break;
+		default:
+			return -1;
+	}
+	if ((Offset < 0) || (Offset > fSource->Size()))
+		throw ErrStream(ERR_BLOCK_INVALID_POS, Offset, (C_Int64)fSource->Size());
+	return (fPosition = Offset);
+}
+
+SIZE64 CdBlockStreamView::GetSize()
+{
+	return fSource->Size();
+}
+
+void CdBlockStreamView::SetSize(SIZE64 NewSize)
+{
+	throw ErrStream(ERR_VIEW_READONLY);
+}
+
+
 
 // =====================================================================
 // CdBlockCollection
@@ -3178,6 +5903,7 @@ CdBlockCollection::CdBlockCollection(const SIZE64 vCodeStart)
 	fCodeStart = vCodeStart;
 	fClassMgr = &dObjManager();
 	fReadOnly = false;
+	fReadLock = NULL;
 }
 
 CdBlockCollection::~CdBlockCollection()
@@ -3618,6 +6344,7 @@ void CdBlockCollection::DeleteBlockStream(TdGDSBlockID id)
 			(*it)->fList = NULL;
 		}
 		// remove
+		(*it)->_ClearCache();
 		(*it)->Release();
 		fBlockList.erase(it);
 	} else {
@@ -54,6 +54,11 @@
 #   include "../LZ4/lz4frame.h"
 #endif
 
+// zstd library
+#ifndef COREARRAY_NO_ZSTD
+#   include "../ZSTD/zstd.h"
+#endif
+
 // lzma library
 #ifndef COREARRAY_NO_LZMA
 #   ifdef COREARRAY_USE_LZMA_EXT
@@ -148,6 +153,36 @@ namespace CoreArray
 	};
 
 
+	/// Read-only file stream mapped into memory, which serves Read() and
+	/// ReadPtr() from the mapping without system calls
+	class COREARRAY_DLL_DEFAULT CdMappedFileStream: public CdFileStream
+	{
+	public:
+		CdMappedFileStream(const char *const AFileName);
+		virtual ~CdMappedFileStream();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+		virtual const void *ReadPtr(SIZE64 Pos, ssize_t &Count);
+
+		/// the start of mapped file
+		COREARRAY_INLINE const C_UInt8 *Memory() const { return fMemory; }
+
+	protected:
+		const C_UInt8 *fMemory;
+		SIZE64 fSize, fPosition;
+	#if defined(COREARRAY_PLATFORM_WINDOWS)
+		HANDLE fMapping;
+	#endif
+
+	private:
+		void Unmap();
+	};
+
+
 	/// Temporary stream, in which a temporary file is created
 	class COREARRAY_DLL_DEFAULT CdTempStream: public CdFileStream
 	{
@@ -276,12 +311,17 @@ namespace CoreArray
 		TdCompressRemainder() { Size = 0; Buf64 = 0; }
 	};
 
+	class CdRA_ReadAhead;
+	class CdRA_ParallelWrite;
+
 	class COREARRAY_DLL_DEFAULT CdRecodeStream: public CdStream
 	{
 	public:
 		friend class CdRAAlgorithm;
 		friend class CdRA_Read;
 		friend class CdRA_Write;
+		friend class CdRA_ReadAhead;
+		friend class CdRA_ParallelWrite;
 
 		/// compression level
 		enum TLevel
@@ -370,18 +410,30 @@ namespace CoreArray
 		CdRAAlgorithm(CdRecodeStream &owner);
 		/// compression block information
 		COREARRAY_INLINE TBlockSize SizeType() const { return fSizeType; }
+		/// the dictionary priming every block, empty for no dictionary
+		COREARRAY_INLINE const vector<C_UInt8> &Dict() const { return fDict; }
 
 	protected:
 		/// the owner of this object
 		CdRecodeStream &fOwner;
 		/// the size of independent compressed block
 		TBlockSize fSizeType;
+		/// the dictionary priming every block, shared by the encoder and
+		/// decoder, so the blocks can still be decoded independently
+		vector<C_UInt8> fDict;
 	};
 
 	/// The reading algorithm with random access on data stream
 	class COREARRAY_DLL_DEFAULT CdRA_Read: public CdRAAlgorithm
 	{
 	public:
+		friend class CdRA_ReadAhead;
+
+		/// decode an entire independent block, called by worker threads
+		typedef void (*TDecodeProc)(const C_UInt8 *In, size_t InSize,
+			C_UInt8 *Out, size_t OutSize, int Param, const C_UInt8 *Dict,
+			size_t DictSize);
+
 		/// constructor
 		CdRA_Read(CdRecodeStream *owner);
 		/// destructor
@@ -391,6 +443,51 @@ namespace CoreArray
 		void GetUpdated();
 		/// get block lists
 		void GetBlockInfo(vector<SIZE64> &RawSize, vector<SIZE64> &CmpSize);
+		/// set the dictionary used by the encoder, called before reading
+		virtual void SetDict(const vector<C_UInt8> &Dict);
+
+		/// the total number of independent compressed blocks
+		COREARRAY_INLINE C_Int32 BlockNum() const { return fBlockNum; }
+		/// whether the checksums of raw blocks are stored (version 0x12)
+		COREARRAY_INLINE bool HasChecksum() const { return !fChecksum.empty(); }
+		/// read the compressed data of block 'Idx'
+		void LoadBlock(C_Int32 Idx, vector<C_UInt8> &Cmp);
+		/// decode block 'Idx' loaded by LoadBlock() to 'Raw', and compare
+		/// with its checksum if any; it is thread-safe after GetUpdated()
+		void VerifyBlock(C_Int32 Idx, const vector<C_UInt8> &Cmp,
+			vector<C_UInt8> &Raw) const;
+
+		/// set whether the decoded blocks are compared with their checksums,
+		/// applied to a stream when it is opened or seeked
+		static void SetVerify(bool Verify);
+		/// get whether the decoded blocks are compared with their checksums
+		static bool GetVerify();
+
+		/// set the number of worker threads decoding the blocks ahead of a
+		/// sequential scan (0 for no read-ahead), and the number of blocks
+		/// decoded ahead (0 for twice the number of threads)
+		static void SetReadAhead(int NumThread, int NumBlock);
+		/// get the settings of read-ahead
+		static void GetReadAhead(int &NumThread, int &NumBlock);
+		/// join the worker threads of read-ahead and parallel compression,
+		/// when the library is unloaded
+		static void ShutdownPool();
+
+		/// the statistics of the decoded block cache
+		struct TBlockCacheStat
+		{
+			C_Int64 MaxSize;   ///< the memory budget in bytes, 0 for no cache
+			C_Int64 Size;      ///< the total size of the cached blocks
+			C_Int64 NumBlock;  ///< the number of cached blocks
+			C_Int64 Hits;      ///< the number of reads served by the cache
+			C_Int64 Misses;    ///< the number of blocks decoded and cached
+		};
+		/// set the memory budget of the decoded block cache shared by all
+		/// GDS block streams (0 to disable and free the cache)
+		static void SetBlockCache(C_Int64 MaxSize);
+		/// get the statistics of the decoded block cache, and reset the
+		/// hit and miss counters if 'ResetCounter' is true
+		static TBlockCacheStat GetBlockCache(bool ResetCounter=false);
 
 	protected:
 		/// the version number
@@ -421,6 +518,26 @@ namespace CoreArray
 		TIndex *fIndex;
 		/// the available size for the variable fIndex
 		ssize_t fIndexSize;
+		/// the checksums of raw blocks in version 0x12, otherwise empty
+		vector<C_UInt64> fChecksum;
+		/// if true, the blocks are decoded entirely and compared with
+		/// fChecksum
+		bool fVerify;
+
+		/// the function decoding a block, NULL if no read-ahead
+		TDecodeProc fDecodeProc;
+		/// the parameter passed to fDecodeProc
+		int fDecodeParam;
+		/// the blocks decoded ahead, NULL if no sequential scan is detected
+		CdRA_ReadAhead *fReadAhead;
+		/// the number of successive forward moves to the next block
+		int fSeqBlockCnt;
+		/// true if the blocks are read from the decoded block cache
+		bool fCacheMode;
+		/// the decoded block if it is not kept in the cache
+		vector<C_UInt8> fCacheBuf;
+		/// the block index of fCacheBuf, -1 for none
+		C_Int32 fCacheBufIdx;
 
 		/// initialize the stream with magic number and others
 		void InitReadStream();
@@ -432,8 +549,26 @@ namespace CoreArray
 		void BinSearch(SIZE64 Position, ssize_t low, ssize_t high);
 		/// read the magic number on Stream, return true if succeeds
 		virtual bool ReadMagicNumber(CdStream &Stream) = 0;
-		/// load the indexing information for version 0x11
+		/// load the indexing information for version 0x11 and 0x12
 		void LoadIndexing();
+		/// the checksum of block 'Idx', 0 if no checksum
+		COREARRAY_INLINE C_UInt64 BlockChecksum(C_Int32 Idx) const
+			{ return fChecksum.empty() ? 0 : fChecksum[Idx]; }
+
+		/// whether the data are read from entire decoded blocks (the blocks
+		/// decoded ahead or the decoded block cache)
+		bool BlockReadActive() const;
+		/// read from entire decoded blocks, and update 'CurPosition'
+		ssize_t BlockRead(void *Buffer, ssize_t Count, SIZE64 &CurPosition);
+		/// called after moving to the next block when reading, return true
+		/// if read-ahead is switched on
+		bool ReadAheadNext();
+		/// called after seeking, 'Moved' is true if the current block is
+		/// changed; return true if entire decoded blocks are used, otherwise
+		/// 'Moved' is set if the decoding state needs resetting
+		bool BlockReadSeek(C_Int32 OldBlockIdx, bool &Moved);
+		/// read the current block via the decoded block cache
+		void CacheRead(SIZE64 Offset, void *Buffer, ssize_t Count);
 
 	private:
 		/// get the header of block used in Version_1.0
@@ -441,10 +576,34 @@ namespace CoreArray
 	};
 
 	/// The writing algorithm with random access on data stream
+	/** With parallel compression, the data are cut into blocks of the
+	 *  uncompressed block size instead of the compressed size, so the
+	 *  blocks can be compressed independently by worker threads; the output
+	 *  does not depend on the number of threads.
+	**/
 	class COREARRAY_DLL_DEFAULT CdRA_Write: public CdRAAlgorithm
 	{
 	public:
+		friend class CdRA_ParallelWrite;
+
+		/// compress an entire independent block, called by worker threads
+		typedef void (*TEncodeProc)(const C_UInt8 *In, size_t InSize,
+			vector<C_UInt8> &Out, int Level, int SizeType, const C_UInt8 *Dict,
+			size_t DictSize);
+
 		CdRA_Write(CdRecodeStream *owner, TBlockSize bs);
+		~CdRA_Write();
+
+		/// set the number of worker threads compressing blocks in parallel,
+		/// 0 for serial compression
+		static void SetParallel(int NumThread);
+		/// get the number of threads compressing blocks in parallel
+		static int GetParallel();
+		/// set whether the checksums of raw blocks are stored (version 0x12)
+		/// in the streams created afterward
+		static void SetChecksum(bool Checksum);
+		/// get whether the checksums of raw blocks are stored
+		static bool GetChecksum();
 
 		/// initialize the stream with magic number and others
 		void InitWriteStream();
@@ -456,8 +615,13 @@ namespace CoreArray
 		/// finalize a compressed block
 		void DoneWriteBlock();
 
+		/// prime all blocks with 'Dict' if it is not empty, otherwise train
+		/// a dictionary from the first data written and save it to 'Dict';
+		/// called before writing, and ignored if no dictionary is supported
+		void SetDict(vector<C_UInt8> &Dict);
+
 	protected:
-		/// the version number, 0x11 by default
+		/// the version number, 0x11 by default, or 0x12 with checksums
 		C_UInt8 fVersion;
 		/// the total number of independent compressed block
 		C_Int32 fBlockNum;
@@ -469,10 +633,44 @@ namespace CoreArray
 		SIZE64 fBlockListStart;
 		/// whether a block is initialized
 		bool fHasInitWriteBlock;
-		/// save block info in version 0x11
+		/// save block info in version 0x11 and 0x12
 		vector<C_UInt64> fBlockInfoList;
-		/// add indexing info to fBlockInfoList
-		inline void AddBlockInfo(C_UInt32 CmpLen, C_UInt32 RawLen);
+		/// save the checksums of raw blocks in version 0x12
+		vector<C_UInt64> fChecksumList;
+		/// add indexing info to fBlockInfoList, and the checksum of raw
+		/// block to fChecksumList
+		inline void AddBlockInfo(C_UInt32 CmpLen, C_UInt32 RawLen,
+			C_UInt64 Checksum=0);
+
+		/// the function compressing a block, NULL if no parallel compression
+		TEncodeProc fEncodeProc;
+		/// the compression level passed to fEncodeProc
+		int fEncodeLevel;
+		/// the blocks compressed in parallel, NULL for serial compression
+		CdRA_ParallelWrite *fParallel;
+		/// the maximum size of dictionary, 0 if it is not supported
+		size_t fDictMaxSize;
+		/// if true, the data are buffered in fDictSample for training
+		bool fDictTrain;
+		/// the first data written, used to train the dictionary
+		vector<C_UInt8> fDictSample;
+		/// the trained dictionary is saved to it, or NULL
+		vector<C_UInt8> *fDictOut;
+
+		/// buffer the data until the sample is large enough for training
+		ssize_t DictWrite(const void *Buffer, ssize_t Count);
+		/// train the dictionary from the buffered data, and write the data
+		void DictSync();
+		/// called when the dictionary is set before writing the first block
+		virtual void InitDict() { }
+
+		/// return true if the blocks are compressed in parallel, which is
+		/// decided before writing the first block
+		bool ParallelMode();
+		/// buffer the data, and compress the full blocks in parallel
+		ssize_t ParallelWrite(const void *Buffer, ssize_t Count);
+		/// compress the buffered data as a block, and write all blocks
+		void ParallelSync();
 
 		/// write the magic number on Stream
 		virtual void WriteMagicNumber(CdStream &Stream) = 0;
@@ -559,6 +757,10 @@ namespace CoreArray
 		virtual ssize_t Write(const void *Buffer, ssize_t Count);
 		virtual void Close();
 
+		/// prime all blocks with 'Dict', or train it if 'Dict' is empty
+		COREARRAY_INLINE void SetDict(vector<C_UInt8> &Dict)
+			{ CdRA_Write::SetDict(Dict); }
+
 		/// Copy from a CdStream object
 		/** \param Source  a stream object
 		 *  \param Pos     the starting position
@@ -574,6 +776,8 @@ namespace CoreArray
 		virtual void WriteMagicNumber(CdStream &Stream);
 		/// finish and close a ZIP compressed block
 		void SyncFinishBlock();
+		/// use the largest window with the dictionary
+		virtual void InitDict();
 	};
 
 
@@ -588,12 +792,15 @@ namespace CoreArray
 
 		virtual ssize_t Read(void *Buffer, ssize_t Count);
 		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual void SetDict(const vector<C_UInt8> &Dict);
 
 	protected:
 		/// read the magic number on Stream
 		virtual bool ReadMagicNumber(CdStream &Stream);
 		/// reset the variables internally
 		void Reset();
+		/// reset the zlib stream at the start of a block
+		void ResetBlock();
 	};
 
 
@@ -720,6 +927,10 @@ namespace CoreArray
 		**/
 		virtual void CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count);
 
+		/// prime all blocks with 'Dict', or train it if 'Dict' is empty
+		COREARRAY_INLINE void SetDict(vector<C_UInt8> &Dict)
+			{ CdRA_Write::SetDict(Dict); }
+
 		ssize_t Pending() { return 0; }
 		COREARRAY_INLINE bool HaveClosed() const { return fHaveClosed; }
 		COREARRAY_INLINE CdRecodeStream::TLevel Level() const { return fLevel; }
@@ -753,12 +964,14 @@ namespace CoreArray
 		friend class CdLZ4Encoder_RA;
 
 		CdLZ4Decoder_RA(CdStream &Source);
+		virtual ~CdLZ4Decoder_RA();
 
 		virtual ssize_t Read(void *Buffer, ssize_t Count);
 		virtual ssize_t Write(const void *Buffer, ssize_t Count);
 		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
 		virtual SIZE64 GetSize();
 		virtual void SetSize(SIZE64 NewSize);
+		virtual void SetDict(const vector<C_UInt8> &Dict);
 
 		COREARRAY_INLINE CdRecodeStream::TLevel Level() const { return fLevel; }
 
@@ -767,8 +980,9 @@ namespace CoreArray
 		CdRecodeStream::TLevel fLevel;
 		/// the decompression algorithm
 		LZ4_streamDecode_t lz4_body;
-		/// the buffer for uncompressed data, since LZ4_decompress_safe_continue needs the last block
-		char fRawBuffer[2][LZ4RA_RAW_BUFFER_SIZE];
+		/// the buffer for uncompressed data, since LZ4_decompress_safe_continue
+		/// needs the last block; allocated on the first partial block read
+		char *fRawBuffer[2];
 		/// indicator for double buffer, 0: fRawBuffer[0], 1: fRawBuffer[1]
 		int _IdxRaw;
 		/// the current position
@@ -780,6 +994,10 @@ namespace CoreArray
 		virtual bool ReadMagicNumber(CdStream &Stream);
 		/// reset the variables internally
 		void Reset();
+		/// reset the decoding state at the start of a block
+		void ResetBlock();
+		/// decode the entire current block into 'Buffer' without the raw buffer
+		void DecodeBlock(C_UInt8 *Buffer);
 	};
 
 
@@ -822,7 +1040,9 @@ namespace CoreArray
 		public CdBaseXZStream, public CdRecodeLevel
 	{
 	public:
-		CdXZEncoder(CdStream &Dest, TLevel Level);
+		/// the multithreaded encoder is used if 'Parallel' is true and it is
+		/// switched on by SetParallel()
+		CdXZEncoder(CdStream &Dest, TLevel Level, bool Parallel=true);
 		CdXZEncoder(CdStream &Dest, int DictKB);
 		virtual ~CdXZEncoder();
 
@@ -836,10 +1056,17 @@ namespace CoreArray
     	COREARRAY_INLINE bool HaveClosed() const { return fHaveClosed; }
 		TdCompressRemainder *PtrExtRec;
 
+		/// set the number of threads used by the multithreaded xz encoder
+		/// for the streams without random access (0 or 1 for single-threaded),
+		/// and the uncompressed size of xz blocks (0 for the liblzma default)
+		static void SetParallel(int NumThread, C_Int64 BlockSize);
+		/// get the settings of the multithreaded xz encoder
+		static void GetParallel(int &NumThread, C_Int64 &BlockSize);
+
 	protected:
 		bool fHaveClosed;
 		void SyncFinish();
-		void InitXZStream();
+		void InitXZStream(int NumThread=0);
 	};
 
 
@@ -928,11 +1155,242 @@ namespace CoreArray
 
 
 
+	// =====================================================================
+	// The classes of zstd stream
+	// =====================================================================
+
+#ifndef COREARRAY_NO_ZSTD
+
+	/** The wrapper of Zstandard algorithm (https://facebook.github.io/zstd) **/
+	class COREARRAY_DLL_DEFAULT CdBaseZstdStream: public CdRecodeStream
+	{
+	public:
+		CdBaseZstdStream(CdStream &vStream);
+	};
+
+
+	/// Input stream for zstd
+	class COREARRAY_DLL_DEFAULT CdZstdEncoder:
+		public CdBaseZstdStream, public CdRecodeLevel
+	{
+	public:
+		CdZstdEncoder(CdStream &Dest, TLevel Level);
+		virtual ~CdZstdEncoder();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual void SetSize(SIZE64 NewSize);
+		virtual void Close();
+
+		ssize_t Pending();
+		COREARRAY_INLINE bool HaveClosed() const { return fHaveClosed; }
+		TdCompressRemainder *PtrExtRec;
+
+	protected:
+		ZSTD_CCtx *fCCtx;
+		bool fHaveClosed;
+		void SyncFinish();
+	};
+
+
+	/// Output stream for zstd
+	class COREARRAY_DLL_DEFAULT CdZstdDecoder: public CdBaseZstdStream
+	{
+	public:
+		CdZstdDecoder(CdStream &Source);
+		virtual ~CdZstdDecoder();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+
+	protected:
+		ZSTD_DCtx *fDCtx;
+		C_UInt8 fBuffer[16384];  // 2^14, 16K
+		size_t fBufPos, fBufSize;  ///< the unused input in fBuffer
+		SIZE64 fCurPosition;
+		void ResetDCtx();
+	};
+
+
+	/// Input stream for zstd with the support of random access
+	/** Unlike the other algorithms, a block is ended at the uncompressed
+	 *  block size, and each block is compressed as a whole zstd frame, in
+	 *  parallel if CdRA_Write::SetParallel() is used.
+	**/
+	class COREARRAY_DLL_DEFAULT CdZstdEncoder_RA:
+		protected CdRA_Write, public CdZstdEncoder
+	{
+	public:
+		CdZstdEncoder_RA(CdStream &Dest, TLevel Level, TBlockSize BlockSize);
+
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual void Close();
+
+		/// Copy from a CdStream object
+		/** \param Source  a stream object
+		 *  \param Pos     the starting position
+		 *  \param Count   the number of bytes, -1 for all data starting from Pos
+		**/
+		virtual void CopyFrom(CdStream &Source, SIZE64 Pos, SIZE64 Count);
+
+	protected:
+		/// write the magic number
+		virtual void WriteMagicNumber(CdStream &Stream);
+	};
+
+
+	/// Output stream for zstd with the support of random access
+	class COREARRAY_DLL_DEFAULT CdZstdDecoder_RA:
+		public CdRA_Read, public CdZstdDecoder
+	{
+	public:
+		friend class CdZstdEncoder_RA;
+
+		CdZstdDecoder_RA(CdStream &Source);
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+
+	protected:
+		/// read the magic number on Stream
+		virtual bool ReadMagicNumber(CdStream &Stream);
+		/// reset the variables internally
+		void Reset();
+	};
+
+
+	/// Exception for zstd stream
+	class COREARRAY_DLL_EXPORT EZstdError: public ErrRecodeStream
+	{
+	public:
+		EZstdError(): ErrRecodeStream()
+			{ }
+		EZstdError(const char *fmt, ...): ErrRecodeStream()
+			{ _COREARRAY_ERRMACRO_(fmt); }
+		EZstdError(const std::string &msg): ErrRecodeStream()
+			{ fMessage = msg; }
+		EZstdError(size_t code): ErrRecodeStream()
+			{ fMessage = Format("zstd stream error: %s", ZSTD_getErrorName(code)); }
+	};
+
+#endif
+
+
+
+	// =====================================================================
+	// The classes of shuffle filter
+	// =====================================================================
+
+	/// The base class of byte-shuffle, bit-shuffle and delta filters
+	/** A shuffle filter is chained before a compression stream. The data are
+	 *  split into chunks of SHUFFLE_CHUNK elements, and the bytes (or bits)
+	 *  of the elements in a chunk are grouped by their significance, which
+	 *  makes numeric data more compressible. The whole elements at the end of
+	 *  data are shuffled as a smaller chunk, and the remaining bytes (e.g.,
+	 *  fewer than 8 elements in the bit-shuffle mode) are left unchanged.
+	 *  The delta filter replaces integers by the zigzag-encoded differences
+	 *  of adjacent elements before shuffling, starting from zero in each
+	 *  chunk, so that a chunk is still decoded independently.
+	**/
+	class COREARRAY_DLL_DEFAULT CdShuffleStream: public CdRecodeStream
+	{
+	public:
+		/// shuffle mode (bit flags)
+		enum TMode
+		{
+			smNone  = 0,   //< no shuffle
+			smByte  = 1,   //< byte shuffle
+			smBit   = 2,   //< bit shuffle
+			smDelta = 4    //< delta and zigzag encoding of integers
+		};
+
+		/// the number of elements in a chunk
+		static const ssize_t SHUFFLE_CHUNK = 4096;
+
+		CdShuffleStream(CdStream &vStream, TMode Mode, int ElmSize);
+
+		COREARRAY_INLINE TMode Mode() const { return fMode; }
+		COREARRAY_INLINE int ElmSize() const { return fElmSize; }
+
+	protected:
+		TMode fMode;       ///< shuffle mode
+		int fElmSize;      ///< the size of element in bytes
+		ssize_t fChunkSize;  ///< the size of chunk in bytes
+		vector<C_UInt8> fBuffer;  ///< the current chunk
+		vector<C_UInt8> fTmp;     ///< the shuffled chunk and working buffer
+	};
+
+
+	/// Input stream of shuffle filter
+	class COREARRAY_DLL_DEFAULT CdShuffleEncoder: public CdShuffleStream
+	{
+	public:
+		CdShuffleEncoder(CdStream &Dest, TMode Mode, int ElmSize);
+		virtual ~CdShuffleEncoder();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual void SetSize(SIZE64 NewSize);
+
+		/// write the remaining data to the destination stream
+		void Close();
+
+		/// the number of bytes not passed to the destination stream
+		COREARRAY_INLINE ssize_t Pending() const { return fBufLen; }
+		COREARRAY_INLINE bool HaveClosed() const { return fHaveClosed; }
+
+	protected:
+		ssize_t fBufLen;
+		bool fHaveClosed;
+		void WriteChunk(const C_UInt8 *Buffer, ssize_t Count);
+	};
+
+
+	/// Output stream of shuffle filter
+	class COREARRAY_DLL_DEFAULT CdShuffleDecoder: public CdShuffleStream
+	{
+	public:
+		CdShuffleDecoder(CdStream &Source, TMode Mode, int ElmSize);
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+
+	protected:
+		SIZE64 fCurPosition;  ///< the current position
+		SIZE64 fChunkStart;   ///< the starting position of the current chunk
+		ssize_t fChunkLen;    ///< the length of the current chunk, -1 if none
+		bool LoadChunk(SIZE64 Position);
+	};
+
+
+	/// Exception for shuffle filter
+	class COREARRAY_DLL_EXPORT EShuffleError: public ErrRecodeStream
+	{
+	public:
+		EShuffleError(): ErrRecodeStream()
+			{ }
+		EShuffleError(const char *fmt, ...): ErrRecodeStream()
+			{ _COREARRAY_ERRMACRO_(fmt); }
+		EShuffleError(const std::string &msg): ErrRecodeStream()
+			{ fMessage = msg; }
+	};
+
+
+
 	// =====================================================================
 	// GDS block stream
 	// =====================================================================
 
 	class COREARRAY_DLL_DEFAULT CdBlockCollection;
+	class CdThreadMutex;
 
 	/// 0x7FFF,FFFF,FFFF
 	extern const C_Int64 GDS_STREAM_POS_MASK;
@@ -945,6 +1403,7 @@ namespace CoreArray
 	{
 	public:
 		friend class CdBlockCollection;
+		friend class CdRA_Read;
 
 		struct TBlockInfo
 		{
@@ -972,6 +1431,7 @@ namespace CoreArray
 		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
 		virtual SIZE64 GetSize();
 		virtual void SetSize(SIZE64 NewSize);
+		virtual const void *ReadPtr(SIZE64 Pos, ssize_t &Count);
         void SetSizeOnly(SIZE64 NewSize);
 
 		void SyncSizeInfo();
@@ -995,7 +1455,9 @@ namespace CoreArray
 
 	private:
     	bool fNeedSyncSize;
+		bool fHasCache;  ///< true if the decoded blocks may be cached
 		TBlockInfo *_FindCur(const SIZE64 Pos);
+		void _ClearCache();
 	};
 
 	/// The pointer to the chunk stream
@@ -1004,6 +1466,28 @@ namespace CoreArray
 	typedef CdBlockStream::TBlockInfo* PdBlockStream_BlockInfo;
 
 
+	/// A read-only view of a chunk stream with its own position, so that
+	/// several threads can read different parts of the same chunk stream
+	/// (the stream of collection is guarded by its read lock)
+	class COREARRAY_DLL_DEFAULT CdBlockStreamView: public CdStream
+	{
+	public:
+		CdBlockStreamView(CdBlockStream &Source);
+		virtual ~CdBlockStreamView();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+
+	protected:
+		CdBlockStream *fSource;
+		const CdBlockStream::TBlockInfo *fCurrent;
+		SIZE64 fPosition;
+	};
+
+
 	/// a collection of stream block
 	class COREARRAY_DLL_DEFAULT CdBlockCollection: public CdAbstract
 	{
@@ -1040,6 +1524,15 @@ namespace CoreArray
 		COREARRAY_INLINE const CdBlockStream::TBlockInfo* UnusedBlock() const
         	{ return fUnuse; }
 
+		/// set the mutex locked when a block stream reads the file stream, so
+		/// that different block streams can be read by several threads
+		/// (NULL, no lock by default)
+		COREARRAY_INLINE void SetReadLock(CdThreadMutex *Lock)
+			{ fReadLock = Lock; }
+		/// get the mutex locked when a block stream reads the file stream
+		COREARRAY_INLINE CdThreadMutex *ReadLock() const
+			{ return fReadLock; }
+
 	protected:
 		CdStream *fStream;
 		SIZE64 fStreamSize;
@@ -1048,6 +1541,7 @@ namespace CoreArray
 		SIZE64 fCodeStart;
 		CdObjClassMgr *fClassMgr;
 		bool fReadOnly;
+		CdThreadMutex *fReadLock;
 
 		void _IncStreamSize(CdBlockStream &Block, const SIZE64 NewSize);
 		void _DecStreamSize(CdBlockStream &Block, const SIZE64 NewSize);
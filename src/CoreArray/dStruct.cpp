@@ -178,6 +178,21 @@ void CdContainer::Caching()
 	// do nothing ...
 }
 
+int CdContainer::ShuffleElmSize(CdShuffleStream::TMode Mode)
+{
+	const unsigned bits = BitOf();
+	const C_SVType sv = SVType();
+	if (!COREARRAY_SV_NUMERIC(sv) || (bits % 8 != 0))
+		return 0;
+	if (Mode & CdShuffleStream::smDelta)
+	{
+		if (!COREARRAY_SV_INTEGER(sv) ||
+				((bits!=8) && (bits!=16) && (bits!=32) && (bits!=64)))
+			return 0;
+	}
+	return bits / 8;
+}
+
 SIZE64 CdContainer::GDSStreamSize()
 {
 	return -1;
@@ -1150,6 +1165,9 @@ void CdAllocArray::CloseWriter()
             	fPipeInfo->ClosePipe(*fAllocator.BufStream());
 				fNeedUpdate = true;
 				UpdateInfo(NULL);
+				// save the dictionary trained when writing
+				if (fPipeInfo->DictUnsaved())
+					SaveToBlockStream();
 
 				vAllocStream->AddRef();
 				fAllocator.Free();
@@ -1177,6 +1195,7 @@ void CdAllocArray::SetPackedMode(const char *Mode)
 		{
 			Synchronize();
 
+			DeletePipeDict();
 			if (fPipeInfo) delete fPipeInfo;
 			fPipeInfo = dStreamPipeMgr.Match(*this, Mode);
 			if ((fPipeInfo==NULL) && (strcmp(Mode, "")!=0))
@@ -1233,6 +1252,82 @@ void CdAllocArray::SetPackedMode(const char *Mode)
 	}
 }
 
+CdStream *CdAllocArray::EncodeData(CdPipeMgrItem *Pipe)
+{
+	CdStream *TmpStream = new CdTempStream;
+	TmpStream->AddRef();
+	try {
+		TdAutoRef<CdBufStream> Output(new CdBufStream(TmpStream));
+		if (Pipe)
+			Pipe->PushWritePipe(*Output);
+
+		fAllocator.CopyTo(*Output, 0, AllocSize(fTotalCount));
+		Output.get()->FlushWrite();
+		if (Pipe)
+		{
+			Pipe->ClosePipe(*Output);
+			Pipe->GetStreamInfo(Output.get());
+		}
+	}
+	catch (...) {
+		TmpStream->Release();
+		throw;
+	}
+	return TmpStream;
+}
+
+void CdAllocArray::AssignEncoded(CdAllocArray &Source, CdPipeMgrItem *Pipe,
+	CdStream &Encoded)
+{
+	static const char *ERR_ASSIGN_ENCODED =
+		"CdAllocArray::AssignEncoded: the array should be empty.";
+
+	// Pipe is taken over even if failed
+	try {
+		_CheckWritable();
+		_CheckGDSStream();
+		if ((fTotalCount > 0) || (vAllocStream == NULL))
+			throw ErrArray(ERR_ASSIGN_ENCODED);
+	}
+	catch (...) {
+		if (Pipe) delete Pipe;
+		throw;
+	}
+
+	DeletePipeDict();
+	if (fPipeInfo) delete fPipeInfo;
+	fPipeInfo = Pipe;
+	AssignAttribute(Source);
+
+	// copy
+	vAllocStream->AddRef();
+	fAllocator.Free();
+	vAllocStream->SetPosition(0);
+	vAllocStream->SetSizeOnly(0);
+	vAllocStream->CopyFrom(Encoded, 0, -1);
+
+	vAllocStream->SetPosition(0);
+	if (fPipeInfo)
+	{
+		// compressed, no writing
+		fAllocator.Initialize(*vAllocStream, true, false);
+		fPipeInfo->PushReadPipe(*fAllocator.BufStream());
+	} else {
+		// raw data, allow writing
+		fAllocator.Initialize(*vAllocStream, true, true);
+	}
+	vAllocStream->Release();
+
+	TArrayDim DimBuf;
+	Source.GetDim(DimBuf);
+	_ResetDim(DimBuf, Source.DimCnt());
+
+	// save, since PipeInfo and dimensions have been changed.
+	fChanged = true;
+	fNeedUpdate = false;
+	SaveToBlockStream();
+}
+
 const void *CdAllocArray::Append(const void *Buffer, ssize_t Cnt, C_SVType InSV)
 {
 	if (Cnt <= 0) return Buffer;
@@ -1312,7 +1407,7 @@ void CdAllocArray::Caching()
 
 	if (Allocator().BufStream())
 	{
-		CdStream *s = Allocator().BufStream()->Stream();
+		CdStream *s = CdPipeMgrItem::CoderStream(*Allocator().BufStream());
 		if (dynamic_cast<CdZDecoder_RA*>(s))
 		{
 			dynamic_cast<CdZDecoder_RA*>(s)->GetUpdated();
@@ -1325,6 +1420,11 @@ void CdAllocArray::Caching()
 		} else if (dynamic_cast<CdXZDecoder_RA*>(s))
 		{
 			dynamic_cast<CdXZDecoder_RA*>(s)->GetUpdated();
+	#endif
+	#ifndef COREARRAY_NO_ZSTD
+		} else if (dynamic_cast<CdZstdDecoder_RA*>(s))
+		{
+			dynamic_cast<CdZstdDecoder_RA*>(s)->GetUpdated();
 	#endif
 		}
 	}
@@ -1350,12 +1450,16 @@ void CdAllocArray::GetOwnBlockStream(vector<const CdBlockStream*> &Out) const
 {
 	Out.clear();
 	if (vAllocStream) Out.push_back(vAllocStream);
+	if (fPipeInfo && fPipeInfo->DictStream())
+		Out.push_back(fPipeInfo->DictStream());
 }
 
 void CdAllocArray::GetOwnBlockStream(vector<CdStream*> &Out)
 {
 	Out.clear();
 	if (vAllocStream) Out.push_back(vAllocStream);
+	if (fPipeInfo && fPipeInfo->DictStream())
+		Out.push_back(fPipeInfo->DictStream());
 }
 
 void CdAllocArray::_CheckRange(const C_Int32 DimI[])
@@ -119,6 +119,9 @@ namespace CoreArray
 		virtual unsigned BitOf() = 0;
     	/// return whether it is a primitive type
 		virtual bool IsPrimitive() = 0;
+		/// the element size for the shuffle filter if numbers are in bytes,
+		/// and the delta filter requires 1, 2, 4 or 8-byte integers
+		virtual int ShuffleElmSize(CdShuffleStream::TMode Mode);
 
 		/// clear the container
 		virtual void Clear() = 0;
@@ -462,6 +465,16 @@ namespace CoreArray
 
 		virtual void SetPackedMode(const char *Mode);
 
+		/// encode all data with Pipe (NULL, no compression) into a new
+		/// temporary stream which should be released by the caller, the array
+		/// is not changed
+		CdStream *EncodeData(CdPipeMgrItem *Pipe);
+		/// replace the data of an empty array by Encoded returned from
+		/// Source.EncodeData(Pipe), take over Pipe (even if failed), and
+		/// assign the attributes and dimensions of Source
+		void AssignEncoded(CdAllocArray &Source, CdPipeMgrItem *Pipe,
+			CdStream &Encoded);
+
 		/// append new data
 		virtual const void *Append(const void *Buffer, ssize_t Cnt, C_SVType InSV);
 
@@ -478,6 +491,8 @@ namespace CoreArray
 		virtual void GetOwnBlockStream(vector<const CdBlockStream*> &Out) const;
 		/// Get a list of CdStream owned by this object, except fGDSStream
 		virtual void GetOwnBlockStream(vector<CdStream*> &Out);
+		/// the block stream of data processed by the pipe, or NULL
+		virtual CdBlockStream *PipeStream() { return vAllocStream; }
 
 		/// the size of element
 		COREARRAY_FORCEINLINE ssize_t ElmSize() const { return fElmSize; }
@@ -67,11 +67,40 @@ namespace pygds
 	}
 
 
-	/// a list of GDS objects
-	COREARRAY_DLL_LOCAL vector<PdGDSObj> PKG_GDSObj_List;
+	/// a list of file locks, serializing the accesses to 'PKG_GDS_Files'
+	/// from the threads without the GIL
+	COREARRAY_DLL_LOCAL CdThreadMutex PKG_GDS_Locks[PKG_MAX_NUM_GDS_FILES];
+
+	/// get the GDS file of the root folder (e.g., across virtual folders)
+	COREARRAY_DLL_LOCAL PdGDSFile GetRootFile(PdGDSObj Obj)
+	{
+		PdGDSFolder Folder = Obj->Folder();
+		while (Folder != NULL)
+		{
+			Obj = Folder;
+			Folder = Obj->Folder();
+		}
+		return Obj->GDSFile();
+	}
+
+	/// get the lock of the GDS file owning the GDS object
+	COREARRAY_DLL_LOCAL CdThreadMutex *GetObjFileLock(PdGDSObj Obj)
+	{
+		int i = GetFileIndex(GetRootFile(Obj), false);
+		return (i >= 0) ? &PKG_GDS_Locks[i] : NULL;
+	}
+
+	/// get the lock of the GDS file with a file ID
+	COREARRAY_DLL_LOCAL CdThreadMutex *GetFileLock(int file_id)
+	{
+		if ((file_id < 0) || (file_id >= PKG_MAX_NUM_GDS_FILES))
+			return NULL;
+		return &PKG_GDS_Locks[file_id];
+	}
 
-	/// mapping from GDS objects to indices
-	COREARRAY_DLL_LOCAL map<PdGDSObj, int> PKG_GDSObj_Map;
+
+	/// the handles of GDS objects
+	COREARRAY_DLL_LOCAL CdPyObjTable PKG_GDSObj_Table;
 
 
 	/// initialization and finalization
@@ -82,14 +111,12 @@ namespace pygds
 		CInitObject()
 		{
 			memset(PKG_GDS_Files, 0, sizeof(PKG_GDS_Files));
-			PKG_GDSObj_List.reserve(1024);
 		}
 
 		/// finalization
 		~CInitObject()
 		{
-			PKG_GDSObj_List.clear();
-			PKG_GDSObj_Map.clear();
+			PKG_GDSObj_Table.Clear();
 
 			for (int i=0; i < PKG_MAX_NUM_GDS_FILES; i++)
 			{
@@ -162,10 +189,49 @@ COREARRAY_DLL_EXPORT C_BOOL GDS_Is_RFactor(PdGDSObj Obj)
 }
 
 
-// return a Python/NumPy object from a GDS object
-COREARRAY_DLL_EXPORT PyObject* GDS_Py_Array_Read(PdAbstractArray Obj,
-	const C_Int32 *Start, const C_Int32 *Length,
-	const C_BOOL *const Selection[], C_SVType SV)
+// check whether a numpy array can be used as the output buffer of reading
+static void numpy_check_out(PyObject *obj, int ndim, const npy_intp dims[],
+	int npy_type)
+{
+	if (!PyArray_Check(obj))
+		throw ErrGDSFmt("'out' should be a numpy array.");
+	PyArrayObject *arr = (PyArrayObject*)obj;
+
+	if (!PyArray_EquivTypenums(PyArray_TYPE(arr), npy_type) ||
+		!PyArray_ISNOTSWAPPED(arr))
+	{
+		PyArray_Descr *d = PyArray_DescrFromType(npy_type);
+		string nm = d->typeobj->tp_name;
+		Py_DECREF(d);
+		throw ErrGDSFmt("'out' should be a numpy array of '%s' in native "
+			"byte order.", nm.c_str());
+	}
+
+	bool flag = (PyArray_NDIM(arr) == ndim);
+	for (int i=0; flag && (i < ndim); i++)
+		flag = (PyArray_DIM(arr, i) == dims[i]);
+	if (!flag)
+	{
+		string s;
+		for (int i=0; i < ndim; i++)
+		{
+			char buf[32];
+			FmtText(buf, sizeof(buf), (i > 0) ? ", %lld" : "%lld",
+				(long long)dims[i]);
+			s.append(buf);
+		}
+		throw ErrGDSFmt("The shape of 'out' should be (%s).", s.c_str());
+	}
+
+	if (!PyArray_ISCARRAY(arr))
+		throw ErrGDSFmt("'out' should be a writable C-contiguous numpy array.");
+}
+
+
+// determine the storage type of reading and the numpy type of a GDS object,
+// 'SV' is updated if it is svCustom (the default)
+COREARRAY_DLL_LOCAL int Py_Array_Type(PdAbstractArray Obj, C_SVType &SV,
+	bool &is_factor)
 {
 	static NPY_TYPES sv2npy[] = {
 		NPY_VOID,       // svCustom
@@ -187,43 +253,318 @@ COREARRAY_DLL_EXPORT PyObject* GDS_Py_Array_Read(PdAbstractArray Obj,
 		NPY_VOID        // svStrUTF16
 	};
 
-	try
+	NPY_TYPES npy_type = NPY_VOID;
+	is_factor = false;
+	if (SV==svCustom)
+	{
+		if (GDS_Is_RLogical(Obj))
+		{
+			SV = svInt8;
+			npy_type = NPY_BOOL;
+		} else if (GDS_Is_RFactor(Obj))
+		{
+			SV = svInt32;
+			npy_type = NPY_OBJECT;
+			is_factor = true;
+		} else {
+			SV = Obj->SVType();
+			if (SV == svCustomInt)
+				SV = svInt64;
+			else if (SV == svCustomUInt)
+				SV = svUInt64;
+			else if (SV == svCustomFloat)
+				SV = svFloat64;
+			else if (SV == svCustomStr)
+				SV = svStrUTF8;
+			if ((0 <= SV) && (SV < sizeof(sv2npy)/sizeof(NPY_TYPES)))
+				npy_type = sv2npy[SV];
+		}
+	} else {
+		if ((0 <= SV) && (SV < sizeof(sv2npy)/sizeof(NPY_TYPES)))
+			npy_type = sv2npy[SV];
+	}
+
+	if (npy_type == NPY_VOID)
+		throw ErrGDSFmt("Data type is not supported.");
+	return npy_type;
+}
+
+
+// return a Python list of factor levels
+COREARRAY_DLL_LOCAL PyObject* Py_Factor_Levels(PdAbstractArray Obj)
+{
+	int nlevels = 0;
+	CdAny &attr = Obj->Attribute()[UTF8Text("R.levels")];
+	if (attr.IsString())
+		nlevels = 1;
+	else if (attr.IsArray())
+		nlevels = attr.GetArrayLength();
+	PyObject *Levels = PyList_New(nlevels);
+	if (attr.IsString())
+	{
+		const UTF8String &s = attr.GetStr8();
+		PyObject *x = PYSTR_SET2(s.c_str(), s.size());
+		PyList_SetItem(Levels, 0, x);
+	} else if (attr.IsArray())
+	{
+		CdAny *p = attr.GetArray();
+		for (int i=0; i < nlevels; i++, p++)
+		{
+			const UTF8String &s = p->GetStr8();
+			PyObject *x = PYSTR_SET2(s.c_str(), s.size());
+			PyList_SetItem(Levels, i, x);
+		}
+	}
+	return Levels;
+}
+
+
+// replace the items of an object buffer by factor levels, 'codes' could
+// overlap the front of 'p' (the i-th pointer only overlaps the integers at
+// 2i and 2i+1 which have been matched)
+COREARRAY_DLL_LOCAL void Py_Factor_Fill(PyObject **p, const C_Int32 *codes,
+	size_t n, PyObject *Levels)
+{
+	const int nlevels = PyList_GET_SIZE(Levels);
+	for (size_t i=n; i > 0; )
+	{
+		int v = codes[--i];
+		PyObject *x;
+		if ((0 < v) && (v <= nlevels))
+			x = PyList_GET_ITEM(Levels, v-1);
+		else
+			x = Py_None;
+		Py_INCREF(x);
+		p[i] = x;
+	}
+}
+
+
+// replace the items of an object buffer by Python strings
+COREARRAY_DLL_LOCAL void Py_String_Fill(PyObject **p, const UTF8String *s,
+	size_t n)
+{
+	for (; n > 0; n--, p++, s++)
 	{
-		bool bool_flag = GDS_Is_RLogical(Obj);
-		bool bool_factor = false;
-		NPY_TYPES npy_type = NPY_VOID;
+		Py_XDECREF(*p);
+		*p = PYSTR_SET2(s->c_str(), s->size());
+	}
+}
+
+
+// the number of Unicode code points in a UTF-8 string
+static size_t utf8_len(const char *s, size_t n)
+{
+	size_t cnt = 0;
+	for (; n > 0; n--, s++)
+		if ((*s & 0xC0) != 0x80) cnt ++;
+	return cnt;
+}
+
+// decode a UTF-8 string to UCS4, invalid bytes are mapped to U+FFFD
+static void utf8_to_ucs4(const char *str, size_t n, C_UInt32 *out)
+{
+	const C_UInt8 *s = (const C_UInt8*)str, *e = s + n;
+	while (s < e)
+	{
+		C_UInt32 c = *s++;
+		int k = 0;
+		if (c >= 0xF0) { c &= 0x07; k = 3; }
+		else if (c >= 0xE0) { c &= 0x0F; k = 2; }
+		else if (c >= 0xC0) { c &= 0x1F; k = 1; }
+		else if (c >= 0x80) c = 0xFFFD;
+		for (; k > 0; k--)
+		{
+			if ((s >= e) || ((*s & 0xC0) != 0x80)) { c = 0xFFFD; break; }
+			c = (c << 6) | (*s++ & 0x3F);
+		}
+		*out++ = c;
+	}
+}
+
+// read strings block by block along the first dimension into a contiguous
+// byte arena, the i-th string is [Offset[i], Offset[i+1])
+static void read_str_arena(PdAbstractArray Obj, const C_Int32 *Start,
+	const C_Int32 *Length, const C_BOOL *const Selection[],
+	const C_Int32 *ValidCnt, vector<char> &Arena, vector<size_t> &Offset)
+{
+	static const size_t BLOCK_SIZE = 65536;
+	const int ndim = Obj->DimCnt();
+	size_t row = 1;
+	for (int i=1; i < ndim; i++) row *= ValidCnt[i];
+	const C_Int32 k = (row >= BLOCK_SIZE) ? 1 : (BLOCK_SIZE / row);
+
+	CdAbstractArray::TArrayDim St, Len;
+	memcpy(St, Start, sizeof(C_Int32)*ndim);
+	memcpy(Len, Length, sizeof(C_Int32)*ndim);
+	const C_BOOL *Sel[CdAbstractArray::MAX_ARRAY_DIM];
+	if (Selection)
+		memcpy(Sel, Selection, sizeof(C_BOOL*)*ndim);
+
+	vector<UTF8String> buf;
+	Offset.clear();
+	Offset.push_back(0);
+	Arena.clear();
+	for (C_Int32 r=0; (r < Length[0]) && (row > 0); r += k)
+	{
+		St[0] = Start[0] + r;
+		Len[0] = (Length[0] - r < k) ? (Length[0] - r) : k;
+		C_Int32 nrow = Len[0];
+		if (Selection)
+		{
+			Sel[0] = Selection[0] + r;
+			nrow = 0;
+			for (C_Int32 i=0; i < Len[0]; i++)
+				if (Sel[0][i]) nrow ++;
+		}
+		if (nrow <= 0) continue;
+		buf.resize(nrow * row);
+		if (!Selection)
+			Obj->ReadData(St, Len, &buf[0], svStrUTF8);
+		else
+			Obj->ReadDataEx(St, Len, Sel, &buf[0], svStrUTF8);
+		for (size_t i=0; i < buf.size(); i++)
+		{
+			Arena.insert(Arena.end(), buf[i].begin(), buf[i].end());
+			Offset.push_back(Arena.size());
+		}
+	}
+}
 
-		if (SV==svCustom)
+// return a fixed-width numpy 'S' or 'U' array of strings or factor levels,
+// 'Out' is used if it is not NULL (the caller should hold the file lock)
+static PyObject* Py_Array_ReadFixedStr(PdAbstractArray Obj,
+	const C_Int32 *Start, const C_Int32 *Length,
+	const C_BOOL *const Selection[], bool IsFactor, int Mode, PyObject *Out,
+	bool NoGIL)
+{
+	const bool is_bytes = (Mode == prmFixedBytes);
+	const int npy_type = is_bytes ? NPY_STRING : NPY_UNICODE;
+
+	CdAbstractArray::TArrayDim ValidCnt;
+	Obj->GetInfoSelection(Start, Length, Selection, NULL, NULL, ValidCnt);
+	const int ndim = Obj->DimCnt();
+	npy_intp dims[CdAbstractArray::MAX_ARRAY_DIM];
+	size_t n = 1;
+	for (int i=0; i < ndim; i++) { dims[i] = ValidCnt[i]; n *= ValidCnt[i]; }
+
+	// load all strings into a byte arena, or the factor codes
+	vector<char> arena;
+	vector<size_t> offset;
+	vector<C_Int32> codes;
+	vector<UTF8String> levels;
+	size_t width = 0;
+	{
+		CdPyNoGIL NoGILScope(NoGIL);
+		if (IsFactor)
 		{
-			if (bool_flag)
+			CdAny &attr = Obj->Attribute()[UTF8Text("R.levels")];
+			if (attr.IsString())
+				levels.push_back(attr.GetStr8());
+			else if (attr.IsArray())
 			{
-				SV = svInt8;
-				npy_type = NPY_BOOL;
-			} else if (GDS_Is_RFactor(Obj))
+				CdAny *p = attr.GetArray();
+				for (C_UInt32 i=0; i < attr.GetArrayLength(); i++, p++)
+					levels.push_back(p->GetStr8());
+			}
+			codes.resize(n);
+			if (n > 0)
 			{
-				SV = svInt32;
-				npy_type = NPY_OBJECT;
-				bool_factor = true;
-			} else {
-				SV = Obj->SVType();
-				if (SV == svCustomInt)
-					SV = svInt64;
-				else if (SV == svCustomUInt)
-					SV = svUInt64;
-				else if (SV == svCustomFloat)
-					SV = svFloat64;
-				else if (SV == svCustomStr)
-					SV = svStrUTF8;
-				if ((0 <= SV) && (SV < sizeof(sv2npy)/sizeof(NPY_TYPES)))
-					npy_type = sv2npy[SV];
+				if (!Selection)
+					Obj->ReadData(Start, Length, &codes[0], svInt32);
+				else
+					Obj->ReadDataEx(Start, Length, Selection, &codes[0], svInt32);
+			}
+			for (size_t i=0; i < levels.size(); i++)
+			{
+				size_t w = is_bytes ? levels[i].size() :
+					utf8_len(levels[i].data(), levels[i].size());
+				if (w > width) width = w;
 			}
 		} else {
-			if ((0 <= SV) && (SV < sizeof(sv2npy)/sizeof(NPY_TYPES)))
-				npy_type = sv2npy[SV];
+			read_str_arena(Obj, Start, Length, Selection, ValidCnt, arena,
+				offset);
+			for (size_t i=0; i+1 < offset.size(); i++)
+			{
+				size_t w = offset[i+1] - offset[i];
+				if (!is_bytes) w = utf8_len(&arena[offset[i]], w);
+				if (w > width) width = w;
+			}
 		}
+	}
 
-		if (npy_type == NPY_VOID)
-			throw ErrGDSFmt("Data type is not supported.");
+	// create a numpy array object, or use the output array
+	PyObject *rv_ans;
+	if (Out)
+	{
+		numpy_check_out(Out, ndim, dims, npy_type);
+		size_t w = PyArray_ITEMSIZE((PyArrayObject*)Out) / (is_bytes ? 1 : 4);
+		if (w < width)
+			throw ErrGDSFmt("The width of 'out' should be >= %d.", (int)width);
+		width = w;
+		rv_ans = Out;
+		Py_INCREF(rv_ans);
+	} else {
+		if (width <= 0) width = 1;
+		rv_ans = PyArray_New(&PyArray_Type, ndim, dims, npy_type, NULL, NULL,
+			width * (is_bytes ? 1 : 4), 0, NULL);
+		if (!rv_ans)
+			throw ErrGDSFmt("Fails to allocate the numpy array.");
+	}
+
+	// fill
+	{
+		CdPyNoGIL NoGILScope(NoGIL && !Out);
+		const size_t isize = width * (is_bytes ? 1 : 4);
+		char *p = (char*)PyArray_DATA((PyArrayObject*)rv_ans);
+		memset(p, 0, isize * n);
+		for (size_t i=0; i < n; i++, p += isize)
+		{
+			const char *s = NULL;
+			size_t len = 0;
+			if (IsFactor)
+			{
+				C_Int32 v = codes[i];
+				if ((0 < v) && (v <= (C_Int32)levels.size()))
+					{ s = levels[v-1].data(); len = levels[v-1].size(); }
+			} else {
+				s = &arena[0] + offset[i];
+				len = offset[i+1] - offset[i];
+			}
+			if (len <= 0) continue;
+			if (is_bytes)
+				memcpy(p, s, len);
+			else
+				utf8_to_ucs4(s, len, (C_UInt32*)p);
+		}
+	}
+
+	return rv_ans;
+}
+
+
+// return a Python/NumPy object from a GDS object, the data are decoded into
+// 'Out' if it is not NULL, and the GIL is released when decoding if 'NoGIL'
+// (the caller should hold the file lock); strings and factors are converted
+// according to 'Mode' (TPyReadMode)
+COREARRAY_DLL_LOCAL PyObject* Py_Array_Read(PdAbstractArray Obj,
+	const C_Int32 *Start, const C_Int32 *Length,
+	const C_BOOL *const Selection[], C_SVType SV, PyObject *Out, bool NoGIL,
+	int Mode)
+{
+	try
+	{
+		bool bool_factor;
+		int npy_type = Py_Array_Type(Obj, SV, bool_factor);
+
+		if (Mode == prmFactorCodes)
+		{
+			if (!bool_factor)
+				throw ErrGDSFmt("'codes' conversion requires a factor.");
+			PyObject *codes = Py_Array_Read(Obj, Start, Length, Selection,
+				svInt32, Out, NoGIL, prmDefault);
+			return Py_BuildValue("NN", codes, Py_Factor_Levels(Obj));
+		}
 
 		CdAbstractArray::TArrayDim St, Cnt;
 		if (Start == NULL)
@@ -237,6 +578,14 @@ COREARRAY_DLL_EXPORT PyObject* GDS_Py_Array_Read(PdAbstractArray Obj,
 			Length = Cnt;
 		}
 
+		if ((Mode == prmFixedBytes) || (Mode == prmFixedUnicode))
+		{
+			if (!bool_factor && (SV != svStrUTF8))
+				throw ErrGDSFmt("Fixed-width string reading requires strings or a factor.");
+			return Py_Array_ReadFixedStr(Obj, Start, Length, Selection,
+				bool_factor, Mode, Out, NoGIL);
+		}
+
 		CdAbstractArray::TArrayDim ValidCnt;
 		Obj->GetInfoSelection(Start, Length, Selection, NULL, NULL, ValidCnt);
 
@@ -244,79 +593,79 @@ COREARRAY_DLL_EXPORT PyObject* GDS_Py_Array_Read(PdAbstractArray Obj,
 		npy_intp dims[ndim];
 		for (int i=0; i < ndim; i++) dims[i] = ValidCnt[i];
 
-		// create a numpy array object
-		PyObject *rv_ans = PyArray_SimpleNew(ndim, dims, npy_type);
+		// create a numpy array object, or use the output array
+		PyObject *rv_ans;
+		if (Out)
+		{
+			numpy_check_out(Out, ndim, dims, npy_type);
+			rv_ans = Out;
+			Py_INCREF(rv_ans);
+		} else
+			rv_ans = PyArray_SimpleNew(ndim, dims, npy_type);
+		PyArrayObject *arr = (PyArrayObject*)rv_ans;
+		const size_t n = PyArray_SIZE(arr);
 
 		// read
 		if (bool_factor)
 		{
 			// it is an R factor
-			int nlevels = 0;
-			CdAny &attr = Obj->Attribute()[UTF8Text("R.levels")];
-			if (attr.IsString())
-				nlevels = 1;
-			else if (attr.IsArray())
-				nlevels = attr.GetArrayLength();
-			// save factor strings
-			PyObject *Levels = PyList_New(nlevels);
-			if (attr.IsString())
-			{
-				const UTF8String &s = attr.GetStr8();
-				PyObject *x = PYSTR_SET2(s.c_str(), s.size());
-				PyList_SetItem(Levels, 0, x);
-			} else if (attr.IsArray())
+			PyObject *Levels = Py_Factor_Levels(Obj);
+			// load integers into the front of the object buffer, then expand
+			// them backward in place
+			PyObject** p = (PyObject**)PyArray_DATA(arr);
+			if (Out)
 			{
-				CdAny *p = attr.GetArray();
-				for (int i=0; i < nlevels; i++, p++)
-				{
-					const UTF8String &s = p->GetStr8();
-					PyObject *x = PYSTR_SET2(s.c_str(), s.size());
-					PyList_SetItem(Levels, i, x);
-				}
+				for (size_t i=0; i < n; i++)
+					Py_CLEAR(p[i]);
 			}
-			// load integers
-			const size_t n = PyArray_SIZE((PyArrayObject*)rv_ans);
-			vector<C_Int32> intbuf(n);
-			if (!Selection)
-				Obj->ReadData(Start, Length, &intbuf[0], svInt32);
-			else
-				Obj->ReadDataEx(Start, Length, Selection, &intbuf[0], svInt32);
-			// match factor strings
-			PyObject** p = (PyObject**)PyArray_DATA((PyArrayObject*)rv_ans);
-			for (size_t i=0; i < n; i++)
-			{
-				int v = intbuf[i];
-				PyObject *x;
-				if ((0 < v) && (v <= nlevels))
-					x = PyList_GET_ITEM(Levels, v-1);
+			C_Int32 *codes = (C_Int32*)p;
+			try {
+				// the object buffer is visible to other threads if 'Out'
+				CdPyNoGIL NoGILScope(NoGIL && !Out);
+				if (!Selection)
+					Obj->ReadData(Start, Length, codes, svInt32);
 				else
-					x = Py_None;
-				Py_INCREF(x);
-				PyArray_SETITEM((PyArrayObject*)rv_ans, (char*)p++, x);
+					Obj->ReadDataEx(Start, Length, Selection, codes, svInt32);
 			}
+			catch (...) {
+				memset(p, 0, sizeof(PyObject*)*n);
+				Py_DECREF(Levels);
+				Py_DECREF(rv_ans);
+				throw;
+			}
+			// match factor strings
+			Py_Factor_Fill(p, codes, n, Levels);
 			Py_DECREF(Levels);
-			
+
 		} else if (COREARRAY_SV_NUMERIC(SV))
 		{
-			void *datptr = PyArray_DATA((PyArrayObject*)rv_ans);
-			if (!Selection)
-				Obj->ReadData(Start, Length, datptr, SV);
-			else
-				Obj->ReadDataEx(Start, Length, Selection, datptr, SV);
+			void *datptr = PyArray_DATA(arr);
+			try {
+				CdPyNoGIL NoGILScope(NoGIL);
+				if (!Selection)
+					Obj->ReadData(Start, Length, datptr, SV);
+				else
+					Obj->ReadDataEx(Start, Length, Selection, datptr, SV);
+			}
+			catch (...) {
+				Py_DECREF(rv_ans);
+				throw;
+			}
 		} else if (SV == svStrUTF8)
 		{
-			const size_t n = PyArray_SIZE((PyArrayObject*)rv_ans);
 			vector<UTF8String> strbuf(n);
-			if (!Selection)
-				Obj->ReadData(Start, Length, &strbuf[0], SV);
-			else
-				Obj->ReadDataEx(Start, Length, Selection, &strbuf[0], SV);
-			PyObject** p = (PyObject**)PyArray_DATA((PyArrayObject*)rv_ans);
-			for (size_t i=0; i < strbuf.size(); i++)
-			{
-				UTF8String &s = strbuf[i];
-				PyArray_SETITEM((PyArrayObject*)rv_ans, (char*)p++, PYSTR_SET2(&s[0], s.size()));
+			try {
+				CdPyNoGIL NoGILScope(NoGIL);
+				if (!Selection)
+					Obj->ReadData(Start, Length, &strbuf[0], SV);
+				else
+					Obj->ReadDataEx(Start, Length, Selection, &strbuf[0], SV);
 			}
+			catch (...) {
+				Py_DECREF(rv_ans);
+				throw;
+			}
+			Py_String_Fill((PyObject**)PyArray_DATA(arr), &strbuf[0], n);
 		}
 
 		return rv_ans;
@@ -333,6 +682,225 @@ COREARRAY_DLL_EXPORT PyObject* GDS_Py_Array_Read(PdAbstractArray Obj,
 	return NULL;  // never execute
 }
 
+// create a numpy array for the numeric data of a GDS object with the
+// dimension 'Length', return NULL if the data are strings or a factor;
+// 'SV' is updated, and 'Buffer' is the data buffer of the numpy array
+COREARRAY_DLL_LOCAL PyObject* Py_Array_NewNumeric(PdAbstractArray Obj,
+	const C_Int32 *Length, C_SVType &SV, void *&Buffer)
+{
+	bool is_factor;
+	int npy_type = Py_Array_Type(Obj, SV, is_factor);
+	if (is_factor || !COREARRAY_SV_NUMERIC(SV))
+		return NULL;
+
+	int ndim = Obj->DimCnt();
+	npy_intp dims[ndim];
+	for (int i=0; i < ndim; i++) dims[i] = Length[i];
+	PyObject *rv = PyArray_SimpleNew(ndim, dims, npy_type);
+	if (!rv) throw ErrGDSFmt("Fails to create a numpy array.");
+	Buffer = PyArray_DATA((PyArrayObject*)rv);
+	return rv;
+}
+
+// return a Python/NumPy object from a GDS object
+COREARRAY_DLL_EXPORT PyObject* GDS_Py_Array_Read(PdAbstractArray Obj,
+	const C_Int32 *Start, const C_Int32 *Length,
+	const C_BOOL *const Selection[], C_SVType SV)
+{
+	return Py_Array_Read(Obj, Start, Length, Selection, SV, NULL, false,
+		prmDefault);
+}
+
+}
+
+
+// ===========================================================================
+// The table of GDS node handles
+
+static const int OBJ_TABLE_SLOT_BITS = 24;
+static const int OBJ_TABLE_SLOT_MASK = (1 << OBJ_TABLE_SLOT_BITS) - 1;
+static const int OBJ_TABLE_GEN_MASK  = 0x7F;
+
+CdPyObjTable::CdPyObjTable()
+{
+	fFree = -1;
+	for (int i=0; i <= PKG_MAX_NUM_GDS_FILES; i++) fFileHead[i] = -1;
+}
+
+int CdPyObjTable::Add(PdGDSObj Obj, int FileIdx)
+{
+	if ((FileIdx < 0) || (FileIdx >= PKG_MAX_NUM_GDS_FILES))
+		FileIdx = PKG_MAX_NUM_GDS_FILES;
+
+	int slot;
+	std::unordered_map<PdGDSObj, int>::iterator it = fMap.find(Obj);
+	if (it != fMap.end())
+	{
+		slot = it->second;
+	} else {
+		if (fFree >= 0)
+		{
+			slot = fFree;
+			fFree = fSlot[slot].Next;
+			fSlot[slot].Gen = (fSlot[slot].Gen + 1) & OBJ_TABLE_GEN_MASK;
+		} else {
+			if ((int)fSlot.size() > OBJ_TABLE_SLOT_MASK)
+				throw ErrGDSFmt("Too many GDS nodes are in use.");
+			slot = fSlot.size();
+			fSlot.push_back(TSlot());
+			fSlot[slot].Gen = 0;
+		}
+		TSlot &s = fSlot[slot];
+		s.Obj = Obj; s.File = FileIdx;
+		// insert at the head of the file list
+		s.Prev = -1; s.Next = fFileHead[FileIdx];
+		if (s.Next >= 0) fSlot[s.Next].Prev = slot;
+		fFileHead[FileIdx] = slot;
+		fMap[Obj] = slot;
+	}
+
+	return slot | ((int)fSlot[slot].Gen << OBJ_TABLE_SLOT_BITS);
+}
+
+PdGDSObj CdPyObjTable::Get(int Handle) const
+{
+	if (Handle < 0) return NULL;
+	size_t slot = Handle & OBJ_TABLE_SLOT_MASK;
+	if (slot >= fSlot.size()) return NULL;
+	const TSlot &s = fSlot[slot];
+	if (s.Gen != (Handle >> OBJ_TABLE_SLOT_BITS)) return NULL;
+	return s.Obj;
+}
+
+bool CdPyObjTable::Remove(PdGDSObj Obj)
+{
+	std::unordered_map<PdGDSObj, int>::iterator it = fMap.find(Obj);
+	if (it == fMap.end()) return false;
+	int slot = it->second;
+	fMap.erase(it);
+	unlink(slot);
+	return true;
+}
+
+void CdPyObjTable::RemoveFile(int FileIdx)
+{
+	if ((FileIdx < 0) || (FileIdx >= PKG_MAX_NUM_GDS_FILES)) return;
+	int slot = fFileHead[FileIdx];
+	while (slot >= 0)
+	{
+		int next = fSlot[slot].Next;
+		fMap.erase(fSlot[slot].Obj);
+		unlink(slot);
+		slot = next;
+	}
+}
+
+void CdPyObjTable::GetFileObjs(int FileIdx, vector<PdGDSObj> &Out) const
+{
+	Out.clear();
+	if ((FileIdx < 0) || (FileIdx >= PKG_MAX_NUM_GDS_FILES)) return;
+	for (int slot=fFileHead[FileIdx]; slot >= 0; slot=fSlot[slot].Next)
+		Out.push_back(fSlot[slot].Obj);
+}
+
+void CdPyObjTable::Clear()
+{
+	fSlot.clear();
+	fMap.clear();
+	fFree = -1;
+	for (int i=0; i <= PKG_MAX_NUM_GDS_FILES; i++) fFileHead[i] = -1;
+}
+
+void CdPyObjTable::unlink(int slot)
+{
+	TSlot &s = fSlot[slot];
+	// remove from the file list
+	if (s.Prev >= 0)
+		fSlot[s.Prev].Next = s.Next;
+	else
+		fFileHead[s.File] = s.Next;
+	if (s.Next >= 0) fSlot[s.Next].Prev = s.Prev;
+	// push to the free list
+	s.Obj = NULL; s.File = -1; s.Prev = -1;
+	s.Next = fFree;
+	fFree = slot;
+}
+
+
+
+// ===========================================================================
+// Read an array margin by margin
+
+CdPyArrayRead::CdPyArrayRead()
+{
+	fBuffer = fLevels = NULL;
+}
+
+CdPyArrayRead::~CdPyArrayRead()
+{
+	Py_XDECREF(fBuffer);
+	Py_XDECREF(fLevels);
+}
+
+void CdPyArrayRead::Init(CdAbstractArray &vObj, int vMargin, C_SVType vSV)
+{
+	bool is_factor;
+	int npy_type = Py_Array_Type(&vObj, vSV, is_factor);
+	fReader.Init(vObj, vMargin, vSV, NULL, false);
+
+	// the dimension of a slice
+	CdAbstractArray::TArrayDim DimLen;
+	vObj.GetDim(DimLen);
+	int ndim = vObj.DimCnt();
+	npy_intp dims[CdAbstractArray::MAX_ARRAY_DIM];
+	for (int i=0, k=0; i < ndim; i++)
+		if (i != vMargin) dims[k++] = DimLen[i];
+
+	Py_CLEAR(fBuffer);
+	Py_CLEAR(fLevels);
+	fBuffer = PyArray_ZEROS(ndim-1, dims, npy_type, 0);
+	if (!fBuffer)
+		throw ErrGDSFmt("Fails to allocate the numpy buffer.");
+	if (is_factor)
+	{
+		fLevels = Py_Factor_Levels(&vObj);
+		fCodes.resize(fReader.MarginCount());
+	} else if (vSV == svStrUTF8)
+		fStrings.resize(fReader.MarginCount());
+}
+
+PyObject *CdPyArrayRead::Read()
+{
+	PyArrayObject *arr = (PyArrayObject*)fBuffer;
+	const size_t n = PyArray_SIZE(arr);
+	if (fLevels)
+	{
+		{
+			CdPyNoGIL NoGIL;
+			fReader.Read(&fCodes[0]);
+		}
+		PyObject** p = (PyObject**)PyArray_DATA(arr);
+		for (size_t i=0; i < n; i++)
+			Py_CLEAR(p[i]);
+		Py_Factor_Fill(p, &fCodes[0], n, fLevels);
+	} else if (fReader.SVType() == svStrUTF8)
+	{
+		{
+			CdPyNoGIL NoGIL;
+			fReader.Read(&fStrings[0]);
+		}
+		Py_String_Fill((PyObject**)PyArray_DATA(arr), &fStrings[0], n);
+	} else {
+		CdPyNoGIL NoGIL;
+		fReader.Read(PyArray_DATA(arr));
+	}
+	return fBuffer;
+}
+
+
+extern "C"
+{
+
 
 
 
@@ -426,28 +994,8 @@ COREARRAY_DLL_EXPORT void GDS_File_Close(PdGDSFile File)
 	{
 		PKG_GDS_Files[gds_idx] = NULL;
 
-		// delete GDS objects in PKG_GDSObj_List and PKG_GDSObj_Map
-		vector<PdGDSObj>::iterator p = PKG_GDSObj_List.begin();
-		for (; p != PKG_GDSObj_List.end(); p++)
-		{
-			if (*p != NULL)
-			{
-				// for a virtual folder
-				PdGDSObj Obj = *p;
-				PdGDSFolder Folder = Obj->Folder();
-				while (Folder != NULL)
-				{
-					Obj = Folder;
-					Folder = Obj->Folder();
-				}
-				// Obj is the root, and then get the GDS file
-				if (Obj->GDSFile() == File)
-				{
-					PKG_GDSObj_Map.erase(*p);
-					*p = NULL;
-				}
-			}
-		}
+		// delete the handles of GDS objects owned by the file
+		PKG_GDSObj_Table.RemoveFile(gds_idx);
 	}
 	if (File) delete File;
 }
@@ -475,20 +1023,21 @@ COREARRAY_DLL_EXPORT void GDS_Node_Delete(PdGDSObj Node, C_BOOL Force)
 {
 	if (Node != NULL)
 	{
-		vector<C_BOOL> DeleteArray;
+		// the registered child nodes, only the nodes of the same file
+		vector<PdGDSObj> Children;
 		if (dynamic_cast<CdGDSAbsFolder*>(Node))
 		{
-			DeleteArray.resize(PKG_GDSObj_List.size(), false);
-			size_t idx = 0;
-			vector<PdGDSObj>::iterator p = PKG_GDSObj_List.begin();
-			for (; p != PKG_GDSObj_List.end(); p++)
+			int gds_idx = GetFileIndex(GetRootFile(Node), false);
+			if (gds_idx >= 0)
 			{
-				if (*p != NULL)
+				vector<PdGDSObj> List;
+				PKG_GDSObj_Table.GetFileObjs(gds_idx, List);
+				vector<PdGDSObj>::iterator p = List.begin();
+				for (; p != List.end(); p++)
 				{
 					if (static_cast<CdGDSAbsFolder*>(Node)->HasChild(*p, true))
-						DeleteArray[idx] = true;
+						Children.push_back(*p);
 				}
-				idx ++;
 			}
 		}
 
@@ -497,27 +1046,11 @@ COREARRAY_DLL_EXPORT void GDS_Node_Delete(PdGDSObj Node, C_BOOL Force)
 		else
 			throw ErrGDSFmt("Can not delete the root.");
 
-		// delete GDS objects in PKG_GDSObj_List and PKG_GDSObj_Map
-		vector<PdGDSObj>::iterator p = PKG_GDSObj_List.begin();
-		for (; p != PKG_GDSObj_List.end(); p++)
-			if (*p == Node) *p = NULL;
-		PKG_GDSObj_Map.erase(Node);
-
-		if (!DeleteArray.empty())
-		{
-			size_t idx = 0;
-			vector<C_BOOL>::iterator p = DeleteArray.begin();
-			for (; p != DeleteArray.end(); p++)
-			{
-				if (*p)
-				{
-					PdGDSObj &Obj = PKG_GDSObj_List[idx];
-					PKG_GDSObj_Map.erase(Obj);
-					Obj = NULL;
-				}
-				idx ++;
-			}
-		}
+		// delete the handles of GDS objects
+		PKG_GDSObj_Table.Remove(Node);
+		vector<PdGDSObj>::iterator p = Children.begin();
+		for (; p != Children.end(); p++)
+			PKG_GDSObj_Table.Remove(*p);
 	}
 }
 
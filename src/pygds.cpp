@@ -24,17 +24,26 @@
 #include <string>
 #include <set>
 #include <map>
+#include <cmath>
+#include "LZ4/xxhash.h"
 
 
 #define PY_EXPORT    static
 
 
+// defined in PyCoreArray.cpp
+extern "C" PyObject* Py_Array_NewNumeric(CoreArray::PdAbstractArray Obj,
+	const C_Int32 *Length, C_SVType &SV, void *&Buffer);
+
+
 namespace pygds
 {
 	extern PdGDSFile PKG_GDS_Files[];
-	extern vector<PdGDSObj> PKG_GDSObj_List;
-	extern map<PdGDSObj, int> PKG_GDSObj_Map;
+	extern CdPyObjTable PKG_GDSObj_Table;
+	extern PdGDSFile GetRootFile(PdGDSObj Obj);
 	extern int GetFileIndex(PdGDSFile file, bool throw_error=true);
+	extern CdThreadMutex *GetObjFileLock(PdGDSObj Obj);
+	extern CdThreadMutex *GetFileLock(int file_id);
 
 
 	/// initialization and finalization
@@ -159,236 +168,1429 @@ namespace pygds
 	};
 	
 	static CInitNameObject Init;
-}
-
-
-using namespace std;
-using namespace CoreArray;
-using namespace pygds;
 
 
-extern "C"
-{
-
-// error messages
-static const char *ERR_NOT_FOLDER =
-	"The GDS node is not a folder!";
-static const char *ERR_READ_ONLY =
-	"Read-only and please call 'compression.gdsn(node, \"\")' before writing.";
-static const char *ERR_NO_DATA =
-	"There is no data field.";
-
+	/// the summary of numeric data
+	struct COREARRAY_DLL_LOCAL TSummary
+	{
+		double Min, Max, Sum;
+		C_Int64 NumValid;
 
-// ----------------------------------------------------------------------------
-// Internal functions
-// ----------------------------------------------------------------------------
+		TSummary() { Min = Max = NaN; Sum = 0; NumValid = 0; }
 
-/// file size to a string
-static string fmt_size(double b)
-{
-	static const double TB = 1024.0*1024*1024*1024;
-	static const double GB = 1024.0*1024*1024;
-	static const double MB = 1024.0*1024;
-	static const double KB = 1024.0;
+		void Merge(double mn, double mx, double sum, C_Int64 n)
+		{
+			if (n <= 0) return;
+			if (NumValid <= 0)
+				{ Min = mn; Max = mx; }
+			else {
+				if (mn < Min) Min = mn;
+				if (mx > Max) Max = mx;
+			}
+			Sum += sum; NumValid += n;
+		}
+	};
 
-	char s[256];
-	if (b >= TB)
-		FmtText(s, sizeof(s), "%.1fT", b/TB);
-	else if (b >= GB)
-		FmtText(s, sizeof(s), "%.1fG", b/GB);
-	else if (b >= MB)
-		FmtText(s, sizeof(s), "%.1fM", b/MB);
-	else if (b >= KB)
-		FmtText(s, sizeof(s), "%.1fK", b/KB);
-	else
-		FmtText(s, sizeof(s), "%gB", b);
+	/// the accumulator type for the sum of a block of integers
+	template<typename T> struct TSumType { typedef C_Int64 type; };
+	template<> struct TSumType<C_Int64> { typedef double type; };
+	template<> struct TSumType<C_UInt64> { typedef double type; };
+	template<> struct TSumType<C_Float32> { typedef double type; };
+	template<> struct TSumType<C_Float64> { typedef double type; };
 
-	return string(s);
-}
+	/// summarize a block of integers (branch-free, could be vectorized)
+	template<typename T>
+		static void summary_int(const T *p, size_t n, TSummary &s)
+	{
+		if (n <= 0) return;
+		T mn = p[0], mx = p[0];
+		typename TSumType<T>::type sum = 0;
+		for (size_t i=0; i < n; i++)
+		{
+			T v = p[i];
+			mn = (v < mn) ? v : mn;
+			mx = (v > mx) ? v : mx;
+			sum += v;
+		}
+		s.Merge(mn, mx, sum, n);
+	}
 
+	/// summarize a block of floating-point numbers, skipping non-finite values
+	template<typename T>
+		static void summary_float(const T *p, size_t n, TSummary &s)
+	{
+		double mn = +INFINITY, mx = -INFINITY, sum = 0;
+		size_t cnt = 0;
+		for (size_t i=0; i < n; i++)
+		{
+			T v = p[i];
+			if (std::isfinite(v))
+			{
+				mn = (v < mn) ? v : mn;
+				mx = (v > mx) ? v : mx;
+				sum += v; cnt ++;
+			}
+		}
+		s.Merge(mn, mx, sum, cnt);
+	}
 
-/// convert "(CdGDSObj*)  -->  PyObject*"
-static void set_obj(CdGDSObj *Obj, int &outidx, Py_ssize_t &outptr)
-{
-	static const char *ERR_OBJLIST = "Internal error in GDS node list.";
+	/// summarize a block of logical values
+	static void summary_logical(const C_Int8 *p, size_t n, TSummary &s)
+	{
+		size_t cnt = 0;
+		for (size_t i=0; i < n; i++) cnt += (p[i] != 0);
+		if (n > 0)
+			s.Merge((cnt < n) ? 0 : 1, (cnt > 0) ? 1 : 0, cnt, n);
+	}
 
-	if (!Obj)
-		throw ErrGDSFmt("Invalid GDS object [NULL].");
 
-	map<PdGDSObj, int>::iterator it = PKG_GDSObj_Map.find(Obj);
-	if (it != PKG_GDSObj_Map.end())
+	/// whether the compressed node is being written
+	static bool IsWriting(CdGDSObjPipe *P)
 	{
-		outidx = it->second;
-		if ((outidx < 0) || (outidx >= (int)PKG_GDSObj_List.size()))
-			throw ErrGDSFmt(ERR_OBJLIST);
-		if (PKG_GDSObj_List[outidx] != Obj)
-			throw ErrGDSFmt(ERR_OBJLIST);
-	} else {
-		vector<PdGDSObj>::iterator it =
-			find(PKG_GDSObj_List.begin(), PKG_GDSObj_List.end(),
-			(PdGDSObj)NULL);
-		if (it != PKG_GDSObj_List.end())
-		{
-			outidx = it - PKG_GDSObj_List.begin();
-			*it = Obj;
-		} else {
-			outidx = PKG_GDSObj_List.size();
-			PKG_GDSObj_List.push_back(Obj);
-		}
-		PKG_GDSObj_Map[Obj] = outidx;
+		CdBufStream *Buf = NULL;
+		if (dynamic_cast<CdAllocArray*>(P))
+			Buf = static_cast<CdAllocArray*>(P)->Allocator().BufStream();
+		else if (dynamic_cast<CdGDSStreamContainer*>(P))
+			Buf = static_cast<CdGDSStreamContainer*>(P)->BufStream();
+		return Buf && P->PipeInfo()->WriteMode(*Buf);
 	}
 
-	outptr = (Py_ssize_t)Obj;
-}
 
-static CdGDSObj* get_obj(int idx, Py_ssize_t ptr_int)
-{
-	static const char *ERR_GDS_OBJ  =
-		"Invalid GDS node object!";
-	static const char *ERR_GDS_OBJ2 =
-		"Invalid GDS node object (it was closed or deleted).";
+	/// streaming summary of an array node; the integers and real numbers
+	/// stored as is, uncompressed or compressed with random access, are
+	/// read in disjoint ranges by the threads, each with its own decoder;
+	/// otherwise, blocks are decoded one at a time (the array object is not
+	/// thread-safe), and reduced in parallel
+	class COREARRAY_DLL_LOCAL CdSummaryKernel: public Parallel::CParallelBase
+	{
+	public:
+		/// the number of elements in a block
+		static const ssize_t BLOCK_SIZE = 65536;
+		/// the number of elements in a range read by a thread
+		static const C_Int64 RANGE_SIZE = 16 * BLOCK_SIZE;
 
-	CdGDSObj *ptr = (CdGDSObj *)ptr_int;
-	// check
-	if ((idx < 0) || (idx >= (int)PKG_GDSObj_List.size()))
-		throw ErrGDSFmt(ERR_GDS_OBJ);
-	if (ptr == NULL)
-		throw ErrGDSFmt(ERR_GDS_OBJ);
-	if (PKG_GDSObj_List[idx] != ptr)
-		throw ErrGDSFmt(ERR_GDS_OBJ2);
+		TSummary Result;
 
-	return ptr;
-}
+		CdSummaryKernel(CdAbstractArray &Obj, C_SVType SV, bool Logical,
+			int nThread): CParallelBase(nThread), fIter(Obj.IterBegin())
+		{
+			fSV = SV; fLogical = Logical;
+			fRemain = fTotal = Obj.TotalCount();
+			fArray = (nThread > 1) ? RangeArray(Obj, SV) : NULL;
+			fNextRange = 0;
+		}
 
+		void Run()
+		{
+			if (fArray)
+			{
+				// the threads share the stream of GDS file
+				CdBlockCollection &C = fArray->PipeStream()->Collection();
+				CdThreadMutex *old = C.ReadLock();
+				if (!old) C.SetReadLock(&fReadLock);
+				try {
+					RunThreads(&CdSummaryKernel::ProcRange, this);
+				}
+				catch (...) {
+					C.SetReadLock(old);
+					throw;
+				}
+				C.SetReadLock(old);
+			} else
+				RunThreads(&CdSummaryKernel::Proc, this);
+			if (!fError.empty())
+				throw ErrGDSFmt(fError);
+		}
 
+	private:
+		CdIterator fIter;
+		C_SVType fSV;
+		bool fLogical;
+		C_Int64 fTotal, fRemain;
+		string fError;
+		CdAllocArray *fArray;  ///< read by ranges if not NULL
+		vector<C_Int64> fStart;  ///< the starting elements of the ranges
+		size_t fNextRange;
+		CdThreadMutex fReadLock;
+
+		/// a new reader of the data, independent of the array object
+		CdBufStream *NewReader(CdAllocArray &A)
+		{
+			CdBufStream *Buf = new CdBufStream(
+				new CdBlockStreamView(*A.PipeStream()));
+			Buf->AddRef();
+			if (A.PipeInfo())
+			{
+				try {
+					A.PipeInfo()->PushReadPipe(*Buf);
+				}
+				catch (...) {
+					Buf->Release();
+					throw;
+				}
+			}
+			return Buf;
+		}
 
-// ----------------------------------------------------------------------------
-// File Operations
-// ----------------------------------------------------------------------------
+		/// the array if its data can be read in disjoint ranges, or NULL;
+		/// the ranges start at the compressed blocks if any, so that no
+		/// block is decoded twice
+		CdAllocArray *RangeArray(CdAbstractArray &Obj, C_SVType SV)
+		{
+		#ifdef COREARRAY_ENDIAN_LITTLE
+			CdAllocArray *A = dynamic_cast<CdAllocArray*>(&Obj);
+			if (!A || !A->IsPrimitive() || (A->SVType() != SV) ||
+					!A->PipeStream())
+				return NULL;
+			int tr = A->TraitFlag();
+			if ((tr != COREARRAY_TR_INTEGER) && (tr != COREARRAY_TR_FLOAT))
+				return NULL;
+			const SIZE64 esize = A->ElmSize();
+			fStart.clear();
+			fStart.push_back(0);
+			if (A->PipeInfo())
+			{
+				if (IsWriting(A)) return NULL;
+				CdBufStream *Buf = NewReader(*A);
+				CdRA_Read *RA = dynamic_cast<CdRA_Read*>(
+					CdPipeMgrItem::CoderStream(*Buf));
+				vector<SIZE64> RawSize, CmpSize;
+				try {
+					if (RA) RA->GetBlockInfo(RawSize, CmpSize);
+				}
+				catch (...) {
+					Buf->Release();
+					throw;
+				}
+				Buf->Release();
+				if (!RA) return NULL;
+				SIZE64 pos = 0;
+				for (size_t i=0; i < RawSize.size(); i++)
+				{
+					pos += RawSize[i];
+					// the first element starting in the next block
+					C_Int64 st = (pos + esize - 1) / esize;
+					if ((st - fStart.back() >= RANGE_SIZE) && (st < fTotal))
+						fStart.push_back(st);
+				}
+			} else {
+				// the data written but not yet in the stream
+				A->Allocator().BufStream()->FlushWrite();
+				for (C_Int64 st=RANGE_SIZE; st < fTotal; st += RANGE_SIZE)
+					fStart.push_back(st);
+			}
+			fStart.push_back(fTotal);
+			return A;
+		#else
+			return NULL;
+		#endif
+		}
 
-/// Create a GDS file
-PY_EXPORT PyObject* gdsCreateGDS(PyObject *self, PyObject *args)
-{
-	const char *fn;
-	int allow_dup;
-	if (!PyArg_ParseTuple(args, "s" BSTR, &fn, &allow_dup))
-		return NULL;
+		void Reduce(void *buf, ssize_t cnt, TSummary &s)
+		{
+			switch (fSV)
+			{
+			case svInt8:
+				if (fLogical)
+					summary_logical((C_Int8*)buf, cnt, s);
+				else
+					summary_int((C_Int8*)buf, cnt, s);
+				break;
+			case svUInt8:   summary_int((C_UInt8*)buf, cnt, s); break;
+			case svInt16:   summary_int((C_Int16*)buf, cnt, s); break;
+			case svUInt16:  summary_int((C_UInt16*)buf, cnt, s); break;
+			case svInt32:   summary_int((C_Int32*)buf, cnt, s); break;
+			case svUInt32:  summary_int((C_UInt32*)buf, cnt, s); break;
+			case svInt64:   summary_int((C_Int64*)buf, cnt, s); break;
+			case svUInt64:  summary_int((C_UInt64*)buf, cnt, s); break;
+			case svFloat32: summary_float((C_Float32*)buf, cnt, s); break;
+			case svFloat64: summary_float((C_Float64*)buf, cnt, s); break;
+			default: break;
+			}
+		}
 
-	int file_id = -1;
-	COREARRAY_TRY
-		if (!allow_dup)
+		void Proc(CdThread *Thread, int Index)
 		{
-			UTF8String FName = UTF8Text(fn);
-			for (int i=0; i < PKG_MAX_NUM_GDS_FILES; i++)
+			vector<C_Float64> buffer(BLOCK_SIZE);
+			void *buf = &buffer[0];
+			TSummary s;
+			while (true)
 			{
-				if (PKG_GDS_Files[i])
+				ssize_t cnt;
 				{
-					if (PKG_GDS_Files[i]->FileName() == FName)
+					TdAutoMutex AutoMutex(&fMutex);
+					if (!fError.empty() || (fRemain <= 0)) break;
+					cnt = (fRemain >= BLOCK_SIZE) ? BLOCK_SIZE : fRemain;
+					try {
+						fIter.ReadData(buf, cnt, fSV);
+					}
+					catch (std::exception &E) {
+						fError = E.what(); break;
+					}
+					catch (...) {
+						fError = "unknown error!"; break;
+					}
+					fRemain -= cnt;
+				}
+				Reduce(buf, cnt, s);
+			}
+			TdAutoMutex AutoMutex(&fMutex);
+			Result.Merge(s.Min, s.Max, s.Sum, s.NumValid);
+		}
+
+		void ProcRange(CdThread *Thread, int Index)
+		{
+			vector<C_Float64> buffer(BLOCK_SIZE);
+			void *buf = &buffer[0];
+			const ssize_t esize = fArray->ElmSize();
+			TSummary s;
+			CdBufStream *Buf = NULL;
+			try {
+				{
+					TdAutoMutex AutoMutex(&fMutex);
+					Buf = NewReader(*fArray);
+				}
+				while (true)
+				{
+					size_t r;
 					{
-						throw ErrGDSFmt(
-							"The file '%s' has been created or opened.", fn);
+						TdAutoMutex AutoMutex(&fMutex);
+						if (!fError.empty() || (fNextRange+1 >= fStart.size()))
+							break;
+						r = fNextRange ++;
+					}
+					C_Int64 st = fStart[r];
+					C_Int64 n = fStart[r+1] - st;
+					Buf->SetPosition(st * esize);
+					while (n > 0)
+					{
+						ssize_t cnt = (n >= BLOCK_SIZE) ? BLOCK_SIZE : n;
+						Buf->ReadData(buf, cnt * esize);
+						Reduce(buf, cnt, s);
+						n -= cnt;
 					}
 				}
 			}
+			catch (std::exception &E) {
+				TdAutoMutex AutoMutex(&fMutex);
+				if (fError.empty()) fError = E.what();
+			}
+			catch (...) {
+				TdAutoMutex AutoMutex(&fMutex);
+				if (fError.empty()) fError = "unknown error!";
+			}
+			if (Buf) Buf->Release();
+			TdAutoMutex AutoMutex(&fMutex);
+			Result.Merge(s.Min, s.Max, s.Sum, s.NumValid);
 		}
+	};
 
-		CdGDSFile *file = GDS_File_Create(fn);
-		file_id = GetFileIndex(file);
-	COREARRAY_CATCH
 
-	return PyInt_FromLong(file_id);
-}
+	/// a request of read_many
+	struct TReadManyItem
+	{
+		CdAbstractArray *Obj;
+		CdAbstractArray::TArrayDim Start, Count;
+		int StartN, CountN;
+		bool Whole;              ///< read the whole array
+		bool Direct;             ///< numeric, decoded without the GIL
+		C_SVType SV;
+		CdThreadMutex *FileLock; ///< the lock of the owner GDS file
+		SIZE64 Offset;           ///< the file offset of the data
+		void *Buffer;            ///< the data buffer of the numpy array
+	};
+
+	/// decode the numeric requests of read_many, the requests of the same
+	/// file are read in the order of file offsets (the stream of a GDS file
+	/// is not thread-safe), and different files are read in parallel
+	class COREARRAY_DLL_LOCAL CdReadManyKernel: public Parallel::CParallelBase
+	{
+	public:
+		CdReadManyKernel(vector<TReadManyItem> &List, int nThread):
+			CParallelBase(1), fList(List)
+		{
+			// sort by file and offset
+			vector<size_t> Idx;
+			for (size_t i=0; i < List.size(); i++)
+				if (List[i].Direct) Idx.push_back(i);
+			sort(Idx.begin(), Idx.end(), TOrder(List));
+			// group by file
+			for (size_t i=0; i < Idx.size(); i++)
+			{
+				if ((i == 0) ||
+						(List[Idx[i]].FileLock != List[Idx[i-1]].FileLock))
+					fGroup.push_back(vector<size_t>());
+				fGroup.back().push_back(Idx[i]);
+			}
+			fNext = 0;
+			if (nThread > (int)fGroup.size()) nThread = fGroup.size();
+			SetNumThread((nThread > 1) ? nThread : 1);
+		}
 
+		void Run()
+		{
+			if (fGroup.empty()) return;
+			RunThreads(&CdReadManyKernel::Proc, this);
+			if (!fError.empty())
+				throw ErrGDSFmt(fError);
+		}
 
-/// Open an existing GDS file
-PY_EXPORT PyObject* gdsOpenGDS(PyObject *self, PyObject *args)
-{
-	const char *fn;
-	int readonly, allow_dup;
-	if (!PyArg_ParseTuple(args, "s" BSTR BSTR, &fn, &readonly, &allow_dup))
-		return NULL;
+	private:
+		struct TOrder
+		{
+			const vector<TReadManyItem> &List;
+			TOrder(const vector<TReadManyItem> &L): List(L) { }
+			bool operator()(size_t i, size_t j) const
+			{
+				const TReadManyItem &a = List[i], &b = List[j];
+				if (a.FileLock != b.FileLock) return a.FileLock < b.FileLock;
+				if (a.Offset != b.Offset) return a.Offset < b.Offset;
+				return i < j;
+			}
+		};
 
-	int file_id = -1;
-	COREARRAY_TRY
-		if (!allow_dup)
+		vector<TReadManyItem> &fList;
+		vector< vector<size_t> > fGroup;  ///< request indices of each file
+		size_t fNext;
+		string fError;
+
+		void Proc(CdThread *Thread, int Index)
 		{
-			UTF8String FName = UTF8Text(fn);
-			for (int i=0; i < PKG_MAX_NUM_GDS_FILES; i++)
+			while (true)
 			{
-				if (PKG_GDS_Files[i])
+				size_t g;
 				{
-					if (PKG_GDS_Files[i]->FileName() == FName)
+					TdAutoMutex AutoMutex(&fMutex);
+					if (!fError.empty() || (fNext >= fGroup.size())) break;
+					g = fNext ++;
+				}
+				try {
+					vector<size_t> &G = fGroup[g];
+					for (size_t k=0; k < G.size(); k++)
 					{
-						throw ErrGDSFmt(
-							"The file '%s' has been created or opened.", fn);
+						TReadManyItem &I = fList[G[k]];
+						I.Obj->ReadData(I.Whole ? NULL : I.Start,
+							I.Whole ? NULL : I.Count, I.Buffer, I.SV);
 					}
 				}
+				catch (std::exception &E) {
+					TdAutoMutex AutoMutex(&fMutex);
+					fError = E.what(); break;
+				}
+				catch (...) {
+					TdAutoMutex AutoMutex(&fMutex);
+					fError = "unknown error!"; break;
+				}
 			}
 		}
+	};
 
-		CdGDSFile *file = GDS_File_Open(fn, readonly, true);
-		file_id = GetFileIndex(file);
-	COREARRAY_CATCH
-
-	return PyInt_FromLong(file_id);
-}
-
-
-/// Close the GDS file
-PY_EXPORT PyObject* gdsCloseGDS(PyObject *self, PyObject *args)
-{
-	int file_id;
-	if (!PyArg_ParseTuple(args, "i", &file_id))
-		return NULL;
 
-	COREARRAY_TRY
-		if (file_id >= 0)
-			GDS_File_Close(GDS_ID2File(file_id));
-	COREARRAY_CATCH_NONE
-}
+	static const char *ERR_RECOMPRESS_MODE =
+		"Invalid compression method '%s'.";
 
+	static const char *ERR_VERIFY_SIZE =
+		"Invalid data length after decompression (%lld, expected %lld).";
 
-/// Synchronize the GDS file
-PY_EXPORT PyObject* gdsSyncGDS(PyObject *self, PyObject *args)
-{
-	int file_id;
-	if (!PyArg_ParseTuple(args, "i", &file_id))
-		return NULL;
+	/// a compressed node checked by verify
+	struct TVerifyNode
+	{
+		string Name;      ///< the full name of node
+		CdBufStream *Buf; ///< the reading pipes of the node data
+		CdRA_Read *RA;    ///< the decoder with random access, or NULL
+		SIZE64 RawSize;   ///< the uncompressed size, -1 if unknown
+	};
 
-	COREARRAY_TRY
-		GDS_ID2File(file_id)->SyncFile();
-	COREARRAY_CATCH_NONE
-}
+	/// an error found by verify
+	struct TVerifyError
+	{
+		string Name;      ///< the full name of node
+		C_Int32 Block;    ///< the block index, -1 if not applicable
+		string Message;
+	};
 
+	/// decode all blocks of the compressed nodes in a GDS file and compare
+	/// with the checksums if any; the compressed data are read node by node
+	/// under a lock, and the blocks are decoded in parallel; a stream
+	/// without random access is decoded entirely by one thread; the nodes
+	/// being written are skipped, since closing their writers would change
+	/// the file
+	class COREARRAY_DLL_LOCAL CdVerifyKernel: public Parallel::CParallelBase
+	{
+	public:
+		C_Int64 NumBlock;     ///< the number of blocks checked
+		C_Int64 NumChecksum;  ///< the number of blocks with checksums
+		C_Int64 NumSkip;      ///< the number of nodes being written
+		vector<TVerifyError> Error;
 
-/// Get the file size and check the file handler
-PY_EXPORT PyObject* gdsFileSize(PyObject *self, PyObject *args)
-{
-	int file_id;
-	if (!PyArg_ParseTuple(args, "i", &file_id))
-		return NULL;
+		CdVerifyKernel(CdGDSFile &File, int nThread):
+			CParallelBase((nThread > 1) ? nThread : 1)
+		{
+			NumBlock = NumChecksum = NumSkip = 0;
+			fNode = fBlock = 0;
+			AddFolder(File.Root());
+		}
 
-	double sz;
-	COREARRAY_TRY
-		sz = GDS_ID2File(file_id)->GetFileSize();
-	COREARRAY_CATCH
-	return Py_BuildValue("d", sz);
-}
+		~CdVerifyKernel()
+		{
+			for (size_t i=0; i < fList.size(); i++)
+				fList[i].Buf->Release();
+		}
 
+		COREARRAY_INLINE size_t NumNode() const { return fList.size(); }
 
-/// Clean up fragments of a GDS file
-PY_EXPORT PyObject* gdsTidyUp(PyObject *self, PyObject *args)
-{
-	const char *fn;
-	int verbose;
-	if (!PyArg_ParseTuple(args, "s" BSTR, &fn, &verbose))
-		return NULL;
+		void Run()
+		{
+			if (!fList.empty())
+				RunThreads(&CdVerifyKernel::Proc, this);
+		}
 
-	COREARRAY_TRY
+	private:
+		vector<TVerifyNode> fList;
+		size_t fNode;   ///< the next node
+		C_Int32 fBlock; ///< the next block of the node
 
-		CdGDSFile file(fn, CdGDSFile::dmOpenReadWrite);
-		C_Int64 old_s = file.GetFileSize();
-		if (verbose)
+		void AddError(const string &Name, C_Int32 Block, const char *Msg)
+		{
+			Error.push_back(TVerifyError());
+			Error.back().Name = Name;
+			Error.back().Block = Block;
+			Error.back().Message = Msg;
+		}
+
+		/// add the compressed nodes, except the nodes being written
+		void AddFolder(CdGDSAbsFolder &Dir)
+		{
+			for (int i=0; i < Dir.NodeCount(); i++)
+			{
+				CdGDSObj *Obj = Dir.ObjItemEx(i);
+				if (dynamic_cast<CdGDSFolder*>(Obj))
+				{
+					AddFolder(*static_cast<CdGDSFolder*>(Obj));
+					continue;
+				}
+				CdGDSObjPipe *P = dynamic_cast<CdGDSObjPipe*>(Obj);
+				if (!P || !P->PipeInfo() || !P->PipeStream()) continue;
+				if (IsWriting(P)) { NumSkip ++; continue; }
+				TVerifyNode N;
+				N.Name = RawText(Obj->FullName());
+				N.Buf = NULL;
+				try {
+					// the decoders independent of the node
+					CdBlockStream *S = P->PipeStream();
+					S->SetPosition(0);
+					N.Buf = new CdBufStream(S);
+					N.Buf->AddRef();
+					P->PipeInfo()->PushReadPipe(*N.Buf);
+					N.RA = dynamic_cast<CdRA_Read*>(
+						CdPipeMgrItem::CoderStream(*N.Buf));
+					if (N.RA) N.RA->GetUpdated();
+					N.RawSize = P->PipeInfo()->StreamTotalIn();
+					fList.push_back(N);
+				}
+				catch (std::exception &E) {
+					if (N.Buf) N.Buf->Release();
+					AddError(N.Name, -1, E.what());
+				}
+			}
+		}
+
+		void Proc(CdThread *Thread, int Index)
+		{
+			vector<C_UInt8> Cmp, Raw;
+			while (true)
+			{
+				TVerifyNode *N;
+				C_Int32 b;
+				{
+					TdAutoMutex AutoMutex(&fMutex);
+					// the next block, the data are read under the lock
+					while (fNode < fList.size())
+					{
+						N = &fList[fNode];
+						if (N->RA ? (fBlock < N->RA->BlockNum()) : (fBlock == 0))
+							break;
+						fNode ++; fBlock = 0;
+					}
+					if (fNode >= fList.size()) break;
+					b = N->RA ? fBlock : -1;
+					fBlock ++;
+					NumBlock ++;
+					try {
+						if (N->RA)
+						{
+							N->RA->LoadBlock(b, Cmp);
+						} else {
+							// decoded entirely, the errors are detected
+							// by the decoder
+							CdStream *S = CdPipeMgrItem::CoderStream(*N->Buf);
+							Raw.resize(COREARRAY_STREAM_BUFFER);
+							SIZE64 n = 0;
+							ssize_t L;
+							while ((L = S->Read(Raw.data(), Raw.size())) > 0)
+								n += L;
+							if ((N->RawSize >= 0) && (n != N->RawSize))
+								throw ErrGDSFmt(ERR_VERIFY_SIZE, (long long)n,
+									(long long)N->RawSize);
+							continue;
+						}
+					}
+					catch (std::exception &E) {
+						AddError(N->Name, b, E.what());
+						continue;
+					}
+				}
+				try {
+					N->RA->VerifyBlock(b, Cmp, Raw);
+					TdAutoMutex AutoMutex(&fMutex);
+					if (N->RA->HasChecksum()) NumChecksum ++;
+				}
+				catch (std::exception &E) {
+					TdAutoMutex AutoMutex(&fMutex);
+					AddError(N->Name, b, E.what());
+				}
+			}
+		}
+	};
+
+
+	/// a node copied by recompress
+	struct TRecompressNode
+	{
+		CdGDSObj *Src;        ///< the source node
+		CdGDSObj *Dst;        ///< the new node
+		CdPipeMgrItem *Pipe;  ///< the new pipe if encoded by the worker threads
+		CdStream *Data;       ///< the encoded data, or NULL
+		bool Encode;          ///< true if encoded by the worker threads
+		bool Done;            ///< true if encoded
+		string Error;         ///< the error message when encoding
+	};
+
+	/// copy all nodes of a GDS file to a new file and recompress the selected
+	/// ones; the numeric arrays are encoded into temporary streams by the
+	/// worker threads, and the main thread is the only writer of the new file,
+	/// which copies the other nodes and the encoded data in the order of
+	/// nodes; the compressed nodes being written are skipped, since closing
+	/// their writers would change the source file
+	class COREARRAY_DLL_LOCAL CdRecompressKernel: public Parallel::CParallelBase
+	{
+	public:
+		C_Int64 NumNode;      ///< the number of nodes recompressed
+		vector<string> Skipped;  ///< the nodes being written
+
+		CdRecompressKernel(CdGDSFile &Src, CdGDSFile &Dst, const char *Mode,
+			const set<string> *Filter, int nThread):
+			CParallelBase((nThread > 1) ? (nThread+1) : 2)
+		{
+			fMode = Mode; fFilter = Filter;
+			NumNode = 0;
+			fNext = fPending = 0;
+			fAbort = false;
+			fSrcFile = &Src;
+			AddFolder(Src.Root(), Dst.Root());
+			// the source nodes are read by several threads
+			Src.SetReadLock(&fReadLock);
+		}
+
+		~CdRecompressKernel()
+		{
+			fSrcFile->SetReadLock(NULL);
+			for (size_t i=0; i < fList.size(); i++)
+			{
+				if (fList[i].Pipe) delete fList[i].Pipe;
+				if (fList[i].Data) fList[i].Data->Release();
+			}
+		}
+
+		void Run()
+		{
+			RunThreads(&CdRecompressKernel::Proc, this);
+			if (!fError.empty())
+				throw ErrGDSFmt(fError);
+		}
+
+	private:
+		vector<TRecompressNode> fList;
+		vector<size_t> fJob;  ///< the indices of nodes encoded by workers
+		size_t fNext;         ///< the next job
+		size_t fPending;      ///< the number of jobs encoding or not written
+		bool fAbort;
+		string fError;
+		string fMode;
+		const set<string> *fFilter;
+		CdGDSFile *fSrcFile;
+		CdThreadMutex fReadLock;
+		CdThreadCondition fCond;
+
+		/// create the new nodes without data, except folders
+		void AddFolder(CdGDSFolder &Src, CdGDSFolder &Dst)
+		{
+			for (int i=0; i < Src.NodeCount(); i++)
+			{
+				CdGDSObj *Obj = Src.ObjItem(i);
+				if (dynamic_cast<CdGDSFolder*>(Obj))
+				{
+					CdGDSFolder *D = static_cast<CdGDSFolder*>(
+						Dst.AddFolder(Obj->Name()));
+					D->Attribute().Assign(Obj->Attribute());
+					AddFolder(*static_cast<CdGDSFolder*>(Obj), *D);
+					continue;
+				}
+
+				CdGDSObjPipe *P = dynamic_cast<CdGDSObjPipe*>(Obj);
+				if (P && P->PipeInfo() && IsWriting(P))
+				{
+					Skipped.push_back(RawText(Obj->FullName()));
+					continue;
+				}
+				TRecompressNode N;
+				N.Src = Obj; N.Dst = NULL;
+				N.Pipe = NULL; N.Data = NULL;
+				N.Encode = N.Done = false;
+				bool sel = P && (!fFilter ||
+					fFilter->count(RawText(Obj->FullName())));
+				if (sel)
+				{
+					NumNode ++;
+					// the data of integers and real numbers are stored as is
+					CdAllocArray *A = dynamic_cast<CdAllocArray*>(Obj);
+					if (A)
+					{
+						// the buffered data are read by the worker threads
+						if (A->Allocator().BufStream())
+							A->Allocator().BufStream()->FlushWrite();
+						int tr = A->TraitFlag();
+						N.Encode = A->IsPrimitive() &&
+							((tr == COREARRAY_TR_INTEGER) ||
+							(tr == COREARRAY_TR_BIT_INTEGER) ||
+							(tr == COREARRAY_TR_FLOAT));
+					}
+				}
+
+				N.Dst = Obj->NewObject();
+				// the pipe of source is not used to create the new node
+				if (sel)
+					static_cast<CdGDSObjPipe*>(N.Dst)->SetPackedMode("");
+				Dst.AddObj(Obj->Name(), N.Dst);
+				if (N.Encode)
+				{
+					N.Pipe = dStreamPipeMgr.Match(
+						*static_cast<CdGDSObjPipe*>(N.Dst), fMode.c_str());
+					if (!N.Pipe && !fMode.empty())
+						throw ErrGDSFmt(ERR_RECOMPRESS_MODE, fMode.c_str());
+					fJob.push_back(fList.size());
+				} else if (sel)
+				{
+					static_cast<CdGDSObjPipe*>(N.Dst)->SetPackedMode(
+						fMode.c_str());
+				}
+				fList.push_back(N);
+			}
+		}
+
+		void Proc(CdThread *Thread, int Index)
+		{
+			if (Index == 0)
+				Write();
+			else
+				Encode();
+		}
+
+		/// write the new nodes in order (the main thread)
+		void Write()
+		{
+			try {
+				for (size_t i=0; i < fList.size(); i++)
+				{
+					TRecompressNode &N = fList[i];
+					if (N.Encode)
+					{
+						{
+							TdAutoMutex AutoMutex(&fMutex);
+							while (!N.Done)
+								fCond.Wait(fMutex);
+						}
+						if (!N.Error.empty())
+							throw ErrGDSFmt(N.Error);
+						CdPipeMgrItem *Pipe = N.Pipe;
+						N.Pipe = NULL;
+						static_cast<CdAllocArray*>(N.Dst)->AssignEncoded(
+							*static_cast<CdAllocArray*>(N.Src), Pipe, *N.Data);
+						N.Data->Release();
+						N.Data = NULL;
+						TdAutoMutex AutoMutex(&fMutex);
+						fPending --;
+						fCond.Broadcast();
+					} else {
+						N.Dst->Assign(*N.Src, true);
+					}
+				}
+			}
+			catch (std::exception &E) {
+				TdAutoMutex AutoMutex(&fMutex);
+				fError = E.what();
+				fAbort = true;
+				fCond.Broadcast();
+			}
+		}
+
+		/// encode the jobs in order (the worker threads)
+		void Encode()
+		{
+			// the number of encoded data waiting for writing is limited
+			const size_t MaxPending = 2 * (nThread() - 1);
+			while (true)
+			{
+				TRecompressNode *N;
+				{
+					TdAutoMutex AutoMutex(&fMutex);
+					while (!fAbort && (fNext < fJob.size()) &&
+							(fPending >= MaxPending))
+						fCond.Wait(fMutex);
+					if (fAbort || (fNext >= fJob.size())) break;
+					N = &fList[fJob[fNext++]];
+					fPending ++;
+				}
+				CdStream *Data = NULL;
+				string Err;
+				try {
+					Data = static_cast<CdAllocArray*>(N->Src)->EncodeData(N->Pipe);
+				}
+				catch (std::exception &E) {
+					Err = E.what();
+				}
+				TdAutoMutex AutoMutex(&fMutex);
+				N->Data = Data;
+				N->Error = Err;
+				N->Done = true;
+				fCond.Broadcast();
+			}
+		}
+	};
+
+
+	/// decode the chunks along a dimension of an array node on a background
+	/// thread into a ring of numpy buffers; a buffer is reused once the chunk
+	/// after it has been returned
+	class COREARRAY_DLL_LOCAL CdChunkPrefetch
+	{
+	public:
+		CdChunkPrefetch()
+		{
+			fObj = NULL; fFileLock = NULL; fThread = NULL;
+			fNumChunk = fDecoded = fConsumed = 0;
+			fLastBuffer = NULL; fLastPtr = NULL;
+			fValid = true; fStop = false; fDone = true;
+		}
+
+		/// the thread should be stopped before, see Stop() (the GIL is held)
+		~CdChunkPrefetch()
+		{
+			if (fThread)
+			{
+				Stop();
+				CdPyNoGIL NoGIL;
+				try { delete fThread; } catch (...) { }
+			}
+			for (size_t i=0; i < fBuffer.size(); i++)
+				Py_XDECREF(fBuffer[i]);
+			Py_XDECREF(fLastBuffer);
+		}
+
+		/// initialize and start the thread, return false if the data are not
+		/// numeric (the GIL and the file lock are held)
+		bool Init(CdAbstractArray &Obj, CdThreadMutex *FileLock, int Axis,
+			int Size, int Prefetch, C_SVType SV)
+		{
+			fObj = &Obj; fFileLock = FileLock;
+			Obj.GetDim(fDim);
+			const int ndim = Obj.DimCnt();
+			const C_Int32 n = fDim[Axis];
+			fSize = Size;
+			fNumChunk = (n + Size - 1) / Size;
+			fOuter = fInner = 1;
+			for (int i=0; i < Axis; i++) fOuter *= fDim[i];
+			for (int i=Axis+1; i < ndim; i++) fInner *= fDim[i];
+
+			// the ring buffers
+			CdAbstractArray::TArrayDim d;
+			memcpy(d, fDim, sizeof(d));
+			d[Axis] = Size;
+			const C_Int64 nslot = (Prefetch+1 < fNumChunk) ? Prefetch+1 : fNumChunk;
+			for (C_Int64 i=0; i < nslot; i++)
+			{
+				void *ptr;
+				PyObject *buf = Py_Array_NewNumeric(&Obj, d, SV, ptr);
+				if (!buf) return false;
+				fBuffer.push_back(buf);
+				fBufPtr.push_back(ptr);
+			}
+			// the last chunk if it is shorter
+			if ((fNumChunk > 0) && (n % Size != 0))
+			{
+				d[Axis] = n % Size;
+				fLastBuffer = Py_Array_NewNumeric(&Obj, d, SV, fLastPtr);
+			}
+
+			if (fNumChunk > 0)
+			{
+				fReader.Init(Obj, Axis, SV, NULL, true);
+				if (fOuter > 1) fSlice.resize(fReader.MarginSize());
+				fDone = false;
+				fThread = new CdThread;
+				fThread->BeginThread(thread_proc, this);
+			}
+			return true;
+		}
+
+		/// return the next chunk (a new reference), or NULL if all chunks
+		/// have been returned (the GIL is held and released when waiting)
+		PyObject *Next()
+		{
+			C_Int64 c;
+			string err;
+			{
+				CdPyNoGIL NoGIL;
+				TdAutoMutex AutoMutex(&fMutex);
+				while (fValid && fError.empty() && (fConsumed < fNumChunk) &&
+						(fDecoded <= fConsumed))
+					fCond.Wait(fMutex);
+				err = fValid ? fError :
+					string("The GDS node was closed, deleted or unloaded.");
+				c = fConsumed;
+				if (err.empty() && (c < fNumChunk))
+				{
+					fConsumed ++;
+					fCond.Broadcast();
+				}
+			}
+			if (!err.empty())
+				throw ErrGDSFmt(err);
+			if (c >= fNumChunk) return NULL;
+			PyObject *rv = chunk_buffer(c);
+			Py_INCREF(rv);
+			return rv;
+		}
+
+		/// stop decoding since the node is closed, deleted or unloaded (the
+		/// file lock is held)
+		void Cancel()
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			fValid = false;
+			fCond.Broadcast();
+		}
+
+		/// ask the thread to stop, and return whether it has exited; the
+		/// thread waiting for the file lock exits after getting the lock,
+		/// so it can not be joined if the file lock might be held
+		bool Stop()
+		{
+			TdAutoMutex AutoMutex(&fMutex);
+			fStop = true;
+			fCond.Broadcast();
+			return fDone;
+		}
+
+		COREARRAY_INLINE CdAbstractArray *Object() { return fObj; }
+		COREARRAY_INLINE CdThreadMutex *FileLock() { return fFileLock; }
+
+	private:
+		CdAbstractArray *fObj;
+		CdThreadMutex *fFileLock;
+		CdArrayRead fReader;
+		CdAbstractArray::TArrayDim fDim;
+		C_Int32 fSize;
+		C_Int64 fNumChunk, fOuter, fInner;
+		vector<PyObject*> fBuffer;  ///< the ring buffers
+		vector<void*> fBufPtr;
+		PyObject *fLastBuffer;      ///< the buffer of the last shorter chunk
+		void *fLastPtr;
+		vector<C_UInt8> fSlice;     ///< a slice if it is not contiguous
+		CdThread *fThread;
+
+		CdThreadMutex fMutex;       ///< guarding the variables below
+		CdThreadCondition fCond;
+		C_Int64 fDecoded;           ///< the number of chunks decoded
+		C_Int64 fConsumed;          ///< the number of chunks returned
+		bool fValid, fStop;
+		bool fDone;                 ///< the thread has exited or not started
+		string fError;
+
+		PyObject *chunk_buffer(C_Int64 c)
+		{
+			return ((c == fNumChunk-1) && fLastBuffer) ? fLastBuffer :
+				fBuffer[c % fBuffer.size()];
+		}
+
+		static int thread_proc(CdThread *Thread, CdChunkPrefetch *p)
+		{
+			p->Proc();
+			TdAutoMutex AutoMutex(&p->fMutex);
+			p->fDone = true;
+			return 0;
+		}
+
+		void Proc()
+		{
+			const C_Int64 nslot = fBuffer.size();
+			for (C_Int64 c=0; c < fNumChunk; c++)
+			{
+				// wait for a free buffer (the last returned chunk is in use)
+				{
+					TdAutoMutex AutoMutex(&fMutex);
+					while (!fStop &&
+							(c >= nslot + (fConsumed > 0 ? fConsumed-1 : 0)))
+						fCond.Wait(fMutex);
+					if (fStop) return;
+				}
+				C_UInt8 *dst = (C_UInt8*)(((c == fNumChunk-1) && fLastBuffer) ?
+					fLastPtr : fBufPtr[c % nslot]);
+				C_Int32 len = fDim[fReader.Margin()] - c*fSize;
+				if (len > fSize) len = fSize;
+				TdAutoMutex FileLock(fFileLock);
+				try {
+					{
+						TdAutoMutex AutoMutex(&fMutex);
+						if (fStop) return;
+						if (!fValid)
+							throw ErrGDSFmt("The GDS node was closed, deleted or unloaded.");
+					}
+					check_dim();
+					const ssize_t elm = fReader.ElmSize();
+					const size_t inner = fInner * elm;
+					for (C_Int32 j=0; j < len; j++)
+					{
+						if (fOuter <= 1)
+						{
+							fReader.Read(dst + j*inner);
+						} else {
+							fReader.Read(&fSlice[0]);
+							const C_UInt8 *s = &fSlice[0];
+							for (C_Int64 o=0; o < fOuter; o++, s+=inner)
+								memcpy(dst + (o*len + j)*inner, s, inner);
+						}
+					}
+				}
+				catch (std::exception &E) {
+					TdAutoMutex AutoMutex(&fMutex);
+					fError = E.what(); fCond.Broadcast();
+					return;
+				}
+				catch (...) {
+					TdAutoMutex AutoMutex(&fMutex);
+					fError = "unknown error!"; fCond.Broadcast();
+					return;
+				}
+				FileLock.Reset(NULL);
+				TdAutoMutex AutoMutex(&fMutex);
+				fDecoded = c + 1;
+				fCond.Broadcast();
+			}
+		}
+
+		void check_dim()
+		{
+			CdAbstractArray::TArrayDim d;
+			fObj->GetDim(d);
+			for (int i=0; i < fObj->DimCnt(); i++)
+				if (d[i] != fDim[i])
+					throw ErrGDSFmt("The GDS node was modified while iterating.");
+		}
+	};
+}
+
+
+using namespace std;
+using namespace CoreArray;
+using namespace pygds;
+
+
+extern "C"
+{
+
+// error messages
+static const char *ERR_NOT_FOLDER =
+	"The GDS node is not a folder!";
+static const char *ERR_READ_ONLY =
+	"Read-only and please call 'compression.gdsn(node, \"\")' before writing.";
+static const char *ERR_NO_DATA =
+	"There is no data field.";
+
+
+// ----------------------------------------------------------------------------
+// Internal functions
+// ----------------------------------------------------------------------------
+
+/// file size to a string
+static string fmt_size(double b)
+{
+	static const double TB = 1024.0*1024*1024*1024;
+	static const double GB = 1024.0*1024*1024;
+	static const double MB = 1024.0*1024;
+	static const double KB = 1024.0;
+
+	char s[256];
+	if (b >= TB)
+		FmtText(s, sizeof(s), "%.1fT", b/TB);
+	else if (b >= GB)
+		FmtText(s, sizeof(s), "%.1fG", b/GB);
+	else if (b >= MB)
+		FmtText(s, sizeof(s), "%.1fM", b/MB);
+	else if (b >= KB)
+		FmtText(s, sizeof(s), "%.1fK", b/KB);
+	else
+		FmtText(s, sizeof(s), "%gB", b);
+
+	return string(s);
+}
+
+
+/// convert "(CdGDSObj*)  -->  PyObject*"
+static void set_obj(CdGDSObj *Obj, int &outidx, Py_ssize_t &outptr)
+{
+	if (!Obj)
+		throw ErrGDSFmt("Invalid GDS object [NULL].");
+	outidx = PKG_GDSObj_Table.Add(Obj, GetFileIndex(GetRootFile(Obj), false));
+	outptr = (Py_ssize_t)Obj;
+}
+
+static CdGDSObj* get_obj(int idx, Py_ssize_t ptr_int)
+{
+	static const char *ERR_GDS_OBJ  =
+		"Invalid GDS node object!";
+	static const char *ERR_GDS_OBJ2 =
+		"Invalid GDS node object (it was closed or deleted).";
+
+	CdGDSObj *ptr = (CdGDSObj *)ptr_int;
+	// check
+	if ((idx < 0) || (ptr == NULL))
+		throw ErrGDSFmt(ERR_GDS_OBJ);
+	if (PKG_GDSObj_Table.Get(idx) != ptr)
+		throw ErrGDSFmt(ERR_GDS_OBJ2);
+
+	return ptr;
+}
+
+/// get a GDS node, and lock the GDS file it belongs to
+static CdGDSObj* get_obj_lock(int idx, Py_ssize_t ptr_int, CdPyFileLock &Lock)
+{
+	Lock.Lock(GetObjFileLock(get_obj(idx, ptr_int)));
+	// the node might be closed or deleted when waiting for the lock
+	return get_obj(idx, ptr_int);
+}
+
+/// get two GDS nodes, and lock the GDS file(s) they belong to
+static void get_obj2_lock(int idx1, Py_ssize_t ptr1, int idx2, Py_ssize_t ptr2,
+	CdGDSObj *&Obj1, CdGDSObj *&Obj2, CdPyFileLock &Lock)
+{
+	Lock.Lock(GetObjFileLock(get_obj(idx1, ptr1)),
+		GetObjFileLock(get_obj(idx2, ptr2)));
+	Obj1 = get_obj(idx1, ptr1);
+	Obj2 = get_obj(idx2, ptr2);
+}
+
+
+/// the chunk iterators in use (accessed with the GIL held)
+static set<CdChunkPrefetch*> chunk_iter_list;
+/// the freed chunk iterators whose threads have not exited yet (accessed
+/// with the GIL held)
+static vector<CdChunkPrefetch*> chunk_orphan_list;
+
+/// cancel the chunk iterators on 'Node' and its children, or all iterators
+/// of a file if 'Node' is NULL (the file lock is held)
+static void chunk_iter_cancel(CdThreadMutex *FileLock, CdGDSObj *Node)
+{
+	set<CdChunkPrefetch*>::iterator it;
+	for (it=chunk_iter_list.begin(); it != chunk_iter_list.end(); it++)
+	{
+		CdChunkPrefetch *p = *it;
+		if (p->FileLock() != FileLock) continue;
+		CdGDSObj *obj = p->Object();
+		if (!Node || (obj == Node) || (dynamic_cast<CdGDSAbsFolder*>(Node) &&
+				static_cast<CdGDSAbsFolder*>(Node)->HasChild(obj, true)))
+			p->Cancel();
+	}
+}
+
+/// delete a GDS node, and cancel the chunk iterators on it (the file lock
+/// is held)
+static void node_delete(CdGDSObj *Obj, C_BOOL Force)
+{
+	if (!chunk_iter_list.empty())
+		chunk_iter_cancel(GetObjFileLock(Obj), Obj);
+	GDS_Node_Delete(Obj, Force);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// File Operations
+// ----------------------------------------------------------------------------
+
+/// Create a GDS file
+PY_EXPORT PyObject* gdsCreateGDS(PyObject *self, PyObject *args)
+{
+	const char *fn;
+	int allow_dup;
+	if (!PyArg_ParseTuple(args, "s" BSTR, &fn, &allow_dup))
+		return NULL;
+
+	int file_id = -1;
+	COREARRAY_TRY
+		if (!allow_dup)
+		{
+			UTF8String FName = UTF8Text(fn);
+			for (int i=0; i < PKG_MAX_NUM_GDS_FILES; i++)
+			{
+				if (PKG_GDS_Files[i])
+				{
+					if (PKG_GDS_Files[i]->FileName() == FName)
+					{
+						throw ErrGDSFmt(
+							"The file '%s' has been created or opened.", fn);
+					}
+				}
+			}
+		}
+
+		CdGDSFile *file = GDS_File_Create(fn);
+		file_id = GetFileIndex(file);
+	COREARRAY_CATCH
+
+	return PyInt_FromLong(file_id);
+}
+
+
+/// Open an existing GDS file
+PY_EXPORT PyObject* gdsOpenGDS(PyObject *self, PyObject *args)
+{
+	const char *fn;
+	int readonly, allow_dup;
+	if (!PyArg_ParseTuple(args, "s" BSTR BSTR, &fn, &readonly, &allow_dup))
+		return NULL;
+
+	int file_id = -1;
+	COREARRAY_TRY
+		if (!allow_dup)
+		{
+			UTF8String FName = UTF8Text(fn);
+			for (int i=0; i < PKG_MAX_NUM_GDS_FILES; i++)
+			{
+				if (PKG_GDS_Files[i])
+				{
+					if (PKG_GDS_Files[i]->FileName() == FName)
+					{
+						throw ErrGDSFmt(
+							"The file '%s' has been created or opened.", fn);
+					}
+				}
+			}
+		}
+
+		CdGDSFile *file = GDS_File_Open(fn, readonly, true);
+		file_id = GetFileIndex(file);
+	COREARRAY_CATCH
+
+	return PyInt_FromLong(file_id);
+}
+
+
+/// Close the GDS file
+PY_EXPORT PyObject* gdsCloseGDS(PyObject *self, PyObject *args)
+{
+	int file_id;
+	if (!PyArg_ParseTuple(args, "i", &file_id))
+		return NULL;
+
+	COREARRAY_TRY
+		if (file_id >= 0)
+		{
+			// wait for the threads reading or writing the file
+			CdPyFileLock Lock;
+			Lock.Lock(GetFileLock(file_id));
+			chunk_iter_cancel(GetFileLock(file_id), NULL);
+			GDS_File_Close(GDS_ID2File(file_id));
+		}
+	COREARRAY_CATCH_NONE
+}
+
+
+/// Synchronize the GDS file
+PY_EXPORT PyObject* gdsSyncGDS(PyObject *self, PyObject *args)
+{
+	int file_id;
+	if (!PyArg_ParseTuple(args, "i", &file_id))
+		return NULL;
+
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		Lock.Lock(GetFileLock(file_id));
+		GDS_ID2File(file_id)->SyncFile();
+	COREARRAY_CATCH_NONE
+}
+
+
+/// Get the file size and check the file handler
+PY_EXPORT PyObject* gdsFileSize(PyObject *self, PyObject *args)
+{
+	int file_id;
+	if (!PyArg_ParseTuple(args, "i", &file_id))
+		return NULL;
+
+	double sz;
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		Lock.Lock(GetFileLock(file_id));
+		sz = GDS_ID2File(file_id)->GetFileSize();
+	COREARRAY_CATCH
+	return Py_BuildValue("d", sz);
+}
+
+
+/// Set the read-ahead of compressed blocks, return the old settings
+PY_EXPORT PyObject* gdsSetReadAhead(PyObject *self, PyObject *args)
+{
+	int nthread, nblock;
+	if (!PyArg_ParseTuple(args, "ii", &nthread, &nblock))
+		return NULL;
+
+	int old_thread, old_block;
+	COREARRAY_TRY
+		CdRA_Read::GetReadAhead(old_thread, old_block);
+		if (nthread >= 0 || nblock >= 0)
+		{
+			CdRA_Read::SetReadAhead((nthread >= 0) ? nthread : old_thread,
+				(nblock >= 0) ? nblock : old_block);
+		}
+	COREARRAY_CATCH
+	return Py_BuildValue("ii", old_thread, old_block);
+}
+
+
+/// Set the parallel compression of blocks, return the old setting
+PY_EXPORT PyObject* gdsSetParallelCompress(PyObject *self, PyObject *args)
+{
+	int nthread;
+	if (!PyArg_ParseTuple(args, "i", &nthread))
+		return NULL;
+
+	int old_thread;
+	COREARRAY_TRY
+		old_thread = CdRA_Write::GetParallel();
+		if (nthread >= 0)
+			CdRA_Write::SetParallel(nthread);
+	COREARRAY_CATCH
+	return PyInt_FromLong(old_thread);
+}
+
+
+/// Set the multithreaded xz encoder, return the old settings
+PY_EXPORT PyObject* gdsSetLZMAThreads(PyObject *self, PyObject *args)
+{
+	int nthread;
+	long long bsize;
+	if (!PyArg_ParseTuple(args, "iL", &nthread, &bsize))
+		return NULL;
+
+	int old_thread;
+	C_Int64 old_bsize;
+	COREARRAY_TRY
+		CdXZEncoder::GetParallel(old_thread, old_bsize);
+		if (nthread >= 0 || bsize >= 0)
+		{
+			CdXZEncoder::SetParallel((nthread >= 0) ? nthread : old_thread,
+				(bsize >= 0) ? bsize : old_bsize);
+		}
+	COREARRAY_CATCH
+	return Py_BuildValue("iL", old_thread, (long long)old_bsize);
+}
+
+
+/// Set the memory budget of the decoded block cache, return the old one
+PY_EXPORT PyObject* gdsSetBlockCache(PyObject *self, PyObject *args)
+{
+	long long size;
+	if (!PyArg_ParseTuple(args, "L", &size))
+		return NULL;
+
+	C_Int64 old_size;
+	COREARRAY_TRY
+		old_size = CdRA_Read::GetBlockCache().MaxSize;
+		if (size >= 0)
+			CdRA_Read::SetBlockCache(size);
+	COREARRAY_CATCH
+	return Py_BuildValue("L", (long long)old_size);
+}
+
+
+/// Set the checksums of blocks with random access, return the old settings
+PY_EXPORT PyObject* gdsSetChecksum(PyObject *self, PyObject *args)
+{
+	int write, verify;
+	if (!PyArg_ParseTuple(args, "ii", &write, &verify))
+		return NULL;
+
+	bool old_write, old_verify;
+	COREARRAY_TRY
+		old_write = CdRA_Write::GetChecksum();
+		old_verify = CdRA_Read::GetVerify();
+		if (write >= 0)
+			CdRA_Write::SetChecksum(write != 0);
+		if (verify >= 0)
+			CdRA_Read::SetVerify(verify != 0);
+	COREARRAY_CATCH
+	return Py_BuildValue("OO", old_write ? Py_True : Py_False,
+		old_verify ? Py_True : Py_False);
+}
+
+
+/// Set whether the files opened read-only are mapped into memory (-1 to keep);
+/// returns the old setting
+PY_EXPORT PyObject* gdsSetMemoryMap(PyObject *self, PyObject *args)
+{
+	int enable;
+	if (!PyArg_ParseTuple(args, "i", &enable))
+		return NULL;
+
+	bool old = CdGDSFile::GetMemoryMap();
+	if (enable >= 0)
+		CdGDSFile::SetMemoryMap(enable != 0);
+	return Py_BuildValue("O", old ? Py_True : Py_False);
+}
+
+
+/// Get the statistics of the decoded block cache
+PY_EXPORT PyObject* gdsBlockCacheInfo(PyObject *self, PyObject *args)
+{
+	int reset;
+	if (!PyArg_ParseTuple(args, BSTR, &reset))
+		return NULL;
+
+	CdRA_Read::TBlockCacheStat st;
+	COREARRAY_TRY
+		st = CdRA_Read::GetBlockCache(reset != 0);
+	COREARRAY_CATCH
+	return Py_BuildValue("{s:L,s:L,s:L,s:L,s:L}",
+		"max_size", (long long)st.MaxSize, "size", (long long)st.Size,
+		"blocks", (long long)st.NumBlock, "hits", (long long)st.Hits,
+		"misses", (long long)st.Misses);
+}
+
+
+/// Clean up fragments of a GDS file
+PY_EXPORT PyObject* gdsTidyUp(PyObject *self, PyObject *args)
+{
+	const char *fn;
+	int verbose;
+	if (!PyArg_ParseTuple(args, "s" BSTR, &fn, &verbose))
+		return NULL;
+
+	COREARRAY_TRY
+
+		CdGDSFile file(fn, CdGDSFile::dmOpenReadWrite);
+		C_Int64 old_s = file.GetFileSize();
+		if (verbose)
 		{
 			printf("Clean up the fragments of GDS file:\n");
 			printf("    open the file '%s' (%s)\n", fn, fmt_size(old_s).c_str());
@@ -396,515 +1598,1207 @@ PY_EXPORT PyObject* gdsTidyUp(PyObject *self, PyObject *args)
 			printf("    save to '%s.tmp'\n", fn);
 			fflush(stdout);
 		}
-		file.TidyUp(false);
-		if (verbose)
+		file.TidyUp(false);
+		if (verbose)
+		{
+			C_Int64 new_s = file.GetFileSize();
+			printf("    rename '%s.tmp' (%s, reduced: %s)\n", fn,
+				fmt_size(new_s).c_str(), fmt_size(old_s-new_s).c_str());
+			printf("    # of fragments: %d\n", file.GetNumOfFragment());
+			fflush(stdout);
+		}
+
+	COREARRAY_CATCH_NONE
+}
+
+
+/// Clean up fragments of a GDS file
+PY_EXPORT PyObject* gdsRoot(PyObject *self, PyObject *args)
+{
+	int file_id;
+	if (!PyArg_ParseTuple(args, "i", &file_id))
+		return NULL;
+
+	int idx;
+	Py_ssize_t ptr;
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		Lock.Lock(GetFileLock(file_id));
+		set_obj(&GDS_ID2File(file_id)->Root(), idx, ptr);
+	COREARRAY_CATCH
+
+	return Py_BuildValue("in", idx, ptr);
+}
+
+
+/// Clean up fragments of a GDS file
+PY_EXPORT PyObject* gdsIndex(PyObject *self, PyObject *args)
+{
+	int file_id;
+	const char *path;
+	int silent;
+	if (!PyArg_ParseTuple(args, "is" BSTR, &file_id, &path, &silent))
+		return NULL;
+
+	int idx;
+	Py_ssize_t ptr;
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		Lock.Lock(GetFileLock(file_id));
+		CdGDSObj *Obj = GDS_ID2File(file_id)->Root().PathEx(UTF8Text(path));
+		if (!Obj && !silent)
+			throw ErrGDSObj("No such GDS node \"%s\"!", path);
+		if (Obj)
+		{
+			set_obj(Obj, idx, ptr);
+		} else {
+			idx = -1; ptr = 0;
+		}
+	COREARRAY_CATCH
+
+	return Py_BuildValue("in", idx, ptr);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// File Structure Operations
+// ----------------------------------------------------------------------------
+
+/// Enumerate the names of its child nodes
+PY_EXPORT PyObject* gdsnListName(PyObject *self, PyObject *args)
+{
+	int nidx;
+	Py_ssize_t ptr_int;
+	int inc_hidden;
+	if (!PyArg_ParseTuple(args, "in" BSTR, &nidx, &ptr_int, &inc_hidden))
+		return NULL;
+
+	COREARRAY_TRY
+
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
+		CdGDSAbsFolder *Dir = dynamic_cast<CdGDSAbsFolder*>(Obj);
+		if (Dir)
+		{
+			vector<string> List;
+			for (int i=0; i < Dir->NodeCount(); i++)
+			{
+				CdGDSObj *Obj = Dir->ObjItemEx(i);
+				if (Obj)
+				{
+					if (inc_hidden)
+					{
+						List.push_back(RawText(Obj->Name()));
+					} else {
+						if (!Obj->GetHidden() &&
+							!Obj->Attribute().HasName(UTF8Text("R.invisible")))
+						{
+							List.push_back(RawText(Obj->Name()));
+						}
+					}
+				}
+			}
+
+			PyObject *rv_ans = PyList_New(List.size());
+			for (size_t i=0; i < List.size(); i++)
+			{
+				PyObject *x = PYSTR_SET2(List[i].c_str(), List[i].size());
+				PyList_SetItem(rv_ans, i, x);
+			}
+
+			return rv_ans;
+
+		} else {
+			throw ErrGDSObj("It is not a folder.");
+		}
+
+	COREARRAY_CATCH_NONE
+}
+
+
+/// Get the GDS node with a given path
+PY_EXPORT PyObject* gdsnIndex(PyObject *self, PyObject *args)
+{
+	int nidx;
+	Py_ssize_t ptr_int;
+	const char *path;
+	int silent;
+	if (!PyArg_ParseTuple(args, "ins" BSTR, &nidx, &ptr_int, &path, &silent))
+		return NULL;
+
+	int idx;
+	Py_ssize_t ptr;
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
+		CdGDSAbsFolder *Dir = dynamic_cast<CdGDSAbsFolder*>(Obj);
+		if (Dir)
+		{
+			Obj = Dir->PathEx(UTF8Text(path));
+			if (!Obj && !silent)
+				throw ErrGDSObj("No such GDS node \"%s\"!", path);
+			if (Obj)
+			{
+				set_obj(Obj, idx, ptr);
+			} else {
+				idx = -1; ptr = 0;
+			}
+		} else {
+			throw ErrGDSObj("It is not a folder.");
+		}
+	COREARRAY_CATCH
+
+	return Py_BuildValue("in", idx, ptr);
+}
+
+
+/// Get the name of a GDS node
+PY_EXPORT PyObject* gdsnName(PyObject *self, PyObject *args)
+{
+	int nidx;
+	Py_ssize_t ptr_int;
+	int full;
+	if (!PyArg_ParseTuple(args, "in" BSTR, &nidx, &ptr_int, &full))
+		return NULL;
+
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
+		string nm;
+		if (full)
+			nm = RawText(Obj->FullName());
+		else
+			nm = RawText(Obj->Name());
+		return Py_BuildValue("s", nm.c_str());
+	COREARRAY_CATCH_NONE
+}
+
+
+/// Get the name of a GDS node
+PY_EXPORT PyObject* gdsnRename(PyObject *self, PyObject *args)
+{
+	int nidx;
+	Py_ssize_t ptr_int;
+	const char *newname;
+	if (!PyArg_ParseTuple(args, "ins", &nidx, &ptr_int, &newname))
+		return NULL;
+
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
+		Obj->SetName(UTF8Text(newname));
+	COREARRAY_CATCH_NONE
+}
+
+
+/// Get the description of a GDS node
+PY_EXPORT PyObject* gdsnDesp(PyObject *self, PyObject *args)
+{
+	int nidx;
+	Py_ssize_t ptr_int;
+	if (!PyArg_ParseTuple(args, "in", &nidx, &ptr_int))
+		return NULL;
+
+	COREARRAY_TRY
+
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
+
+		string nm  = RawText(Obj->Name());
+		string nm2 = RawText(Obj->FullName());
+		string ste = Obj->dName();
+
+		string tra = Obj->dTraitName();
+		if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
+			tra = RawText(((CdGDSVirtualFolder*)Obj)->LinkFileName());
+
+		string type = "Unknown";
+		if (dynamic_cast<CdGDSLabel*>(Obj))
+			type = "Label";
+		else if (dynamic_cast<CdGDSFolder*>(Obj))
+			type = "Folder";
+		else if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
+			type = "VFolder";
+		else if (dynamic_cast<CdGDSStreamContainer*>(Obj))
+			type = "Raw";
+		else if (dynamic_cast<CdContainer*>(Obj))
+		{
+			CdContainer* nn = static_cast<CdContainer*>(Obj);
+			C_SVType sv = nn->SVType();
+			if (COREARRAY_SV_INTEGER(sv))
+			{
+				if (GDS_Is_RFactor(Obj))
+					type = "Factor";
+				else if (GDS_Is_RLogical(Obj))
+					type = "Logical";
+				else
+					type = "Integer";
+			} else if (COREARRAY_SV_FLOAT(sv))
+				type = "Real";
+			else if (COREARRAY_SV_STRING(sv))
+				type = "String";
+		}
+
+		// dim, the dimension of data field
+		PyObject *dim;
+		string encoder, compress;
+		double cpratio = NaN;
+		if (dynamic_cast<CdAbstractArray*>(Obj))
 		{
-			C_Int64 new_s = file.GetFileSize();
-			printf("    rename '%s.tmp' (%s, reduced: %s)\n", fn,
-				fmt_size(new_s).c_str(), fmt_size(old_s-new_s).c_str());
-			printf("    # of fragments: %d\n", file.GetNumOfFragment());
-			fflush(stdout);
+			CdAbstractArray *_Obj = (CdAbstractArray*)Obj;
+
+			dim = PyList_New(_Obj->DimCnt());
+			for (int i=0; i < _Obj->DimCnt(); i++)
+				PyList_SetItem(dim, i, PyInt_FromLong(_Obj->GetDLen(i)));
+
+			if (_Obj->PipeInfo())
+			{
+				encoder = _Obj->PipeInfo()->Coder();
+				compress = _Obj->PipeInfo()->CoderParam();
+				if (_Obj->PipeInfo()->StreamTotalIn() > 0)
+				{
+					cpratio = (double)_Obj->PipeInfo()->StreamTotalOut() /
+						_Obj->PipeInfo()->StreamTotalIn();
+				}
+			}
+		} else {
+			dim = Py_None; Py_INCREF(dim);
+		}
+
+		// object size
+		double size = NaN;
+		if (dynamic_cast<CdContainer*>(Obj))
+		{
+			CdContainer* p = static_cast<CdContainer*>(Obj);
+			p->Synchronize();
+			size = p->GDSStreamSize();
+		} else if (dynamic_cast<CdGDSStreamContainer*>(Obj))
+		{
+			CdGDSStreamContainer *_Obj = (CdGDSStreamContainer*)Obj;
+			if (_Obj->PipeInfo())
+				size = _Obj->PipeInfo()->StreamTotalIn();
+			else
+				size = _Obj->GetSize();
+		}
+
+		// good
+		int GoodFlag = 1;
+		if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
+		{
+			CdGDSVirtualFolder *v = (CdGDSVirtualFolder*)Obj;
+			GoodFlag = v->IsLoaded(true) ? 1 : 0;
+		} else if (dynamic_cast<CdGDSUnknown*>(Obj))
+		{
+			GoodFlag = 0;
+		}
+
+		// hidden
+		int hidden_flag = Obj->GetHidden() ||
+			Obj->Attribute().HasName(UTF8Text("R.invisible"));
+
+		// message
+		string msg;
+		if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
+		{
+			CdGDSVirtualFolder *v = (CdGDSVirtualFolder*)Obj;
+			v->IsLoaded(true);
+			msg = v->ErrMsg().c_str();
 		}
 
+		return Py_BuildValue(
+			"{s:s,s:s,s:s,s:s,s:s,s:N,s:s,s:s,s:d,s:d,s:N,s:N,s:s}",
+			"name",     nm.c_str(),
+			"fullname", nm2.c_str(),
+			"storage",  ste.c_str(),
+			"trait",    tra.c_str(),
+			"type",     type.c_str(),
+			"dim",      dim,
+			"encoder",  encoder.c_str(),
+			"compress", compress.c_str(),
+			"cpratio",  cpratio,
+			"size",     size,
+			"good",     PyBool_FromLong(GoodFlag),
+			"hidden",   PyBool_FromLong(hidden_flag),
+			"message",  msg.c_str()
+		);
+
 	COREARRAY_CATCH_NONE
 }
 
 
-/// Clean up fragments of a GDS file
-PY_EXPORT PyObject* gdsRoot(PyObject *self, PyObject *args)
+
+// ----------------------------------------------------------------------------
+// Data Operations
+// ----------------------------------------------------------------------------
+
+// defined in PyCoreArray.cpp: decode into 'Out' if not NULL, and the GIL is
+// released when decoding if 'NoGIL', 'Mode' is TPyReadMode
+extern PyObject* Py_Array_Read(PdAbstractArray Obj, const C_Int32 *Start,
+	const C_Int32 *Length, const C_BOOL *const Selection[], C_SVType SV,
+	PyObject *Out, bool NoGIL, int Mode);
+// defined in PyCoreArray.cpp
+extern void *numpy_get_data(PyObject *obj, size_t &num, int &sv_out);
+
+static bool cvt2sv(const char *cvt, C_SVType &sv, int *mode=NULL)
 {
-	int file_id;
-	if (!PyArg_ParseTuple(args, "i", &file_id))
-		return NULL;
+	if (mode) *mode = prmDefault;
+	if (strcmp(cvt, "") == 0)
+		sv = svCustom;
+	else if (strcmp(cvt, "int8") == 0)
+		sv = svInt8;
+	else if (strcmp(cvt, "uint8") == 0)
+		sv = svUInt8;
+	else if (strcmp(cvt, "int16") == 0)
+		sv = svInt16;
+	else if (strcmp(cvt, "uint16") == 0)
+		sv = svUInt16;
+	else if (strcmp(cvt, "int32") == 0)
+		sv = svInt32;
+	else if (strcmp(cvt, "uint32") == 0)
+		sv = svUInt32;
+	else if (strcmp(cvt, "int64") == 0)
+		sv = svInt64;
+	else if (strcmp(cvt, "uint64") == 0)
+		sv = svUInt64;
+	else if (strcmp(cvt, "float32") == 0)
+		sv = svFloat32;
+	else if (strcmp(cvt, "float64") == 0)
+		sv = svFloat64;
+	else if (strcmp(cvt, "utf8") == 0)
+		sv = svStrUTF8;
+	else if (strcmp(cvt, "utf16") == 0)
+		sv = svStrUTF16;
+	else if (mode && (strcmp(cvt, "S") == 0))
+		{ sv = svCustom; *mode = prmFixedBytes; }
+	else if (mode && (strcmp(cvt, "U") == 0))
+		{ sv = svCustom; *mode = prmFixedUnicode; }
+	else if (mode && (strcmp(cvt, "codes") == 0))
+		{ sv = svCustom; *mode = prmFactorCodes; }
+	else {
+		PyErr_SetString(PyExc_ValueError, "Invalid 'cvt'.");
+		return true;
+	}
+	return false;
+}
 
-	int idx;
-	Py_ssize_t ptr;
-	COREARRAY_TRY
-		set_obj(&GDS_ID2File(file_id)->Root(), idx, ptr);
-	COREARRAY_CATCH
+/// parse the arguments 'start' and 'count' (None or lists), return true
+/// if fails with a Python exception
+static bool get_start_count(PyObject *start, PyObject *count,
+	CdAbstractArray::TArrayDim &dm_st, int &dm_st_n,
+	CdAbstractArray::TArrayDim &dm_cnt, int &dm_cnt_n)
+{
+	// check the argument 'start'
+	dm_st_n = 0;
+	if (PyList_Check(start))
+	{
+		dm_st_n = PyList_Size(start);
+		if (dm_st_n > (int)CdAbstractArray::MAX_ARRAY_DIM)
+		{
+			PyErr_SetString(PyExc_ValueError, "'start' is too long.");
+			return true;
+		}
+		for(int i=0; i < dm_st_n; i++)
+			dm_st[i] = PyInt_AsLong(PyList_GetItem(start, i));
+	} else if (start != Py_None)
+	{
+		PyErr_SetString(PyExc_ValueError, "'start' should be None or a list.");
+		return true;
+	}
 
-	return Py_BuildValue("in", idx, ptr);
+	// check the argument 'count'
+	dm_cnt_n = 0;
+	if (PyList_Check(count))
+	{
+		dm_cnt_n = PyList_Size(count);
+		if (dm_cnt_n > (int)CdAbstractArray::MAX_ARRAY_DIM)
+		{
+			PyErr_SetString(PyExc_ValueError, "'count' is too long.");
+			return true;
+		}
+		for(int i=0; i < dm_cnt_n; i++)
+			dm_cnt[i] = PyInt_AsLong(PyList_GetItem(count, i));
+	} else if (count != Py_None)
+	{
+		PyErr_SetString(PyExc_ValueError, "'count' should be None or a list.");
+		return true;
+	}
+
+	if ((dm_st_n==0 && dm_cnt_n>0) || (dm_st_n>0 && dm_cnt_n==0))
+	{
+		PyErr_SetString(PyExc_ValueError, "'start' and 'count' should be both None.");
+		return true;
+	}
+	return false;
+}
+
+/// check 'start' and 'count' against the dimensions of an array, and
+/// return the pointers passed to ReadData (NULL for the whole array)
+static void check_start_count(CdAbstractArray *Obj,
+	CdAbstractArray::TArrayDim &dm_st, int dm_st_n,
+	CdAbstractArray::TArrayDim &dm_cnt, int dm_cnt_n,
+	C_Int32 *&pDS, C_Int32 *&pDL)
+{
+	pDS = pDL = NULL;
+	if (dm_st_n>0 && dm_cnt_n>0)
+	{
+		int Len = Obj->DimCnt();
+		CdAbstractArray::TArrayDim DCnt;
+		Obj->GetDim(DCnt);
+
+		if (dm_st_n != Len)
+			throw ErrGDSFmt("The length of 'start' is invalid.");
+		for (int i=0; i < Len; i++)
+		{
+			if ((dm_st[i] < 0) || (dm_st[i] >= DCnt[i]))
+				throw ErrGDSFmt("'start[%d]=%d' is invalid.", i, dm_st[i]);
+		}
+		pDS = dm_st;
+
+		if (dm_cnt_n != Len)
+			throw ErrGDSFmt("The length of 'count' is invalid.");
+		for (int i=0; i < Len; i++)
+		{
+			C_Int32 &v = dm_cnt[i];
+			if (v == -1)
+				v = DCnt[i] - dm_st[i];
+			if ((v <= 0) || ((dm_st[i]+v) > DCnt[i]))
+				throw ErrGDSFmt("'count[%d]=%d' is invalid.", i, v);
+		}
+		pDL = dm_cnt;
+	}
 }
 
+/// Read data from a GDS node
+PY_EXPORT PyObject* gdsnRead(PyObject *self, PyObject *args)
+{
+	int nidx;
+	Py_ssize_t ptr_int;
+	PyObject *start, *count;
+	const char *cvt;
+	PyObject *out = Py_None;
+	if (!PyArg_ParseTuple(args, "inOOs|O", &nidx, &ptr_int, &start, &count,
+			&cvt, &out))
+		return NULL;
+
+	// check the argument 'cvt'
+	C_SVType sv;
+	int mode;
+	if (cvt2sv(cvt, sv, &mode)) return NULL;
 
-/// Clean up fragments of a GDS file
-PY_EXPORT PyObject* gdsIndex(PyObject *self, PyObject *args)
-{
-	int file_id;
-	const char *path;
-	int silent;
-	if (!PyArg_ParseTuple(args, "is" BSTR, &file_id, &path, &silent))
+	// check the arguments 'start' and 'count'
+	CdAbstractArray::TArrayDim dm_st, dm_cnt;
+	int dm_st_n, dm_cnt_n;
+	if (get_start_count(start, count, dm_st, dm_st_n, dm_cnt, dm_cnt_n))
 		return NULL;
 
-	int idx;
-	Py_ssize_t ptr;
 	COREARRAY_TRY
-		CdGDSObj *Obj = GDS_ID2File(file_id)->Root().PathEx(UTF8Text(path));
-		if (!Obj && !silent)
-			throw ErrGDSObj("No such GDS node \"%s\"!", path);
-		if (Obj)
-		{
-			set_obj(Obj, idx, ptr);
-		} else {
-			idx = -1; ptr = 0;
-		}
-	COREARRAY_CATCH
 
-	return Py_BuildValue("in", idx, ptr);
-}
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
+		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
+		if (Obj == NULL)
+			throw ErrGDSFmt(ERR_NO_DATA);
 
+		C_Int32 *pDS, *pDL;
+		check_start_count(Obj, dm_st, dm_st_n, dm_cnt, dm_cnt_n, pDS, pDL);
 
+		PyObject *rv = Py_Array_Read(Obj, pDS, pDL, NULL, sv,
+			(out != Py_None) ? out : NULL, true, mode);
+		return rv;
 
-// ----------------------------------------------------------------------------
-// File Structure Operations
-// ----------------------------------------------------------------------------
+	COREARRAY_CATCH_NONE
+}
 
-/// Enumerate the names of its child nodes
-PY_EXPORT PyObject* gdsnListName(PyObject *self, PyObject *args)
+
+/// Read a list of GDS nodes, 'reqs' is a list of (idx, ptr, start, count);
+/// returns a tuple of arrays
+PY_EXPORT PyObject* gdsnReadMany(PyObject *self, PyObject *args)
 {
-	int nidx;
-	Py_ssize_t ptr_int;
-	int inc_hidden;
-	if (!PyArg_ParseTuple(args, "in" BSTR, &nidx, &ptr_int, &inc_hidden))
+	PyObject *reqs;
+	const char *cvt;
+	int nthread;
+	if (!PyArg_ParseTuple(args, "Osi", &reqs, &cvt, &nthread))
+		return NULL;
+	if (!PyList_Check(reqs))
+	{
+		PyErr_SetString(PyExc_ValueError, "'reqs' should be a list.");
 		return NULL;
+	}
+
+	// check the argument 'cvt'
+	C_SVType sv;
+	int mode;
+	if (cvt2sv(cvt, sv, &mode)) return NULL;
+
+	// parse the requests
+	const Py_ssize_t n = PyList_Size(reqs);
+	vector<TReadManyItem> List(n);
+	vector<int> NIdx(n);
+	vector<Py_ssize_t> NPtr(n);
+	for (Py_ssize_t i=0; i < n; i++)
+	{
+		PyObject *start, *count;
+		if (!PyArg_ParseTuple(PyList_GET_ITEM(reqs, i), "inOO", &NIdx[i],
+				&NPtr[i], &start, &count))
+			return NULL;
+		TReadManyItem &I = List[i];
+		if (get_start_count(start, count, I.Start, I.StartN, I.Count,
+				I.CountN))
+			return NULL;
+	}
 
+	PyObject *rv = NULL;
 	COREARRAY_TRY
 
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
-		CdGDSAbsFolder *Dir = dynamic_cast<CdGDSAbsFolder*>(Obj);
-		if (Dir)
-		{
-			vector<string> List;
-			for (int i=0; i < Dir->NodeCount(); i++)
+		// lock all GDS files involved
+		vector<CdThreadMutex*> Mutex;
+		for (Py_ssize_t i=0; i < n; i++)
+			Mutex.push_back(GetObjFileLock(get_obj(NIdx[i], NPtr[i])));
+		CdPyFileLock Lock;
+		Lock.Lock(Mutex);
+
+		rv = PyTuple_New(n);
+		try {
+			// check the nodes (they might be closed or deleted when waiting
+			// for the locks), and create the numpy arrays of numeric data
+			for (Py_ssize_t i=0; i < n; i++)
 			{
-				CdGDSObj *Obj = Dir->ObjItemEx(i);
-				if (Obj)
-				{
-					if (inc_hidden)
-					{
-						List.push_back(RawText(Obj->Name()));
-					} else {
-						if (!Obj->GetHidden() &&
-							!Obj->Attribute().HasName(UTF8Text("R.invisible")))
-						{
-							List.push_back(RawText(Obj->Name()));
-						}
-					}
-				}
+				TReadManyItem &I = List[i];
+				CdGDSObj *obj = get_obj(NIdx[i], NPtr[i]);
+				I.Obj = dynamic_cast<CdAbstractArray*>(obj);
+				if (I.Obj == NULL)
+					throw ErrGDSFmt(ERR_NO_DATA);
+				C_Int32 *pDS, *pDL;
+				check_start_count(I.Obj, I.Start, I.StartN, I.Count, I.CountN,
+					pDS, pDL);
+				I.Whole = (pDS == NULL);
+				I.FileLock = GetObjFileLock(obj);
+
+				I.SV = sv;
+				I.Direct = false;
+				if (mode != prmDefault) continue;
+				if (I.Whole) I.Obj->GetDim(I.Count);
+				PyObject *a = Py_Array_NewNumeric(I.Obj, I.Count, I.SV,
+					I.Buffer);
+				if (!a) continue;
+				PyTuple_SET_ITEM(rv, i, a);
+				I.Direct = true;
+
+				vector<const CdBlockStream*> BL;
+				I.Obj->GetOwnBlockStream(BL);
+				I.Offset = (!BL.empty() && BL[0]->List()) ?
+					BL[0]->List()->AbsStart() : 0;
 			}
 
-			PyObject *rv_ans = PyList_New(List.size());
-			for (size_t i=0; i < List.size(); i++)
+			// decode the numeric data
 			{
-				PyObject *x = PYSTR_SET2(List[i].c_str(), List[i].size());
-				PyList_SetItem(rv_ans, i, x);
+				CdReadManyKernel Kernel(List, nthread);
+				CdPyNoGIL NoGIL;
+				Kernel.Run();
 			}
 
-			return rv_ans;
-
-		} else {
-			throw ErrGDSObj("It is not a folder.");
+			// strings and factors need the GIL
+			for (Py_ssize_t i=0; i < n; i++)
+			{
+				TReadManyItem &I = List[i];
+				if (I.Direct) continue;
+				PyObject *a = Py_Array_Read(I.Obj, I.Whole ? NULL : I.Start,
+					I.Whole ? NULL : I.Count, NULL, sv, NULL, true, mode);
+				PyTuple_SET_ITEM(rv, i, a);
+			}
+		}
+		catch (...) {
+			Py_DECREF(rv);
+			throw;
 		}
 
-	COREARRAY_CATCH_NONE
+	COREARRAY_CATCH
+	return rv;
 }
 
 
-/// Get the GDS node with a given path
-PY_EXPORT PyObject* gdsnIndex(PyObject *self, PyObject *args)
+/// parse the selection of a dimension, which is None, a slice, a bool numpy
+/// vector or a sorted numpy vector of int64 indices; the selection is
+/// returned as a block [St, St+Len) with a bool vector relative to St
+/// ('Sel' is NULL if all entries in the block are selected)
+static void get_dim_sel(PyObject *sel, int i, C_Int32 DimLen, C_Int32 &St,
+	C_Int32 &Len, vector<C_BOOL> &Buf, const C_BOOL *&Sel)
 {
-	int nidx;
-	Py_ssize_t ptr_int;
-	const char *path;
-	int silent;
-	if (!PyArg_ParseTuple(args, "ins" BSTR, &nidx, &ptr_int, &path, &silent))
-		return NULL;
+	extern C_BOOL *numpy_get_bool(PyObject *obj, size_t &num);
 
-	int idx;
-	Py_ssize_t ptr;
-	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
-		CdGDSAbsFolder *Dir = dynamic_cast<CdGDSAbsFolder*>(Obj);
-		if (Dir)
+	St = 0; Len = DimLen; Sel = NULL;
+	if (sel == Py_None) return;
+
+	if (PySlice_Check(sel))
+	{
+		Py_ssize_t start, stop, step, n;
+		if (PySlice_GetIndicesEx(sel, DimLen, &start, &stop, &step, &n) < 0)
 		{
-			Obj = Dir->PathEx(UTF8Text(path));
-			if (!Obj && !silent)
-				throw ErrGDSObj("No such GDS node \"%s\"!", path);
-			if (Obj)
-			{
-				set_obj(Obj, idx, ptr);
-			} else {
-				idx = -1; ptr = 0;
-			}
-		} else {
-			throw ErrGDSObj("It is not a folder.");
+			PyErr_Clear();
+			throw ErrGDSFmt("'sel[%d]' is an invalid slice.", i);
 		}
-	COREARRAY_CATCH
+		if (step <= 0)
+			throw ErrGDSFmt("'sel[%d]' should be a slice with a positive step.", i);
+		St = (n > 0) ? start : 0;
+		Len = (n > 0) ? ((n - 1) * step + 1) : 0;
+		if (step > 1)
+		{
+			Buf.assign(Len, 0);
+			for (Py_ssize_t k=0; k < Len; k += step) Buf[k] = 1;
+			Sel = &Buf[0];
+		}
+		return;
+	}
 
-	return Py_BuildValue("in", idx, ptr);
+	size_t n = 0;
+	const C_BOOL *bs = numpy_get_bool(sel, n);
+	if (bs)
+	{
+		if (n != (size_t)DimLen)
+			throw ErrGDSFmt("The length of 'sel[%d]' is not correct.", i);
+		// trim the leading and trailing unselected entries
+		C_Int32 e = DimLen;
+		while ((St < e) && !bs[St]) St ++;
+		while ((e > St) && !bs[e-1]) e --;
+		Len = e - St;
+		Sel = bs + St;
+		return;
+	}
+
+	int sv = -1;
+	const C_Int64 *idx = (const C_Int64*)numpy_get_data(sel, n, sv);
+	if (!idx || (sv != svInt64))
+	{
+		throw ErrGDSFmt("'sel[%d]' should be None, a slice, a bool numpy "
+			"vector or an int64 numpy vector.", i);
+	}
+	for (size_t k=0; k < n; k++)
+	{
+		if ((idx[k] < 0) || (idx[k] >= DimLen))
+			throw ErrGDSFmt("'sel[%d]' is out of range.", i);
+		if ((k > 0) && (idx[k] <= idx[k-1]))
+			throw ErrGDSFmt("'sel[%d]' should be sorted without duplicates.", i);
+	}
+	St = (n > 0) ? idx[0] : 0;
+	Len = (n > 0) ? (idx[n-1] - idx[0] + 1) : 0;
+	if ((size_t)Len != n)
+	{
+		Buf.assign(Len, 0);
+		for (size_t k=0; k < n; k++) Buf[idx[k] - St] = 1;
+		Sel = &Buf[0];
+	}
 }
 
 
-/// Get the name of a GDS node
-PY_EXPORT PyObject* gdsnName(PyObject *self, PyObject *args)
+/// Read data from a GDS node with a selection
+PY_EXPORT PyObject* gdsnRead2(PyObject *self, PyObject *args)
 {
 	int nidx;
 	Py_ssize_t ptr_int;
-	int full;
-	if (!PyArg_ParseTuple(args, "in" BSTR, &nidx, &ptr_int, &full))
+	PyObject *selection;
+	const char *cvt;
+	PyObject *out = Py_None;
+	if (!PyArg_ParseTuple(args, "inOs|O", &nidx, &ptr_int, &selection, &cvt,
+			&out))
 		return NULL;
 
-	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
-		string nm;
-		if (full)
-			nm = RawText(Obj->FullName());
-		else
-			nm = RawText(Obj->Name());
-		return Py_BuildValue("s", nm.c_str());
-	COREARRAY_CATCH_NONE
-}
-
+	// check the argument 'cvt'
+	C_SVType sv;
+	int mode;
+	if (cvt2sv(cvt, sv, &mode)) return NULL;
 
-/// Get the name of a GDS node
-PY_EXPORT PyObject* gdsnRename(PyObject *self, PyObject *args)
-{
-	int nidx;
-	Py_ssize_t ptr_int;
-	const char *newname;
-	if (!PyArg_ParseTuple(args, "ins", &nidx, &ptr_int, &newname))
+	// check the argument 'sel'
+	if (!PyList_Check(selection))
+	{
+		PyErr_SetString(PyExc_ValueError, "'sel' should be a list.");
 		return NULL;
+	}
 
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
-		Obj->SetName(UTF8Text(newname));
+
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
+		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
+		if (Obj == NULL)
+			throw ErrGDSFmt(ERR_NO_DATA);
+		const int ndim = Obj->DimCnt();
+		if (PyList_Size(selection) != ndim)
+			throw ErrGDSFmt("The dimension of 'sel' is not correct.");
+
+		// the selection of each dimension, as a block with an optional
+		// bool vector relative to the start of the block
+		CdAbstractArray::TArrayDim St, Len;
+		vector< vector<C_BOOL> > tmpSel(ndim);
+		vector<const C_BOOL*> SelList(ndim);
+		bool need_sel = false, empty = false;
+		C_Int32 MaxLen = 0;
+		for (int i=0; i < ndim; i++)
+		{
+			get_dim_sel(PyList_GET_ITEM(selection, i), i, Obj->GetDLen(i),
+				St[i], Len[i], tmpSel[i], SelList[i]);
+			if (SelList[i]) need_sel = true;
+			if (Len[i] <= 0) empty = true;
+			if (Len[i] > MaxLen) MaxLen = Len[i];
+		}
+
+		// read data
+		vector<C_BOOL> ones;
+		if (empty)
+		{
+			// nothing to read, 'Len' is used as the dimension of output
+			for (int i=0; i < ndim; i++)
+			{
+				if (SelList[i])
+				{
+					C_Int32 n = 0;
+					for (C_Int32 k=0; k < Len[i]; k++)
+						if (SelList[i][k]) n ++;
+					Len[i] = n;
+				}
+			}
+		} else if (need_sel)
+		{
+			ones.assign(MaxLen, 1);
+			for (int i=0; i < ndim; i++)
+				if (!SelList[i]) SelList[i] = &ones[0];
+		}
+		PyObject *rv = Py_Array_Read(Obj, St, Len,
+			(need_sel && !empty) ? &(SelList[0]) : NULL, sv,
+			(out != Py_None) ? out : NULL, true, mode);
+		return rv;
+
 	COREARRAY_CATCH_NONE
 }
 
 
-/// Get the description of a GDS node
-PY_EXPORT PyObject* gdsnDesp(PyObject *self, PyObject *args)
+/// the state of reading nodes margin by margin in lock-step
+struct COREARRAY_DLL_LOCAL TApplyIter
 {
-	int nidx;
-	Py_ssize_t ptr_int;
-	if (!PyArg_ParseTuple(args, "in", &nidx, &ptr_int))
-		return NULL;
+	vector<int> Idx;
+	vector<Py_ssize_t> Ptr;
+	vector<CdPyArrayRead*> Reader;
 
-	COREARRAY_TRY
-
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
-
-		string nm  = RawText(Obj->Name());
-		string nm2 = RawText(Obj->FullName());
-		string ste = Obj->dName();
+	~TApplyIter()
+	{
+		for (size_t i=0; i < Reader.size(); i++)
+			delete Reader[i];
+	}
+};
 
-		string tra = Obj->dTraitName();
-		if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
-			tra = RawText(((CdGDSVirtualFolder*)Obj)->LinkFileName());
+static const char *APPLY_CAPSULE_NAME = "pygds.apply";
 
-		string type = "Unknown";
-		if (dynamic_cast<CdGDSLabel*>(Obj))
-			type = "Label";
-		else if (dynamic_cast<CdGDSFolder*>(Obj))
-			type = "Folder";
-		else if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
-			type = "VFolder";
-		else if (dynamic_cast<CdGDSStreamContainer*>(Obj))
-			type = "Raw";
-		else if (dynamic_cast<CdContainer*>(Obj))
-		{
-			CdContainer* nn = static_cast<CdContainer*>(Obj);
-			C_SVType sv = nn->SVType();
-			if (COREARRAY_SV_INTEGER(sv))
-			{
-				if (GDS_Is_RFactor(Obj))
-					type = "Factor";
-				else if (GDS_Is_RLogical(Obj))
-					type = "Logical";
-				else
-					type = "Integer";
-			} else if (COREARRAY_SV_FLOAT(sv))
-				type = "Real";
-			else if (COREARRAY_SV_STRING(sv))
-				type = "String";
-		}
+static void apply_iter_free(PyObject *capsule)
+{
+	delete (TApplyIter*)PyCapsule_GetPointer(capsule, APPLY_CAPSULE_NAME);
+}
 
-		// dim, the dimension of data field
-		PyObject *dim;
-		string encoder, compress;
-		double cpratio = NaN;
-		if (dynamic_cast<CdAbstractArray*>(Obj))
-		{
-			CdAbstractArray *_Obj = (CdAbstractArray*)Obj;
+/// Initialize reading nodes margin by margin; returns an opaque iterator
+PY_EXPORT PyObject* gdsnApplyInit(PyObject *self, PyObject *args)
+{
+	PyObject *nodes, *margins;
+	const char *cvt;
+	double buffer_size;
+	if (!PyArg_ParseTuple(args, "OOsd", &nodes, &margins, &cvt, &buffer_size))
+		return NULL;
+	C_SVType sv;
+	if (cvt2sv(cvt, sv)) return NULL;
+	if (!PyList_Check(nodes) || !PyList_Check(margins))
+	{
+		PyErr_SetString(PyExc_ValueError,
+			"'nodes' and 'margins' should be lists.");
+		return NULL;
+	}
+	const Py_ssize_t n = PyList_Size(nodes);
+	if ((n <= 0) || (n != PyList_Size(margins)))
+	{
+		PyErr_SetString(PyExc_ValueError,
+			"'nodes' and 'margins' must have the same length.");
+		return NULL;
+	}
+	vector<int> margin(n);
+	for (Py_ssize_t i=0; i < n; i++)
+	{
+		margin[i] = PyInt_AsLong(PyList_GET_ITEM(margins, i));
+		if ((margin[i] == -1) && PyErr_Occurred()) return NULL;
+	}
 
-			dim = PyList_New(_Obj->DimCnt());
-			for (int i=0; i < _Obj->DimCnt(); i++)
-				PyList_SetItem(dim, i, PyInt_FromLong(_Obj->GetDLen(i)));
+	COREARRAY_TRY
 
-			if (_Obj->PipeInfo())
+		TApplyIter *It = new TApplyIter;
+		try {
+			for (Py_ssize_t i=0; i < n; i++)
 			{
-				encoder = _Obj->PipeInfo()->Coder();
-				compress = _Obj->PipeInfo()->CoderParam();
-				if (_Obj->PipeInfo()->StreamTotalIn() > 0)
+				int idx; Py_ssize_t ptr;
+				const int m = margin[i];
+				if (!PyArg_ParseTuple(PyList_GET_ITEM(nodes, i), "in", &idx, &ptr))
+					throw ErrGDSFmt("'nodes[%d]' should be a tuple (idx, ptr).", (int)i);
+				It->Idx.push_back(idx);
+				It->Ptr.push_back(ptr);
+
+				CdPyFileLock Lock;
+				CdGDSObj *obj = get_obj_lock(idx, ptr, Lock);
+				CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
+				if (Obj == NULL)
+					throw ErrGDSFmt(ERR_NO_DATA);
+				if ((m < 0) || (m >= Obj->DimCnt()))
+					throw ErrGDSFmt("'margins[%d]' is out of range.", (int)i);
+				It->Reader.push_back(new CdPyArrayRead);
+				It->Reader.back()->Init(*Obj, m, sv);
+				if (It->Reader.back()->Reader().Count() !=
+						It->Reader[0]->Reader().Count())
 				{
-					cpratio = (double)_Obj->PipeInfo()->StreamTotalOut() /
-						_Obj->PipeInfo()->StreamTotalIn();
+					delete It;
+					PyErr_SetString(PyExc_ValueError,
+						"All nodes must have the same length along their margins.");
+					return NULL;
 				}
 			}
-		} else {
-			dim = Py_None; Py_INCREF(dim);
+
+			// share the memory buffer among the nodes
+			if (It->Reader[0]->Reader().Count() > 0)
+			{
+				vector<CdArrayRead*> lst(n);
+				for (Py_ssize_t i=0; i < n; i++)
+					lst[i] = &It->Reader[i]->Reader();
+				Balance_ArrayRead_Buffer(&lst[0], n, (C_Int64)buffer_size);
+			}
 		}
-
-		// object size
-		double size = NaN;
-		if (dynamic_cast<CdContainer*>(Obj))
-		{
-			CdContainer* p = static_cast<CdContainer*>(Obj);
-			p->Synchronize();
-			size = p->GDSStreamSize();
-		} else if (dynamic_cast<CdGDSStreamContainer*>(Obj))
-		{
-			CdGDSStreamContainer *_Obj = (CdGDSStreamContainer*)Obj;
-			if (_Obj->PipeInfo())
-				size = _Obj->PipeInfo()->StreamTotalIn();
-			else
-				size = _Obj->GetSize();
+		catch (...) {
+			delete It;
+			throw;
 		}
+		return PyCapsule_New(It, APPLY_CAPSULE_NAME, apply_iter_free);
 
-		// good
-		int GoodFlag = 1;
-		if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
-		{
-			CdGDSVirtualFolder *v = (CdGDSVirtualFolder*)Obj;
-			GoodFlag = v->IsLoaded(true) ? 1 : 0;
-		} else if (dynamic_cast<CdGDSUnknown*>(Obj))
-		{
-			GoodFlag = 0;
-		}
+	COREARRAY_CATCH_NONE
+}
 
-		// hidden
-		int hidden_flag = Obj->GetHidden() ||
-			Obj->Attribute().HasName(UTF8Text("R.invisible"));
 
-		// message
-		string msg;
-		if (dynamic_cast<CdGDSVirtualFolder*>(Obj))
+/// Read the next slices of the nodes; returns a tuple of numpy arrays which
+/// are reused by the next call, or None if all slices have been read
+PY_EXPORT PyObject* gdsnApplyNext(PyObject *self, PyObject *args)
+{
+	PyObject *capsule;
+	if (!PyArg_ParseTuple(args, "O", &capsule))
+		return NULL;
+	TApplyIter *It = (TApplyIter*)PyCapsule_GetPointer(capsule,
+		APPLY_CAPSULE_NAME);
+	if (!It) return NULL;
+
+	COREARRAY_TRY
+
+		const size_t n = It->Reader.size();
+		if (It->Reader[0]->Reader().Eof())
+			Py_RETURN_NONE;
+		for (size_t i=0; i < n; i++)
 		{
-			CdGDSVirtualFolder *v = (CdGDSVirtualFolder*)Obj;
-			v->IsLoaded(true);
-			msg = v->ErrMsg().c_str();
+			CdPyFileLock Lock;
+			CdGDSObj *obj = get_obj_lock(It->Idx[i], It->Ptr[i], Lock);
+			if (obj != &It->Reader[i]->Reader().Object())
+				throw ErrGDSFmt("Invalid GDS node object.");
+			It->Reader[i]->Read();
 		}
-
-		return Py_BuildValue(
-			"{s:s,s:s,s:s,s:s,s:s,s:N,s:s,s:s,s:d,s:d,s:N,s:N,s:s}",
-			"name",     nm.c_str(),
-			"fullname", nm2.c_str(),
-			"storage",  ste.c_str(),
-			"trait",    tra.c_str(),
-			"type",     type.c_str(),
-			"dim",      dim,
-			"encoder",  encoder.c_str(),
-			"compress", compress.c_str(),
-			"cpratio",  cpratio,
-			"size",     size,
-			"good",     PyBool_FromLong(GoodFlag),
-			"hidden",   PyBool_FromLong(hidden_flag),
-			"message",  msg.c_str()
-		);
+		PyObject *rv = PyTuple_New(n);
+		for (size_t i=0; i < n; i++)
+		{
+			PyObject *buf = It->Reader[i]->Buffer();
+			Py_INCREF(buf);
+			PyTuple_SET_ITEM(rv, i, buf);
+		}
+		return rv;
 
 	COREARRAY_CATCH_NONE
 }
 
 
 
-// ----------------------------------------------------------------------------
-// Data Operations
-// ----------------------------------------------------------------------------
+/// the iterator of chunks prefetched by a background thread
+static const char *CHUNK_CAPSULE_NAME = "pygds.chunks";
 
-static bool cvt2sv(const char *cvt, C_SVType &sv)
+/// delete the freed chunk iterators whose threads have exited
+static void chunk_orphan_reap()
 {
-	if (strcmp(cvt, "") == 0)
-		sv = svCustom;
-	else if (strcmp(cvt, "int8") == 0)
-		sv = svInt8;
-	else if (strcmp(cvt, "uint8") == 0)
-		sv = svUInt8;
-	else if (strcmp(cvt, "int16") == 0)
-		sv = svInt16;
-	else if (strcmp(cvt, "uint16") == 0)
-		sv = svUInt16;
-	else if (strcmp(cvt, "int32") == 0)
-		sv = svInt32;
-	else if (strcmp(cvt, "uint32") == 0)
-		sv = svUInt32;
-	else if (strcmp(cvt, "int64") == 0)
-		sv = svInt64;
-	else if (strcmp(cvt, "uint64") == 0)
-		sv = svUInt64;
-	else if (strcmp(cvt, "float32") == 0)
-		sv = svFloat32;
-	else if (strcmp(cvt, "float64") == 0)
-		sv = svFloat64;
-	else if (strcmp(cvt, "utf8") == 0)
-		sv = svStrUTF8;
-	else if (strcmp(cvt, "utf16") == 0)
-		sv = svStrUTF16;
-	else {
-		PyErr_SetString(PyExc_ValueError, "Invalid 'cvt'.");
-		return true;
+	size_t n = 0;
+	for (size_t i=0; i < chunk_orphan_list.size(); i++)
+	{
+		CdChunkPrefetch *p = chunk_orphan_list[i];
+		if (p->Stop())
+			delete p;
+		else
+			chunk_orphan_list[n++] = p;
 	}
-	return false;
+	chunk_orphan_list.resize(n);
 }
 
-/// Read data from a GDS node
-PY_EXPORT PyObject* gdsnRead(PyObject *self, PyObject *args)
+static void chunk_iter_free(PyObject *capsule)
 {
-	int nidx;
-	Py_ssize_t ptr_int;
-	PyObject *start, *count;
+	CdChunkPrefetch *p = (CdChunkPrefetch*)PyCapsule_GetPointer(capsule,
+		CHUNK_CAPSULE_NAME);
+	chunk_iter_list.erase(p);
+	// the capsule might be freed with the file lock held, and the thread
+	// might be waiting for the lock
+	if (p->Stop())
+		delete p;
+	else
+		chunk_orphan_list.push_back(p);
+	chunk_orphan_reap();
+}
+
+/// Initialize reading chunks along an axis, returns an opaque iterator, or
+/// None if the data are not numeric
+PY_EXPORT PyObject* gdsnIterChunksInit(PyObject *self, PyObject *args)
+{
+	int nidx; Py_ssize_t ptr_int;
+	int axis, size, prefetch;
 	const char *cvt;
-	if (!PyArg_ParseTuple(args, "inOOs", &nidx, &ptr_int, &start, &count, &cvt))
+	if (!PyArg_ParseTuple(args, "iniiis", &nidx, &ptr_int, &axis, &size,
+			&prefetch, &cvt))
 		return NULL;
-
-	// check the argument 'cvt'
 	C_SVType sv;
 	if (cvt2sv(cvt, sv)) return NULL;
-
-	// check the argument 'start'
-	CdAbstractArray::TArrayDim dm_st;
-	int dm_st_n = 0;
-	if (PyList_Check(start))
-	{
-		dm_st_n = PyList_Size(start);
-		for(int i=0; i < dm_st_n; i++)
-			dm_st[i] = PyInt_AsLong(PyList_GetItem(start, i));
-	} else if (start != Py_None)
+	if ((size < 1) || (prefetch < 1))
 	{
-		PyErr_SetString(PyExc_ValueError, "'start' should be None or a list.");
+		PyErr_SetString(PyExc_ValueError,
+			"'size' and 'prefetch' should be greater than zero.");
 		return NULL;
 	}
 
-	// check the argument 'count'
-	CdAbstractArray::TArrayDim dm_cnt;
-	int dm_cnt_n = 0;
-	if (PyList_Check(count))
-	{
-		dm_cnt_n = PyList_Size(count);
-		for(int i=0; i < dm_cnt_n; i++)
-			dm_cnt[i] = PyInt_AsLong(PyList_GetItem(count, i));
-	} else if (count != Py_None)
-	{
-		PyErr_SetString(PyExc_ValueError, "'count' should be None or a list.");
+	COREARRAY_TRY
+
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
+		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
+		if (Obj == NULL)
+			throw ErrGDSFmt(ERR_NO_DATA);
+		if ((axis < 0) || (axis >= Obj->DimCnt()))
+			throw ErrGDSFmt("'axis' is out of range.");
+
+		chunk_orphan_reap();
+		CdChunkPrefetch *p = new CdChunkPrefetch;
+		try {
+			if (!p->Init(*Obj, GetObjFileLock(Obj), axis, size, prefetch, sv))
+			{
+				delete p;
+				Py_RETURN_NONE;
+			}
+		}
+		catch (...) {
+			delete p;
+			throw;
+		}
+		chunk_iter_list.insert(p);
+		return PyCapsule_New(p, CHUNK_CAPSULE_NAME, chunk_iter_free);
+
+	COREARRAY_CATCH_NONE
+}
+
+
+/// Return the next chunk, which is a numpy array reused after the chunks
+/// prefetched, or None if all chunks have been returned
+PY_EXPORT PyObject* gdsnIterChunksNext(PyObject *self, PyObject *args)
+{
+	PyObject *capsule;
+	if (!PyArg_ParseTuple(args, "O", &capsule))
 		return NULL;
-	}
+	CdChunkPrefetch *p = (CdChunkPrefetch*)PyCapsule_GetPointer(capsule,
+		CHUNK_CAPSULE_NAME);
+	if (!p) return NULL;
 
-	if ((dm_st_n==0 && dm_cnt_n>0) || (dm_st_n>0 && dm_cnt_n==0))
+	COREARRAY_TRY
+		PyObject *rv = p->Next();
+		if (rv) return rv;
+	COREARRAY_CATCH_NONE
+}
+
+
+
+// defined in PyCoreArray.cpp
+extern int Py_Array_Type(PdAbstractArray Obj, C_SVType &SV, bool &is_factor);
+
+/// the size of memory buffer for computing digests
+static const size_t DIGEST_BUFFER_SIZE = 4*1024*1024;
+
+/// the number of bytes of a numeric element
+static size_t sv_size(C_SVType sv)
+{
+	switch (sv)
 	{
-		PyErr_SetString(PyExc_ValueError, "'start' and 'count' should be both None.");
-		return NULL;
+		case svInt8:  case svUInt8:   return 1;
+		case svInt16: case svUInt16:  return 2;
+		case svInt32: case svUInt32: case svFloat32:  return 4;
+		case svInt64: case svUInt64: case svFloat64:  return 8;
+		default:
+			throw ErrGDSFmt("Data type is not supported.");
 	}
+}
+
+/// XXH64 state, freed automatically
+class COREARRAY_DLL_LOCAL CdXXH64
+{
+public:
+	CdXXH64() { fState = XXH64_createState(); XXH64_reset(fState, 0); }
+	~CdXXH64() { XXH64_freeState(fState); }
+	XXH64_state_t *fState;
+};
+
+/// Compute a digest of the data in a node, by streaming it in storage order
+/// through a bounded buffer (little-endian for numeric data, and the UTF-8
+/// bytes for strings and factor levels); returns the XXH64 hex string if
+/// 'hasher' is None, otherwise calls 'hasher.update()' on each block
+PY_EXPORT PyObject* gdsnDigest(PyObject *self, PyObject *args)
+{
+	int nidx;
+	Py_ssize_t ptr_int;
+	PyObject *hasher;
+	if (!PyArg_ParseTuple(args, "inO", &nidx, &ptr_int, &hasher))
+		return NULL;
 
 	COREARRAY_TRY
 
-		CdGDSObj *obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
 		if (Obj == NULL)
 			throw ErrGDSFmt(ERR_NO_DATA);
 
-		C_Int32 *pDS=NULL, *pDL=NULL;
-		if (dm_st_n>0 && dm_cnt_n>0)
-		{
-			int Len = Obj->DimCnt();
-			CdAbstractArray::TArrayDim DCnt;
-			Obj->GetDim(DCnt);
+		C_SVType sv = svCustom;
+		bool is_factor;
+		Py_Array_Type(Obj, sv, is_factor);
+		const bool is_str = is_factor || (sv == svStrUTF8);
 
-			if (dm_st_n != Len)
-				throw ErrGDSFmt("The length of 'start' is invalid.");
-			for (int i=0; i < Len; i++)
+		// factor levels
+		vector<UTF8String> levels;
+		if (is_factor)
+		{
+			CdAny &attr = Obj->Attribute()[UTF8Text("R.levels")];
+			if (attr.IsString())
+				levels.push_back(attr.GetStr8());
+			else if (attr.IsArray())
 			{
-				if ((dm_st[i] < 0) || (dm_st[i] >= DCnt[i]))
-					throw ErrGDSFmt("'start[%d]=%d' is invalid.", i, dm_st[i]);
+				CdAny *p = attr.GetArray();
+				for (C_UInt32 i=0; i < attr.GetArrayLength(); i++, p++)
+					levels.push_back(p->GetStr8());
 			}
-			pDS = dm_st;
+		}
 
-			if (dm_cnt_n != Len)
-				throw ErrGDSFmt("The length of 'count' is invalid.");
-			for (int i=0; i < Len; i++)
+		// the number of elements in a block
+		const size_t esize = is_factor ? sizeof(C_Int32) :
+			(is_str ? 256 : sv_size(sv));
+		const ssize_t nblock = DIGEST_BUFFER_SIZE / esize;
+
+		vector<C_UInt8> buffer;
+		vector<UTF8String> strbuf;
+		string bytes;
+		if (!is_str || is_factor)
+			buffer.resize(nblock * esize);
+		if (is_str && !is_factor)
+			strbuf.resize(nblock);
+
+		CdXXH64 xxh;
+		CdIterator it = Obj->IterBegin();
+		for (C_Int64 n=Obj->TotalCount(); n > 0; )
+		{
+			ssize_t cnt = (n >= nblock) ? nblock : n;
+			const void *ptr;
+			size_t size;
+			{
+				CdPyNoGIL NoGIL;
+				if (!is_str)
+				{
+					it.ReadData(&buffer[0], cnt, sv);
+					ptr = &buffer[0]; size = cnt * esize;
+				} else {
+					bytes.clear();
+					if (is_factor)
+					{
+						C_Int32 *p = (C_Int32*)&buffer[0];
+						it.ReadData(p, cnt, svInt32);
+						for (ssize_t i=0; i < cnt; i++, p++)
+						{
+							if ((0 < *p) && (*p <= (C_Int32)levels.size()))
+								bytes.append(levels[*p - 1]);
+						}
+					} else {
+						it.ReadData(&strbuf[0], cnt, svStrUTF8);
+						for (ssize_t i=0; i < cnt; i++)
+							bytes.append(strbuf[i]);
+					}
+					ptr = bytes.data(); size = bytes.size();
+				}
+				if (hasher == Py_None)
+					XXH64_update(xxh.fState, ptr, size);
+			}
+			if (hasher != Py_None)
 			{
-				int &v = dm_cnt[i];
-				if (v == -1)
-					v = DCnt[i] - dm_st[i];
-				if ((v <= 0) || ((dm_st[i]+v) > DCnt[i]))
-					throw ErrGDSFmt("'count[%d]=%d' is invalid.", i, v);
+				PyObject *mv = PyMemoryView_FromMemory((char*)ptr, size,
+					PyBUF_READ);
+				if (!mv) return NULL;
+				PyObject *rv = PyObject_CallMethod(hasher, "update", "O", mv);
+				Py_DECREF(mv);
+				if (!rv) return NULL;
+				Py_DECREF(rv);
 			}
-			pDL = dm_cnt;
+			n -= cnt;
 		}
 
-		PyObject *rv = GDS_Py_Array_Read(Obj, pDS, pDL, NULL, sv);
-		return rv;
+		if (hasher == Py_None)
+		{
+			char s[32];
+			FmtText(s, sizeof(s), "%016llx",
+				(unsigned long long)XXH64_digest(xxh.fState));
+			return PYSTR_SET(s);
+		}
 
 	COREARRAY_CATCH_NONE
 }
 
 
-/// Read data from a GDS node
-PY_EXPORT PyObject* gdsnRead2(PyObject *self, PyObject *args)
+
+/// Summarize the data in a node; returns a dict {min, max, mean, num_na, n}
+/// for numeric data, otherwise {n}
+PY_EXPORT PyObject* gdsnSummary(PyObject *self, PyObject *args)
 {
 	int nidx;
 	Py_ssize_t ptr_int;
-	PyObject *selection;
-	const char *cvt;
-	if (!PyArg_ParseTuple(args, "inOs", &nidx, &ptr_int, &selection, &cvt))
-		return NULL;
-
-	// check the argument 'cvt'
-	C_SVType sv;
-	if (cvt2sv(cvt, sv)) return NULL;
-
-	// check the argument 'sel'
-	if (!PyList_Check(selection))
-	{
-		PyErr_SetString(PyExc_ValueError, "'sel' should be a list.");
+	int nthread;
+	if (!PyArg_ParseTuple(args, "ini", &nidx, &ptr_int, &nthread))
 		return NULL;
-	}
 
+	C_Int64 n = 0;
+	bool numeric = false;
+	TSummary s;
 	COREARRAY_TRY
 
-		CdGDSObj *obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
 		if (Obj == NULL)
 			throw ErrGDSFmt(ERR_NO_DATA);
-		if (PyList_Size(selection) != Obj->DimCnt())
-			throw ErrGDSFmt("The dimension of 'sel' is not correct.");
-
-		// set the selection
-		vector< vector<C_BOOL> > tmpSel(Obj->DimCnt());
-		vector<C_BOOL*> SelList(Obj->DimCnt());
 
-		for (size_t i=0; i < SelList.size(); i++)
+		C_SVType sv = svCustom;
+		bool is_factor;
+		Py_Array_Type(Obj, sv, is_factor);
+		n = Obj->TotalCount();
+		numeric = !is_factor && COREARRAY_SV_NUMERIC(sv);
+		if (numeric)
 		{
-			PyObject *sel = PyList_GET_ITEM(selection, i);
-			if (sel == Py_None)
-			{
-				tmpSel[i].resize(Obj->GetDLen(i), 1);
-				SelList[i] = &(tmpSel[i][0]);
-			} else {
-				extern C_BOOL *numpy_get_bool(PyObject *obj, size_t &num);
-				size_t n = 0;
-				C_BOOL *bs = numpy_get_bool(sel, n);
-				if (bs == NULL)
-					throw ErrGDSFmt("'sel[%d]' should be a bool numpy vector or None.", (int)i);
-				if (n != (size_t)Obj->GetDLen(i))
-					throw ErrGDSFmt("The length of 'sel[%d]' is not correct.", (int)i);
-				SelList[i] = bs;
-			}
+			if (nthread < 1) nthread = 1;
+			CdSummaryKernel Kernel(*Obj, sv, GDS_Is_RLogical(Obj), nthread);
+			CdPyNoGIL NoGIL;
+			Kernel.Run();
+			s = Kernel.Result;
 		}
 
-		// read data
-		PyObject *rv = GDS_Py_Array_Read(Obj, NULL, NULL, &(SelList[0]), sv);
-		return rv;
+	COREARRAY_CATCH
 
-	COREARRAY_CATCH_NONE
+	if (numeric)
+	{
+		double mean = (s.NumValid > 0) ? (s.Sum / s.NumValid) : NaN;
+		return Py_BuildValue("{s:d,s:d,s:d,s:L,s:L}", "min", s.Min,
+			"max", s.Max, "mean", mean, "num_na", (long long)(n - s.NumValid),
+			"n", (long long)n);
+	} else
+		return Py_BuildValue("{s:L}", "n", (long long)n);
 }
 
 
@@ -950,7 +2844,8 @@ PY_EXPORT PyObject* gdsnGetAttr(PyObject *self, PyObject *args)
 		return NULL;
 
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
 		if (Obj->Attribute().Count() > 0)
 		{
 			const size_t n = Obj->Attribute().Count();
@@ -974,9 +2869,6 @@ PY_EXPORT PyObject* gdsnGetAttr(PyObject *self, PyObject *args)
 // Node creation, deletion and data writing
 // ----------------------------------------------------------------------------
 
-// defined in PyCoreArray.cpp: contiguous numpy buffer + element count + sv type
-extern void *numpy_get_data(PyObject *obj, size_t &num, int &sv_out);
-
 
 /// map a storage name through the class-name table
 static const char *map_storage(const char *stm)
@@ -987,7 +2879,8 @@ static const char *map_storage(const char *stm)
 }
 
 
-/// append numeric (numpy array) or string (python list) data to an array node
+/// append numeric (numpy array) or string (python list) data to an array node,
+/// the GIL is released when encoding (the caller should hold the file lock)
 static void append_value(CdAbstractArray *Obj, PyObject *val)
 {
 	if (PyList_Check(val))
@@ -1004,7 +2897,10 @@ static void append_value(CdAbstractArray *Obj, PyObject *val)
 				throw ErrGDSFmt("'val[%d]' should be a string.", (int)i);
 		}
 		if (n > 0)
+		{
+			CdPyNoGIL NoGIL;
 			Obj->Append(&buf[0], n, svStrUTF8);
+		}
 	} else {
 		size_t num = 0; int sv = -1;
 		void *p = numpy_get_data(val, num, sv);
@@ -1012,7 +2908,10 @@ static void append_value(CdAbstractArray *Obj, PyObject *val)
 			throw ErrGDSFmt("'val' should be a C-contiguous numpy array of a "
 				"supported numeric dtype, or a list of strings.");
 		if (num > 0)
+		{
+			CdPyNoGIL NoGIL;
 			Obj->Append(p, num, (C_SVType)sv);
+		}
 	}
 }
 
@@ -1032,7 +2931,8 @@ PY_EXPORT PyObject* gdsnAddNode(PyObject *self, PyObject *args)
 	int idx; Py_ssize_t ptr;
 	COREARRAY_TRY
 
-		CdGDSObj *obj = get_obj(pidx, pptr);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(pidx, pptr, Lock);
 		if (!dynamic_cast<CdGDSAbsFolder*>(obj))
 			throw ErrGDSFmt(ERR_NOT_FOLDER);
 		CdGDSAbsFolder &Dir = *((CdGDSAbsFolder*)obj);
@@ -1044,7 +2944,7 @@ PY_EXPORT PyObject* gdsnAddNode(PyObject *self, PyObject *args)
 			if (tmp)
 			{
 				IdxReplace = Dir.IndexObj(tmp);
-				GDS_Node_Delete(tmp, true);
+				node_delete(tmp, true);
 			}
 		}
 
@@ -1129,7 +3029,8 @@ PY_EXPORT PyObject* gdsnAddFolder(PyObject *self, PyObject *args)
 	int idx; Py_ssize_t ptr;
 	COREARRAY_TRY
 
-		CdGDSObj *obj = get_obj(pidx, pptr);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(pidx, pptr, Lock);
 		if (!dynamic_cast<CdGDSAbsFolder*>(obj))
 			throw ErrGDSFmt(ERR_NOT_FOLDER);
 		CdGDSAbsFolder &Dir = *((CdGDSAbsFolder*)obj);
@@ -1141,7 +3042,7 @@ PY_EXPORT PyObject* gdsnAddFolder(PyObject *self, PyObject *args)
 			if (tmp)
 			{
 				IdxReplace = Dir.IndexObj(tmp);
-				GDS_Node_Delete(tmp, true);
+				node_delete(tmp, true);
 			}
 		}
 
@@ -1178,15 +3079,9 @@ PY_EXPORT PyObject* gdsnDelete(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "in" BSTR, &nidx, &ptr_int, &force))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
-		// drop it from the tracking list as well
-		map<PdGDSObj, int>::iterator it = PKG_GDSObj_Map.find(Obj);
-		if (it != PKG_GDSObj_Map.end())
-		{
-			PKG_GDSObj_List[it->second] = NULL;
-			PKG_GDSObj_Map.erase(it);
-		}
-		GDS_Node_Delete(Obj, force);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
+		node_delete(Obj, force);
 	COREARRAY_CATCH_NONE
 }
 
@@ -1198,7 +3093,8 @@ PY_EXPORT PyObject* gdsnAppend(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "inO", &nidx, &ptr_int, &val))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
 		if (Obj == NULL) throw ErrGDSFmt(ERR_NO_DATA);
 		append_value(Obj, val);
@@ -1219,7 +3115,8 @@ PY_EXPORT PyObject* gdsnWriteAll(PyObject *self, PyObject *args)
 		return NULL;
 	}
 	COREARRAY_TRY
-		CdGDSObj *obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
 		if (Obj == NULL) throw ErrGDSFmt(ERR_NO_DATA);
 
@@ -1266,7 +3163,8 @@ PY_EXPORT PyObject* gdsnWrite(PyObject *self, PyObject *args)
 	}
 
 	COREARRAY_TRY
-		CdGDSObj *obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
 		if (Obj == NULL) throw ErrGDSFmt(ERR_NO_DATA);
 
@@ -1284,12 +3182,14 @@ PY_EXPORT PyObject* gdsnWrite(PyObject *self, PyObject *args)
 				PyObject *s = PyList_GetItem(val, i);
 				if (PYSTR_IS(s)) buf[i] = UTF8Text(PYSTR_CHAR(s));
 			}
+			CdPyNoGIL NoGIL;
 			Obj->WriteData(dm_st, dm_cnt, n>0 ? &buf[0] : NULL, svStrUTF8);
 		} else {
 			void *p = numpy_get_data(val, num, sv);
 			if (p == NULL)
 				throw ErrGDSFmt("'val' should be a C-contiguous numpy array or "
 					"a list of strings.");
+			CdPyNoGIL NoGIL;
 			Obj->WriteData(dm_st, dm_cnt, p, (C_SVType)sv);
 		}
 	COREARRAY_CATCH_NONE
@@ -1308,7 +3208,8 @@ PY_EXPORT PyObject* gdsnSetDim(PyObject *self, PyObject *args)
 		return NULL;
 	}
 	COREARRAY_TRY
-		CdGDSObj *obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdAbstractArray *Obj = dynamic_cast<CdAbstractArray*>(obj);
 		if (Obj == NULL) throw ErrGDSFmt(ERR_NO_DATA);
 
@@ -1340,7 +3241,8 @@ PY_EXPORT PyObject* gdsnCompress(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "ins", &nidx, &ptr_int, &cp))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
 		if (dynamic_cast<CdContainer*>(Obj))
 			static_cast<CdContainer*>(Obj)->SetPackedMode(cp);
 		else if (dynamic_cast<CdGDSStreamContainer*>(Obj))
@@ -1358,7 +3260,8 @@ PY_EXPORT PyObject* gdsnReadMode(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "in", &nidx, &ptr_int))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
 		if (dynamic_cast<CdContainer*>(Obj))
 			static_cast<CdContainer*>(Obj)->CloseWriter();
 	COREARRAY_CATCH_NONE
@@ -1373,7 +3276,8 @@ PY_EXPORT PyObject* gdsnPutAttr(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "insO", &nidx, &ptr_int, &name, &val))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdAny *p;
 		if (Obj->Attribute().HasName(UTF8Text(name)))
 		{
@@ -1426,7 +3330,8 @@ PY_EXPORT PyObject* gdsnDeleteAttr(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "ins", &nidx, &ptr_int, &name))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
 		Obj->Attribute().Delete(UTF8Text(name));
 	COREARRAY_CATCH_NONE
 }
@@ -1440,7 +3345,8 @@ PY_EXPORT PyObject* gdsnExist(PyObject *self, PyObject *args)
 		return NULL;
 	int flag = 0;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
 		CdGDSAbsFolder *Dir = dynamic_cast<CdGDSAbsFolder*>(Obj);
 		if (!Dir) throw ErrGDSFmt(ERR_NOT_FOLDER);
 		flag = Dir->PathEx(UTF8Text(path)) ? 1 : 0;
@@ -1457,7 +3363,8 @@ PY_EXPORT PyObject* gdsnIsSparse(PyObject *self, PyObject *args)
 		return NULL;
 	int flag = 0;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr_int);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr_int, Lock);
 		flag = dynamic_cast<CdSpExStruct*>(Obj) ? 1 : 0;
 	COREARRAY_CATCH
 	return PyBool_FromLong(flag);
@@ -1476,8 +3383,9 @@ PY_EXPORT PyObject* gdsnMoveTo(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "inins", &nidx, &ptr, &lidx, &lptr, &relpos))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr);
-		CdGDSObj *LObj = get_obj(lidx, lptr);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj, *LObj;
+		get_obj2_lock(nidx, ptr, lidx, lptr, Obj, LObj, Lock);
 
 		if (strcmp(relpos, "into") == 0)
 		{
@@ -1503,11 +3411,11 @@ PY_EXPORT PyObject* gdsnMoveTo(PyObject *self, PyObject *args)
 						Obj->Folder()->MoveTo(i_Obj, i_LObj+1);
 					if (strcmp(relpos, "replace") == 0)
 					{
-						GDS_Node_Delete(LObj, true);
+						node_delete(LObj, true);
 					} else if (strcmp(relpos, "replace+rename") == 0)
 					{
 						UTF8String nm(LObj->Name());
-						GDS_Node_Delete(LObj, true);
+						node_delete(LObj, true);
 						Obj->SetName(nm);
 					}
 				} else if (strcmp(relpos, "before") == 0)
@@ -1533,8 +3441,9 @@ PY_EXPORT PyObject* gdsnCopyTo(PyObject *self, PyObject *args)
 		return NULL;
 	int idx; Py_ssize_t ptr;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(fidx, fptr);
-		CdGDSObj *SObj = get_obj(sidx, sptr);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj, *SObj;
+		get_obj2_lock(fidx, fptr, sidx, sptr, Obj, SObj, Lock);
 		if (!dynamic_cast<CdGDSAbsFolder*>(Obj))
 			throw ErrGDSFmt("'node' should be a folder.");
 		if (dynamic_cast<CdGDSAbsFolder*>(SObj) &&
@@ -1559,8 +3468,9 @@ PY_EXPORT PyObject* gdsnAssign(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "inin", &didx, &dptr, &sidx, &sptr))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Dst = get_obj(didx, dptr);
-		CdGDSObj *Src = get_obj(sidx, sptr);
+		CdPyFileLock Lock;
+		CdGDSObj *Dst, *Src;
+		get_obj2_lock(didx, dptr, sidx, sptr, Dst, Src, Lock);
 		Dst->Assign(*Src, true);
 	COREARRAY_CATCH_NONE
 }
@@ -1573,9 +3483,13 @@ PY_EXPORT PyObject* gdsnCache(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "in", &nidx, &ptr))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr, Lock);
 		if (dynamic_cast<CdContainer*>(Obj))
+		{
+			CdPyNoGIL NoGIL;
 			static_cast<CdContainer*>(Obj)->Caching();
+		}
 	COREARRAY_CATCH_NONE
 }
 
@@ -1587,9 +3501,17 @@ PY_EXPORT PyObject* gdsnUnload(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "in", &nidx, &ptr))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr, Lock);
 		if (Obj->Folder())
+		{
+			if (!chunk_iter_list.empty())
+				chunk_iter_cancel(GetObjFileLock(Obj), Obj);
 			Obj->Folder()->UnloadObj(Obj);
+			// the handles of the node are no longer valid (a folder can not
+			// be unloaded, so there are no child handles)
+			PKG_GDSObj_Table.Remove(Obj);
+		}
 	COREARRAY_CATCH_NONE
 }
 
@@ -1605,7 +3527,8 @@ PY_EXPORT PyObject* gdsnAddFile(PyObject *self, PyObject *args)
 		return NULL;
 	int idx; Py_ssize_t ptr;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(fidx, fptr);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(fidx, fptr, Lock);
 		if (!dynamic_cast<CdGDSAbsFolder*>(Obj))
 			throw ErrGDSFmt(ERR_NOT_FOLDER);
 		CdGDSAbsFolder &Dir = *((CdGDSAbsFolder*)Obj);
@@ -1614,7 +3537,7 @@ PY_EXPORT PyObject* gdsnAddFile(PyObject *self, PyObject *args)
 		if (replace)
 		{
 			CdGDSObj *tmp = Dir.ObjItemEx(UTF8Text(name));
-			if (tmp) { IdxReplace = Dir.IndexObj(tmp); GDS_Node_Delete(tmp, true); }
+			if (tmp) { IdxReplace = Dir.IndexObj(tmp); node_delete(tmp, true); }
 		}
 
 		TdAutoRef<CdBufStream> file(new CdBufStream(
@@ -1644,7 +3567,8 @@ PY_EXPORT PyObject* gdsnGetFile(PyObject *self, PyObject *args)
 	if (!PyArg_ParseTuple(args, "ins", &nidx, &ptr, &out_fn))
 		return NULL;
 	COREARRAY_TRY
-		CdGDSObj *Obj = get_obj(nidx, ptr);
+		CdPyFileLock Lock;
+		CdGDSObj *Obj = get_obj_lock(nidx, ptr, Lock);
 		if (!dynamic_cast<CdGDSStreamContainer*>(Obj))
 			throw ErrGDSFmt("It is not a stream container!");
 		CdGDSStreamContainer *_Obj = static_cast<CdGDSStreamContainer*>(Obj);
@@ -1655,6 +3579,87 @@ PY_EXPORT PyObject* gdsnGetFile(PyObject *self, PyObject *args)
 }
 
 
+/// Decode all compressed blocks and compare with the checksums; returns dict
+/// {nodes, blocks, checksums, skipped, errors}
+PY_EXPORT PyObject* gdsVerify(PyObject *self, PyObject *args)
+{
+	int file_id, nthread;
+	if (!PyArg_ParseTuple(args, "ii", &file_id, &nthread))
+		return NULL;
+
+	PyObject *rv = NULL;
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		Lock.Lock(GetFileLock(file_id));
+		CdVerifyKernel Kernel(*GDS_ID2File(file_id), nthread);
+		{
+			CdPyNoGIL NoGIL;
+			Kernel.Run();
+		}
+		PyObject *err = PyList_New(Kernel.Error.size());
+		for (size_t i=0; i < Kernel.Error.size(); i++)
+		{
+			TVerifyError &E = Kernel.Error[i];
+			PyList_SET_ITEM(err, i, Py_BuildValue("(sis)", E.Name.c_str(),
+				(int)E.Block, E.Message.c_str()));
+		}
+		rv = Py_BuildValue("{s:n,s:L,s:L,s:L,s:N}", "nodes",
+			(Py_ssize_t)Kernel.NumNode(), "blocks", (long long)Kernel.NumBlock,
+			"checksums", (long long)Kernel.NumChecksum,
+			"skipped", (long long)Kernel.NumSkip, "errors", err);
+	COREARRAY_CATCH
+	return rv;
+}
+
+
+/// Copy a GDS file to a new file, and recompress the nodes listed in 'filter'
+/// (all if None) by several threads; returns the number of nodes recompressed
+PY_EXPORT PyObject* gdsRecompress(PyObject *self, PyObject *args)
+{
+	int file_id, nthread;
+	const char *fn, *mode;
+	PyObject *filter;
+	if (!PyArg_ParseTuple(args, "issiO", &file_id, &fn, &mode, &nthread,
+			&filter))
+		return NULL;
+
+	set<string> names;
+	if (filter != Py_None)
+	{
+		if (!PyList_Check(filter))
+		{
+			PyErr_SetString(PyExc_ValueError, "'filter' should be a list.");
+			return NULL;
+		}
+		for (Py_ssize_t i=0; i < PyList_GET_SIZE(filter); i++)
+		{
+			const char *s = PyUnicode_AsUTF8(PyList_GET_ITEM(filter, i));
+			if (!s) return NULL;
+			names.insert(s);
+		}
+	}
+
+	C_Int64 n = 0;
+	vector<string> skipped;
+	COREARRAY_TRY
+		CdPyFileLock Lock;
+		Lock.Lock(GetFileLock(file_id));
+		CdGDSFile *file = GDS_ID2File(file_id);
+		CdPyNoGIL NoGIL;
+		CdGDSFile dst(fn, CdGDSFile::dmCreate);
+		CdRecompressKernel Kernel(*file, dst, mode,
+			(filter != Py_None) ? &names : NULL, nthread);
+		Kernel.Run();
+		n = Kernel.NumNode;
+		skipped.swap(Kernel.Skipped);
+	COREARRAY_CATCH
+	PyObject *lst = PyList_New(skipped.size());
+	for (size_t i=0; i < skipped.size(); i++)
+		PyList_SET_ITEM(lst, i, PyUnicode_FromString(skipped[i].c_str()));
+	return Py_BuildValue("(LN)", (long long)n, lst);
+}
+
+
 /// File fragment diagnosis; returns dict {num_fragment, size}
 PY_EXPORT PyObject* gdsDiagnosis(PyObject *self, PyObject *args)
 {
@@ -1663,6 +3668,8 @@ PY_EXPORT PyObject* gdsDiagnosis(PyObject *self, PyObject *args)
 		return NULL;
 	int nfrag = 0; double sz = NaN;
 	COREARRAY_TRY
+		CdPyFileLock Lock;
+		Lock.Lock(GetFileLock(file_id));
 		CdGDSFile *file = GDS_ID2File(file_id);
 		nfrag = file->GetNumOfFragment();
 		sz = file->GetFileSize();
@@ -1685,6 +3692,13 @@ static PyMethodDef module_methods[] = {
 	{ "close_gds", (PyCFunction)gdsCloseGDS, METH_VARARGS, NULL },
 	{ "sync_gds", (PyCFunction)gdsSyncGDS, METH_VARARGS, NULL },
 	{ "filesize", (PyCFunction)gdsFileSize, METH_VARARGS, NULL },
+	{ "set_read_ahead", (PyCFunction)gdsSetReadAhead, METH_VARARGS, NULL },
+	{ "set_parallel_compress", (PyCFunction)gdsSetParallelCompress, METH_VARARGS, NULL },
+	{ "set_lzma_threads", (PyCFunction)gdsSetLZMAThreads, METH_VARARGS, NULL },
+	{ "set_block_cache", (PyCFunction)gdsSetBlockCache, METH_VARARGS, NULL },
+	{ "block_cache_info", (PyCFunction)gdsBlockCacheInfo, METH_VARARGS, NULL },
+	{ "set_checksum", (PyCFunction)gdsSetChecksum, METH_VARARGS, NULL },
+	{ "set_mmap", (PyCFunction)gdsSetMemoryMap, METH_VARARGS, NULL },
 	{ "tidy_up", (PyCFunction)gdsTidyUp, METH_VARARGS, NULL },
 	{ "root_gds", (PyCFunction)gdsRoot, METH_VARARGS, NULL },
 	{ "index_gds", (PyCFunction)gdsIndex, METH_VARARGS, NULL },
@@ -1703,7 +3717,14 @@ static PyMethodDef module_methods[] = {
 
 	// data operations
 	{ "read_gdsn", (PyCFunction)gdsnRead, METH_VARARGS, NULL },
+	{ "read_many_gdsn", (PyCFunction)gdsnReadMany, METH_VARARGS, NULL },
 	{ "read2_gdsn", (PyCFunction)gdsnRead2, METH_VARARGS, NULL },
+	{ "apply_init_gdsn", (PyCFunction)gdsnApplyInit, METH_VARARGS, NULL },
+	{ "apply_next_gdsn", (PyCFunction)gdsnApplyNext, METH_VARARGS, NULL },
+	{ "iter_chunks_init_gdsn", (PyCFunction)gdsnIterChunksInit, METH_VARARGS, NULL },
+	{ "iter_chunks_next_gdsn", (PyCFunction)gdsnIterChunksNext, METH_VARARGS, NULL },
+	{ "digest_gdsn", (PyCFunction)gdsnDigest, METH_VARARGS, NULL },
+	{ "summary_gdsn", (PyCFunction)gdsnSummary, METH_VARARGS, NULL },
 	{ "writeall_gdsn", (PyCFunction)gdsnWriteAll, METH_VARARGS, NULL },
 	{ "write_gdsn", (PyCFunction)gdsnWrite, METH_VARARGS, NULL },
 	{ "append_gdsn", (PyCFunction)gdsnAppend, METH_VARARGS, NULL },
@@ -1722,6 +3743,8 @@ static PyMethodDef module_methods[] = {
 	{ "addfile_gdsn", (PyCFunction)gdsnAddFile, METH_VARARGS, NULL },
 	{ "getfile_gdsn", (PyCFunction)gdsnGetFile, METH_VARARGS, NULL },
 	{ "diagnosis_gds", (PyCFunction)gdsDiagnosis, METH_VARARGS, NULL },
+	{ "verify_gds", (PyCFunction)gdsVerify, METH_VARARGS, NULL },
+	{ "recompress_gds", (PyCFunction)gdsRecompress, METH_VARARGS, NULL },
 
 	// attribute operations
 	{ "getattr_gdsn", (PyCFunction)gdsnGetAttr, METH_VARARGS, NULL },
@@ -1737,13 +3760,21 @@ static PyMethodDef module_methods[] = {
 
 #if PY_MAJOR_VERSION >= 3
 
+/// join the worker threads when the module is unloaded
+static void pygds_free(void *mod)
+{
+	CdRA_Read::ShutdownPool();
+}
+
 static struct PyModuleDef ModStruct =
 {
 	PyModuleDef_HEAD_INIT,
 	"pygds.ccall",  // name of module
 	"C functions for data manipulation",  // module documentation
 	-1,  // size of per-interpreter state of the module, or -1 if the module keeps state in global variables
-	module_methods
+	module_methods,
+	NULL, NULL, NULL,
+	pygds_free  // called when the module is freed
 };
 
 PyMODINIT_FUNC PyInit_ccall()
@@ -4,11 +4,13 @@ Run directly (``python tests/test_pygds.py``) or under pytest.
 Covers: open/read of the bundled example, create/write/read round-trips for
 all common numeric types and string data, every compressor (ZIP / LZMA / LZ4
 and their _RA variants), multi-dimensional arrays, sub-region writes, append,
-folders, attributes, setdim, exist and delete.
+folders, attributes, setdim, exist and delete, and concurrent reads from
+Python threads.
 """
 
 import os
 import tempfile
+import warnings
 
 import numpy as np
 
@@ -48,12 +50,16 @@ def test_numeric_types():
 		'i64': np.arange(5, dtype=np.int64) * 10_000_000_000,
 		'f32': (np.arange(20, dtype=np.float32) / 7),
 		'f64': np.linspace(-1, 1, 333),
+		'i32r': np.random.default_rng(0).integers(-2**31, 2**31, 9999,
+			dtype=np.int32),
 	}
 	f = pygds.gdsfile(); f.create(fn)
 	try:
 		r = f.root()
 		for nm, v in cases.items():
 			r.add(nm, v)
+			# the delta filter is ignored for floating-point numbers
+			r.add(nm + '_delta', v, compress='ZIP_RA.delta.shuffle')
 	finally:
 		f.close()
 
@@ -63,6 +69,10 @@ def test_numeric_types():
 		for nm, v in cases.items():
 			got = r.index(nm).read()
 			assert np.array_equal(got, v), (nm, got[:5], v[:5])
+			got = r.index(nm + '_delta').read()
+			assert np.array_equal(got, v), (nm, got[:5], v[:5])
+		assert r.index('f64_delta').description()['compress'].startswith(
+			'ZIP_RA.def.shuffle')
 	finally:
 		f.close()
 
@@ -70,21 +80,166 @@ def test_numeric_types():
 def test_compressors():
 	fn = os.path.join(tempfile.mkdtemp(), 'comp.gds')
 	data = np.tile(np.arange(2000, dtype=np.int32), 3)  # compressible
-	methods = ['', 'ZIP', 'ZIP_RA', 'LZMA', 'LZMA_RA', 'LZ4', 'LZ4_RA']
+	methods = ['', 'ZIP', 'ZIP_RA', 'LZMA', 'LZMA_RA', 'LZ4', 'LZ4_RA',
+		'ZSTD', 'ZSTD_RA', 'ZIP.shuffle', 'LZ4_RA.bitshuffle', 'LZ4_RA.delta']
 	f = pygds.gdsfile(); f.create(fn)
 	try:
 		r = f.root()
 		for m in methods:
 			r.add('c_' + (m or 'none'), data, compress=m)
+		# several small blocks for read-ahead
+		big = np.random.default_rng(0).integers(0, 50, 200000).astype(np.int32)
+		ra = ['ZIP_RA:16K', 'LZMA_RA:16K', 'LZ4_RA:16K', 'LZ4_RA.min:16K',
+			'ZSTD_RA:16K', 'ZSTD_RA.max:16K', 'LZ4_RA.shuffle:16K',
+			'ZIP_RA.bitshuffle:16K', 'ZIP_RA.delta.shuffle:16K',
+			'LZ4_RA.dict:16K', 'ZIP_RA.max.dict:16K']
+		for i, m in enumerate(ra):
+			r.add('ra%d' % i, big, compress=m)
+		r.add('mat', big.reshape(400, 500), compress='ZIP_RA:16K')
+		# zero-length data through each filter
+		empty = ['ZIP.shuffle', 'ZIP_RA.shuffle', 'LZ4_RA.bitshuffle',
+			'LZMA_RA.shuffle', 'ZSTD_RA.delta', 'LZ4.delta.bitshuffle']
+		for i, m in enumerate(empty):
+			r.add('e%d' % i, np.zeros(0, np.int32), compress=m)
 	finally:
 		f.close()
 
 	f = pygds.gdsfile(); f.open(fn)
+	old = pygds.set_read_ahead(2, 3)
 	try:
+		pygds.set_read_ahead(blocks=4)
+		assert pygds.set_read_ahead() == (2, 4)
 		r = f.root()
+		for i, m in enumerate(empty):
+			assert len(r.index('e%d' % i).read()) == 0, m
 		for m in methods:
 			got = r.index('c_' + (m or 'none')).read()
 			assert np.array_equal(got, data), m
+		desc = r.index('c_LZ4_RA.bitshuffle').description()
+		assert desc['compress'].startswith('LZ4_RA.hc.bitshuffle')
+		for i, m in enumerate(ra):
+			n = r.index('ra%d' % i)
+			assert np.array_equal(n.read(), big), m
+			for st in (150000, 3, 70000):  # seek backward and forward
+				v = n.read([st], [30000 if st < 150000 else 50000])
+				assert np.array_equal(v, big[st:st+len(v)]), m
+			assert np.array_equal(n.readex([slice(1, None, 5)]), big[1::5]), m
+	finally:
+		pygds.set_read_ahead(*old)
+		f.close()
+
+	# column-wise reads with the decoded block cache
+	mat = big.reshape(400, 500)
+	old = pygds.set_block_cache(1 << 22)
+	pygds.block_cache_info(reset=True)
+	f = pygds.gdsfile(); f.open(fn)
+	try:
+		n = f.root().index('mat')
+		for j in (0, 7, 499, 7):
+			assert np.array_equal(n[:, j], mat[:, j])
+		assert np.array_equal(n.read(), mat)
+		st = pygds.block_cache_info()
+		assert st['hits'] > 0 and 0 < st['size'] <= (1 << 22)
+	finally:
+		f.close()
+		pygds.set_block_cache(old)
+	assert pygds.block_cache_info()['blocks'] == 0
+
+	# LZ4_RA blocks decoded into the destination, mixed with partial reads
+	f = pygds.gdsfile(); f.open(fn)
+	try:
+		for i in (2, 3):
+			n = f.root().index('ra%d' % i)
+			assert np.array_equal(n.read([5], [10]), big[5:15])
+			assert np.array_equal(n.read([15], [150000]), big[15:150015])
+			assert np.array_equal(n.read(), big)
+	finally:
+		f.close()
+
+	# parallel compression, the same bytes as serial compression
+	pm = ra + ['LZ4_RA.fast:16K', 'LZMA']
+	fns = []
+	old = pygds.set_parallel_compress()
+	old_xz = pygds.set_lzma_threads()
+	try:
+		for nt in (0, 1, 3):
+			pygds.set_parallel_compress(nt)
+			pygds.set_lzma_threads(max(nt, 1) + 1, 1 << 16)
+			fns.append(os.path.join(tempfile.mkdtemp(), 'par.gds'))
+			f = pygds.gdsfile(); f.create(fns[-1])
+			try:
+				for i, m in enumerate(pm):
+					f.root().add('p%d' % i, big, compress=m)
+			finally:
+				f.close()
+	finally:
+		pygds.set_parallel_compress(old)
+		pygds.set_lzma_threads(*old_xz)
+	for fn in fns[1:]:
+		with open(fns[0], 'rb') as a, open(fn, 'rb') as b:
+			assert a.read() == b.read()
+	f = pygds.gdsfile(); f.open(fns[-1])
+	try:
+		for i, m in enumerate(pm):
+			n = f.root().index('p%d' % i)
+			assert np.array_equal(n.read(), big), m
+			v = n.read([70000], [30000])
+			assert np.array_equal(v, big[70000:100000]), m
+	finally:
+		f.close()
+
+	# checksums of blocks, verified with and without decoding the nodes
+	fn = os.path.join(tempfile.mkdtemp(), 'sum.gds')
+	old = pygds.set_checksum(True)
+	try:
+		f = pygds.gdsfile(); f.create(fn)
+		try:
+			for i, m in enumerate(ra + ['ZIP']):
+				f.root().add('s%d' % i, big, compress=m)
+			# a node being written is skipped and can still be appended
+			w = f.root().add('w', big[:10], compress='ZIP_RA', closezip=False)
+			v = f.verify()
+			assert v['skipped'] == 1 and v['nodes'] == len(ra) + 1
+			w.append(big[10:20]); w.readmode()
+			assert np.array_equal(w.read(), big[:20])
+			w.delete()
+		finally:
+			f.close()
+	finally:
+		pygds.set_checksum(*old)
+	f = pygds.gdsfile(); f.open(fn)
+	try:
+		v = f.verify(threads=3)
+		assert v['nodes'] == len(ra) + 1 and not v['errors']
+		assert v['checksums'] == v['blocks'] - 1 > len(ra)
+		old = pygds.set_checksum(verify=True)
+		try:
+			for i, m in enumerate(ra):
+				n = f.root().index('s%d' % i)
+				assert np.array_equal(n.read([70000], [30000]),
+					big[70000:100000]), m
+		finally:
+			pygds.set_checksum(*old)
+	finally:
+		f.close()
+	with open(fn, 'r+b') as fh:  # corrupt a block of the first node
+		fh.seek(os.path.getsize(fn) // (3 * len(ra)))
+		b = fh.read(1)
+		fh.seek(-1, 1)
+		fh.write(bytes([b[0] ^ 0x10]))
+	f = pygds.gdsfile(); f.open(fn)
+	try:
+		v = f.verify(threads=2)
+		assert [e[0] for e in v['errors']] == ['s0']
+		old = pygds.set_checksum(verify=True)
+		try:
+			try:
+				f.root().index('s0').read()
+				assert False, 'corruption not detected'
+			except OSError:
+				pass
+		finally:
+			pygds.set_checksum(*old)
 	finally:
 		f.close()
 
@@ -109,6 +264,16 @@ def test_multidim_and_subregion():
 		assert cube.shape == (2, 3, 4) and np.array_equal(cube, a)
 		mat = r.index('mat').read()
 		assert mat[1, 1] == 7 and mat[1, 2] == 7 and mat[0, 0] == 0
+		# integer indices, slices and bool vectors (orthogonal indexing)
+		c = r.index('cube')
+		assert np.array_equal(c.readex([None, np.array([0, 2]), slice(1, 4, 2)]),
+			a[:, [0, 2]][:, :, 1:4:2])
+		assert np.array_equal(c.readex([[1, 0], None, [3, 3, 0]]),
+			a[[1, 0]][:, :, [3, 3, 0]])
+		assert np.array_equal(c[1, ::-1, [True, False, True, False]],
+			a[1, ::-1][:, [0, 2]])
+		assert np.array_equal(c[..., -1], a[..., -1]) and c[1, 2, 3] == 23
+		assert c[:, [], 1:3].shape == (2, 0, 2)
 	finally:
 		f.close()
 
@@ -122,6 +287,21 @@ def test_strings_and_append():
 		n = r.add('grow', np.arange(3, dtype=np.int32))
 		n.append(np.arange(3, 6, dtype=np.int32))
 		n.append(np.arange(6, 9, dtype=np.int32))
+		r.add('u', ['x', '', 'h\u00e9llo', '\u4e2d\u6587'], storage='string')
+		fac = r.add('fac', np.array([1, 2, 0, 2], dtype=np.int32))
+		fac.putattr('R.class', 'factor')
+		fac.putattr('R.levels', ['A', 'BB'])
+		# small blocks primed with a dictionary
+		rng = np.random.default_rng(1)
+		keys = ['AC', 'AN', 'AF', 'DP', 'MQ', 'QD', 'FS', 'SOR']
+		ann = [';'.join('%s=%d' % (k, rng.integers(1000)) for k in
+			rng.choice(keys, 4, replace=False)) for _ in range(40000)]
+		for m in ('LZ4_RA:16K', 'LZ4_RA.dict:16K', 'ZIP_RA:16K',
+				'ZIP_RA.dict:16K'):
+			r.add(m, ann, compress=m)
+		r.add('small', ann[:10], compress='LZ4_RA.dict:16K')
+		r.add('recomp', ann, compress='LZ4_RA.dict:16K').compression(
+			'ZIP_RA.dict:16K')
 	finally:
 		f.close()
 
@@ -130,6 +310,45 @@ def test_strings_and_append():
 		r = f.root()
 		assert list(r.index('s').read()) == ['alpha', 'beta', 'gamma']
 		assert list(r.index('grow').read()) == list(range(9))
+		# fixed-width string reads
+		s = r.index('s')
+		v = s.read(cvt='S')
+		assert v.dtype == np.dtype('S5') and list(v) == [b'alpha', b'beta', b'gamma']
+		u = r.index('u')
+		v = u.read(cvt='U')
+		assert v.dtype == np.dtype('U5') and list(v) == list(u.read())
+		assert u.read(cvt='S').dtype == np.dtype('S6')
+		assert list(s.readex([[2, 0]], cvt='U')) == ['gamma', 'alpha']
+		out = np.zeros(3, dtype='U8')
+		assert s.read(cvt='U', out=out) is out and out[1] == 'beta'
+		assert list(r.index('fac').read(cvt='U')) == ['A', 'BB', '', 'BB']
+		# factor codes and levels
+		codes, levels = r.index('fac').read(cvt='codes')
+		assert codes.dtype == np.int32 and list(codes) == [1, 2, 0, 2]
+		assert levels == ['A', 'BB']
+		codes, _ = r.index('fac').readex([[3, 0]], cvt='codes')
+		assert list(codes) == [2, 1]
+		try:
+			import pandas
+		except ImportError:
+			pandas = None
+		if pandas is not None:
+			c = r.index('fac').read_categorical()
+			assert list(c.codes) == [0, 1, -1, 1]
+		if hasattr(np, 'dtypes') and hasattr(np.dtypes, 'StringDType'):
+			v = u.read(cvt='T')
+			assert isinstance(v.dtype, np.dtypes.StringDType)
+			assert list(v) == list(u.read())
+		# dictionaries, including the dictionary stream in the node size
+		for m in ('LZ4_RA', 'ZIP_RA', 'recomp'):
+			n = r.index(m + '.dict:16K' if m != 'recomp' else m)
+			assert list(n.read()) == ann, m
+			assert list(n.read([30000], [5])) == ann[30000:30005], m
+			assert n.description()['compress'].endswith('.dict:16K'), m
+			if m != 'recomp':
+				assert n.description()['size'] < \
+					r.index(m + ':16K').description()['size'], m
+		assert list(r.index('small').read()) == ann[:10]
 	finally:
 		f.close()
 
@@ -149,7 +368,47 @@ def test_folders_attrs_exist_delete():
 		n.putattr('drop', 'gone')
 		n.delattr('drop')
 		r.add('tmp', np.arange(3, dtype=np.int32))
-		r.index('tmp').delete()
+		t = r.index('tmp'); old_idx = t.idx
+		t.delete()
+		# the freed handle slot is reused with a new generation
+		t2 = r.add('tmp2', np.arange(3, dtype=np.int32))
+		assert (t2.idx & 0xFFFFFF) == (old_idx & 0xFFFFFF) and t2.idx != old_idx
+		stale = pygds.gdsnode(); stale.idx, stale.pid = old_idx, t2.pid
+		# deleting a folder invalidates the handles of its children
+		d = r.addfolder('sub'); dx = d.add('x', np.arange(2, dtype=np.int32))
+		d.delete(force=True)
+		# closing another file keeps the handles of this file
+		f2 = pygds.gdsfile(); f2.create(fn + '.2')
+		f2.root().add('z', 1); f2.close()
+		assert list(t2.read()) == [0, 1, 2]
+		# an unloaded node is reloaded through its folder
+		u = r.add('tmp3', np.arange(3, dtype=np.int32)); u.unload()
+		assert list(r.index('tmp3').read()) == [0, 1, 2]
+		for v in (stale, dx, u):
+			try:
+				v.read()
+				assert False, 'expected an invalid node handle'
+			except RuntimeError:
+				pass
+		t2.delete(); r.index('tmp3').delete()
+		# name lookups stay consistent through rename, move and delete
+		big = r.addfolder('big')
+		for i in range(2000):
+			big.add('v%d' % i, i)
+		big.index('v10').rename('w10')
+		big.index('v20').moveto(big.index('v0'), 'before')
+		big.index('v30').delete()
+		assert big.exist('w10') and not big.exist('v10')
+		assert not big.exist('v30') and big.ls()[0] == 'v20'
+		assert big.index('v1999').read() == 1999
+		assert big.index('v20').name() == 'v20'
+		big.index('v40').moveto(big.index('v1990'), 'after')
+		big.index('v50').delete()
+		# every name maps to its own node after the shifts
+		names = big.ls()
+		assert names.index('v40') == names.index('v1990') + 1
+		for nm in names:
+			assert big.index(nm).read() == int(nm[1:])
 	finally:
 		f.close()
 
@@ -162,6 +421,22 @@ def test_folders_attrs_exist_delete():
 		assert at['unit'] == 'm' and at['k'] == 7 and at['flag'] is True
 		assert at['vec'] == [1, 2, 3] and 'drop' not in at
 		assert r.index('tmp', silent=True) is None
+		big = r.index('big')
+		assert len(big.ls()) == 1998 and big.index('w10').read() == 10
+	finally:
+		f.close()
+
+	# a file with duplicated names: renaming the first keeps the second
+	f = pygds.gdsfile(); f.create(fn)
+	f.root().add('dupA', 1); f.root().add('dupB', 2); f.close()
+	with open(fn, 'rb') as fh: b = fh.read()
+	with open(fn, 'wb') as fh: fh.write(b.replace(b'dupB', b'dupA'))
+	f = pygds.gdsfile(); f.open(fn, readonly=False)
+	try:
+		r = f.root()
+		assert r.ls() == ['dupA', 'dupA']
+		r.index('dupA').rename('dupC')
+		assert r.index('dupA').read() == 2 and r.index('dupC').read() == 1
 	finally:
 		f.close()
 
@@ -169,10 +444,13 @@ def test_folders_attrs_exist_delete():
 def test_apply():
 	fn = os.path.join(tempfile.mkdtemp(), 'apply.gds')
 	mat = np.arange(24, dtype=np.int32).reshape(4, 6)  # 4 rows x 6 cols
+	arr3 = np.arange(3*5*7, dtype=np.float64).reshape(3, 5, 7)
 	f = pygds.gdsfile(); f.create(fn)
 	try:
 		f.root().add('m', mat)
 		f.root().add('v', np.arange(4, dtype=np.int32))
+		f.root().add('a3', arr3, compress='LZ4_RA')
+		f.root().add('s', ['a', 'bb', 'ccc', 'dd'])
 	finally:
 		f.close()
 
@@ -193,17 +471,60 @@ def test_apply():
 		out = pygds.apply_gdsn([m, v], [0, 0],
 			lambda row, sv: int(row.sum()) + int(sv), as_is='list')
 		assert out == [int(mat[i].sum()) + i for i in range(4)], out
+		# middle margin of a 3-D array, and strings
+		a3 = f.root().index('a3')
+		rs = a3.apply(1, lambda x: x.copy(), as_is='list')
+		assert all(np.array_equal(rs[j], arr3[:, j, :]) for j in range(5))
+		ss = f.root().index('s').apply(0, lambda x: str(x[()]), as_is='list')
+		assert ss == ['a', 'bb', 'ccc', 'dd'], ss
+		try:
+			pygds.apply_gdsn([m, a3], [0, 0], lambda x, y: None)
+			assert False, 'expected a margin length mismatch'
+		except ValueError:
+			pass
+		# chunks with prefetching, a shorter last chunk, and the fallback
+		for ax, sz, k in ((0, 2, 1), (1, 2, 3), (2, 3, 2), (1, 5, 1)):
+			cs = [x.copy() for x in a3.iter_chunks(ax, sz, prefetch=k)]
+			assert len(cs) == (arr3.shape[ax] + sz - 1) // sz
+			assert np.array_equal(np.concatenate(cs, axis=ax), arr3), (ax, sz)
+		cs = list(m.iter_chunks(1, 4, prefetch=0, cvt='float64'))
+		assert cs[1].dtype == np.float64 and np.array_equal(cs[1], mat[:, 4:])
+		cs = list(f.root().index('s').iter_chunks(0, 3))
+		assert [list(x) for x in cs] == [['a', 'bb', 'ccc'], ['dd']], cs
+		# unloading the node stops its chunk iterators
+		it = m.iter_chunks(0, 1, prefetch=2)
+		next(it); m.unload()
+		try:
+			next(it)
+			assert False, 'expected an error after unloading the node'
+		except RuntimeError:
+			pass
+		it = a3.iter_chunks(0, 1, prefetch=2)
+		next(it)
 	finally:
 		f.close()
+	try:
+		next(it)
+		assert False, 'expected an error after closing the file'
+	except RuntimeError:
+		pass
 
 
 def test_digest_summarize_diagnosis():
 	import hashlib
 	fn = os.path.join(tempfile.mkdtemp(), 'dig.gds')
 	v = np.arange(1000, dtype=np.int32)
+	big = np.arange(3000000, dtype=np.int64) % 1013  # several stream blocks
+	strs = ['x', 'yy', '', 'zzz']
 	f = pygds.gdsfile(); f.create(fn)
 	try:
 		f.root().add('v', v, compress='LZMA_RA')
+		f.root().add('v2', v, compress='ZIP_RA')
+		f.root().add('big', big, compress='LZ4_RA')
+		f.root().add('bf', big / 7.0)
+		f.root().add('s', strs)
+		f.root().add('e', np.zeros(0, dtype=np.int32))
+		f.root().add('r', np.array([1.0, np.nan, -1.5, np.inf, 2.5]))
 	finally:
 		f.close()
 
@@ -213,9 +534,31 @@ def test_digest_summarize_diagnosis():
 		md5 = n.digest('md5')
 		assert md5 == hashlib.md5(v.tobytes()).hexdigest()
 		assert n.digest('sha256') == hashlib.sha256(v.tobytes()).hexdigest()
+		b = f.root().index('big')
+		assert b.digest('sha1') == hashlib.sha1(big.tobytes()).hexdigest()
+		assert f.root().index('s').digest('md5') == \
+			hashlib.md5(''.join(strs).encode('utf-8')).hexdigest()
+		# xxh64 depends on the data only, not on the compression method
+		x = n.digest('xxh64')
+		assert len(x) == 16 and x == f.root().index('v2').digest('xxh64')
+		assert x != b.digest('xxh64')
+		assert f.root().index('e').digest('xxh64') == 'ef46db3751d8e999'
 		s = n.summarize()
 		assert s['min'] == 0 and s['max'] == 999 and s['n'] == 1000
 		assert abs(s['mean'] - 499.5) < 1e-9
+		s = b.summarize(threads=3)
+		assert s['min'] == 0 and s['max'] == 1012 and s['n'] == big.size
+		assert abs(s['mean'] - big.mean()) < 1e-9
+		# the threads read disjoint ranges with their own decoders
+		assert s == b.summarize(threads=1)
+		bf = f.root().index('bf')
+		s = bf.summarize(threads=4)
+		assert s['n'] == big.size and s['max'] == 1012 / 7.0
+		assert abs(s['mean'] - (big / 7.0).mean()) < 1e-9
+		assert s['min'] == bf.summarize(threads=1)['min'] == 0
+		assert f.root().index('s').summarize() == {'n': 4}
+		s = f.root().index('r').summarize(threads=2)
+		assert s['num_na'] == 2 and s['min'] == -1.5 and s['max'] == 2.5
 		diag = f.diagnosis()
 		assert diag['num_fragment'] >= 1 and diag['size'] > 0
 	finally:
@@ -245,6 +588,11 @@ def test_moveto_copyto_assign_addfile():
 		r.index('a').moveto(r.index('b'), 'before')
 		# embed external file, then extract it
 		r.addfile('payload', ext, compress='ZIP')
+		r.add('s', ['x', 'yy', 'zzz'], compress='ZIP')
+		g = r.addfolder('g')
+		g.putattr('k', 1)
+		g.add('m', np.arange(60000.0).reshape(300, 200), compress='ZIP')
+		g.add('v', np.arange(100000, dtype=np.int16), compress='ZIP')
 	finally:
 		f.close()
 
@@ -257,8 +605,190 @@ def test_moveto_copyto_assign_addfile():
 		r.index('payload').getfile(out)
 		with open(out, 'rb') as fh:
 			assert fh.read() == payload
+		# recompress all nodes except 'g/v' to a new file
+		fn2 = os.path.join(d, 'rc.gds')
+		n = f.recompress(fn2, 'LZ4_RA', threads=3,
+			filter=lambda v: v.name(True) != 'g/v')
+		assert n == 7
+		# a link to the source file is not overwritten
+		ln = os.path.join(d, 'link.gds')
+		os.symlink(fn, ln)
+		size = os.path.getsize(fn)
+		try:
+			f.recompress(ln, 'LZ4_RA')
+			assert False, 'expected an error for the source file'
+		except ValueError:
+			pass
+		assert os.path.getsize(fn) == size
+	finally:
+		f.close()
+	# a filter mode on the example, which has empty integer nodes
+	f = pygds.gdsfile(); f.open(pygds.get_example_path('ceu_exon.gds'))
+	try:
+		fn3 = os.path.join(d, 'rc_shuffle.gds')
+		f.recompress(fn3, 'LZ4_RA.shuffle', threads=2)
+		geno = f.root().index('genotype/data').read()
+	finally:
+		f.close()
+	f = pygds.gdsfile(); f.open(fn3)
+	try:
+		assert np.array_equal(f.root().index('genotype/data').read(), geno)
+		assert f.verify()['errors'] == []
+	finally:
+		f.close()
+	f = pygds.gdsfile(); f.open(fn2)
+	try:
+		r = f.root()
+		assert r.ls() == ['a', 'b', 'a_copy', 'c', 'payload', 's', 'g']
+		assert list(r.index('c').read()) == [3, 4, 5]
+		assert list(r.index('s').read()) == ['x', 'yy', 'zzz']
+		assert r.index('s').description()['encoder'] == 'LZ4_ra'
+		g = r.index('g')
+		assert g.getattr() == {'k': 1}
+		assert np.array_equal(g.index('m').read(),
+			np.arange(60000.0).reshape(300, 200))
+		assert g.index('m').description()['encoder'] == 'LZ4_ra'
+		assert g.index('v').description()['encoder'] == 'ZIP'
+		assert np.array_equal(g.index('v').read(),
+			np.arange(100000, dtype=np.int16))
+		out = os.path.join(d, 'out2.bin')
+		r.index('payload').getfile(out)
+		with open(out, 'rb') as fh:
+			assert fh.read() == payload
+		assert f.verify()['errors'] == []
+	finally:
+		f.close()
+	# a node being written is not copied, and can still be appended
+	fn4 = os.path.join(d, 'rc_w.gds')
+	f = pygds.gdsfile(); f.create(os.path.join(d, 'w.gds'))
+	try:
+		w = f.root().add('w', np.arange(10), compress='ZIP_RA', closezip=False)
+		u = f.root().add('u', np.arange(10))
+		with warnings.catch_warnings(record=True) as wl:
+			warnings.simplefilter('always')
+			assert f.recompress(fn4, 'LZ4_RA') == 1
+		assert len(wl) == 1 and 'w' in str(wl[0].message)
+		w.append(np.arange(10, 20))
+		u.append(np.arange(10, 20))
+		w.readmode()
+		assert np.array_equal(w.read(), np.arange(20))
+		assert np.array_equal(u.read(), np.arange(20))
 	finally:
 		f.close()
+	f = pygds.gdsfile(); f.open(fn4)
+	try:
+		assert f.root().ls() == ['u']
+		assert np.array_equal(f.root().index('u').read(), np.arange(10))
+	finally:
+		f.close()
+
+
+def test_read_out():
+	fn = os.path.join(tempfile.mkdtemp(), 'out.gds')
+	mat = np.arange(60, dtype=np.int32).reshape(6, 10)
+	raw = np.random.default_rng(2).integers(0, 1000, (20, 5000)).astype(np.int32)
+	f = pygds.gdsfile(); f.create(fn)
+	try:
+		f.root().add('m', mat, compress='ZIP_RA')
+		f.root().add('u', raw)
+	finally:
+		f.close()
+
+	f = pygds.gdsfile(); f.open(fn)
+	try:
+		m = f.root().index('m')
+		# decode into a view of a larger preallocated array
+		big = np.full((10, 10), -1, dtype=np.int32)
+		rv = m.read([2, 0], [3, -1], out=big[4:7])
+		assert np.shares_memory(rv, big)
+		assert np.array_equal(big[4:7], mat[2:5]) and (big[:4] == -1).all()
+		sel = [np.array([True, False] * 3), None]
+		buf = np.empty((3, 10), dtype=np.int32)
+		m.readex(sel, out=buf)
+		assert np.array_equal(buf, mat[::2])
+		# factor levels into an object array
+		filt = pygds.gdsfile(); filt.open(pygds.get_example_path('ceu_exon.gds'))
+		try:
+			n = filt.root().index('annotation/filter')
+			o = np.empty(1348, dtype=object)
+			n.read(out=o)
+			assert list(o) == list(n.read())
+		finally:
+			filt.close()
+		# invalid dtype, shape or layout
+		for bad in (np.empty((3, 10), dtype=np.int64),
+				np.empty((3, 9), dtype=np.int32),
+				np.empty((10, 3), dtype=np.int32).T):
+			try:
+				m.read([2, 0], [3, -1], out=bad)
+				assert False, 'should fail'
+			except RuntimeError:
+				pass
+	finally:
+		f.close()
+
+	# read-only files with and without memory mapping
+	old = pygds.set_mmap()
+	assert old is False  # opt-in
+	try:
+		for mm in (False, True):
+			pygds.set_mmap(mm)
+			f = pygds.gdsfile(); f.open(fn)
+			try:
+				u = f.root().index('u')
+				assert np.array_equal(u.read(), raw)
+				assert np.array_equal(u.read([3, 100], [2, 500]),
+					raw[3:5, 100:600])
+				assert np.array_equal(f.root().index('m').read(), mat)
+			finally:
+				f.close()
+	finally:
+		pygds.set_mmap(old)
+
+
+def test_threaded_read():
+	from concurrent.futures import ThreadPoolExecutor
+	d = tempfile.mkdtemp()
+	data = np.arange(200000, dtype=np.int32) % 977
+	fns = [os.path.join(d, 't%d.gds' % i) for i in range(2)]
+	for fn in fns:
+		f = pygds.gdsfile(); f.create(fn)
+		try:
+			f.root().add('a', data, compress='ZIP_RA')
+			f.root().add('b', data[::-1].copy(), compress='LZ4_RA')
+			f.root().add('s', ['x', 'yy', 'zzz'])
+		finally:
+			f.close()
+
+	files = [pygds.gdsfile() for fn in fns]
+	for f, fn in zip(files, fns):
+		f.open(fn)
+	try:
+		nodes = [(f.root().index(nm), nm) for f in files for nm in ('a', 'b')]
+		def work(k):
+			n, nm = nodes[k % len(nodes)]
+			st = (k * 7919) % 150000
+			v = n.read([st], [1000])
+			ref = data if nm == 'a' else data[::-1]
+			return np.array_equal(v, ref[st:st+1000])
+		with ThreadPoolExecutor(max_workers=4) as ex:
+			assert all(ex.map(work, range(64)))
+		# batched reads across files, numeric and string nodes
+		a0, b0, a1 = nodes[0][0], nodes[1][0], nodes[2][0]
+		s1 = files[1].root().index('s')
+		rs = files[0].read_many([(b0, [10], [5]), a1, s1, (a0, [7], [-1])],
+			threads=2)
+		assert np.array_equal(rs[0], data[::-1][10:15])
+		assert np.array_equal(rs[1], data) and list(rs[2]) == ['x', 'yy', 'zzz']
+		assert np.array_equal(rs[3], data[7:])
+		try:
+			files[0].read_many([(a0, [0], [200001])])
+			assert False, 'expected an invalid count'
+		except RuntimeError:
+			pass
+	finally:
+		for f in files:
+			f.close()
 
 
 def _run_all():